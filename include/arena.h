@@ -0,0 +1,58 @@
+//
+//  include/arena.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdint.h>
+#include "notnull.h"
+
+/*
+ * An arena hands out memory from large chunks by bumping a pointer, so that
+ * many small allocations, which are all freed together, don't each have to go
+ * through malloc() and free().
+ */
+
+struct arena_chunk {
+    struct arena_chunk *next;
+};
+
+struct arena {
+    /*
+     * The first chunk is the chunk currently being allocated from.
+     */
+
+    struct arena_chunk *chunks;
+
+    uint8_t *ptr;
+    uint8_t *end;
+};
+
+void *arena_alloc(struct arena *__notnull arena, uint64_t size);
+
+char *
+arena_alloc_and_copy(struct arena *__notnull arena,
+                     const char *__notnull string,
+                     uint64_t length);
+
+/*
+ * Move all of src's chunks to dst, leaving src empty. Memory allocated from
+ * src remains valid until dst is reset or destroyed.
+ */
+
+void arena_move(struct arena *__notnull dst, struct arena *__notnull src);
+
+/*
+ * Free all memory allocated from arena at once. Only the current chunk is
+ * kept, to be reused for the next allocations.
+ */
+
+void arena_reset(struct arena *__notnull arena);
+void arena_destroy(struct arena *__notnull arena);
+
+#endif /* ARENA_H */
@@ -30,6 +30,22 @@ enum bit_list_result
 bit_list_create_with_capacity(struct bit_list *__notnull list,
                               uint64_t capacity);
 
+/*
+ * Get the size of the buffer needed for a bit-list of the provided capacity,
+ * which is zero if the bits can be held on the stack.
+ */
+
+uint64_t bit_list_get_buffer_size_for_capacity(uint64_t capacity);
+
+/*
+ * Create a bit-list with its bits stored in buffer, which must be zeroed. The
+ * bit-list does not own buffer, and must not be destroyed.
+ */
+
+void
+bit_list_create_with_buffer(struct bit_list *__notnull list,
+                            uint64_t *__notnull buffer);
+
 uint64_t bit_list_find_first_bit(struct bit_list list);
 uint64_t bit_list_find_bit_after_last(struct bit_list list, uint64_t last);
 
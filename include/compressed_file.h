@@ -0,0 +1,51 @@
+//
+//  include/compressed_file.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef COMPRESSED_FILE_H
+#define COMPRESSED_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "notnull.h"
+
+enum compressed_file_format {
+    COMPRESSED_FILE_FORMAT_GZIP,
+    COMPRESSED_FILE_FORMAT_ZSTD
+};
+
+/*
+ * zstd support is only built in when TBD_WITH_ZSTD is defined, and libzstd is
+ * linked in.
+ */
+
+bool compressed_file_format_is_supported(enum compressed_file_format format);
+
+/*
+ * Open a stream that compresses everything written to it, in blocks of bounded
+ * size, and writes the compressed data out to file.
+ *
+ * With a threads_count greater than one, blocks are compressed concurrently on
+ * up to threads_count threads. gzip blocks are written out as separate gzip
+ * members, which gzip decompresses as one stream.
+ *
+ * Closing the returned stream finishes the compressed data, and closes file if
+ * close_file is true. Errors writing out compressed data may only be returned
+ * once the stream is closed.
+ *
+ * Returns NULL on failure, or if format isn't supported.
+ */
+
+FILE *
+compressed_file_open(FILE *__notnull file,
+                     enum compressed_file_format format,
+                     uint32_t threads_count,
+                     bool close_file);
+
+#endif /* COMPRESSED_FILE_H */
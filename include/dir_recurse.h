@@ -71,4 +71,37 @@ dir_recurse_with_subdirs(
     __notnull const dir_recurse_callback callback,
     __notnull const dir_recurse_fail_callback fail_callback);
 
+/*
+ * Return whether a file, given the head of its data, should be passed on to
+ * callback.
+ */
+
+typedef bool
+(*dir_recurse_filter)(const uint8_t *__notnull head,
+                      uint64_t head_size,
+                      void *info);
+
+/*
+ * Recurse like dir_recurse_with_subdirs(), but list directories on
+ * thread_count worker threads.
+ *
+ * callback and fail_callback are still called on the calling thread, in the
+ * same order as dir_recurse_with_subdirs().
+ *
+ * Where possible, the files of each directory are opened, and their heads
+ * read, in batches, with any file rejected by filter, if provided, closed
+ * without callback being called.
+ */
+
+enum dir_recurse_result
+dir_recurse_with_subdirs_parallel(
+    const char *__notnull path,
+    uint64_t path_length,
+    int file_open_flags,
+    uint32_t thread_count,
+    void *callback_info,
+    dir_recurse_filter filter,
+    __notnull dir_recurse_callback callback,
+    __notnull dir_recurse_fail_callback fail_callback);
+
 #endif /* DIR_RECURSE_H */
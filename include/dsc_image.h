@@ -60,7 +60,24 @@ enum dsc_image_parse_result {
 };
 
 struct dsc_image_parse_options {
-
+    /*
+     * Drop the image's pages of the shared-cache from memory after parsing, so
+     * that memory use stays flat across the entire shared-cache.
+     *
+     * Strings are then always copied, as they would otherwise point into the
+     * dropped pages.
+     */
+
+    bool drop_pages : 1;
+
+    /*
+     * The index of the target the image's metadata and symbols are added for.
+     *
+     * This is only non-zero when the same image of several shared-caches is
+     * parsed into a single create-info, with one target for each cache.
+     */
+
+    uint64_t target_index;
 };
 
 enum dsc_image_parse_result
@@ -74,4 +91,16 @@ dsc_image_parse(struct tbd_create_info *__notnull info_in,
                 struct tbd_parse_options tbd_options,
                 struct dsc_image_parse_options options);
 
+/*
+ * Read the uuid of image from its load-commands alone, without parsing the
+ * rest of the image.
+ *
+ * Returns false if the image couldn't be read, or doesn't have a uuid.
+ */
+
+bool
+dsc_image_get_uuid(const struct dyld_shared_cache_info *__notnull dsc_info,
+                   const struct dyld_cache_image_info *__notnull image,
+                   uint8_t *__notnull uuid_out);
+
 #endif /* DSC_IMAGE_H */
@@ -42,7 +42,33 @@ enum dyld_shared_cache_parse_result {
 
     E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_RANGES,
     E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_IMAGES,
-    E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS
+    E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS,
+
+    /*
+     * The file is one of the subcaches (or the .symbols file) of a split
+     * shared-cache, rather than the main cache-file, and has no images of its
+     * own.
+     */
+
+    E_DYLD_SHARED_CACHE_PARSE_IS_SUBCACHE,
+
+    E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES,
+    E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_OPEN_FAIL,
+    E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH
+};
+
+/*
+ * One of the files of a shared-cache, with the mappings it stores.
+ */
+
+struct dyld_shared_cache_file {
+    uint8_t *map;
+    uint64_t size;
+
+    const struct dyld_cache_mapping_info *mappings;
+    uint32_t mappings_count;
+
+    struct range available_range;
 };
 
 struct dyld_shared_cache_info {
@@ -63,13 +89,29 @@ struct dyld_shared_cache_info {
     const struct arch_info *arch;
     struct range available_range;
 
+    /*
+     * The subcaches of a split shared-cache, which store the mappings of most
+     * of the images, and are mapped alongside the main cache-file.
+     */
+
+    struct dyld_shared_cache_file *subcaches;
+    uint32_t subcaches_count;
+    uint64_t subcaches_size;
+
     struct dyld_shared_cache_flags flags;
 };
 
+/*
+ * path is the path of the main cache-file, used to find the files of a split
+ * shared-cache's subcaches. If path is NULL, the subcaches are not mapped,
+ * which still allows a split shared-cache's images to be listed.
+ */
+
 enum dyld_shared_cache_parse_result
 dyld_shared_cache_parse_from_file(
     struct dyld_shared_cache_info *__notnull info_in,
     int fd,
+    const char *path,
     const char magic[16],
     struct dyld_shared_cache_parse_options options);
 
@@ -86,6 +128,18 @@ dyld_shared_cache_print_list_of_images(int fd,
                                        uint64_t start,
                                        uint64_t end);
 
+/*
+ * Drop the pages of data, which points into one of the shared-cache's files,
+ * from memory once they're no longer needed. The pages are read back in from
+ * the file if they're accessed again.
+ */
+
+void
+dyld_shared_cache_drop_pages(
+    const struct dyld_shared_cache_info *__notnull info,
+    const uint8_t *__notnull data,
+    uint64_t size);
+
 void
 dyld_shared_cache_info_destroy(struct dyld_shared_cache_info *__notnull info);
 
@@ -40,4 +40,52 @@ struct dyld_cache_image_info {
     uint32_t pad;
 };
 
+/*
+ * The header has since grown well past the fields above. As the mapping-infos
+ * always directly follow the header, a later field is only present if
+ * mappingOffset is past it.
+ */
+
+#define DYLD_CACHE_HEADER_UUID_OFFSET 0x58
+#define DYLD_CACHE_HEADER_SUBCACHES_OFFSET 0x188
+#define DYLD_CACHE_HEADER_IMAGES_OFFSET 0x1c0
+#define DYLD_CACHE_HEADER_CACHE_SUB_TYPE_OFFSET 0x1c8
+
+/*
+ * Stored at DYLD_CACHE_HEADER_SUBCACHES_OFFSET.
+ */
+
+struct dyld_cache_header_subcaches {
+    uint32_t subCacheArrayOffset;
+    uint32_t subCacheArrayCount;
+};
+
+/*
+ * Stored at DYLD_CACHE_HEADER_IMAGES_OFFSET. Once present, the original
+ * imagesOffset and imagesCount fields are left zeroed.
+ */
+
+struct dyld_cache_header_images {
+    uint32_t imagesOffset;
+    uint32_t imagesCount;
+};
+
+/*
+ * A split cache's subcaches are stored in files next to the main cache-file,
+ * named with a suffix of ".1", ".2", etc. for the first version of the
+ * subcache-array entries, which are used when the header ends before the
+ * cacheSubType field.
+ */
+
+struct dyld_subcache_entry_v1 {
+    uint8_t uuid[16];
+    uint64_t cacheVMOffset;
+};
+
+struct dyld_subcache_entry {
+    uint8_t uuid[16];
+    uint64_t cacheVMOffset;
+    char fileSuffix[32];
+};
+
 #endif /* DYLD_SHARED_CACHE_FORMAT_H */
@@ -29,6 +29,18 @@ handle_macho_file_for_main_error_callback(
     enum macho_file_parse_callback_type type,
     void *cb_info);
 
+/*
+ * Used when parsing on a job, which cannot print or request user-input. Any
+ * call stops the parse, and sets the bool pointed to by cb_info, so the file
+ * can be parsed again on the main thread.
+ */
+
+bool
+handle_macho_file_defer_error_callback(
+    struct tbd_create_info *__notnull info_in,
+    enum macho_file_parse_callback_type type,
+    void *__notnull cb_info);
+
 void
 handle_macho_file_open_result(enum macho_file_open_result result,
                               const char *__notnull dir_path,
@@ -0,0 +1,144 @@
+//
+//  include/input_manifest.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef INPUT_MANIFEST_H
+#define INPUT_MANIFEST_H
+
+#include <sys/stat.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "array.h"
+#include "notnull.h"
+
+/*
+ * An input-manifest records every input parsed into a write-path, with the
+ * file's identity and modification-time when it was parsed, so that inputs
+ * left unchanged since can be skipped without being parsed again.
+ *
+ * The manifest is stored next to the write-path, at
+ * "<write-path>.tbd-manifest".
+ */
+
+struct input_manifest_entry {
+    char *path;
+    uint64_t path_length;
+
+    /*
+     * output_path is NULL for an input that wasn't among the provided
+     * filetypes, or whose outputs can't be tracked.
+     */
+
+    char *output_path;
+    uint64_t output_path_length;
+
+    uint64_t device;
+    uint64_t inode;
+    uint64_t size;
+
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+
+    /*
+     * The fingerprint of the options the input was parsed with.
+     */
+
+    uint64_t fingerprint;
+    bool seen;
+};
+
+struct input_manifest {
+    char *path;
+    uint64_t path_length;
+
+    const char *write_path;
+    uint64_t write_path_length;
+
+    uint64_t fingerprint;
+
+    /*
+     * The entries are kept sorted by their path.
+     */
+
+    struct array entries;
+};
+
+enum input_manifest_result {
+    E_INPUT_MANIFEST_OK,
+
+    E_INPUT_MANIFEST_ALLOC_FAIL,
+    E_INPUT_MANIFEST_READ_FAIL,
+    E_INPUT_MANIFEST_WRITE_FAIL
+};
+
+/*
+ * Add string to fingerprint, starting from a fingerprint of zero.
+ */
+
+uint64_t
+input_manifest_fingerprint_add(uint64_t fingerprint,
+                               const char *__notnull string);
+
+/*
+ * Load the manifest stored for write_path, with a missing manifest, or one
+ * written in an unknown format, loaded as empty.
+ *
+ * write_path must stay valid until the manifest is destroyed.
+ */
+
+enum input_manifest_result
+input_manifest_load(struct input_manifest *__notnull manifest,
+                    const char *__notnull write_path,
+                    uint64_t write_path_length,
+                    uint64_t fingerprint);
+
+/*
+ * Return whether the input at path, with the provided stat-info, was already
+ * parsed with the same options, and is unchanged since.
+ *
+ * An input found in the manifest is marked as seen either way.
+ */
+
+bool
+input_manifest_input_unchanged(struct input_manifest *__notnull manifest,
+                               const char *__notnull path,
+                               uint64_t path_length,
+                               const struct stat *__notnull sbuf);
+
+/*
+ * Record the input at path as parsed, replacing any previous entry, whose
+ * output is removed if different from output_path.
+ */
+
+enum input_manifest_result
+input_manifest_record(struct input_manifest *__notnull manifest,
+                      const char *__notnull path,
+                      uint64_t path_length,
+                      const struct stat *__notnull sbuf,
+                      const char *output_path,
+                      uint64_t output_path_length);
+
+/*
+ * Remove the entries of inputs in the directory at dir_path that weren't seen,
+ * and no longer exist, along with their outputs.
+ *
+ * Returns the number of inputs removed.
+ */
+
+uint64_t
+input_manifest_remove_vanished(struct input_manifest *__notnull manifest,
+                               const char *__notnull dir_path,
+                               uint64_t dir_path_length);
+
+enum input_manifest_result
+input_manifest_write(const struct input_manifest *__notnull manifest);
+
+void input_manifest_destroy(struct input_manifest *__notnull manifest);
+
+#endif /* INPUT_MANIFEST_H */
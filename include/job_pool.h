@@ -0,0 +1,128 @@
+//
+//  include/job_pool.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "notnull.h"
+
+/*
+ * A job-pool runs jobs on a set of worker threads, while committing them on the
+ * thread that added them, in the order they were added.
+ *
+ * Jobs are stored in a ring of fixed size, so once the ring is full, adding a
+ * job waits for the oldest job to finish and be committed. This bounds both
+ * the memory held by finished jobs, and how far the workers can get ahead of
+ * the committing thread.
+ *
+ * The work-callback is called on a worker thread, with the worker-info of that
+ * thread, and should not print or request user-input. The commit-callback is
+ * always called on the adding thread, and should free any resources the job
+ * holds.
+ */
+
+typedef void
+(*job_pool_work_callback)(void *__notnull job, void *__notnull worker_info);
+
+typedef void
+(*job_pool_commit_callback)(void *__notnull job, void *commit_info);
+
+struct job_pool;
+struct job_pool_thread {
+    pthread_t thread;
+
+    struct job_pool *pool;
+    void *worker_info;
+};
+
+struct job_pool {
+    pthread_mutex_t lock;
+
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+
+    uint8_t *ring;
+    bool *ring_done;
+
+    uint64_t ring_count;
+    uint64_t job_size;
+
+    /*
+     * The counts below are indexes in the order jobs were added, and always
+     * satisfy: committed_count <= claimed_count <= added_count.
+     */
+
+    uint64_t added_count;
+    uint64_t claimed_count;
+    uint64_t committed_count;
+
+    struct job_pool_thread *threads;
+    uint32_t thread_count;
+
+    bool is_finished;
+
+    job_pool_work_callback work;
+    job_pool_commit_callback commit;
+
+    void *commit_info;
+};
+
+enum job_pool_result {
+    E_JOB_POOL_OK,
+    E_JOB_POOL_ALLOC_FAIL,
+    E_JOB_POOL_THREAD_CREATE_FAIL
+};
+
+/*
+ * workers should point to an array of worker_count worker-infos, each
+ * worker_info_size bytes large, with one worker-info given to each thread.
+ */
+
+enum job_pool_result
+job_pool_create(struct job_pool *__notnull pool,
+                void *__notnull workers,
+                uint64_t worker_info_size,
+                uint32_t worker_count,
+                uint64_t job_size,
+                __notnull job_pool_work_callback work,
+                __notnull job_pool_commit_callback commit,
+                void *commit_info);
+
+/*
+ * job is copied into the pool. Any jobs that have finished by the time
+ * job_pool_add() returns are committed before returning.
+ */
+
+void job_pool_add(struct job_pool *__notnull pool, const void *__notnull job);
+
+/*
+ * Wait for the oldest job that has yet to be committed to finish, then commit
+ * it, along with any jobs after it that have also finished.
+ */
+
+void job_pool_commit_oldest(struct job_pool *__notnull pool);
+
+/*
+ * Wait for all added jobs to finish and be committed, while leaving the worker
+ * threads running for any jobs added afterwards.
+ */
+
+void job_pool_commit_all(struct job_pool *__notnull pool);
+
+/*
+ * Wait for all added jobs to finish and be committed, then stop the worker
+ * threads. The worker-infos can be destroyed after this returns.
+ */
+
+void job_pool_finish_and_destroy(struct job_pool *__notnull pool);
+
+#endif /* JOB_POOL_H */
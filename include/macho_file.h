@@ -47,6 +47,27 @@ struct macho_file_parse_options {
      */
 
     bool use_symbol_table : 1;
+
+    /*
+     * Parse the symbols of each architecture of a fat mach-o file on their own
+     * thread.
+     */
+
+    bool parse_archs_concurrently : 1;
+
+    /*
+     * Only parse the load-commands, leaving the symbols to be parsed later by
+     * macho_file_parse_symbols_from_map().
+     */
+
+    bool dont_parse_symbols : 1;
+
+    /*
+     * The number of threads, including the calling thread, the architectures
+     * are parsed on with parse_archs_concurrently.
+     */
+
+    uint32_t archs_jobs_count;
 };
 
 struct macho_file {
@@ -170,6 +191,20 @@ macho_file_parse_from_file(struct tbd_create_info *__notnull info_in,
                            struct tbd_parse_options tbd_options,
                            struct macho_file_parse_options options);
 
+/*
+ * Read the uuid of every architecture of macho, by reading only their headers
+ * and load-commands, into a newly allocated list of 16-byte uuids, in the
+ * order the architectures are stored in.
+ *
+ * Returns false if the uuids couldn't be read, or if any architecture doesn't
+ * have a uuid.
+ */
+
+bool
+macho_file_read_uuids(const struct macho_file *__notnull macho,
+                      uint8_t **__notnull uuids_out,
+                      uint32_t *__notnull count_out);
+
 void macho_file_print_archs(int fd);
 
 #endif /* MACHO_FILE_H */
@@ -17,6 +17,7 @@
 #include "macho_file.h"
 #include "notnull.h"
 #include "range.h"
+#include "string_buffer.h"
 #include "tbd.h"
 
 struct macho_file_parse_lc_flags {
@@ -49,6 +50,21 @@ struct macho_file_lc_info_out {
     struct symtab_command symtab;
 };
 
+/*
+ * Advise the kernel that the export-trie and symbol-table described by lc_info,
+ * which are found in the __LINKEDIT segment of the mach-o at base, are about to
+ * be read, so they can be read ahead.
+ */
+
+void
+macho_file_advise_linkedit(
+    int fd,
+    uint64_t base,
+    const struct macho_file_lc_info_out *__notnull lc_info,
+    bool is_64,
+    struct tbd_parse_options tbd_options,
+    struct macho_file_parse_options options);
+
 enum macho_file_parse_result
 macho_file_parse_load_commands_from_file(
     struct tbd_create_info *__notnull info_in,
@@ -56,10 +72,29 @@ macho_file_parse_load_commands_from_file(
     struct macho_file_parse_extra_args extra,
     struct macho_file_lc_info_out *sym_info_out);
 
+/*
+ * Return a pointer to the size bytes of data at address, or NULL if no such
+ * data is available.
+ */
+
+typedef const uint8_t *
+(*macho_file_get_data_at_address)(const void *info,
+                                  uint64_t address,
+                                  uint64_t size);
+
 struct mf_parse_lc_from_map_info {
     const uint8_t *map;
     uint64_t map_size;
 
+    /*
+     * The images of a split dyld_shared_cache can have their segments spread
+     * across several files, so when set, sections are found by their address
+     * instead of their file-offset.
+     */
+
+    macho_file_get_data_at_address get_data_at_address;
+    const void *get_data_at_address_info;
+
     const uint8_t *macho;
     uint64_t macho_size;
 
@@ -84,4 +119,30 @@ macho_file_parse_load_commands_from_map(
     struct macho_file_parse_extra_args extra,
     struct macho_file_lc_info_out *sym_info_out);
 
+/*
+ * Parse the symbols of a mach-o file whose load-commands were parsed with the
+ * dont_parse_symbols option, using the lc_info it returned.
+ *
+ * map should point to the mach-o's header, with available_range relative to
+ * map.
+ */
+
+struct mf_parse_symbols_from_map_info {
+    const uint8_t *map;
+    struct range available_range;
+
+    uint64_t arch_index;
+    struct macho_file_lc_info_out lc_info;
+
+    struct tbd_parse_options tbd_options;
+    struct macho_file_parse_options options;
+    struct macho_file_parse_lc_flags flags;
+};
+
+enum macho_file_parse_result
+macho_file_parse_symbols_from_map(
+    struct tbd_create_info *__notnull info_in,
+    const struct mf_parse_symbols_from_map_info *__notnull parse_info,
+    struct string_buffer *__notnull export_trie_sb);
+
 #endif /* MACHO_FILE_PARSE_LOAD_COMMANDS_H */
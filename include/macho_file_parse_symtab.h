@@ -21,6 +21,13 @@ struct macho_file_parse_symtab_args {
 
     bool is_big_endian : 1;
 
+    /*
+     * Symbol-strings parsed from a map are borrowed from the map, unless
+     * copy_strings is set. Strings parsed from a file are always copied.
+     */
+
+    bool copy_strings : 1;
+
     uint32_t symoff;
     uint32_t nsyms;
     uint32_t stroff;
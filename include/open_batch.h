@@ -0,0 +1,113 @@
+//
+//  include/open_batch.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef OPEN_BATCH_H
+#define OPEN_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "notnull.h"
+
+/*
+ * An open-batch opens a batch of files within a directory, and reads the head
+ * of each file, with all the opens, and then all the reads, submitted at once
+ * through io_uring, instead of waiting on each syscall one at a time.
+ *
+ * A filter is then given each file's head, so that files that aren't worth
+ * parsing can be closed right away.
+ *
+ * io_uring is only available on Linux, so open_batch_create() fails
+ * elsewhere, and when the running kernel doesn't support it, in which case
+ * files are expected to be opened as usual.
+ */
+
+static const uint32_t OPEN_BATCH_MAX_COUNT = 64;
+static const uint32_t OPEN_BATCH_HEAD_SIZE = 4096;
+
+/*
+ * Return whether a file, with the given head, should be kept open.
+ */
+
+typedef bool
+(*open_batch_filter)(const uint8_t *__notnull head,
+                     uint64_t head_size,
+                     void *info);
+
+struct open_batch_result {
+    /*
+     * fd is -1 if the file failed to open, with error holding the errno, or
+     * if the file was filtered out, in which case error is 0.
+     */
+
+    int fd;
+    int error;
+};
+
+struct open_batch {
+    int ring_fd;
+
+    void *sq_ring;
+    uint64_t sq_ring_size;
+
+    void *cq_ring;
+    uint64_t cq_ring_size;
+
+    void *sqes;
+    uint64_t sqes_size;
+
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_array;
+    uint32_t sq_mask;
+
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    void *cqes;
+    uint32_t cq_mask;
+
+    uint8_t *heads;
+
+    /*
+     * Once the ring fails, every following batch is opened and read one file
+     * at a time.
+     */
+
+    bool failed;
+
+    /*
+     * Set if operations were left in flight after the ring failed, and
+     * couldn't be cancelled, in which case heads is never freed.
+     */
+
+    bool undrained;
+};
+
+bool open_batch_create(struct open_batch *__notnull batch);
+
+/*
+ * Open every file in names, up to OPEN_BATCH_MAX_COUNT, relative to dir_fd,
+ * storing the result for each in results.
+ *
+ * Files whose head can't be read are kept open, so that the error is found,
+ * and handled, when the file is parsed as usual.
+ */
+
+void
+open_batch_run(struct open_batch *__notnull batch,
+               int dir_fd,
+               const char *__notnull const *__notnull names,
+               uint32_t count,
+               int open_flags,
+               open_batch_filter filter,
+               void *filter_info,
+               struct open_batch_result *__notnull results);
+
+void open_batch_destroy(struct open_batch *__notnull batch);
+
+#endif /* OPEN_BATCH_H */
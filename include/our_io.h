@@ -17,17 +17,67 @@
 
 int our_open(const char *path, int flags, int mode);
 int our_openat(int dirfd, const char *pathname, int flags);
+int our_openat_with_mode(int dirfd, const char *pathname, int flags, int mode);
 
 int our_mkdir(const char *path, mode_t mode);
+int our_mkdirat(int dirfd, const char *path, mode_t mode);
 int our_unlink(const char *path);
 int our_rmdir(const char *path);
 
 off_t our_lseek(int fd, off_t offset, int whence);
 ssize_t our_read(int fd, void *buf, size_t size);
 
+/*
+ * Write all of buf, retrying on short writes and EINTR.
+ *
+ * Returns 0 on success, or -1 with errno set on failure.
+ */
+
+int our_write_all(int fd, const void *buf, size_t size);
+
+/*
+ * Read at offset without moving the file's offset, so that a single fd can be
+ * shared by several threads.
+ */
+
+ssize_t our_pread(int fd, void *buf, size_t size, off_t offset);
+
+/*
+ * Advise the kernel that the range of fd described by offset and size is about
+ * to be read, so it can be read ahead of time. Failures are ignored, as this is
+ * only a hint.
+ */
+
+void our_advise_willneed(int fd, off_t offset, size_t size);
+
+/*
+ * Create a file that only lives in memory (or, where that isn't available, an
+ * already unlinked temporary file), so that data in memory can be handed to
+ * code that expects a file-descriptor, including mapping it.
+ */
+
+int our_open_anonymous_file(const char *name);
+
+/*
+ * Return fd if it's already a regular file. Otherwise, as with a pipe, read fd
+ * until its end into an anonymous file, and return the anonymous file's fd, so
+ * that streamed input can be mapped and seeked like a file on disk.
+ *
+ * Input is kept in memory while small, and moved to an unlinked temporary file
+ * in $TMPDIR once large, so that a large input doesn't take up as much memory.
+ *
+ * Returns -1 with errno set on failure.
+ */
+
+int our_spool_to_seekable_file(int fd, const char *name);
+
 DIR *our_fdopendir(int fd);
 struct dirent *our_readdir(DIR *dir);
 
+#if defined(__linux__)
+ssize_t our_getdents64(int fd, void *buf, size_t size);
+#endif
+
 ssize_t our_getline(char **lineptr, size_t *n, FILE *stream);
 
 #endif /* OUR_IO_H */
@@ -9,6 +9,7 @@
 #ifndef PARSE_DSC_FOR_MAIN_H
 #define PARSE_DSC_FOR_MAIN_H
 
+#include "job_pool.h"
 #include "magic_buffer.h"
 #include "string_buffer.h"
 #include "tbd_for_main.h"
@@ -21,6 +22,59 @@ struct parse_dsc_for_main_options {
     bool verify_write_path : 1;
 };
 
+struct dsc_image_jobs_worker;
+struct dsc_image_jobs {
+    struct job_pool pool;
+
+    struct dsc_image_jobs_worker *workers;
+    uint32_t worker_count;
+};
+
+/*
+ * A batch extracts the images of every dyld_shared_cache file found while
+ * recursing on a single job-pool, so that the images of one shared-cache can
+ * be parsed while the images of the shared-caches found before it are still
+ * being committed.
+ *
+ * A shared-cache stays mapped until all of its images have been committed, so
+ * a shared-cache is only added once the total size of all mapped shared-caches
+ * would stay within mapped_size_limit, unless no other shared-cache is mapped.
+ *
+ * As images are committed in the order their shared-caches were found, any
+ * messages for files found after a shared-cache should only be printed after
+ * calling parse_dsc_for_main_batch_commit_all().
+ */
+
+struct parse_dsc_for_main_batch {
+    struct dsc_image_jobs jobs;
+
+    uint64_t mapped_size;
+    uint64_t mapped_size_limit;
+
+    uint64_t caches_count;
+};
+
+enum parse_dsc_for_main_batch_result {
+    E_PARSE_DSC_FOR_MAIN_BATCH_OK,
+    E_PARSE_DSC_FOR_MAIN_BATCH_CREATE_FAIL
+};
+
+enum parse_dsc_for_main_batch_result
+parse_dsc_for_main_batch_create(
+    struct parse_dsc_for_main_batch *__notnull batch,
+    const struct tbd_for_main *__notnull tbd,
+    const struct tbd_for_main *__notnull orig,
+    uint32_t worker_count,
+    uint64_t mapped_size_limit);
+
+void
+parse_dsc_for_main_batch_commit_all(
+    struct parse_dsc_for_main_batch *__notnull batch);
+
+void
+parse_dsc_for_main_batch_finish_and_destroy(
+    struct parse_dsc_for_main_batch *__notnull batch);
+
 struct parse_dsc_for_main_args {
     int fd;
 
@@ -38,6 +92,13 @@ struct parse_dsc_for_main_args {
 
     FILE *combine_file;
 
+    /*
+     * When not NULL while recursing, the images of the shared-cache are added
+     * to batch, instead of being extracted before returning.
+     */
+
+    struct parse_dsc_for_main_batch *batch;
+
     bool dont_handle_non_dsc_error : 1;
     bool print_paths : 1;
 
@@ -12,6 +12,7 @@
 #include "magic_buffer.h"
 #include "string_buffer.h"
 #include "tbd_for_main.h"
+#include "tbd_writer.h"
 
 struct parse_macho_for_main_options {
     bool verify_write_path : 1;
@@ -43,6 +44,13 @@ struct parse_macho_for_main_args {
 
     FILE *combine_file;
 
+    /*
+     * When not NULL, .tbd files written out while recursing are handed off to
+     * writer, rather than written out on the calling thread.
+     */
+
+    struct tbd_writer *writer;
+
     bool dont_handle_non_macho_error : 1;
     bool print_paths : 1;
 
@@ -63,4 +71,57 @@ enum parse_macho_for_main_result
 parse_macho_file_for_main_while_recursing(
     struct parse_macho_for_main_args *__notnull args_ptr);
 
+/*
+ * Buffered parsing is used by recursing jobs (see recurse_jobs.h), where the
+ * parse, and the creation of the .tbd, happens away from the main thread, while
+ * anything that prints, requests user-input, or writes to the filesystem is
+ * left for when the buffered result is later committed on the main thread.
+ */
+
+enum parse_macho_for_main_buffered_result {
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_OK,
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_NOT_A_MACHO,
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_OPEN_FAIL,
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_PARSE_FAIL,
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_CREATE_FAIL,
+
+    /*
+     * The parse called the error-callback, which may need to print or request
+     * user-input, so the file has to be parsed again on the main thread.
+     */
+
+    E_PARSE_MACHO_FOR_MAIN_BUFFERED_NEEDS_CALLBACK
+};
+
+struct parse_macho_for_main_buffered {
+    enum parse_macho_for_main_buffered_result result;
+
+    enum macho_file_open_result open_result;
+    enum macho_file_parse_result parse_result;
+
+    char *data;
+    size_t size;
+};
+
+void
+parse_macho_file_for_main_to_buffer(
+    struct tbd_for_main *__notnull tbd,
+    const struct tbd_for_main *__notnull orig,
+    int fd,
+    struct string_buffer *__notnull export_trie_sb,
+    struct parse_macho_for_main_buffered *__notnull buffered);
+
+/*
+ * args->magic_buffer should be empty, as the file is re-read from the start if
+ * it has to be parsed again.
+ *
+ * If args->writer is not NULL, ownership of buffered->data may be passed to the
+ * writer, in which case buffered->data is set to NULL.
+ */
+
+enum parse_macho_for_main_result
+parse_macho_file_for_main_from_buffered(
+    struct parse_macho_for_main_args *__notnull args,
+    struct parse_macho_for_main_buffered *__notnull buffered);
+
 #endif /* PARSE_MACHO_FOR_MAIN_H */
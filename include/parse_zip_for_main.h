@@ -0,0 +1,69 @@
+//
+//  include/parse_zip_for_main.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef PARSE_ZIP_FOR_MAIN_H
+#define PARSE_ZIP_FOR_MAIN_H
+
+#include <stdio.h>
+
+#include "string_buffer.h"
+#include "tbd_for_main.h"
+#include "tbd_writer.h"
+
+struct parse_zip_for_main_options {
+    bool verify_write_path : 1;
+};
+
+/*
+ * The mach-o members of a zip archive (such as an .ipa, or a zipped
+ * .xcframework) are parsed as if the archive were a directory being recursed,
+ * with each member's path in the archive used for its write-path.
+ */
+
+struct parse_zip_for_main_args {
+    int fd;
+    struct retained_user_info *retained;
+
+    struct tbd_for_main *tbd;
+    struct tbd_for_main *orig;
+
+    /*
+     * When not recursing, name will be NULL and dir_path will store the entire
+     * path.
+     */
+
+    const char *dir_path;
+    uint64_t dir_path_length;
+
+    const char *name;
+    uint64_t name_length;
+
+    FILE *combine_file;
+    struct tbd_writer *writer;
+
+    bool dont_handle_non_zip_error : 1;
+    bool print_paths : 1;
+
+    struct string_buffer *export_trie_sb;
+    struct parse_zip_for_main_options options;
+};
+
+enum parse_zip_for_main_result {
+    E_PARSE_ZIP_FOR_MAIN_OK,
+    E_PARSE_ZIP_FOR_MAIN_NOT_A_ZIP,
+    E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR
+};
+
+enum parse_zip_for_main_result
+parse_zip_for_main(struct parse_zip_for_main_args args);
+
+enum parse_zip_for_main_result
+parse_zip_for_main_while_recursing(
+    struct parse_zip_for_main_args *__notnull args);
+
+#endif /* PARSE_ZIP_FOR_MAIN_H */
@@ -0,0 +1,111 @@
+//
+//  include/recurse_jobs.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef RECURSE_JOBS_H
+#define RECURSE_JOBS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "job_pool.h"
+#include "notnull.h"
+#include "parse_macho_for_main.h"
+#include "string_buffer.h"
+#include "tbd_for_main.h"
+
+/*
+ * Recurse-jobs parse files found while recursing on a job-pool.
+ *
+ * Files are added in the order they're discovered. Once a job has finished
+ * parsing, it waits in the pool until all jobs discovered before it have been
+ * committed, so that the commit-callback (which writes out the .tbd and prints
+ * any diagnostics) is always called on the main thread, and in discovery order,
+ * regardless of how many workers are in use.
+ */
+
+struct recurse_job {
+    /*
+     * name is stored in the same allocation as dir_path.
+     */
+
+    char *dir_path;
+    uint64_t dir_path_length;
+
+    const char *name;
+    uint64_t name_length;
+
+    int fd;
+    struct parse_macho_for_main_buffered buffered;
+};
+
+typedef void
+(*recurse_jobs_commit_callback)(struct recurse_job *__notnull job, void *info);
+
+struct recurse_jobs;
+struct recurse_jobs_worker {
+    struct recurse_jobs *jobs;
+
+    struct tbd_for_main tbd;
+    struct string_buffer export_trie_sb;
+};
+
+struct recurse_jobs {
+    struct job_pool pool;
+    const struct tbd_for_main *orig;
+
+    struct recurse_jobs_worker *workers;
+    uint32_t worker_count;
+
+    recurse_jobs_commit_callback commit;
+    void *commit_info;
+};
+
+enum recurse_jobs_result {
+    E_RECURSE_JOBS_OK,
+    E_RECURSE_JOBS_ALLOC_FAIL,
+    E_RECURSE_JOBS_THREAD_CREATE_FAIL
+};
+
+/*
+ * Each worker receives its own copy of tbd, while orig is used to restore the
+ * copies' create-info after every parse.
+ */
+
+enum recurse_jobs_result
+recurse_jobs_create(struct recurse_jobs *__notnull jobs,
+                    const struct tbd_for_main *__notnull tbd,
+                    const struct tbd_for_main *__notnull orig,
+                    uint32_t worker_count,
+                    bool will_parse_export_trie,
+                    __notnull recurse_jobs_commit_callback commit,
+                    void *commit_info);
+
+/*
+ * Ownership of fd is passed to the job, and is closed after the job has been
+ * committed.
+ *
+ * Any jobs that have finished by the time recurse_jobs_add() returns are
+ * committed before returning.
+ */
+
+enum recurse_jobs_result
+recurse_jobs_add(struct recurse_jobs *__notnull jobs,
+                 const char *__notnull dir_path,
+                 uint64_t dir_path_length,
+                 const char *__notnull name,
+                 uint64_t name_length,
+                 int fd);
+
+/*
+ * Wait for all added jobs to finish and be committed, before destroying the
+ * workers.
+ */
+
+void recurse_jobs_finish_and_destroy(struct recurse_jobs *__notnull jobs);
+
+#endif /* RECURSE_JOBS_H */
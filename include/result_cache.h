@@ -0,0 +1,82 @@
+//
+//  include/result_cache.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "macho_file.h"
+#include "notnull.h"
+
+/*
+ * A result-cache is a directory storing the .tbds created from mach-o files,
+ * keyed by the uuids of their architectures and the options they were parsed
+ * with, so that copies of the same mach-o file, found in other places, or
+ * parsed again later, don't have their symbols parsed again.
+ *
+ * Entries are written out to a temporary file and renamed into place, so a
+ * result-cache can be shared by multiple tbd processes running at once.
+ */
+
+struct result_cache_key {
+    /*
+     * The 16-byte uuids of every architecture, in sorted order.
+     */
+
+    uint8_t *uuids;
+    uint32_t uuid_count;
+
+    uint32_t create_options;
+    uint64_t fingerprint;
+};
+
+enum result_cache_result {
+    E_RESULT_CACHE_OK,
+    E_RESULT_CACHE_MISS,
+
+    E_RESULT_CACHE_ALLOC_FAIL,
+    E_RESULT_CACHE_WRITE_FAIL
+};
+
+/*
+ * Create the key for macho, parsed with the options fingerprinted as
+ * fingerprint, and written out with create_options.
+ *
+ * Returns false if macho can't be cached, as one of its architectures doesn't
+ * have a uuid.
+ */
+
+bool
+result_cache_key_create(struct result_cache_key *__notnull key,
+                        const struct macho_file *__notnull macho,
+                        uint64_t fingerprint,
+                        uint32_t create_options);
+
+/*
+ * Read the .tbd stored for key into a newly allocated buffer.
+ */
+
+enum result_cache_result
+result_cache_lookup(const char *__notnull dir_path,
+                    uint64_t dir_path_length,
+                    const struct result_cache_key *__notnull key,
+                    char **__notnull data_out,
+                    size_t *__notnull size_out);
+
+enum result_cache_result
+result_cache_store(const char *__notnull dir_path,
+                   uint64_t dir_path_length,
+                   const struct result_cache_key *__notnull key,
+                   const char *__notnull data,
+                   size_t size);
+
+void result_cache_key_destroy(struct result_cache_key *__notnull key);
+
+#endif /* RESULT_CACHE_H */
@@ -0,0 +1,59 @@
+//
+//  include/tar_writer.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef TAR_WRITER_H
+#define TAR_WRITER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "notnull.h"
+
+/*
+ * A tar-writer writes out files as entries of a single ustar archive, so that
+ * many small files can be written out with one sequential stream.
+ *
+ * Like the yaml-emitter, the functions below return 1 on failure, and 0
+ * otherwise.
+ */
+
+struct tar_writer {
+    FILE *file;
+
+    /*
+     * Every entry is given the same modification-time, which is the time the
+     * archive was created at.
+     */
+
+    uint64_t mtime;
+};
+
+void
+tar_writer_create(struct tar_writer *__notnull writer, FILE *__notnull file);
+
+/*
+ * Write out a regular file at path, with the contents of data.
+ *
+ * Paths too long to fit in a ustar header are stored in a pax extended-header
+ * preceding the entry.
+ */
+
+int
+tar_writer_write_file(struct tar_writer *__notnull writer,
+                      const char *__notnull path,
+                      uint64_t path_length,
+                      const char *__notnull data,
+                      uint64_t size);
+
+/*
+ * Write out the blocks ending the archive. The file is not closed.
+ */
+
+int tar_writer_finish(struct tar_writer *__notnull writer);
+
+#endif /* TAR_WRITER_H */
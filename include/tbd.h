@@ -13,11 +13,13 @@
 #include <stdio.h>
 
 #include "arch_info.h"
+#include "arena.h"
 #include "array.h"
 
 #include "bit_list.h"
 #include "notnull.h"
 #include "target_list.h"
+#include "yaml_emitter.h"
 
 /*
  * Options to handle when parsing out information for tbd_create_info.
@@ -225,11 +227,53 @@ struct tbd_create_info_fields {
     struct array uuids;
 };
 
+/*
+ * While a create-info is being ingested, metadata and symbols are appended to
+ * the end of their lists, and are looked up through open-addressing hash-tables
+ * instead of by a binary-search of the sorted lists, with the lists only sorted
+ * once ingestion is finished.
+ *
+ * Each slot stores the index of an item in its list plus one, so that a slot
+ * with an index of zero is empty.
+ */
+
+struct tbd_ci_ingest_slot {
+    uint32_t index;
+    uint32_t hash;
+};
+
+struct tbd_ci_ingest_table {
+    struct tbd_ci_ingest_slot *slots;
+    uint64_t capacity;
+};
+
+struct tbd_create_info_ingest {
+    struct tbd_ci_ingest_table metadata;
+    struct tbd_ci_ingest_table symbols;
+
+    /*
+     * The parent-umbrella is normally the first item of the sorted metadata
+     * list, so its index (plus one) is tracked while the list is unsorted.
+     */
+
+    uint64_t parent_umbrella_index;
+    bool is_active;
+};
+
 struct tbd_create_info {
     enum tbd_version version;
 
     struct tbd_create_info_fields fields;
     struct tbd_create_info_flags flags;
+
+    struct tbd_create_info_ingest ingest;
+
+    /*
+     * The strings and heap bit-lists of metadata and symbols are allocated
+     * from arena, which is reset once the fields are cleared.
+     */
+
+    struct arena arena;
 };
 
 enum tbd_ci_set_target_count_result {
@@ -285,6 +329,12 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull info_in,
                             enum tbd_symbol_meta_type meta_type,
                             struct tbd_parse_options options);
 
+/*
+ * If copy_string is false, the symbol's string is borrowed from string instead
+ * of copied, if it is null-terminated within max_len, in which case string must
+ * remain valid for as long as info_in's symbols are used.
+ */
+
 enum tbd_ci_add_data_result
 tbd_ci_add_symbol_with_info(struct tbd_create_info *__notnull info_in,
                             const char *__notnull string,
@@ -293,6 +343,7 @@ tbd_ci_add_symbol_with_info(struct tbd_create_info *__notnull info_in,
                             enum tbd_symbol_type predefined_type,
                             enum tbd_symbol_meta_type meta_type,
                             bool is_exported,
+                            bool copy_string,
                             struct tbd_parse_options options);
 
 enum tbd_ci_add_data_result
@@ -313,8 +364,27 @@ void
 tbd_ci_set_single_platform(struct tbd_create_info *__notnull info,
                            enum tbd_platform platform);
 
+/*
+ * Sorting info_in also finishes any ingestion of info_in, as its lists no
+ * longer need to be looked up afterwards.
+ */
+
 void tbd_ci_sort_info(struct tbd_create_info *__notnull info_in);
 
+/*
+ * Start ingesting into info_in, discarding any ingestion state info_in may have
+ * been copied with.
+ */
+
+void tbd_ci_begin_ingesting(struct tbd_create_info *__notnull info_in);
+
+/*
+ * Sort info_in's metadata and symbols without regard to their targets, and stop
+ * ingesting. Does nothing if info_in is not being ingested.
+ */
+
+void tbd_ci_finish_ingesting(struct tbd_create_info *__notnull info_in);
+
 enum tbd_ci_add_uuid_result {
     E_TBD_CI_ADD_UUID_OK,
     E_TBD_CI_ADD_UUID_ARRAY_FAIL,
@@ -356,9 +426,14 @@ struct tbd_create_options {
     };
 };
 
+/*
+ * Write out the .tbd for info to emitter, which is left to the caller to flush
+ * out, all at once, to a file.
+ */
+
 enum tbd_create_result
 tbd_create_with_info(const struct tbd_create_info *__notnull info,
-                     FILE *__notnull file,
+                     struct yaml_emitter *__notnull emitter,
                      struct tbd_create_options options);
 
 void
@@ -366,6 +441,20 @@ tbd_create_info_clear_fields_and_create_from(
     struct tbd_create_info *__notnull dst,
     const struct tbd_create_info *__notnull src);
 
+/*
+ * Move the metadata and symbols of every info of others into info_in in a
+ * single pass, merging the targets of any equal items. The metadata and
+ * symbols of others are destroyed afterwards, even on failure.
+ *
+ * info_in and others are sorted first if they're still being ingested, and
+ * otherwise must already be sorted.
+ */
+
+enum tbd_ci_add_data_result
+tbd_ci_merge_data(struct tbd_create_info *__notnull info_in,
+                  struct tbd_create_info *__notnull *__notnull others,
+                  uint64_t count);
+
 void tbd_create_info_destroy(struct tbd_create_info *__notnull info);
 
 #endif /* TBD_H */
@@ -65,8 +65,30 @@ struct tbd_for_main_options {
     bool replace_path_extension     : 1;
     bool preserve_directory_subdirs : 1;
 
-    bool no_overwrite : 1;
-    bool combine_tbds : 1;
+    bool no_overwrite     : 1;
+    bool combine_tbds     : 1;
+    bool write_if_changed : 1;
+
+    /*
+     * Write out the images of a dyld_shared_cache file as entries of a single
+     * tar archive, instead of as separate files.
+     */
+
+    bool tar_output : 1;
+
+    /*
+     * Compress the combined .tbd file, tar archive, or .tbds written to stdout.
+     */
+
+    bool gzip_output : 1;
+    bool zstd_output : 1;
+
+    /*
+     * Skip inputs left unchanged since they were last parsed into the
+     * write-path, as recorded in a manifest stored next to it.
+     */
+
+    bool incremental : 1;
 
     bool no_requests     : 1;
     bool ignore_warnings : 1;
@@ -108,6 +130,7 @@ struct tbd_for_main_filetypes {
         struct {
             bool macho : 1;
             bool dyld_shared_cache : 1;
+            bool zip : 1;
             bool user_provided : 1;
         };
     };
@@ -136,6 +159,7 @@ struct tbd_for_main {
 
     struct macho_file_parse_options macho_options;
     struct dyld_shared_cache_parse_options dsc_options;
+    struct dsc_image_parse_options dsc_image_options;
 
     struct tbd_parse_options parse_options;
     struct tbd_create_options write_options;
@@ -146,6 +170,53 @@ struct tbd_for_main {
     enum tbd_platform platform;
     uint64_t dsc_filter_paths_count;
 
+    /*
+     * The number of worker threads to parse files, dyld_shared_cache images,
+     * or the architectures of a fat mach-o file, with. A count of zero or one
+     * parses everything on the main thread.
+     */
+
+    uint32_t jobs_count;
+
+    /*
+     * When not zero, dyld_shared_cache files found while recursing with jobs
+     * are extracted concurrently, with the total size of the shared-caches
+     * mapped at once kept under this limit, in bytes.
+     */
+
+    uint64_t dsc_mapped_size_limit;
+
+    /*
+     * When not NULL, the path of a previous version of the dyld_shared_cache
+     * being parsed, whose images, if unchanged, are not extracted again.
+     */
+
+    char *dsc_previous_path;
+
+    /*
+     * The paths of the dyld_shared_caches, of other architectures, whose
+     * images are merged into the .tbds of the images of the dyld_shared_cache
+     * being parsed that have the same install-name.
+     */
+
+    struct array dsc_merge_paths;
+
+    /*
+     * A fingerprint of the options provided for this path, so that inputs
+     * parsed with different options aren't skipped in incremental mode, or
+     * found in a result-cache.
+     */
+
+    uint64_t options_fingerprint;
+
+    /*
+     * When not NULL, the directory of a result-cache (see result_cache.h) to
+     * store the .tbds created from mach-o files in, and to find them in.
+     */
+
+    char *cache_dir_path;
+    uint64_t cache_dir_path_length;
+
     struct retained_user_info retained;
     struct tbd_for_main_options options;
     struct tbd_for_main_flags flags;
@@ -213,6 +284,18 @@ tbd_for_main_open_write_file_for_path(const struct tbd_for_main *__notnull tbd,
                                       FILE **__notnull file_out,
                                       char **__notnull terminator_out);
 
+/*
+ * Wrap file in a stream compressing everything written to it, if the user asked
+ * for compressed output, or otherwise simply return file.
+ *
+ * The stream closes file when closed if close_file is true.
+ */
+
+FILE *
+tbd_for_main_open_output_stream(const struct tbd_for_main *__notnull tbd,
+                                FILE *__notnull file,
+                                bool close_file);
+
 void
 tbd_for_main_write_to_file(const struct tbd_for_main *__notnull tbd,
                            char *__notnull write_path,
@@ -221,6 +304,57 @@ tbd_for_main_write_to_file(const struct tbd_for_main *__notnull tbd,
                            FILE *__notnull file,
                            bool print_paths);
 
+/*
+ * Write out a .tbd previously created with tbd_for_main_write_to_buffer().
+ */
+
+void
+tbd_for_main_write_buffer_to_file(const struct tbd_for_main *__notnull tbd,
+                                  char *__notnull write_path,
+                                  uint64_t write_path_length,
+                                  char *terminator,
+                                  FILE *__notnull file,
+                                  const char *__notnull data,
+                                  size_t size,
+                                  bool print_paths);
+
+/*
+ * Write out a .tbd, either created from tbd's create-info, or previously
+ * created into a buffer, to write_path only if its contents have changed,
+ * without having to open a write-file first.
+ */
+
+void
+tbd_for_main_write_to_path_if_changed(const struct tbd_for_main *__notnull tbd,
+                                      char *__notnull write_path,
+                                      uint64_t write_path_length,
+                                      bool print_paths);
+
+void
+tbd_for_main_write_buffer_to_path_if_changed(
+    const struct tbd_for_main *__notnull tbd,
+    char *__notnull write_path,
+    uint64_t write_path_length,
+    const char *__notnull data,
+    size_t size,
+    bool print_paths);
+
+/*
+ * Create a .tbd from tbd's create-info into a newly allocated buffer, so it can
+ * be written out later, or on another thread.
+ */
+
+enum tbd_create_result
+tbd_for_main_write_to_buffer(const struct tbd_for_main *__notnull tbd,
+                             char **__notnull data_out,
+                             size_t *__notnull size_out);
+
+/*
+ * Write out the footer ending a combined .tbd file.
+ */
+
+enum tbd_create_result tbd_for_main_write_footer(FILE *__notnull file);
+
 void
 tbd_for_main_write_to_stdout(const struct tbd_for_main *__notnull tbd,
                              const char *__notnull input_path,
@@ -233,6 +367,19 @@ tbd_for_main_write_to_stdout_for_dsc_image(
     const char *__notnull image_path,
     bool print_paths);
 
+/*
+ * Create a copy of tbd for a worker-thread to parse with. The copy shares every
+ * field with tbd, except for the arrays of its create-info.
+ */
+
+void
+tbd_for_main_create_job_copy(struct tbd_for_main *__notnull copy,
+                             const struct tbd_for_main *__notnull tbd);
+
+void
+tbd_for_main_destroy_job_copy(struct tbd_for_main *__notnull copy,
+                              const struct tbd_for_main *__notnull orig);
+
 void tbd_for_main_destroy(struct tbd_for_main *__notnull tbd);
 
 #endif /* TBD_FOR_MAIN_H */
@@ -0,0 +1,173 @@
+//
+//  include/tbd_writer.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef TBD_WRITER_H
+#define TBD_WRITER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "notnull.h"
+#include "tbd.h"
+#include "yaml_emitter.h"
+
+/*
+ * A tbd-writer writes out .tbd files on a dedicated thread, so that the thread
+ * parsing files can move on to the next file while the previous one is still
+ * being written.
+ *
+ * Write-files are still opened by the adding thread, as opening them may print
+ * or request user-input, and are then handed off, together with an output, to
+ * the writer-thread, which writes out the output, and closes the file.
+ *
+ * Writes are stored in a ring of fixed size, so once the ring is full, adding a
+ * write waits for the writer-thread to catch up.
+ */
+
+struct tbd_writer_output {
+    /*
+     * An output either holds a create-info, which the writer-thread creates the
+     * .tbd from, or the data of an already created .tbd.
+     */
+
+    struct tbd_create_info info;
+    struct tbd_create_options write_options;
+
+    char *data;
+    size_t size;
+
+    /*
+     * An output can be written out to multiple files, and is only destroyed
+     * once every write, and the adding thread, has released it.
+     */
+
+    uint64_t ref_count;
+    bool ignore_warnings;
+};
+
+struct tbd_writer_write {
+    struct tbd_writer_output *output;
+
+    /*
+     * file is NULL for writes added with tbd_writer_add_if_changed(), which
+     * are instead written out to path only if its contents have changed.
+     */
+
+    FILE *file;
+
+    char *path;
+    uint64_t path_length;
+
+    /*
+     * terminator points into path, and is NULL if no directories were created
+     * for the write-file.
+     */
+
+    char *terminator;
+
+    bool print_paths;
+    bool no_overwrite;
+};
+
+struct tbd_writer {
+    pthread_mutex_t lock;
+
+    pthread_cond_t write_cond;
+    pthread_cond_t written_cond;
+
+    struct tbd_writer_write *ring;
+    uint64_t ring_count;
+
+    /*
+     * The counts below are indexes in the order writes were added, and always
+     * satisfy: written_count <= added_count.
+     */
+
+    uint64_t added_count;
+    uint64_t written_count;
+
+    /*
+     * The emitter is only used by the writer-thread, and is reused for every
+     * output it creates.
+     */
+
+    struct yaml_emitter emitter;
+
+    pthread_t thread;
+    bool is_finished;
+};
+
+enum tbd_writer_result {
+    E_TBD_WRITER_OK,
+    E_TBD_WRITER_ALLOC_FAIL,
+    E_TBD_WRITER_THREAD_CREATE_FAIL
+};
+
+enum tbd_writer_result tbd_writer_create(struct tbd_writer *__notnull writer);
+
+/*
+ * Move the fields of info into a new output, leaving info with empty arrays,
+ * so that info can be cleared and reused for the next parse as usual.
+ *
+ * Any strings info borrows, such as an install-name or symbols pointing into a
+ * mapped file, must remain valid until the writer is finished.
+ */
+
+struct tbd_writer_output *
+tbd_writer_output_create_from_info(struct tbd_create_info *__notnull info,
+                                   struct tbd_create_options write_options,
+                                   bool ignore_warnings);
+
+/*
+ * Ownership of data is passed to the output.
+ */
+
+struct tbd_writer_output *
+tbd_writer_output_create_from_data(char *__notnull data,
+                                   size_t size,
+                                   bool ignore_warnings);
+
+/*
+ * Ownership of file is passed to the writer, while path is copied.
+ */
+
+void
+tbd_writer_add(struct tbd_writer *__notnull writer,
+               struct tbd_writer_output *__notnull output,
+               FILE *__notnull file,
+               char *__notnull path,
+               uint64_t path_length,
+               char *terminator,
+               bool print_paths);
+
+/*
+ * Write out output to path only if the file at path doesn't already have the
+ * exact same contents, with path copied as above.
+ */
+
+void
+tbd_writer_add_if_changed(struct tbd_writer *__notnull writer,
+                          struct tbd_writer_output *__notnull output,
+                          char *__notnull path,
+                          uint64_t path_length,
+                          bool no_overwrite,
+                          bool print_paths);
+
+void
+tbd_writer_release_output(struct tbd_writer *__notnull writer,
+                          struct tbd_writer_output *__notnull output);
+
+/*
+ * Wait for all added writes to be written out, then stop the writer-thread.
+ */
+
+void tbd_writer_finish_and_destroy(struct tbd_writer *__notnull writer);
+
+#endif /* TBD_WRITER_H */
@@ -0,0 +1,55 @@
+//
+//  include/write_if_changed.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef WRITE_IF_CHANGED_H
+#define WRITE_IF_CHANGED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "notnull.h"
+
+enum write_if_changed_result {
+    E_WRITE_IF_CHANGED_OK,
+
+    /*
+     * The file at path already had the exact contents provided, and was left
+     * untouched.
+     */
+
+    E_WRITE_IF_CHANGED_UNCHANGED,
+
+    E_WRITE_IF_CHANGED_PATH_ALREADY_EXISTS,
+    E_WRITE_IF_CHANGED_OPEN_FAIL,
+    E_WRITE_IF_CHANGED_WRITE_FAIL,
+    E_WRITE_IF_CHANGED_RENAME_FAIL
+};
+
+/*
+ * Write data out to the file at path, only if the file doesn't already have
+ * the exact same contents, so that unchanged files keep their modification
+ * time.
+ *
+ * The existing file's size is compared first, and its contents are only read
+ * if the sizes match.
+ *
+ * Changed files are first written to a temporary file in the same directory,
+ * which is then renamed over path, so that readers never see a partially
+ * written file. Any directories in path's hierarchy are created as needed.
+ *
+ * On failure, errno is left with the error of the call that failed.
+ */
+
+enum write_if_changed_result
+write_if_changed(char *__notnull path,
+                 uint64_t path_length,
+                 const char *__notnull data,
+                 uint64_t size,
+                 bool no_overwrite);
+
+#endif /* WRITE_IF_CHANGED_H */
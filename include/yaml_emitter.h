@@ -0,0 +1,83 @@
+//
+//  include/yaml_emitter.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef YAML_EMITTER_H
+#define YAML_EMITTER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "notnull.h"
+
+/*
+ * A yaml-emitter collects a document in memory, so that it can be written out
+ * to a file with a single call, without going through stdio's format-parsing,
+ * and locking, for every key and symbol.
+ *
+ * The write functions below return 1 on failure, and 0 otherwise, to match the
+ * tbd_write_*() functions they're called from.
+ */
+
+struct yaml_emitter {
+    char *data;
+
+    uint64_t length;
+    uint64_t capacity;
+};
+
+int
+yaml_emitter_write(struct yaml_emitter *__notnull emitter,
+                   const char *__notnull data,
+                   uint64_t length);
+
+int
+yaml_emitter_write_c_str(struct yaml_emitter *__notnull emitter,
+                         const char *__notnull string);
+
+/*
+ * Write out a string-literal, whose length is known at compile-time.
+ */
+
+#define yaml_emitter_write_literal(emitter, literal) \
+    yaml_emitter_write(emitter, literal, sizeof(literal) - 1)
+
+int yaml_emitter_write_char(struct yaml_emitter *__notnull emitter, char ch);
+
+/*
+ * Write count spaces, as used to align the values of keys.
+ */
+
+int
+yaml_emitter_write_padding(struct yaml_emitter *__notnull emitter,
+                           uint64_t count);
+
+int
+yaml_emitter_write_uint(struct yaml_emitter *__notnull emitter,
+                        uint64_t value);
+
+/*
+ * Write out byte as two upper-case hexadecimal digits.
+ */
+
+int
+yaml_emitter_write_hex_byte(struct yaml_emitter *__notnull emitter,
+                            uint8_t byte);
+
+/*
+ * Write out everything written so far to file, then clear the emitter to be
+ * reused.
+ */
+
+int
+yaml_emitter_flush(struct yaml_emitter *__notnull emitter,
+                   FILE *__notnull file);
+
+void yaml_emitter_clear(struct yaml_emitter *__notnull emitter);
+void yaml_emitter_destroy(struct yaml_emitter *__notnull emitter);
+
+#endif /* YAML_EMITTER_H */
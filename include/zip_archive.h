@@ -0,0 +1,124 @@
+//
+//  include/zip_archive.h
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#ifndef ZIP_ARCHIVE_H
+#define ZIP_ARCHIVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "notnull.h"
+
+struct zip_archive {
+    int fd;
+    uint64_t size;
+
+    /*
+     * The entire central-directory is read in at once, as it's where every
+     * entry's path and sizes are stored.
+     */
+
+    uint8_t *central_directory;
+    uint64_t central_directory_size;
+    uint64_t entries_count;
+};
+
+struct zip_archive_entry {
+    /*
+     * path is not null-terminated, and points into the archive's
+     * central-directory.
+     */
+
+    const char *path;
+    uint64_t path_length;
+
+    uint64_t compressed_size;
+    uint64_t size;
+    uint64_t local_header_offset;
+
+    uint32_t crc32;
+    uint32_t external_attributes;
+
+    uint16_t method;
+    uint16_t flags;
+    uint16_t version_made_by;
+};
+
+enum zip_archive_result {
+    E_ZIP_ARCHIVE_OK,
+
+    E_ZIP_ARCHIVE_NOT_A_ZIP,
+    E_ZIP_ARCHIVE_READ_FAIL,
+    E_ZIP_ARCHIVE_WRITE_FAIL,
+    E_ZIP_ARCHIVE_ALLOC_FAIL,
+
+    E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY,
+    E_ZIP_ARCHIVE_INVALID_ENTRY,
+
+    E_ZIP_ARCHIVE_MULTIPLE_DISKS,
+    E_ZIP_ARCHIVE_ENCRYPTED_ENTRY,
+    E_ZIP_ARCHIVE_UNSUPPORTED_METHOD,
+
+    E_ZIP_ARCHIVE_INFLATE_FAIL,
+    E_ZIP_ARCHIVE_CRC_MISMATCH
+};
+
+/*
+ * Find and read in the central-directory of the zip archive at fd, including
+ * zip64 archives.
+ */
+
+enum zip_archive_result
+zip_archive_open(struct zip_archive *__notnull archive, int fd);
+
+/*
+ * Return false from the callback to stop iterating.
+ */
+
+typedef bool
+(*zip_archive_entry_callback)(struct zip_archive *__notnull archive,
+                              const struct zip_archive_entry *__notnull entry,
+                              void *cb_info);
+
+enum zip_archive_result
+zip_archive_iterate(struct zip_archive *__notnull archive,
+                    zip_archive_entry_callback callback,
+                    void *cb_info);
+
+/*
+ * Return whether entry is a regular file, and not a directory or symbolic
+ * link.
+ */
+
+bool zip_archive_entry_is_file(const struct zip_archive_entry *__notnull entry);
+
+/*
+ * Decompress only the first size bytes of entry into buf, so an entry's magic
+ * can be checked without decompressing all of it.
+ */
+
+enum zip_archive_result
+zip_archive_read_entry_head(const struct zip_archive *__notnull archive,
+                            const struct zip_archive_entry *__notnull entry,
+                            void *__notnull buf,
+                            uint64_t size,
+                            uint64_t *__notnull size_out);
+
+/*
+ * Decompress all of entry, writing it out to fd from fd's current offset, and
+ * verify the decompressed data against the entry's checksum.
+ */
+
+enum zip_archive_result
+zip_archive_extract_entry(const struct zip_archive *__notnull archive,
+                          const struct zip_archive_entry *__notnull entry,
+                          int fd);
+
+void zip_archive_destroy(struct zip_archive *__notnull archive);
+
+#endif /* ZIP_ARCHIVE_H */
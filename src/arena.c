@@ -0,0 +1,180 @@
+//
+//  src/arena.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "likely.h"
+
+/*
+ * Chunks are large enough to hold a few thousand symbol-strings, while
+ * allocations above a quarter of a chunk get a chunk of their own, so as to not
+ * waste the rest of the current chunk.
+ */
+
+static const uint64_t CHUNK_SIZE = 64 * 1024;
+static const uint64_t LARGE_ALLOC_SIZE = CHUNK_SIZE / 4;
+
+static inline uint64_t align_size(const uint64_t size) {
+    return ((size + 7) & ~7ull);
+}
+
+static inline uint8_t *get_chunk_data(struct arena_chunk *__notnull chunk) {
+    return (uint8_t *)(chunk + 1);
+}
+
+static struct arena_chunk *create_chunk(const uint64_t data_size) {
+    struct arena_chunk *const chunk =
+        malloc(sizeof(struct arena_chunk) + data_size);
+
+    if (unlikely(chunk == NULL)) {
+        return NULL;
+    }
+
+    chunk->next = NULL;
+    return chunk;
+}
+
+static void *
+alloc_large(struct arena *__notnull const arena, const uint64_t size) {
+    struct arena_chunk *const chunk = create_chunk(size);
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    /*
+     * Insert the chunk behind the current chunk, so that the current chunk
+     * can still be allocated from.
+     */
+
+    struct arena_chunk *const current = arena->chunks;
+    if (current != NULL) {
+        chunk->next = current->next;
+        current->next = chunk;
+    } else {
+        uint8_t *const end = get_chunk_data(chunk) + size;
+
+        arena->chunks = chunk;
+        arena->ptr = end;
+        arena->end = end;
+    }
+
+    return get_chunk_data(chunk);
+}
+
+void *arena_alloc(struct arena *__notnull const arena, const uint64_t size) {
+    const uint64_t aligned_size = align_size(size);
+    uint8_t *const ptr = arena->ptr;
+
+    if (likely((uint64_t)(arena->end - ptr) >= aligned_size)) {
+        arena->ptr = ptr + aligned_size;
+        return ptr;
+    }
+
+    if (aligned_size > LARGE_ALLOC_SIZE) {
+        return alloc_large(arena, aligned_size);
+    }
+
+    const uint64_t data_size = CHUNK_SIZE - sizeof(struct arena_chunk);
+    struct arena_chunk *const chunk = create_chunk(data_size);
+
+    if (chunk == NULL) {
+        return NULL;
+    }
+
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+
+    uint8_t *const data = get_chunk_data(chunk);
+
+    arena->ptr = data + aligned_size;
+    arena->end = data + data_size;
+
+    return data;
+}
+
+char *
+arena_alloc_and_copy(struct arena *__notnull const arena,
+                     const char *__notnull const string,
+                     const uint64_t length)
+{
+    char *const copy = arena_alloc(arena, length + 1);
+    if (unlikely(copy == NULL)) {
+        return NULL;
+    }
+
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+void
+arena_move(struct arena *__notnull const dst, struct arena *__notnull const src)
+{
+    struct arena_chunk *const src_chunks = src->chunks;
+    if (src_chunks == NULL) {
+        return;
+    }
+
+    struct arena_chunk *const current = dst->chunks;
+    if (current != NULL) {
+        /*
+         * Splice src's chunks in behind dst's current chunk.
+         */
+
+        struct arena_chunk *last = src_chunks;
+        while (last->next != NULL) {
+            last = last->next;
+        }
+
+        last->next = current->next;
+        current->next = src_chunks;
+    } else {
+        *dst = *src;
+    }
+
+    src->chunks = NULL;
+    src->ptr = NULL;
+    src->end = NULL;
+}
+
+static void free_chunks(struct arena_chunk *chunk) {
+    while (chunk != NULL) {
+        struct arena_chunk *const next = chunk->next;
+
+        free(chunk);
+        chunk = next;
+    }
+}
+
+void arena_reset(struct arena *__notnull const arena) {
+    struct arena_chunk *const current = arena->chunks;
+    if (current == NULL) {
+        return;
+    }
+
+    free_chunks(current->next);
+    current->next = NULL;
+
+    /*
+     * A large chunk may have become the current chunk, in which case end
+     * still points to its end.
+     */
+
+    arena->ptr = get_chunk_data(current);
+}
+
+void arena_destroy(struct arena *__notnull const arena) {
+    free_chunks(arena->chunks);
+
+    arena->chunks = NULL;
+    arena->ptr = NULL;
+    arena->end = NULL;
+}
@@ -15,29 +15,40 @@
 #include "bit_list.h"
 #include "likely.h"
 
-enum bit_list_result
-bit_list_create_with_capacity(struct bit_list *__notnull const list,
-                              const uint64_t capacity)
-{
+uint64_t bit_list_get_buffer_size_for_capacity(const uint64_t capacity) {
     /*
      * We can only hold 63 bits on the stack.
      */
 
     const uint64_t integer_count = (capacity >> 6);
-    if (integer_count == 0) {
+    return (sizeof(uint64_t) * integer_count);
+}
+
+void
+bit_list_create_with_buffer(struct bit_list *__notnull const list,
+                            uint64_t *__notnull const buffer)
+{
+    list->data = (uint64_t)buffer | 1;
+    list->alloc_count += 1;
+}
+
+enum bit_list_result
+bit_list_create_with_capacity(struct bit_list *__notnull const list,
+                              const uint64_t capacity)
+{
+    const uint64_t byte_capacity =
+        bit_list_get_buffer_size_for_capacity(capacity);
+
+    if (byte_capacity == 0) {
         return E_BIT_LIST_OK;
     }
 
-    const uint64_t byte_capacity = (sizeof(uint64_t) * integer_count);
     uint64_t *const data = malloc(byte_capacity);
-
     if (data == NULL) {
         return E_BIT_LIST_ALLOC_FAIL;
     }
 
-    list->data = (uint64_t)data | 1;
-    list->alloc_count += 1;
-
+    bit_list_create_with_buffer(list, data);
     return E_BIT_LIST_OK;
 }
 
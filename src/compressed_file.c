@@ -0,0 +1,577 @@
+//
+//  src/compressed_file.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+/*
+ * fopencookie() is only declared by glibc with _GNU_SOURCE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <zlib.h>
+
+#if defined(TBD_WITH_ZSTD)
+#include <zstd.h>
+#endif
+
+#include "compressed_file.h"
+
+/*
+ * Data is compressed in blocks of a fixed size, so that the memory held by a
+ * stream stays bounded no matter how much is written to it.
+ */
+
+static const uint64_t GZIP_BLOCK_SIZE = 1024 * 1024;
+
+struct gzip_block {
+    char *input;
+    uint64_t input_size;
+
+    char *output;
+    uint64_t output_size;
+    uint64_t output_capacity;
+
+    pthread_t thread;
+
+    /*
+     * has_output is set once the block has been handed off to be compressed,
+     * and is cleared once its output is written out.
+     */
+
+    bool has_output;
+    bool has_thread;
+    bool failed;
+};
+
+struct compressed_file {
+    FILE *file;
+    enum compressed_file_format format;
+
+    struct gzip_block *blocks;
+    uint32_t blocks_count;
+    uint32_t next_block;
+
+#if defined(TBD_WITH_ZSTD)
+    ZSTD_CCtx *cctx;
+
+    char *zstd_output;
+    size_t zstd_output_size;
+#endif
+
+    bool close_file;
+    bool wrote_data;
+    bool failed;
+};
+
+bool
+compressed_file_format_is_supported(const enum compressed_file_format format) {
+    switch (format) {
+        case COMPRESSED_FILE_FORMAT_GZIP:
+            return true;
+
+        case COMPRESSED_FILE_FORMAT_ZSTD:
+#if defined(TBD_WITH_ZSTD)
+            return true;
+#else
+            return false;
+#endif
+    }
+
+    return false;
+}
+
+/*
+ * Compress block's input into a complete gzip member.
+ */
+
+static void compress_gzip_block(struct gzip_block *__notnull const block) {
+    /*
+     * Adding 16 to the window-bits has zlib write a gzip header and trailer,
+     * instead of a zlib one.
+     */
+
+    z_stream stream = {};
+    const int init_ret =
+        deflateInit2(&stream,
+                     Z_DEFAULT_COMPRESSION,
+                     Z_DEFLATED,
+                     15 + 16,
+                     8,
+                     Z_DEFAULT_STRATEGY);
+
+    if (init_ret != Z_OK) {
+        block->failed = true;
+        return;
+    }
+
+    const uint64_t bound = deflateBound(&stream, (uLong)block->input_size);
+    if (block->output_capacity < bound) {
+        char *const output = realloc(block->output, bound);
+        if (output == NULL) {
+            deflateEnd(&stream);
+            block->failed = true;
+
+            return;
+        }
+
+        block->output = output;
+        block->output_capacity = bound;
+    }
+
+    stream.next_in = (Bytef *)block->input;
+    stream.avail_in = (uInt)block->input_size;
+    stream.next_out = (Bytef *)block->output;
+    stream.avail_out = (uInt)block->output_capacity;
+
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+        block->failed = true;
+    } else {
+        block->output_size = stream.total_out;
+    }
+
+    deflateEnd(&stream);
+}
+
+static void *compress_gzip_block_thread(void *__notnull const arg) {
+    compress_gzip_block((struct gzip_block *)arg);
+    return NULL;
+}
+
+static void
+start_gzip_block(const struct compressed_file *__notnull const cf,
+                 struct gzip_block *__notnull const block)
+{
+    block->has_output = true;
+    block->has_thread = false;
+
+    /*
+     * If we fail to create a thread, we simply compress the block on this
+     * thread instead.
+     */
+
+    if (cf->blocks_count > 1) {
+        const int create_ret =
+            pthread_create(&block->thread,
+                           NULL,
+                           compress_gzip_block_thread,
+                           block);
+
+        if (create_ret == 0) {
+            block->has_thread = true;
+            return;
+        }
+    }
+
+    compress_gzip_block(block);
+}
+
+/*
+ * Wait for block to be compressed, if needed, then write out its output, so
+ * that the block can be reused.
+ */
+
+static void
+finish_gzip_block(struct compressed_file *__notnull const cf,
+                  struct gzip_block *__notnull const block)
+{
+    if (!block->has_output) {
+        return;
+    }
+
+    if (block->has_thread) {
+        pthread_join(block->thread, NULL);
+        block->has_thread = false;
+    }
+
+    if (block->failed) {
+        cf->failed = true;
+    } else if (!cf->failed) {
+        const uint64_t size = block->output_size;
+        if (fwrite(block->output, 1, size, cf->file) != size) {
+            cf->failed = true;
+        }
+    }
+
+    block->input_size = 0;
+    block->output_size = 0;
+
+    block->has_output = false;
+    block->failed = false;
+}
+
+static bool
+write_gzip(struct compressed_file *__notnull const cf,
+           const char *__notnull buf,
+           uint64_t size)
+{
+    while (size != 0) {
+        struct gzip_block *const block = cf->blocks + cf->next_block;
+        finish_gzip_block(cf, block);
+
+        if (cf->failed) {
+            return false;
+        }
+
+        uint64_t copy_size = GZIP_BLOCK_SIZE - block->input_size;
+        if (copy_size > size) {
+            copy_size = size;
+        }
+
+        memcpy(block->input + block->input_size, buf, copy_size);
+        block->input_size += copy_size;
+
+        buf += copy_size;
+        size -= copy_size;
+
+        if (block->input_size == GZIP_BLOCK_SIZE) {
+            start_gzip_block(cf, block);
+            cf->next_block = (cf->next_block + 1) % cf->blocks_count;
+        }
+    }
+
+    return true;
+}
+
+static void close_gzip(struct compressed_file *__notnull const cf) {
+    /*
+     * Always write out at least one member, so that even an empty stream is
+     * valid gzip.
+     */
+
+    struct gzip_block *const last = cf->blocks + cf->next_block;
+    if (!last->has_output && (last->input_size != 0 || !cf->wrote_data)) {
+        start_gzip_block(cf, last);
+        cf->next_block = (cf->next_block + 1) % cf->blocks_count;
+    }
+
+    /*
+     * The oldest block is always the next one, so finishing every block from
+     * there on writes out the blocks in the order they were filled.
+     */
+
+    const uint32_t count = cf->blocks_count;
+    for (uint32_t i = 0; i != count; i++) {
+        const uint32_t index = (cf->next_block + i) % count;
+        finish_gzip_block(cf, cf->blocks + index);
+    }
+
+    for (uint32_t i = 0; i != count; i++) {
+        free(cf->blocks[i].input);
+        free(cf->blocks[i].output);
+    }
+
+    free(cf->blocks);
+}
+
+static bool
+open_gzip(struct compressed_file *__notnull const cf,
+          const uint32_t threads_count)
+{
+    const uint32_t count = (threads_count > 1) ? threads_count : 1;
+    struct gzip_block *const blocks = calloc(count, sizeof(*blocks));
+
+    if (blocks == NULL) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i != count; i++) {
+        char *const input = malloc(GZIP_BLOCK_SIZE);
+        if (input == NULL) {
+            for (uint32_t j = 0; j != i; j++) {
+                free(blocks[j].input);
+            }
+
+            free(blocks);
+            return false;
+        }
+
+        blocks[i].input = input;
+    }
+
+    cf->blocks = blocks;
+    cf->blocks_count = count;
+
+    return true;
+}
+
+#if defined(TBD_WITH_ZSTD)
+
+static bool
+write_zstd_with_directive(struct compressed_file *__notnull const cf,
+                          const char *const buf,
+                          const size_t size,
+                          const ZSTD_EndDirective directive)
+{
+    ZSTD_inBuffer input = {
+        .src = buf,
+        .size = size,
+        .pos = 0
+    };
+
+    do {
+        ZSTD_outBuffer output = {
+            .dst = cf->zstd_output,
+            .size = cf->zstd_output_size,
+            .pos = 0
+        };
+
+        const size_t remaining =
+            ZSTD_compressStream2(cf->cctx, &output, &input, directive);
+
+        if (ZSTD_isError(remaining)) {
+            return false;
+        }
+
+        if (fwrite(cf->zstd_output, 1, output.pos, cf->file) != output.pos) {
+            return false;
+        }
+
+        /*
+         * When ending the frame, we're only done once zstd has nothing left to
+         * flush. Otherwise, we're done once all of the input is consumed.
+         */
+
+        if (directive == ZSTD_e_end) {
+            if (remaining == 0) {
+                break;
+            }
+        } else if (input.pos == input.size) {
+            break;
+        }
+    } while (true);
+
+    return true;
+}
+
+static bool
+open_zstd(struct compressed_file *__notnull const cf,
+          const uint32_t threads_count)
+{
+    ZSTD_CCtx *const cctx = ZSTD_createCCtx();
+    if (cctx == NULL) {
+        return false;
+    }
+
+    const size_t output_size = ZSTD_CStreamOutSize();
+    char *const output = malloc(output_size);
+
+    if (output == NULL) {
+        ZSTD_freeCCtx(cctx);
+        return false;
+    }
+
+    ZSTD_CCtx_setParameter(cctx,
+                           ZSTD_c_compressionLevel,
+                           ZSTD_CLEVEL_DEFAULT);
+
+    /*
+     * Setting the number of workers fails if libzstd was built without
+     * multi-threading support, in which case we simply compress on this thread.
+     */
+
+    if (threads_count > 1) {
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, (int)threads_count);
+    }
+
+    cf->cctx = cctx;
+    cf->zstd_output = output;
+    cf->zstd_output_size = output_size;
+
+    return true;
+}
+
+static void close_zstd(struct compressed_file *__notnull const cf) {
+    if (!cf->failed) {
+        if (!write_zstd_with_directive(cf, NULL, 0, ZSTD_e_end)) {
+            cf->failed = true;
+        }
+    }
+
+    ZSTD_freeCCtx(cf->cctx);
+    free(cf->zstd_output);
+}
+
+#endif
+
+static bool
+write_data(struct compressed_file *__notnull const cf,
+           const char *__notnull const buf,
+           const uint64_t size)
+{
+    if (cf->failed) {
+        return false;
+    }
+
+    cf->wrote_data = true;
+    switch (cf->format) {
+        case COMPRESSED_FILE_FORMAT_GZIP:
+            if (!write_gzip(cf, buf, size)) {
+                cf->failed = true;
+            }
+
+            break;
+
+        case COMPRESSED_FILE_FORMAT_ZSTD:
+#if defined(TBD_WITH_ZSTD)
+            if (!write_zstd_with_directive(cf, buf, size, ZSTD_e_continue)) {
+                cf->failed = true;
+            }
+#endif
+
+            break;
+    }
+
+    return !cf->failed;
+}
+
+static int close_data(struct compressed_file *__notnull const cf) {
+    switch (cf->format) {
+        case COMPRESSED_FILE_FORMAT_GZIP:
+            close_gzip(cf);
+            break;
+
+        case COMPRESSED_FILE_FORMAT_ZSTD:
+#if defined(TBD_WITH_ZSTD)
+            close_zstd(cf);
+#endif
+
+            break;
+    }
+
+    bool failed = cf->failed;
+    if (cf->close_file) {
+        if (fclose(cf->file) != 0) {
+            failed = true;
+        }
+    } else if (fflush(cf->file) != 0) {
+        failed = true;
+    }
+
+    free(cf);
+    return failed ? -1 : 0;
+}
+
+#if defined(__APPLE__) || defined(__FreeBSD__)
+
+static int
+funopen_write(void *__notnull const cookie,
+              const char *__notnull const buf,
+              const int size)
+{
+    struct compressed_file *const cf = (struct compressed_file *)cookie;
+    if (!write_data(cf, buf, (uint64_t)size)) {
+        return -1;
+    }
+
+    return size;
+}
+
+static int funopen_close(void *__notnull const cookie) {
+    return close_data((struct compressed_file *)cookie);
+}
+
+static FILE *open_stream(struct compressed_file *__notnull const cf) {
+    return funopen(cf, NULL, funopen_write, NULL, funopen_close);
+}
+
+#elif defined(__linux__)
+
+static ssize_t
+cookie_write(void *__notnull const cookie,
+             const char *__notnull const buf,
+             const size_t size)
+{
+    struct compressed_file *const cf = (struct compressed_file *)cookie;
+    if (!write_data(cf, buf, size)) {
+        return -1;
+    }
+
+    return (ssize_t)size;
+}
+
+static int cookie_close(void *__notnull const cookie) {
+    return close_data((struct compressed_file *)cookie);
+}
+
+static FILE *open_stream(struct compressed_file *__notnull const cf) {
+    const cookie_io_functions_t functions = {
+        .write = cookie_write,
+        .close = cookie_close
+    };
+
+    return fopencookie(cf, "w", functions);
+}
+
+#else
+
+static FILE *open_stream(struct compressed_file *__notnull const cf) {
+    (void)cf;
+    return NULL;
+}
+
+#endif
+
+FILE *
+compressed_file_open(FILE *__notnull const file,
+                     const enum compressed_file_format format,
+                     const uint32_t threads_count,
+                     const bool close_file)
+{
+    if (!compressed_file_format_is_supported(format)) {
+        return NULL;
+    }
+
+    struct compressed_file *const cf = calloc(1, sizeof(*cf));
+    if (cf == NULL) {
+        return NULL;
+    }
+
+    cf->file = file;
+    cf->format = format;
+    cf->close_file = close_file;
+
+    bool opened = false;
+    switch (format) {
+        case COMPRESSED_FILE_FORMAT_GZIP:
+            opened = open_gzip(cf, threads_count);
+            break;
+
+        case COMPRESSED_FILE_FORMAT_ZSTD:
+#if defined(TBD_WITH_ZSTD)
+            opened = open_zstd(cf, threads_count);
+#endif
+
+            break;
+    }
+
+    if (!opened) {
+        free(cf);
+        return NULL;
+    }
+
+    FILE *const stream = open_stream(cf);
+    if (stream == NULL) {
+        /*
+         * Closing without having written anything only releases the stream's
+         * resources, but we mustn't close file, which the caller still owns.
+         */
+
+        cf->close_file = false;
+        cf->failed = true;
+
+        close_data(cf);
+        return NULL;
+    }
+
+    return stream;
+}
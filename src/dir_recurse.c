@@ -9,14 +9,19 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "array.h"
+#include "copy.h"
 #include "dir_recurse.h"
+#include "open_batch.h"
 #include "our_io.h"
 #include "path.h"
+#include "string_buffer.h"
 #include "unused.h"
 
 static inline uint64_t
@@ -310,3 +315,1013 @@ dir_recurse_with_subdirs(
     return E_DIR_RECURSE_OK;
 }
 
+/*
+ * dir_recurse_with_subdirs_parallel() lists directories on worker threads,
+ * while the calling thread walks the listed directories in the same order as
+ * dir_recurse_with_subdirs(), so the callbacks are still called in order, on
+ * the calling thread.
+ *
+ * Every sub-directory found becomes a node pushed onto the deque of the thread
+ * that listed it. Workers take nodes from the back of their own deque, and
+ * steal from the front of another deque once theirs is empty.
+ */
+
+struct dir_node {
+    struct dir_node *parent;
+
+    const char *path;
+    uint64_t path_length;
+    uint64_t name_length;
+
+    int fd;
+    int error;
+
+    struct array entries;
+    struct string_buffer names;
+
+    bool is_listed : 1;
+    bool failed_to_open : 1;
+    bool failed_to_read : 1;
+};
+
+struct dir_node_entry {
+    struct dir_node *subdir;
+
+    uint64_t name_offset;
+    uint64_t name_length;
+
+    unsigned char type;
+};
+
+struct dir_deque {
+    pthread_mutex_t lock;
+
+    struct dir_node **items;
+    uint64_t front;
+    uint64_t back;
+    uint64_t capacity;
+};
+
+struct dir_walker;
+struct dir_walker_thread {
+    pthread_t thread;
+
+    struct dir_walker *walker;
+    uint64_t index;
+
+    /*
+     * The buffer entries are read into is allocated before the thread is
+     * created, so the calling thread knows how many workers it actually has.
+     */
+
+    void *buffer;
+};
+
+struct dir_walker {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t listed_cond;
+
+    struct dir_deque *deques;
+    uint64_t deque_count;
+
+    struct dir_walker_thread *threads;
+    uint64_t thread_count;
+
+    /*
+     * queued_count is the number of nodes in the deques that have not been
+     * claimed by a worker, while pending_count is the number of nodes that
+     * have not yet been listed.
+     */
+
+    uint64_t queued_count;
+    uint64_t pending_count;
+    uint64_t open_fd_count;
+
+    /*
+     * The open-batch is only used by the calling thread, while walking.
+     */
+
+    struct open_batch batch;
+    dir_recurse_filter filter;
+
+    bool has_batch;
+    bool is_finished;
+};
+
+/*
+ * Listed directories keep their fd open so files can later be opened relative
+ * to it, up to a limit, after which they're opened again from their path.
+ */
+
+static const uint64_t MAX_OPEN_DIR_FDS = 128;
+static const uint64_t DIR_BUFFER_SIZE = 32768;
+
+static struct dir_node *
+create_node(struct dir_node *const parent,
+            const char *__notnull const path,
+            const uint64_t path_length,
+            const uint64_t name_length)
+{
+    struct dir_node *const node = calloc(1, sizeof(*node));
+    if (node == NULL) {
+        return NULL;
+    }
+
+    node->parent = parent;
+    node->path = path;
+    node->path_length = path_length;
+    node->name_length = name_length;
+    node->fd = -1;
+
+    return node;
+}
+
+static void
+destroy_node(struct dir_walker *__notnull const walker,
+             struct dir_node *__notnull const node)
+{
+    struct dir_node_entry *entry = node->entries.data;
+    const struct dir_node_entry *const end = node->entries.data_end;
+
+    for (; entry != end; entry++) {
+        if (entry->subdir != NULL) {
+            destroy_node(walker, entry->subdir);
+        }
+    }
+
+    if (node->fd >= 0) {
+        close(node->fd);
+
+        pthread_mutex_lock(&walker->lock);
+        walker->open_fd_count -= 1;
+        pthread_mutex_unlock(&walker->lock);
+    }
+
+    /*
+     * The root node's path belongs to the caller.
+     */
+
+    if (node->parent != NULL) {
+        free((char *)node->path);
+    }
+
+    array_destroy(&node->entries);
+    sb_destroy(&node->names);
+
+    free(node);
+}
+
+static void
+list_node(struct dir_walker *__notnull walker,
+          struct dir_node *__notnull node,
+          uint64_t deque_index,
+          void *__notnull buffer);
+
+static void
+push_node(struct dir_walker *__notnull const walker,
+          const uint64_t deque_index,
+          struct dir_node *__notnull const node,
+          void *__notnull const buffer)
+{
+    struct dir_deque *const deque = walker->deques + deque_index;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->back == deque->capacity) {
+        const uint64_t new_capacity =
+            (deque->capacity != 0) ? deque->capacity * 2 : 16;
+
+        struct dir_node **const items =
+            realloc(deque->items, sizeof(*items) * new_capacity);
+
+        /*
+         * If the deque can't grow, list the node on this thread instead.
+         */
+
+        if (items == NULL) {
+            pthread_mutex_unlock(&deque->lock);
+            pthread_mutex_lock(&walker->lock);
+
+            walker->pending_count += 1;
+            pthread_mutex_unlock(&walker->lock);
+
+            list_node(walker, node, deque_index, buffer);
+            return;
+        }
+
+        deque->items = items;
+        deque->capacity = new_capacity;
+    }
+
+    deque->items[deque->back] = node;
+    deque->back += 1;
+
+    pthread_mutex_unlock(&deque->lock);
+    pthread_mutex_lock(&walker->lock);
+
+    walker->queued_count += 1;
+    walker->pending_count += 1;
+
+    pthread_cond_signal(&walker->work_cond);
+    pthread_mutex_unlock(&walker->lock);
+}
+
+static struct dir_node *
+take_node(struct dir_walker *__notnull const walker, const uint64_t index) {
+    /*
+     * The caller has already claimed one of the queued nodes, so keep looking
+     * until it's found.
+     */
+
+    const uint64_t deque_count = walker->deque_count;
+    do {
+        struct dir_deque *const own = walker->deques + index;
+        pthread_mutex_lock(&own->lock);
+
+        if (own->back != own->front) {
+            own->back -= 1;
+            struct dir_node *const node = own->items[own->back];
+
+            if (own->back == own->front) {
+                own->front = 0;
+                own->back = 0;
+            }
+
+            pthread_mutex_unlock(&own->lock);
+            return node;
+        }
+
+        pthread_mutex_unlock(&own->lock);
+        for (uint64_t i = 1; i != deque_count; i++) {
+            struct dir_deque *const other =
+                walker->deques + ((index + i) % deque_count);
+
+            pthread_mutex_lock(&other->lock);
+            if (other->back == other->front) {
+                pthread_mutex_unlock(&other->lock);
+                continue;
+            }
+
+            struct dir_node *const node = other->items[other->front];
+            other->front += 1;
+
+            if (other->back == other->front) {
+                other->front = 0;
+                other->back = 0;
+            }
+
+            pthread_mutex_unlock(&other->lock);
+            return node;
+        }
+    } while (true);
+}
+
+static inline bool is_dot_or_two_dot(const char *__notnull const name) {
+    if (name[0] != '.') {
+        return false;
+    }
+
+    return (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+static bool
+add_entry(struct dir_node *__notnull const node,
+          const char *__notnull const name,
+          const unsigned char type)
+{
+    switch (type) {
+        case DT_DIR:
+            if (is_dot_or_two_dot(name)) {
+                return true;
+            }
+
+            break;
+
+        case DT_REG:
+            break;
+
+        default:
+            return true;
+    }
+
+    const uint64_t name_length = strlen(name);
+    struct dir_node_entry entry = {
+        .name_offset = node->names.length,
+        .name_length = name_length,
+        .type = type
+    };
+
+    /*
+     * Store the null-terminator as well, so names can be used directly.
+     */
+
+    if (sb_add_c_str(&node->names, name, name_length + 1) != E_STRING_BUFFER_OK)
+    {
+        return false;
+    }
+
+    /*
+     * If the sub-directory's path can't be allocated, subdir is left NULL,
+     * and the failure is reported when the entry is reached.
+     */
+
+    if (type == DT_DIR) {
+        uint64_t subdir_path_length = 0;
+        char *const subdir_path =
+            path_append_component(node->path,
+                                  node->path_length,
+                                  name,
+                                  name_length,
+                                  &subdir_path_length);
+
+        if (subdir_path != NULL) {
+            entry.subdir =
+                create_node(node, subdir_path, subdir_path_length, name_length);
+
+            if (entry.subdir == NULL) {
+                free(subdir_path);
+            }
+        }
+    }
+
+    const enum array_result add_entry_result =
+        array_add_item(&node->entries, sizeof(entry), &entry, NULL);
+
+    if (add_entry_result != E_ARRAY_OK) {
+        if (entry.subdir != NULL) {
+            free((char *)entry.subdir->path);
+            free(entry.subdir);
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static int open_node(const struct dir_node *__notnull const node) {
+    /*
+     * The parent's fd is only closed once all its sub-directories have been
+     * walked, so it can be used here if it was kept open.
+     */
+
+    const struct dir_node *const parent = node->parent;
+    if (parent != NULL && parent->fd >= 0) {
+        const char *const name =
+            node->path + (node->path_length - node->name_length);
+
+        return our_openat(parent->fd, name, O_RDONLY | O_DIRECTORY);
+    }
+
+    return our_open(node->path, O_RDONLY | O_DIRECTORY, 0);
+}
+
+static bool
+read_entries(struct dir_node *__notnull const node,
+             const int fd,
+             void *__notnull const buffer)
+{
+#if defined(__linux__)
+    struct linux_dirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    /*
+     * Read the entries in bulk with getdents64, rather than one at a time
+     * through readdir.
+     */
+
+    do {
+        const ssize_t read_size = our_getdents64(fd, buffer, DIR_BUFFER_SIZE);
+        if (read_size < 0) {
+            return false;
+        }
+
+        if (read_size == 0) {
+            return true;
+        }
+
+        for (ssize_t offset = 0; offset < read_size;) {
+            const struct linux_dirent64 *const entry =
+                (const struct linux_dirent64 *)(buffer + offset);
+
+            if (!add_entry(node, entry->d_name, entry->d_type)) {
+                return false;
+            }
+
+            offset += entry->d_reclen;
+        }
+    } while (true);
+#else
+    (void)buffer;
+
+    /*
+     * fdopendir() takes ownership of the fd it's given, so give it a copy.
+     */
+
+    const int dir_fd = dup(fd);
+    if (dir_fd < 0) {
+        return false;
+    }
+
+    DIR *const dir = our_fdopendir(dir_fd);
+    if (dir == NULL) {
+        close(dir_fd);
+        return false;
+    }
+
+    errno = 0;
+    do {
+        const struct dirent *const entry = our_readdir(dir);
+        if (entry == NULL) {
+            const int error = errno;
+            closedir(dir);
+
+            errno = error;
+            return (error == 0);
+        }
+
+        if (!add_entry(node, entry->d_name, entry->d_type)) {
+            closedir(dir);
+            return false;
+        }
+    } while (true);
+#endif
+}
+
+static void
+list_node(struct dir_walker *__notnull const walker,
+          struct dir_node *__notnull const node,
+          const uint64_t deque_index,
+          void *__notnull const buffer)
+{
+    int fd = node->fd;
+    if (fd < 0) {
+        fd = open_node(node);
+        if (fd < 0) {
+            node->failed_to_open = true;
+            node->error = errno;
+        }
+    }
+
+    if (fd >= 0) {
+        if (!read_entries(node, fd, buffer)) {
+            node->failed_to_read = true;
+            node->error = errno;
+        }
+
+        /*
+         * Decide whether to keep the fd before queueing any sub-directories,
+         * which may open themselves relative to it.
+         */
+
+        pthread_mutex_lock(&walker->lock);
+
+        if (node->fd < 0) {
+            if (walker->open_fd_count < MAX_OPEN_DIR_FDS) {
+                walker->open_fd_count += 1;
+                node->fd = fd;
+            } else {
+                close(fd);
+            }
+        }
+
+        pthread_mutex_unlock(&walker->lock);
+    }
+
+    /*
+     * Push the sub-directories in reverse, so the first sub-directory is the
+     * next node taken from the back of this deque.
+     */
+
+    const struct dir_node_entry *const first = node->entries.data;
+    const struct dir_node_entry *entry = node->entries.data_end;
+
+    while (entry != first) {
+        entry--;
+        if (entry->subdir != NULL) {
+            push_node(walker, deque_index, entry->subdir, buffer);
+        }
+    }
+
+    pthread_mutex_lock(&walker->lock);
+
+    node->is_listed = true;
+    walker->pending_count -= 1;
+
+    if (walker->pending_count == 0) {
+        pthread_cond_broadcast(&walker->work_cond);
+    }
+
+    pthread_cond_broadcast(&walker->listed_cond);
+    pthread_mutex_unlock(&walker->lock);
+}
+
+static void *walker_thread_main(void *__notnull const arg) {
+    const struct dir_walker_thread *const thread =
+        (const struct dir_walker_thread *)arg;
+
+    struct dir_walker *const walker = thread->walker;
+    void *const buffer = thread->buffer;
+
+    pthread_mutex_lock(&walker->lock);
+
+    do {
+        if (walker->is_finished || walker->pending_count == 0) {
+            break;
+        }
+
+        if (walker->queued_count == 0) {
+            pthread_cond_wait(&walker->work_cond, &walker->lock);
+            continue;
+        }
+
+        walker->queued_count -= 1;
+        pthread_mutex_unlock(&walker->lock);
+
+        struct dir_node *const node = take_node(walker, thread->index);
+        list_node(walker, node, thread->index, buffer);
+
+        pthread_mutex_lock(&walker->lock);
+    } while (true);
+
+    pthread_mutex_unlock(&walker->lock);
+    return NULL;
+}
+
+static void
+wait_for_node(struct dir_walker *__notnull const walker,
+              const struct dir_node *__notnull const node)
+{
+    pthread_mutex_lock(&walker->lock);
+
+    while (!node->is_listed) {
+        pthread_cond_wait(&walker->listed_cond, &walker->lock);
+    }
+
+    pthread_mutex_unlock(&walker->lock);
+}
+
+static void
+fill_dirent(struct dirent *__notnull const dirent,
+            const char *__notnull const name,
+            const uint64_t name_length,
+            const unsigned char type)
+{
+    uint64_t copy_length = name_length;
+    if (copy_length > sizeof(dirent->d_name) - 1) {
+        copy_length = sizeof(dirent->d_name) - 1;
+    }
+
+    memcpy(dirent->d_name, name, copy_length);
+    dirent->d_name[copy_length] = '\0';
+    dirent->d_type = type;
+
+#if defined(__APPLE__) || defined(_DIRENT_HAVE_D_NAMLEN)
+    dirent->d_namlen = copy_length;
+#endif
+}
+
+/*
+ * Open the run of files starting at entry, up to the next sub-directory, as a
+ * batch, returning the number of files opened.
+ *
+ * The run stops at sub-directories so that no more than one batch of files is
+ * open at once for each level of sub-directories being walked.
+ */
+
+static uint32_t
+open_next_batch(struct dir_walker *__notnull const walker,
+                const struct dir_node *__notnull const node,
+                const struct dir_node_entry *entry,
+                const int dir_fd,
+                const int file_open_flags,
+                void *const callback_info,
+                struct open_batch_result *__notnull const results)
+{
+    const char *names[OPEN_BATCH_MAX_COUNT];
+    const struct dir_node_entry *const end = node->entries.data_end;
+
+    uint32_t count = 0;
+    for (; entry != end && count != OPEN_BATCH_MAX_COUNT; entry++) {
+        if (entry->type == DT_DIR) {
+            break;
+        }
+
+        names[count] = node->names.data + entry->name_offset;
+        count++;
+    }
+
+    open_batch_run(&walker->batch,
+                   dir_fd,
+                   names,
+                   count,
+                   file_open_flags,
+                   walker->filter,
+                   callback_info,
+                   results);
+
+    return count;
+}
+
+/*
+ * As when walking serially, a callback asking to stop only stops the walk of
+ * the directory it was called for, with the walk of its parent going on.
+ *
+ * A stopped walk is incomplete, as the sub-directories it didn't reach may
+ * still be listed by a worker, and so can't be destroyed until the workers
+ * have stopped.
+ */
+
+enum walk_node_result {
+    E_WALK_NODE_COMPLETE,
+    E_WALK_NODE_INCOMPLETE
+};
+
+/*
+ * fail_callback isn't marked __notnull here, as that would also mark the NULL
+ * dirent passed for E_DIR_RECURSE_FAILED_TO_READ_ENTRY.
+ */
+
+static enum walk_node_result
+walk_node(struct dir_walker *__notnull const walker,
+          struct dir_node *__notnull const node,
+          const int file_open_flags,
+          void *const callback_info,
+          __notnull const dir_recurse_callback callback,
+          const dir_recurse_fail_callback fail_callback)
+{
+    const char *const dir_path = node->path;
+    const uint64_t dir_path_length = node->path_length;
+
+    /*
+     * The node's fd may have been closed after it was listed, in which case the
+     * directory is opened again here, but only once a file is actually found.
+     */
+
+    int dir_fd = node->fd;
+    bool opened_dir_fd = false;
+    bool should_exit = false;
+    bool is_complete = true;
+
+    struct open_batch_result results[OPEN_BATCH_MAX_COUNT];
+    uint32_t batch_index = 0;
+    uint32_t batch_count = 0;
+
+    struct dirent dirent = {};
+    struct dir_node_entry *entry = node->entries.data;
+    const struct dir_node_entry *const end = node->entries.data_end;
+
+    for (; entry != end; entry++) {
+        const char *const name = node->names.data + entry->name_offset;
+        const uint64_t name_length = entry->name_length;
+
+        fill_dirent(&dirent, name, name_length, entry->type);
+
+        if (entry->type == DT_DIR) {
+            struct dir_node *const subdir = entry->subdir;
+            if (subdir == NULL) {
+                const bool should_continue =
+                    fail_callback(dir_path,
+                                  dir_path_length,
+                                  E_DIR_RECURSE_FAILED_TO_ALLOC_PATH,
+                                  &dirent,
+                                  callback_info);
+
+                if (!should_continue) {
+                    should_exit = true;
+                    break;
+                }
+
+                continue;
+            }
+
+            wait_for_node(walker, subdir);
+            if (subdir->failed_to_open) {
+                errno = subdir->error;
+
+                const bool should_continue =
+                    fail_callback(subdir->path,
+                                  subdir->path_length,
+                                  E_DIR_RECURSE_FAILED_TO_OPEN_SUBDIR,
+                                  &dirent,
+                                  callback_info);
+
+                if (!should_continue) {
+                    should_exit = true;
+                    break;
+                }
+
+                continue;
+            }
+
+            const enum walk_node_result walk_subdir_result =
+                walk_node(walker,
+                          subdir,
+                          file_open_flags,
+                          callback_info,
+                          callback,
+                          fail_callback);
+
+            /*
+             * If every node within subdir has been walked, and so listed, no
+             * worker can still be using it. Otherwise, it's left to be
+             * destroyed once the workers have stopped.
+             */
+
+            if (walk_subdir_result == E_WALK_NODE_INCOMPLETE) {
+                is_complete = false;
+                continue;
+            }
+
+            destroy_node(walker, subdir);
+            entry->subdir = NULL;
+
+            continue;
+        }
+
+        if (dir_fd < 0) {
+            dir_fd = our_open(dir_path, O_RDONLY | O_DIRECTORY, 0);
+            opened_dir_fd = (dir_fd >= 0);
+        }
+
+        int fd = -1;
+        if (walker->has_batch && dir_fd >= 0) {
+            if (batch_index == batch_count) {
+                batch_count =
+                    open_next_batch(walker,
+                                    node,
+                                    entry,
+                                    dir_fd,
+                                    file_open_flags,
+                                    callback_info,
+                                    results);
+
+                batch_index = 0;
+            }
+
+            const struct open_batch_result result = results[batch_index];
+            batch_index++;
+
+            /*
+             * A file that was filtered out has no error.
+             */
+
+            fd = result.fd;
+            if (fd < 0) {
+                if (result.error == 0) {
+                    continue;
+                }
+
+                errno = result.error;
+            }
+        } else if (dir_fd >= 0) {
+            fd = our_openat(dir_fd, name, file_open_flags);
+        }
+
+        if (fd < 0) {
+            const bool should_continue =
+                fail_callback(dir_path,
+                              dir_path_length,
+                              E_DIR_RECURSE_FAILED_TO_OPEN_FILE,
+                              &dirent,
+                              callback_info);
+
+            if (!should_continue) {
+                should_exit = true;
+                break;
+            }
+
+            continue;
+        }
+
+        const bool callback_result =
+            callback(dir_path,
+                     dir_path_length,
+                     fd,
+                     &dirent,
+                     name_length,
+                     callback_info);
+
+        if (!callback_result) {
+            should_exit = true;
+            break;
+        }
+    }
+
+    /*
+     * Close any files left open in the batch if the walk was stopped early.
+     */
+
+    for (; batch_index != batch_count; batch_index++) {
+        const int fd = results[batch_index].fd;
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    if (opened_dir_fd) {
+        close(dir_fd);
+    }
+
+    if (should_exit) {
+        return E_WALK_NODE_INCOMPLETE;
+    }
+
+    if (node->failed_to_read) {
+        errno = node->error;
+        fail_callback(dir_path,
+                      dir_path_length,
+                      E_DIR_RECURSE_FAILED_TO_READ_ENTRY,
+                      NULL,
+                      callback_info);
+    }
+
+    if (!is_complete) {
+        return E_WALK_NODE_INCOMPLETE;
+    }
+
+    return E_WALK_NODE_COMPLETE;
+}
+
+static void destroy_walker(struct dir_walker *__notnull const walker) {
+    struct dir_deque *deque = walker->deques;
+    const struct dir_deque *const end = deque + walker->deque_count;
+
+    for (; deque != end; deque++) {
+        pthread_mutex_destroy(&deque->lock);
+        free(deque->items);
+    }
+
+    free(walker->deques);
+    free(walker->threads);
+
+    pthread_cond_destroy(&walker->listed_cond);
+    pthread_cond_destroy(&walker->work_cond);
+    pthread_mutex_destroy(&walker->lock);
+}
+
+static bool
+create_walker(struct dir_walker *__notnull const walker,
+              const uint64_t thread_count)
+{
+    const uint64_t deque_count = thread_count + 1;
+
+    walker->deques = calloc(deque_count, sizeof(*walker->deques));
+    if (walker->deques == NULL) {
+        return false;
+    }
+
+    walker->threads = calloc(thread_count, sizeof(*walker->threads));
+    if (walker->threads == NULL) {
+        free(walker->deques);
+        return false;
+    }
+
+    pthread_mutex_init(&walker->lock, NULL);
+    pthread_cond_init(&walker->work_cond, NULL);
+    pthread_cond_init(&walker->listed_cond, NULL);
+
+    for (uint64_t i = 0; i != deque_count; i++) {
+        pthread_mutex_init(&walker->deques[i].lock, NULL);
+    }
+
+    walker->deque_count = deque_count;
+    return true;
+}
+
+static void finish_walker(struct dir_walker *__notnull const walker) {
+    pthread_mutex_lock(&walker->lock);
+
+    walker->is_finished = true;
+    pthread_cond_broadcast(&walker->work_cond);
+
+    pthread_mutex_unlock(&walker->lock);
+
+    struct dir_walker_thread *thread = walker->threads;
+    const struct dir_walker_thread *const end = thread + walker->thread_count;
+
+    for (; thread != end; thread++) {
+        pthread_join(thread->thread, NULL);
+        free(thread->buffer);
+    }
+}
+
+enum dir_recurse_result
+dir_recurse_with_subdirs_parallel(
+    const char *__notnull const dir_path,
+    const uint64_t dir_path_length,
+    const int file_open_flags,
+    const uint32_t thread_count,
+    void *const callback_info,
+    const dir_recurse_filter filter,
+    __notnull const dir_recurse_callback callback,
+    __notnull const dir_recurse_fail_callback fail_callback)
+{
+    const int dir_fd = our_open(dir_path, O_RDONLY | O_DIRECTORY, 0);
+    if (dir_fd < 0) {
+        return E_DIR_RECURSE_FAILED_TO_OPEN;
+    }
+
+    struct dir_walker walker = {};
+    struct dir_node *root = NULL;
+    void *buffer = NULL;
+
+    if (create_walker(&walker, thread_count)) {
+        root = create_node(NULL, dir_path, dir_path_length, 0);
+        buffer = malloc(DIR_BUFFER_SIZE);
+    }
+
+    if (root != NULL && buffer != NULL) {
+        root->fd = dir_fd;
+
+        walker.open_fd_count = 1;
+        walker.pending_count = 1;
+
+        for (uint32_t i = 0; i != thread_count; i++) {
+            struct dir_walker_thread *const thread = walker.threads + i;
+
+            thread->walker = &walker;
+            thread->index = i;
+            thread->buffer = malloc(DIR_BUFFER_SIZE);
+
+            /*
+             * The walk goes on with whichever workers were created, and if
+             * none were, falls back to walking serially below.
+             */
+
+            if (thread->buffer == NULL) {
+                break;
+            }
+
+            const int create_thread_result =
+                pthread_create(&thread->thread,
+                               NULL,
+                               walker_thread_main,
+                               thread);
+
+            if (create_thread_result != 0) {
+                free(thread->buffer);
+                break;
+            }
+
+            walker.thread_count += 1;
+        }
+    }
+
+    /*
+     * Fall back to walking serially if the walker couldn't be created.
+     */
+
+    if (walker.thread_count == 0) {
+        if (walker.deques != NULL) {
+            destroy_walker(&walker);
+        }
+
+        free(root);
+        free(buffer);
+
+        const enum dir_recurse_result recurse_dir_result =
+            recurse_dir_fd(dir_fd,
+                           dir_path,
+                           dir_path_length,
+                           file_open_flags,
+                           callback_info,
+                           callback,
+                           fail_callback);
+
+        return recurse_dir_result;
+    }
+
+    /*
+     * The last deque belongs to this thread, which lists the root node itself.
+     */
+
+    list_node(&walker, root, walker.deque_count - 1, buffer);
+
+    walker.filter = filter;
+    walker.has_batch = open_batch_create(&walker.batch);
+
+    walk_node(&walker,
+              root,
+              file_open_flags,
+              callback_info,
+              callback,
+              fail_callback);
+
+    if (walker.has_batch) {
+        open_batch_destroy(&walker.batch);
+    }
+
+    finish_walker(&walker);
+    destroy_node(&walker, root);
+
+    destroy_walker(&walker);
+    free(buffer);
+
+    return E_DIR_RECURSE_OK;
+}
@@ -6,17 +6,19 @@
 //  Copyright © 2018 - 2020 inoahdev. All rights reserved.
 //
 
+#include <string.h>
 #include <unistd.h>
 
 #include "mach-o/loader.h"
 #include "mach-o/fat.h"
+#include "mach-o/nlist.h"
 
 #include "dsc_image.h"
 #include "macho_file_parse_load_commands.h"
 #include "macho_file_parse_export_trie.h"
 #include "macho_file_parse_symtab.h"
+#include "swap.h"
 #include "tbd.h"
-#include "unused.h"
 
 /*
  * We avoid copying code by handing most of the mach-o parsing over to the
@@ -152,13 +154,13 @@ translate_macho_file_parse_result(const enum macho_file_parse_result result) {
  */
 
 static uint64_t
-get_offset_from_addr(struct dyld_shared_cache_info *__notnull const info,
-                     const uint64_t address,
-                     uint64_t *__notnull const max_size_out)
+get_offset_in_file(const struct dyld_shared_cache_file *__notnull const file,
+                   const uint64_t address,
+                   uint64_t *__notnull const max_size_out)
 {
-    const uint64_t count = info->mappings_count;
+    const uint64_t count = file->mappings_count;
 
-    const struct dyld_cache_mapping_info *mapping = info->mappings;
+    const struct dyld_cache_mapping_info *mapping = file->mappings;
     const struct dyld_cache_mapping_info *const end = mapping + count;
 
     for (; mapping != end; mapping++) {
@@ -184,6 +186,181 @@ get_offset_from_addr(struct dyld_shared_cache_info *__notnull const info,
     return 0;
 }
 
+/*
+ * The mappings of a split dyld_shared_cache are spread across the main
+ * cache-file and its subcaches, so the file whose mappings contain address is
+ * returned in file_out.
+ */
+
+static uint64_t
+get_offset_from_addr(const struct dyld_shared_cache_info *__notnull const info,
+                     const uint64_t address,
+                     uint64_t *__notnull const max_size_out,
+                     struct dyld_shared_cache_file *__notnull const file_out)
+{
+    const struct dyld_shared_cache_file main_file = {
+        .map = info->map,
+        .size = info->size,
+
+        .mappings = info->mappings,
+        .mappings_count = info->mappings_count,
+
+        .available_range = info->available_range
+    };
+
+    const uint64_t main_offset =
+        get_offset_in_file(&main_file, address, max_size_out);
+
+    if (main_offset != 0) {
+        *file_out = main_file;
+        return main_offset;
+    }
+
+    const struct dyld_shared_cache_file *file = info->subcaches;
+    const struct dyld_shared_cache_file *const end =
+        file + info->subcaches_count;
+
+    for (; file != end; file++) {
+        const uint64_t offset = get_offset_in_file(file, address, max_size_out);
+        if (offset != 0) {
+            *file_out = *file;
+            return offset;
+        }
+    }
+
+    return 0;
+}
+
+static const uint8_t *
+get_data_at_address(const void *const info,
+                    const uint64_t address,
+                    const uint64_t size)
+{
+    struct dyld_shared_cache_file file = {};
+    uint64_t max_size = 0;
+
+    const uint64_t offset =
+        get_offset_from_addr(info, address, &max_size, &file);
+
+    if (offset == 0 || max_size < size) {
+        return NULL;
+    }
+
+    return file.map + offset;
+}
+
+/*
+ * The data that an image's export-trie and symbol-table offsets are relative
+ * to, with the range of offsets that can be read from it.
+ */
+
+struct linkedit_map {
+    const uint8_t *map;
+    struct range available_range;
+};
+
+/*
+ * The images of a split dyld_shared_cache have their __LINKEDIT in a different
+ * file than their header, with the export-trie and symbol-table offsets
+ * relative to that file, so __LINKEDIT's file is found by the segment's
+ * address.
+ */
+
+static bool
+find_linkedit_map(const struct dyld_shared_cache_info *__notnull const info,
+                  const uint8_t *__notnull const load_commands,
+                  const uint32_t ncmds,
+                  const uint32_t sizeofcmds,
+                  const struct macho_file_parse_lc_flags flags,
+                  struct linkedit_map *__notnull const linkedit_out)
+{
+    const uint8_t *iter = load_commands;
+    uint32_t size_left = sizeofcmds;
+
+    for (uint32_t i = 0; i != ncmds; i++) {
+        if (size_left < sizeof(struct load_command)) {
+            return false;
+        }
+
+        const struct load_command *const load_cmd =
+            (const struct load_command *)iter;
+
+        uint32_t cmd = load_cmd->cmd;
+        uint32_t cmdsize = load_cmd->cmdsize;
+
+        if (flags.is_big_endian) {
+            cmd = swap_uint32(cmd);
+            cmdsize = swap_uint32(cmdsize);
+        }
+
+        if (cmdsize < sizeof(struct load_command) || cmdsize > size_left) {
+            return false;
+        }
+
+        uint64_t vmaddr = 0;
+        uint64_t fileoff = 0;
+
+        if (cmd == LC_SEGMENT_64 && flags.is_64) {
+            if (cmdsize < sizeof(struct segment_command_64)) {
+                return false;
+            }
+
+            const struct segment_command_64 *const segment =
+                (const struct segment_command_64 *)iter;
+
+            if (strncmp(segment->segname, SEG_LINKEDIT, 16) == 0) {
+                vmaddr = segment->vmaddr;
+                fileoff = segment->fileoff;
+
+                if (flags.is_big_endian) {
+                    vmaddr = swap_uint64(vmaddr);
+                    fileoff = swap_uint64(fileoff);
+                }
+            }
+        } else if (cmd == LC_SEGMENT && !flags.is_64) {
+            if (cmdsize < sizeof(struct segment_command)) {
+                return false;
+            }
+
+            const struct segment_command *const segment =
+                (const struct segment_command *)iter;
+
+            if (strncmp(segment->segname, SEG_LINKEDIT, 16) == 0) {
+                vmaddr = segment->vmaddr;
+                fileoff = segment->fileoff;
+
+                if (flags.is_big_endian) {
+                    vmaddr = swap_uint32((uint32_t)vmaddr);
+                    fileoff = swap_uint32((uint32_t)fileoff);
+                }
+            }
+        }
+
+        if (vmaddr != 0) {
+            struct dyld_shared_cache_file file = {};
+            uint64_t max_size = 0;
+
+            const uint64_t offset =
+                get_offset_from_addr(info, vmaddr, &max_size, &file);
+
+            if (offset == 0 || offset < fileoff) {
+                return false;
+            }
+
+            linkedit_out->map = file.map + (offset - fileoff);
+            linkedit_out->available_range.begin = fileoff;
+            linkedit_out->available_range.end = fileoff + max_size;
+
+            return true;
+        }
+
+        iter += cmdsize;
+        size_left -= cmdsize;
+    }
+
+    return false;
+}
+
 static inline bool
 call_callback(const macho_file_parse_error_callback callback,
               struct tbd_create_info *__notnull const info_in,
@@ -199,20 +376,85 @@ call_callback(const macho_file_parse_error_callback callback,
     return false;
 }
 
-enum dsc_image_parse_result
-dsc_image_parse(struct tbd_create_info *__notnull const info_in,
-                struct dyld_shared_cache_info *__notnull const dsc_info,
-                struct dyld_cache_image_info *__notnull const image,
-                const macho_file_parse_error_callback callback,
-                void *const cb_info,
-                struct string_buffer *__notnull const export_trie_sb,
-                struct macho_file_parse_options macho_options,
-                const struct tbd_parse_options tbd_options,
-                __unused const struct dsc_image_parse_options options)
+/*
+ * The parts of the shared-cache read while parsing an image, to be dropped
+ * afterwards.
+ */
+
+struct image_region {
+    const uint8_t *data;
+    uint64_t size;
+};
+
+struct image_regions {
+    struct image_region header;
+    struct image_region exports;
+    struct image_region symbols;
+    struct image_region strings;
+};
+
+static void
+set_region(struct image_region *__notnull const region,
+           const struct linkedit_map *__notnull const linkedit,
+           const uint64_t offset,
+           const uint64_t size)
 {
+    const struct range range = {
+        .begin = offset,
+        .end = offset + size
+    };
+
+    if (!range_contains_other(linkedit->available_range, range)) {
+        return;
+    }
+
+    region->data = linkedit->map + offset;
+    region->size = size;
+}
+
+static void
+set_linkedit_regions(
+    struct image_regions *__notnull const regions,
+    const struct linkedit_map *__notnull const linkedit,
+    const struct macho_file_lc_info_out *__notnull const lc_info,
+    const bool is_64)
+{
+    set_region(&regions->exports,
+               linkedit,
+               lc_info->export_off,
+               lc_info->export_size);
+
+    const uint64_t nlist_size =
+        (is_64) ? sizeof(struct nlist_64) : sizeof(struct nlist);
+
+    set_region(&regions->symbols,
+               linkedit,
+               lc_info->symtab.symoff,
+               nlist_size * lc_info->symtab.nsyms);
+
+    set_region(&regions->strings,
+               linkedit,
+               lc_info->symtab.stroff,
+               lc_info->symtab.strsize);
+}
+
+static enum dsc_image_parse_result
+parse_image(struct tbd_create_info *__notnull const info_in,
+            struct dyld_shared_cache_info *__notnull const dsc_info,
+            struct dyld_cache_image_info *__notnull const image,
+            const macho_file_parse_error_callback callback,
+            void *const cb_info,
+            struct string_buffer *__notnull const export_trie_sb,
+            struct macho_file_parse_options macho_options,
+            const struct tbd_parse_options tbd_options,
+            const uint64_t target_index,
+            struct image_regions *__notnull const regions)
+{
+    struct dyld_shared_cache_file file = {};
     uint64_t max_image_size = 0;
+
     const uint64_t file_offset =
-        get_offset_from_addr(dsc_info, image->address, &max_image_size);
+        get_offset_from_addr(dsc_info, image->address, &max_image_size, &file);
 
     if (file_offset == 0) {
         return E_DSC_IMAGE_PARSE_NO_MAPPING;
@@ -222,7 +464,7 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
         return E_DSC_IMAGE_PARSE_SIZE_TOO_SMALL;
     }
 
-    const uint8_t *const map = dsc_info->map;
+    const uint8_t *const map = file.map;
     const struct mach_header *const header =
         (const struct mach_header *)(map + file_offset);
 
@@ -300,15 +542,24 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
     const uint32_t header_size =
         (is_64) ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
 
+    regions->header.data = (const uint8_t *)header;
+    regions->header.size = header_size + header->sizeofcmds;
+
+    if (regions->header.size > max_image_size) {
+        regions->header.size = max_image_size;
+    }
+
     struct mf_parse_lc_from_map_info info = {
         .map = map,
-        .map_size = dsc_info->size,
+        .map_size = file.size,
 
         .macho = (const uint8_t *)header,
         .macho_size = max_image_size,
 
         .arch = dsc_info->arch,
-        .available_map_range = dsc_info->available_range,
+        .arch_index = target_index,
+
+        .available_map_range = file.available_range,
 
         .ncmds = header->ncmds,
         .sizeofcmds = header->sizeofcmds,
@@ -320,6 +571,11 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
         .flags = lc_flags
     };
 
+    if (dsc_info->subcaches_count != 0) {
+        info.get_data_at_address = get_data_at_address;
+        info.get_data_at_address_info = dsc_info;
+    }
+
     struct macho_file_parse_extra_args extra = {
         .callback = callback,
         .cb_info = cb_info,
@@ -337,6 +593,30 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
         return translate_macho_file_parse_result(parse_load_commands_result);
     }
 
+    struct linkedit_map linkedit = {
+        .map = map,
+        .available_range = file.available_range
+    };
+
+    if (dsc_info->subcaches_count != 0) {
+        /*
+         * The load-commands were already verified to fit in the image when
+         * parsed above.
+         */
+
+        const uint8_t *const load_commands =
+            (const uint8_t *)header + header_size;
+
+        find_linkedit_map(dsc_info,
+                          load_commands,
+                          header->ncmds,
+                          header->sizeofcmds,
+                          lc_flags,
+                          &linkedit);
+    }
+
+    set_linkedit_regions(regions, &linkedit, &lc_info, is_64);
+
     bool parsed_dyld_info = false;
     bool parse_symtab = true;
 
@@ -350,7 +630,8 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
         if (lc_info.export_off != 0 && lc_info.export_size != 0) {
             const struct macho_file_parse_export_trie_args args = {
                 .info_in = info_in,
-                .available_range = dsc_info->available_range,
+                .available_range = linkedit.available_range,
+                .arch_index = target_index,
 
                 .is_64 = is_64,
                 .is_big_endian = is_big_endian,
@@ -362,7 +643,7 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
                 .tbd_options = tbd_options
             };
 
-            ret = macho_file_parse_export_trie_from_map(args, map);
+            ret = macho_file_parse_export_trie_from_map(args, linkedit.map);
             if (ret != E_MACHO_FILE_PARSE_OK) {
                 return translate_macho_file_parse_result(ret);
             }
@@ -383,23 +664,25 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
     if (parse_symtab) {
         const struct macho_file_parse_symtab_args args = {
             .info_in = info_in,
-            .available_range = dsc_info->available_range,
+            .available_range = linkedit.available_range,
 
             .is_big_endian = is_big_endian,
+            .copy_strings = macho_options.copy_strings_in_map,
 
             .symoff = lc_info.symtab.symoff,
             .nsyms = lc_info.symtab.nsyms,
 
             .stroff = lc_info.symtab.stroff,
             .strsize = lc_info.symtab.strsize,
+            .arch_index = target_index,
 
             .tbd_options = tbd_options
         };
 
         if (is_64) {
-            ret = macho_file_parse_symtab_64_from_map(&args, map);
+            ret = macho_file_parse_symtab_64_from_map(&args, linkedit.map);
         } else {
-            ret = macho_file_parse_symtab_from_map(&args, map);
+            ret = macho_file_parse_symtab_from_map(&args, linkedit.map);
         }
     } else if (!parsed_dyld_info) {
         /*
@@ -420,3 +703,138 @@ dsc_image_parse(struct tbd_create_info *__notnull const info_in,
 
     return E_DSC_IMAGE_PARSE_OK;
 }
+
+enum dsc_image_parse_result
+dsc_image_parse(struct tbd_create_info *__notnull const info_in,
+                struct dyld_shared_cache_info *__notnull const dsc_info,
+                struct dyld_cache_image_info *__notnull const image,
+                const macho_file_parse_error_callback callback,
+                void *const cb_info,
+                struct string_buffer *__notnull const export_trie_sb,
+                struct macho_file_parse_options macho_options,
+                const struct tbd_parse_options tbd_options,
+                const struct dsc_image_parse_options options)
+{
+    if (options.drop_pages) {
+        macho_options.copy_strings_in_map = true;
+    }
+
+    /*
+     * The image's metadata and symbols are ingested unsorted, and are only
+     * sorted once the image has been fully parsed.
+     */
+
+    tbd_ci_begin_ingesting(info_in);
+
+    struct image_regions regions = {};
+    const enum dsc_image_parse_result ret =
+        parse_image(info_in,
+                    dsc_info,
+                    image,
+                    callback,
+                    cb_info,
+                    export_trie_sb,
+                    macho_options,
+                    tbd_options,
+                    options.target_index,
+                    &regions);
+
+    tbd_ci_finish_ingesting(info_in);
+
+    if (options.drop_pages) {
+        const struct image_region *region = &regions.header;
+        const struct image_region *const end = &regions.strings + 1;
+
+        for (; region != end; region++) {
+            if (region->size != 0) {
+                dyld_shared_cache_drop_pages(dsc_info,
+                                             region->data,
+                                             region->size);
+            }
+        }
+    }
+
+    return ret;
+}
+
+bool
+dsc_image_get_uuid(
+    const struct dyld_shared_cache_info *__notnull const dsc_info,
+    const struct dyld_cache_image_info *__notnull const image,
+    uint8_t *__notnull const uuid_out)
+{
+    struct dyld_shared_cache_file file = {};
+    uint64_t max_image_size = 0;
+
+    const uint64_t file_offset =
+        get_offset_from_addr(dsc_info, image->address, &max_image_size, &file);
+
+    if (file_offset == 0 || max_image_size < sizeof(struct mach_header_64)) {
+        return false;
+    }
+
+    const struct mach_header *const header =
+        (const struct mach_header *)(file.map + file_offset);
+
+    const uint32_t magic = header->magic;
+
+    const bool is_64 = (magic == MH_MAGIC_64 || magic == MH_CIGAM_64);
+    const bool is_big_endian = (magic == MH_CIGAM || magic == MH_CIGAM_64);
+
+    if (!is_64 && magic != MH_MAGIC && magic != MH_CIGAM) {
+        return false;
+    }
+
+    uint32_t ncmds = header->ncmds;
+    uint32_t sizeofcmds = header->sizeofcmds;
+
+    if (is_big_endian) {
+        ncmds = swap_uint32(ncmds);
+        sizeofcmds = swap_uint32(sizeofcmds);
+    }
+
+    const uint32_t header_size =
+        (is_64) ? sizeof(struct mach_header_64) : sizeof(struct mach_header);
+
+    if (sizeofcmds > max_image_size - header_size) {
+        return false;
+    }
+
+    const uint8_t *iter = (const uint8_t *)header + header_size;
+    uint32_t size_left = sizeofcmds;
+
+    for (uint32_t i = 0; i != ncmds; i++) {
+        if (size_left < sizeof(struct load_command)) {
+            return false;
+        }
+
+        struct load_command load_cmd = *(const struct load_command *)iter;
+        if (is_big_endian) {
+            load_cmd.cmd = swap_uint32(load_cmd.cmd);
+            load_cmd.cmdsize = swap_uint32(load_cmd.cmdsize);
+        }
+
+        if (load_cmd.cmdsize < sizeof(struct load_command) ||
+            load_cmd.cmdsize > size_left)
+        {
+            return false;
+        }
+
+        if (load_cmd.cmd == LC_UUID) {
+            if (load_cmd.cmdsize < sizeof(struct uuid_command)) {
+                return false;
+            }
+
+            const struct uuid_command *const uuid_cmd =
+                (const struct uuid_command *)iter;
+
+            memcpy(uuid_out, uuid_cmd->uuid, sizeof(uuid_cmd->uuid));
+            return true;
+        }
+
+        iter += load_cmd.cmdsize;
+        size_left -= load_cmd.cmdsize;
+    }
+
+    return false;
+}
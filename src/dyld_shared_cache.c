@@ -10,7 +10,10 @@
 #include <sys/stat.h>
 
 #include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -19,12 +22,400 @@
 #include "dyld_shared_cache.h"
 #include "dyld_shared_cache_format.h"
 #include "guard_overflow.h"
+#include "mach/vm_prot.h"
 #include "our_io.h"
 #include "range.h"
 
 static const uint64_t dsc_magic_64_normal = 2319765435151317348;
 static const uint64_t dsc_magic_64_arm64_32 = 7003509047616633188;
 
+/*
+ * Apply advice to the pages of map covering the file-range begin to end.
+ * Failures are ignored, as advice is only a hint.
+ */
+
+static void
+advise_range(uint8_t *__notnull const map,
+             const uint64_t begin,
+             const uint64_t end,
+             const int advice)
+{
+    const uint64_t page_mask = (uint64_t)sysconf(_SC_PAGESIZE) - 1;
+    const uint64_t page_begin = begin & ~page_mask;
+
+    if (page_begin >= end) {
+        return;
+    }
+
+    madvise(map + page_begin, end - page_begin, advice);
+}
+
+/*
+ * Verify that the mappings of a shared-cache file of size file_size lie within
+ * the file, and don't overlap.
+ */
+
+static enum dyld_shared_cache_parse_result
+verify_mappings(const struct dyld_cache_mapping_info *__notnull const list,
+                const uint32_t count,
+                const uint64_t file_size)
+{
+    /*
+     * We use full_cache_range to verify our dsc-mappings.
+     *
+     * Our mappings are comparable to mach-o segments, recording the information
+     * of large swaths of file and address-space in the entire dyld_shared_cache
+     * file.
+     */
+
+    const struct range full_cache_range = {
+        .begin = 0,
+        .end = file_size
+    };
+
+    /*
+     * Verify we don't have any overlapping mappings.
+     */
+
+    const struct dyld_cache_mapping_info *mapping = list;
+    const struct dyld_cache_mapping_info *const mappings_end = mapping + count;
+
+    for (; mapping != mappings_end; mapping++) {
+        const uint64_t mapping_file_begin = mapping->fileOffset;
+
+        /*
+         * We skip validation of mapping's address-range we don't use it, and
+         * because we aim to be lenient.
+         */
+
+        uint64_t mapping_file_end = mapping_file_begin;
+        if (guard_overflow_add(&mapping_file_end, mapping->size)) {
+            return E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS;
+        }
+
+        const struct range mapping_file_range = {
+            .begin = mapping_file_begin,
+            .end = mapping_file_end
+        };
+
+        if (!range_contains_other(full_cache_range, mapping_file_range)) {
+            return E_DYLD_SHARED_CACHE_PARSE_INVALID_MAPPINGS;
+        }
+
+        /*
+         * Check the previous mappings, which conveniently have already gone
+         * through verification in this loop before, for any overlaps with the
+         * current mapping.
+         */
+
+        const struct dyld_cache_mapping_info *inner = list;
+        for (; inner != mapping; inner++) {
+            const uint64_t inner_file_begin = inner->fileOffset;
+            const uint64_t inner_file_end = inner_file_begin + inner->size;
+
+            const struct range inner_file_range = {
+                .begin = inner_file_begin,
+                .end = inner_file_end
+            };
+
+            if (!ranges_overlap(mapping_file_range, inner_file_range)) {
+                continue;
+            }
+
+            return E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS;
+        }
+    }
+
+    return E_DYLD_SHARED_CACHE_PARSE_OK;
+}
+
+static void
+advise_mappings(uint8_t *__notnull const map,
+                const struct dyld_cache_mapping_info *__notnull const list,
+                const uint32_t count)
+{
+#if defined(MADV_HUGEPAGE)
+    /*
+     * The read-only mappings hold __LINKEDIT, which every image reads from, and
+     * is large enough that huge pages noticeably cut down on TLB misses.
+     */
+
+    const struct dyld_cache_mapping_info *mapping = list;
+    const struct dyld_cache_mapping_info *const mappings_end = mapping + count;
+
+    for (; mapping != mappings_end; mapping++) {
+        if (mapping->initProt != (uint32_t)VM_PROT_READ) {
+            continue;
+        }
+
+        const uint64_t mapping_file_end = mapping->fileOffset + mapping->size;
+        advise_range(map, mapping->fileOffset, mapping_file_end, MADV_HUGEPAGE);
+    }
+#else
+    (void)map;
+    (void)list;
+    (void)count;
+#endif
+}
+
+/*
+ * Map the subcache-file at path, verifying that it belongs to the main
+ * cache-file by its magic and uuid.
+ */
+
+static enum dyld_shared_cache_parse_result
+map_subcache(struct dyld_shared_cache_file *__notnull const file,
+             const char *__notnull const path,
+             const char magic[const 16],
+             const uint8_t uuid[const 16])
+{
+    const int fd = our_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_OPEN_FAIL;
+    }
+
+    struct dyld_cache_header header = {};
+    if (our_read(fd, &header, sizeof(header)) != sizeof(header)) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH;
+    }
+
+    if (memcmp(header.magic, magic, sizeof(header.magic)) != 0) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH;
+    }
+
+    /*
+     * The uuid is stored before the mapping-infos in any header that lists
+     * subcaches.
+     */
+
+    const uint64_t uuid_end = DYLD_CACHE_HEADER_UUID_OFFSET + 16;
+    if (header.mappingOffset < uuid_end) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH;
+    }
+
+    uint8_t file_uuid[16] = {};
+    const ssize_t read_size =
+        our_pread(fd,
+                  file_uuid,
+                  sizeof(file_uuid),
+                  DYLD_CACHE_HEADER_UUID_OFFSET);
+
+    if (read_size != sizeof(file_uuid)) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH;
+    }
+
+    if (memcmp(file_uuid, uuid, sizeof(file_uuid)) != 0) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH;
+    }
+
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) < 0) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_FSTAT_FAIL;
+    }
+
+    const uint64_t size = (uint64_t)sbuf.st_size;
+
+    uint64_t mappings_size = sizeof(struct dyld_cache_mapping_info);
+    if (guard_overflow_mul(&mappings_size, header.mappingCount)) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    uint64_t mappings_off_end = header.mappingOffset;
+    if (guard_overflow_add(&mappings_off_end, mappings_size)) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    if (mappings_off_end > size) {
+        close(fd);
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    /*
+     * Unlike the main cache-file, nothing is written to a subcache, so it's
+     * mapped read-only.
+     */
+
+    uint8_t *const map = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED) {
+        return E_DYLD_SHARED_CACHE_PARSE_MMAP_FAIL;
+    }
+
+    const struct dyld_cache_mapping_info *const mapping_list =
+        (const struct dyld_cache_mapping_info *)(map + header.mappingOffset);
+
+    const enum dyld_shared_cache_parse_result verify_mappings_result =
+        verify_mappings(mapping_list, header.mappingCount, size);
+
+    if (verify_mappings_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+        munmap(map, size);
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    advise_range(map, 0, size, MADV_RANDOM);
+    advise_mappings(map, mapping_list, header.mappingCount);
+
+    file->map = map;
+    file->size = size;
+
+    file->mappings = mapping_list;
+    file->mappings_count = header.mappingCount;
+
+    file->available_range.begin = mappings_off_end;
+    file->available_range.end = size;
+
+    return E_DYLD_SHARED_CACHE_PARSE_OK;
+}
+
+static void
+unmap_subcaches(struct dyld_shared_cache_file *__notnull const files,
+                const uint32_t count)
+{
+    const struct dyld_shared_cache_file *file = files;
+    const struct dyld_shared_cache_file *const end = files + count;
+
+    for (; file != end; file++) {
+        munmap(file->map, file->size);
+    }
+
+    free(files);
+}
+
+/*
+ * Map every subcache listed in the main cache-file's subcache-array, whose
+ * files are found by appending each subcache's suffix to path.
+ */
+
+static enum dyld_shared_cache_parse_result
+map_subcaches(struct dyld_shared_cache_info *__notnull const info_in,
+              const char *__notnull const path,
+              const char magic[const 16],
+              const uint8_t *__notnull const map,
+              const uint64_t size,
+              const uint32_t mapping_offset)
+{
+    const struct dyld_cache_header_subcaches *const subcaches =
+        (const struct dyld_cache_header_subcaches *)
+            (map + DYLD_CACHE_HEADER_SUBCACHES_OFFSET);
+
+    const uint32_t count = subcaches->subCacheArrayCount;
+    if (count == 0) {
+        return E_DYLD_SHARED_CACHE_PARSE_OK;
+    }
+
+    /*
+     * Entries only store their file's suffix once the header reaches the
+     * cacheSubType field.
+     */
+
+    const bool has_suffixes =
+        (mapping_offset > DYLD_CACHE_HEADER_CACHE_SUB_TYPE_OFFSET);
+
+    const uint64_t entry_size =
+        (has_suffixes) ?
+            sizeof(struct dyld_subcache_entry) :
+            sizeof(struct dyld_subcache_entry_v1);
+
+    uint64_t array_size = entry_size;
+    if (guard_overflow_mul(&array_size, count)) {
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    const uint64_t array_offset = subcaches->subCacheArrayOffset;
+
+    uint64_t array_end = array_offset;
+    if (guard_overflow_add(&array_end, array_size)) {
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    if (array_offset < mapping_offset || array_end > size) {
+        return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+    }
+
+    struct dyld_shared_cache_file *const files =
+        calloc(count, sizeof(struct dyld_shared_cache_file));
+
+    if (files == NULL) {
+        return E_DYLD_SHARED_CACHE_PARSE_ALLOC_FAIL;
+    }
+
+    /*
+     * Suffixes are at most 32 characters, which is more than enough for the
+     * ".<number>" suffix of the first version of the entries.
+     */
+
+    const uint64_t suffix_max =
+        sizeof(((const struct dyld_subcache_entry *)NULL)->fileSuffix);
+    const uint64_t path_length = strlen(path);
+
+    char *const subcache_path = malloc(path_length + suffix_max + 1);
+    if (subcache_path == NULL) {
+        free(files);
+        return E_DYLD_SHARED_CACHE_PARSE_ALLOC_FAIL;
+    }
+
+    memcpy(subcache_path, path, path_length);
+
+    const uint8_t *entry = map + array_offset;
+    uint64_t total_size = 0;
+
+    for (uint32_t i = 0; i != count; i++, entry += entry_size) {
+        char *const suffix = subcache_path + path_length;
+        if (has_suffixes) {
+            const char *const file_suffix =
+                ((const struct dyld_subcache_entry *)entry)->fileSuffix;
+
+            const uint64_t suffix_length = strnlen(file_suffix, suffix_max);
+
+            /*
+             * A suffix is only ever appended to the main cache-file's name, so
+             * it can't lead into another directory.
+             */
+
+            if (memchr(file_suffix, '/', suffix_length) != NULL) {
+                unmap_subcaches(files, i);
+                free(subcache_path);
+
+                return E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES;
+            }
+
+            memcpy(suffix, file_suffix, suffix_length);
+            suffix[suffix_length] = '\0';
+        } else {
+            snprintf(suffix, suffix_max + 1, ".%" PRIu32, i + 1);
+        }
+
+        const enum dyld_shared_cache_parse_result map_subcache_result =
+            map_subcache(files + i, subcache_path, magic, entry);
+
+        if (map_subcache_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+            unmap_subcaches(files, i);
+            free(subcache_path);
+
+            return map_subcache_result;
+        }
+
+        total_size += files[i].size;
+    }
+
+    free(subcache_path);
+
+    info_in->subcaches = files;
+    info_in->subcaches_count = count;
+    info_in->subcaches_size = total_size;
+
+    return E_DYLD_SHARED_CACHE_PARSE_OK;
+}
+
 static int
 get_arch_info_from_magic(const char magic[const 16],
                          const struct arch_info **__notnull const arch_info_out)
@@ -203,6 +594,7 @@ enum dyld_shared_cache_parse_result
 dyld_shared_cache_parse_from_file(
     struct dyld_shared_cache_info *__notnull const info_in,
     const int fd,
+    const char *const path,
     const char magic[16],
     const struct dyld_shared_cache_parse_options options)
 {
@@ -224,6 +616,37 @@ dyld_shared_cache_parse_from_file(
         return E_DYLD_SHARED_CACHE_PARSE_READ_FAIL;
     }
 
+    const uint64_t images_field_end =
+        DYLD_CACHE_HEADER_IMAGES_OFFSET +
+        sizeof(struct dyld_cache_header_images);
+
+    if (header.mappingOffset >= images_field_end) {
+        struct dyld_cache_header_images images = {};
+        const ssize_t read_size =
+            our_pread(fd,
+                      &images,
+                      sizeof(images),
+                      DYLD_CACHE_HEADER_IMAGES_OFFSET);
+
+        if (read_size != sizeof(images)) {
+            return E_DYLD_SHARED_CACHE_PARSE_READ_FAIL;
+        }
+
+        header.imagesOffset = images.imagesOffset;
+        header.imagesCount = images.imagesCount;
+    }
+
+    /*
+     * Only the main cache-file of a split shared-cache lists the images, while
+     * its subcaches, which store the same header, list none.
+     */
+
+    if (header.imagesCount == 0) {
+        if (header.mappingOffset > DYLD_CACHE_HEADER_SUBCACHES_OFFSET) {
+            return E_DYLD_SHARED_CACHE_PARSE_IS_SUBCACHE;
+        }
+    }
+
     /*
      * Validate that the mapping-infos array and images-array have no overflows.
      */
@@ -318,77 +741,33 @@ dyld_shared_cache_parse_from_file(
         return E_DYLD_SHARED_CACHE_PARSE_MMAP_FAIL;
     }
 
-    const struct dyld_cache_mapping_info *const mapping_list =
-        (const struct dyld_cache_mapping_info *)(map + header.mappingOffset);
-
     /*
-     * We use full_cache_range to verify our dsc-mappings.
+     * Images are parsed by jumping between their headers and the export-tries
+     * and symbol-tables in __LINKEDIT, so readahead around each access mostly
+     * pulls in pages that are never read.
      *
-     * Our mappings are comparable to mach-o segments, recording the information
-     * of large swaths of file and address-space in the entire dyld_shared_cache
-     * file.
+     * The header, mapping-infos and image-infos are all read right away, so
+     * they're faulted in ahead of time instead.
      */
 
-    const struct range full_cache_range = {
-        .begin = 0,
-        .end = dsc_size
-    };
-
-    /*
-     * Verify we don't have any overlapping mappings.
-     */
-
-    const struct dyld_cache_mapping_info *mapping = mapping_list;
-    const struct dyld_cache_mapping_info *const mappings_end =
-        mapping + header.mappingCount;
-
-    for (; mapping != mappings_end; mapping++) {
-        const uint64_t mapping_file_begin = mapping->fileOffset;
-
-        /*
-         * We skip validation of mapping's address-range we don't use it, and
-         * because we aim to be lenient.
-         */
-
-        uint64_t mapping_file_end = mapping_file_begin;
-        if (guard_overflow_add(&mapping_file_end, mapping->size)) {
-            munmap(map, dsc_size);
-            return E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS;
-        }
-
-        const struct range mapping_file_range = {
-            .begin = mapping_file_begin,
-            .end = mapping_file_end
-        };
+    advise_range(map, 0, dsc_size, MADV_RANDOM);
 
-        if (!range_contains_other(full_cache_range, mapping_file_range)) {
-            munmap(map, dsc_size);
-            return E_DYLD_SHARED_CACHE_PARSE_INVALID_MAPPINGS;
-        }
+    uint64_t tables_end = images_off_end;
+    if (tables_end < mappings_off_end) {
+        tables_end = mappings_off_end;
+    }
 
-        /*
-         * Check the previous mappings, which conveniently have already gone
-         * through verification in this loop before, for any overlaps with the
-         * current mapping.
-         */
+    advise_range(map, 0, tables_end, MADV_WILLNEED);
 
-        const struct dyld_cache_mapping_info *inner = mapping_list;
-        for (; inner != mapping; inner++) {
-            const uint64_t inner_file_begin = inner->fileOffset;
-            const uint64_t inner_file_end = inner_file_begin + inner->size;
+    const struct dyld_cache_mapping_info *const mapping_list =
+        (const struct dyld_cache_mapping_info *)(map + header.mappingOffset);
 
-            const struct range inner_file_range = {
-                .begin = inner_file_begin,
-                .end = inner_file_end
-            };
+    const enum dyld_shared_cache_parse_result verify_mappings_result =
+        verify_mappings(mapping_list, header.mappingCount, dsc_size);
 
-            if (!ranges_overlap(mapping_file_range, inner_file_range)) {
-                continue;
-            }
-
-            munmap(map, dsc_size);
-            return E_DYLD_SHARED_CACHE_PARSE_OVERLAPPING_MAPPINGS;
-        }
+    if (verify_mappings_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+        munmap(map, dsc_size);
+        return verify_mappings_result;
     }
 
     /*
@@ -405,6 +784,8 @@ dyld_shared_cache_parse_from_file(
         available_range.begin = mappings_off_end;
     }
 
+    advise_mappings(map, mapping_list, header.mappingCount);
+
     struct dyld_cache_image_info *const image_list =
         (struct dyld_cache_image_info *)(map + header.imagesOffset);
 
@@ -451,6 +832,25 @@ dyld_shared_cache_parse_from_file(
         }
     }
 
+    const uint64_t subcaches_field_end =
+        DYLD_CACHE_HEADER_SUBCACHES_OFFSET +
+        sizeof(struct dyld_cache_header_subcaches);
+
+    if (path != NULL && header.mappingOffset >= subcaches_field_end) {
+        const enum dyld_shared_cache_parse_result map_subcaches_result =
+            map_subcaches(info_in,
+                          path,
+                          magic,
+                          map,
+                          dsc_size,
+                          header.mappingOffset);
+
+        if (map_subcaches_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+            munmap(map, dsc_size);
+            return map_subcaches_result;
+        }
+    }
+
     info_in->images = image_list;
     info_in->images_count = header.imagesCount;
 
@@ -468,6 +868,87 @@ dyld_shared_cache_parse_from_file(
     return E_DYLD_SHARED_CACHE_PARSE_OK;
 }
 
+/*
+ * Find the file, among the main cache-file and its subcaches, that data points
+ * into.
+ */
+
+static bool
+find_file_of_data(const struct dyld_shared_cache_info *__notnull const info,
+                  const uint8_t *__notnull const data,
+                  struct dyld_shared_cache_file *__notnull const file_out)
+{
+    const uintptr_t location = (uintptr_t)data;
+    const uintptr_t main_begin = (uintptr_t)info->map;
+
+    if (location >= main_begin && location - main_begin < info->size) {
+        file_out->map = info->map;
+        file_out->size = info->size;
+        file_out->available_range = info->available_range;
+
+        return true;
+    }
+
+    const struct dyld_shared_cache_file *file = info->subcaches;
+    const struct dyld_shared_cache_file *const end =
+        file + info->subcaches_count;
+
+    for (; file != end; file++) {
+        const uintptr_t begin = (uintptr_t)file->map;
+        if (location >= begin && location - begin < file->size) {
+            *file_out = *file;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+dyld_shared_cache_drop_pages(
+    const struct dyld_shared_cache_info *__notnull const info,
+    const uint8_t *__notnull const data,
+    const uint64_t size)
+{
+    struct dyld_shared_cache_file file = {};
+    if (!find_file_of_data(info, data, &file)) {
+        return;
+    }
+
+    /*
+     * The image-infos, and everything before them, are never dropped, as the
+     * image-infos are written to, and the written pages of a private mapping
+     * are discarded, not re-read from the file.
+     */
+
+    uint64_t begin = (uint64_t)(data - file.map);
+    uint64_t end = begin + size;
+
+    if (begin < file.available_range.begin) {
+        begin = file.available_range.begin;
+    }
+
+    if (end > file.size || end < begin) {
+        end = file.size;
+    }
+
+    /*
+     * Only pages entirely within range are dropped, so that pages shared with
+     * another structure are left alone.
+     */
+
+    const uint64_t page_mask = (uint64_t)sysconf(_SC_PAGESIZE) - 1;
+
+    begin = (begin + page_mask) & ~page_mask;
+    end &= ~page_mask;
+
+    if (begin >= end) {
+        return;
+    }
+
+    madvise(file.map + begin, end - begin, MADV_DONTNEED);
+}
+
 void
 dyld_shared_cache_info_destroy(
     struct dyld_shared_cache_info *__notnull const info)
@@ -476,9 +957,17 @@ dyld_shared_cache_info_destroy(
         munmap(info->map, info->size);
     }
 
+    if (info->subcaches != NULL) {
+        unmap_subcaches(info->subcaches, info->subcaches_count);
+    }
+
     info->map = NULL;
     info->size = 0;
 
+    info->subcaches = NULL;
+    info->subcaches_count = 0;
+    info->subcaches_size = 0;
+
     info->mappings = NULL;
     info->images = NULL;
 
@@ -227,6 +227,93 @@ handle_dsc_file_parse_result(
                       stderr);
             }
 
+            break;
+
+        case E_DYLD_SHARED_CACHE_PARSE_IS_SUBCACHE:
+            if (is_recursing) {
+                fprintf(stderr,
+                        "dyld_shared_cache file (at path %s/%s) is a subcache, "
+                        "and can only be parsed along with its main "
+                        "dyld_shared_cache file\n",
+                        dir_path,
+                        name);
+            } else if (print_paths) {
+                fprintf(stderr,
+                        "dyld_shared_cache file (at path %s) is a subcache, "
+                        "and can only be parsed along with its main "
+                        "dyld_shared_cache file\n",
+                        dir_path);
+            } else {
+                fputs("dyld_shared_cache file at the provided path is a "
+                      "subcache, and can only be parsed along with its main "
+                      "dyld_shared_cache file\n",
+                      stderr);
+            }
+
+            break;
+
+        case E_DYLD_SHARED_CACHE_PARSE_INVALID_SUBCACHES:
+            if (is_recursing) {
+                fprintf(stderr,
+                        "dyld_shared_cache file (at path %s/%s) has an invalid "
+                        "subcache-array\n",
+                        dir_path,
+                        name);
+            } else if (print_paths) {
+                fprintf(stderr,
+                        "dyld_shared_cache file (at path %s) has an invalid "
+                        "subcache-array\n",
+                        dir_path);
+            } else {
+                fputs("dyld_shared_cache file at the provided path has an "
+                      "invalid subcache-array\n",
+                      stderr);
+            }
+
+            break;
+
+        case E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_OPEN_FAIL:
+            if (is_recursing) {
+                fprintf(stderr,
+                        "Failed to open a subcache of dyld_shared_cache file "
+                        "(at path %s/%s), error: %s\n",
+                        dir_path,
+                        name,
+                        strerror(errno));
+            } else if (print_paths) {
+                fprintf(stderr,
+                        "Failed to open a subcache of dyld_shared_cache file "
+                        "(at path %s), error: %s\n",
+                        dir_path,
+                        strerror(errno));
+            } else {
+                fprintf(stderr,
+                        "Failed to open a subcache of the dyld_shared_cache "
+                        "file at the provided path, error: %s\n",
+                        strerror(errno));
+            }
+
+            break;
+
+        case E_DYLD_SHARED_CACHE_PARSE_SUBCACHE_MISMATCH:
+            if (is_recursing) {
+                fprintf(stderr,
+                        "A subcache of dyld_shared_cache file (at path %s/%s) "
+                        "doesn't match the main dyld_shared_cache file\n",
+                        dir_path,
+                        name);
+            } else if (print_paths) {
+                fprintf(stderr,
+                        "A subcache of dyld_shared_cache file (at path %s) "
+                        "doesn't match the main dyld_shared_cache file\n",
+                        dir_path);
+            } else {
+                fputs("A subcache of the dyld_shared_cache file at the "
+                      "provided path doesn't match the main dyld_shared_cache "
+                      "file\n",
+                      stderr);
+            }
+
             break;
     }
 }
@@ -635,6 +635,18 @@ handle_macho_file_for_main_error_callback(
     return true;
 }
 
+bool
+handle_macho_file_defer_error_callback(
+    __unused struct tbd_create_info *__notnull const info_in,
+    __unused const enum macho_file_parse_callback_type type,
+    void *const cb_info)
+{
+    bool *const needs_callback = (bool *)cb_info;
+    *needs_callback = true;
+
+    return false;
+}
+
 void
 handle_macho_file_open_result(const enum macho_file_open_result result,
                               const char *__notnull const dir_path,
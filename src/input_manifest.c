@@ -0,0 +1,689 @@
+//
+//  src/input_manifest.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+/*
+ * nftw() is only declared by glibc with _XOPEN_SOURCE 500 or _GNU_SOURCE.
+ */
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "copy.h"
+#include "input_manifest.h"
+#include "our_io.h"
+#include "string_buffer.h"
+#include "unused.h"
+#include "write_if_changed.h"
+
+static const char manifest_extension[] = ".tbd-manifest";
+static const char manifest_header[] = "tbd-input-manifest-v1\n";
+
+/*
+ * Fingerprints are 64-bit FNV-1a hashes.
+ */
+
+static const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+static const uint64_t FNV_PRIME = 0x100000001b3;
+
+uint64_t
+input_manifest_fingerprint_add(uint64_t fingerprint,
+                               const char *__notnull const string)
+{
+    if (fingerprint == 0) {
+        fingerprint = FNV_OFFSET_BASIS;
+    }
+
+    /*
+     * Include the null-terminator so that consecutive strings can't combine
+     * into the same fingerprint.
+     */
+
+    const char *iter = string;
+    do {
+        fingerprint ^= (uint8_t)*iter;
+        fingerprint *= FNV_PRIME;
+    } while (*(iter++) != '\0');
+
+    return fingerprint;
+}
+
+static int
+entry_comparator(const void *__notnull const array_item,
+                 const void *__notnull const item)
+{
+    const struct input_manifest_entry *const array_entry =
+        (const struct input_manifest_entry *)array_item;
+
+    const struct input_manifest_entry *const entry =
+        (const struct input_manifest_entry *)item;
+
+    const uint64_t array_length = array_entry->path_length;
+    const uint64_t length = entry->path_length;
+
+    const uint64_t min_length = (array_length < length) ? array_length : length;
+    const int ret = memcmp(array_entry->path, entry->path, min_length);
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (array_length < length) {
+        return -1;
+    }
+
+    return (array_length > length);
+}
+
+static void set_stat_info(struct input_manifest_entry *__notnull const entry,
+                          const struct stat *__notnull const sbuf)
+{
+    entry->device = (uint64_t)sbuf->st_dev;
+    entry->inode = (uint64_t)sbuf->st_ino;
+    entry->size = (uint64_t)sbuf->st_size;
+
+#if defined(__APPLE__)
+    entry->mtime_sec = (int64_t)sbuf->st_mtimespec.tv_sec;
+    entry->mtime_nsec = (int64_t)sbuf->st_mtimespec.tv_nsec;
+#else
+    entry->mtime_sec = (int64_t)sbuf->st_mtim.tv_sec;
+    entry->mtime_nsec = (int64_t)sbuf->st_mtim.tv_nsec;
+#endif
+}
+
+static void destroy_entry(struct input_manifest_entry *__notnull const entry) {
+    free(entry->path);
+    free(entry->output_path);
+}
+
+/*
+ * Parse a single tab-separated field of a line, which has to be followed by
+ * a tab.
+ */
+
+static const char *
+parse_number_field(const char *__notnull const iter,
+                   const int base,
+                   uint64_t *__notnull const number_out)
+{
+    char *end = NULL;
+
+    errno = 0;
+    *number_out = strtoull(iter, &end, base);
+
+    if (errno != 0 || end == iter || *end != '\t') {
+        return NULL;
+    }
+
+    return end + 1;
+}
+
+/*
+ * Each line is of the form:
+ * "<device>\t<inode>\t<size>\t<mtime>\t<mtime-nsec>\t<fingerprint>\t<path>\t
+ *  <output-path>", with an empty output-path if the input has none.
+ */
+
+static bool
+parse_line(const char *__notnull const line,
+           const char *__notnull const end,
+           struct input_manifest_entry *__notnull const entry_out)
+{
+    uint64_t numbers[6] = {};
+    const char *iter = line;
+
+    for (int i = 0; i != 6; i++) {
+        const int base = (i == 5) ? 16 : 10;
+        iter = parse_number_field(iter, base, &numbers[i]);
+
+        if (iter == NULL || iter >= end) {
+            return false;
+        }
+    }
+
+    const char *const path_end = memchr(iter, '\t', (size_t)(end - iter));
+    if (path_end == NULL || path_end == iter) {
+        return false;
+    }
+
+    const uint64_t path_length = (uint64_t)(path_end - iter);
+    const char *const output_path = path_end + 1;
+    const uint64_t output_path_length = (uint64_t)(end - output_path);
+
+    char *const path_copy = alloc_and_copy(iter, path_length);
+    if (path_copy == NULL) {
+        return false;
+    }
+
+    char *output_path_copy = NULL;
+    if (output_path_length != 0) {
+        output_path_copy = alloc_and_copy(output_path, output_path_length);
+        if (output_path_copy == NULL) {
+            free(path_copy);
+            return false;
+        }
+    }
+
+    const struct input_manifest_entry entry = {
+        .path = path_copy,
+        .path_length = path_length,
+
+        .output_path = output_path_copy,
+        .output_path_length = output_path_length,
+
+        .device = numbers[0],
+        .inode = numbers[1],
+        .size = numbers[2],
+
+        .mtime_sec = (int64_t)numbers[3],
+        .mtime_nsec = (int64_t)numbers[4],
+
+        .fingerprint = numbers[5]
+    };
+
+    *entry_out = entry;
+    return true;
+}
+
+static enum input_manifest_result
+parse_manifest(struct input_manifest *__notnull const manifest,
+               const char *__notnull const data,
+               const uint64_t size)
+{
+    const uint64_t header_length = sizeof(manifest_header) - 1;
+    if (size < header_length) {
+        return E_INPUT_MANIFEST_OK;
+    }
+
+    if (memcmp(data, manifest_header, header_length) != 0) {
+        return E_INPUT_MANIFEST_OK;
+    }
+
+    const char *iter = data + header_length;
+    const char *const end = data + size;
+
+    while (iter != end) {
+        const char *line_end = memchr(iter, '\n', (size_t)(end - iter));
+        if (line_end == NULL) {
+            break;
+        }
+
+        struct input_manifest_entry entry = {};
+        if (parse_line(iter, line_end, &entry)) {
+            const enum array_result add_entry_result =
+                array_add_item(&manifest->entries,
+                               sizeof(entry),
+                               &entry,
+                               NULL);
+
+            if (add_entry_result != E_ARRAY_OK) {
+                destroy_entry(&entry);
+                return E_INPUT_MANIFEST_ALLOC_FAIL;
+            }
+        }
+
+        iter = line_end + 1;
+    }
+
+    array_sort_with_comparator(&manifest->entries,
+                               sizeof(struct input_manifest_entry),
+                               entry_comparator);
+
+    return E_INPUT_MANIFEST_OK;
+}
+
+static enum input_manifest_result
+read_manifest(struct input_manifest *__notnull const manifest) {
+    const int fd = our_open(manifest->path, O_RDONLY, 0);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            return E_INPUT_MANIFEST_OK;
+        }
+
+        return E_INPUT_MANIFEST_READ_FAIL;
+    }
+
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0) {
+        close(fd);
+        return E_INPUT_MANIFEST_READ_FAIL;
+    }
+
+    const uint64_t size = (uint64_t)sbuf.st_size;
+    if (size == 0) {
+        close(fd);
+        return E_INPUT_MANIFEST_OK;
+    }
+
+    char *const data = malloc(size);
+
+    if (data == NULL) {
+        close(fd);
+        return E_INPUT_MANIFEST_ALLOC_FAIL;
+    }
+
+    uint64_t offset = 0;
+    while (offset != size) {
+        const ssize_t read_size =
+            our_read(fd, data + offset, (size_t)(size - offset));
+
+        if (read_size <= 0) {
+            free(data);
+            close(fd);
+
+            return E_INPUT_MANIFEST_READ_FAIL;
+        }
+
+        offset += (uint64_t)read_size;
+    }
+
+    close(fd);
+
+    const enum input_manifest_result result =
+        parse_manifest(manifest, data, size);
+
+    free(data);
+    return result;
+}
+
+enum input_manifest_result
+input_manifest_load(struct input_manifest *__notnull const manifest,
+                    const char *__notnull const write_path,
+                    const uint64_t write_path_length,
+                    const uint64_t fingerprint)
+{
+    const uint64_t extension_length = sizeof(manifest_extension) - 1;
+    const uint64_t path_length = write_path_length + extension_length;
+
+    char *const path = malloc(path_length + 1);
+    if (path == NULL) {
+        return E_INPUT_MANIFEST_ALLOC_FAIL;
+    }
+
+    memcpy(path, write_path, write_path_length);
+    memcpy(path + write_path_length, manifest_extension, extension_length);
+
+    path[path_length] = '\0';
+
+    manifest->path = path;
+    manifest->path_length = path_length;
+
+    manifest->write_path = write_path;
+    manifest->write_path_length = write_path_length;
+
+    manifest->fingerprint = fingerprint;
+    return read_manifest(manifest);
+}
+
+static struct input_manifest_entry *
+find_entry(const struct input_manifest *__notnull const manifest,
+           const char *__notnull const path,
+           const uint64_t path_length,
+           struct array_cached_index_info *const info_out)
+{
+    const struct input_manifest_entry key = {
+        .path = (char *)path,
+        .path_length = path_length
+    };
+
+    return array_find_item_in_sorted(&manifest->entries,
+                                     sizeof(struct input_manifest_entry),
+                                     &key,
+                                     entry_comparator,
+                                     info_out);
+}
+
+bool
+input_manifest_input_unchanged(struct input_manifest *__notnull const manifest,
+                               const char *__notnull const path,
+                               const uint64_t path_length,
+                               const struct stat *__notnull const sbuf)
+{
+    struct input_manifest_entry *const entry =
+        find_entry(manifest, path, path_length, NULL);
+
+    if (entry == NULL) {
+        return false;
+    }
+
+    entry->seen = true;
+
+    struct input_manifest_entry current = {};
+    set_stat_info(&current, sbuf);
+
+    if (entry->fingerprint != manifest->fingerprint ||
+        entry->device != current.device ||
+        entry->inode != current.inode ||
+        entry->size != current.size ||
+        entry->mtime_sec != current.mtime_sec ||
+        entry->mtime_nsec != current.mtime_nsec)
+    {
+        return false;
+    }
+
+    /*
+     * An output removed since has to be created again.
+     */
+
+    if (entry->output_path != NULL) {
+        if (access(entry->output_path, F_OK) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static int
+remove_tree_entry(const char *__notnull const path,
+                  __unused const struct stat *const sbuf,
+                  __unused const int typeflag,
+                  __unused struct FTW *const ftw)
+{
+    remove(path);
+    return 0;
+}
+
+/*
+ * Remove an output, which is either a single file, or a directory of the
+ * outputs of a dyld_shared_cache, but only if it's within the write-path.
+ */
+
+static void
+remove_output(const struct input_manifest *__notnull const manifest,
+              const char *__notnull const output_path,
+              const uint64_t output_path_length)
+{
+    const uint64_t write_path_length = manifest->write_path_length;
+    if (output_path_length <= write_path_length) {
+        return;
+    }
+
+    if (memcmp(output_path, manifest->write_path, write_path_length) != 0) {
+        return;
+    }
+
+    if (output_path[write_path_length] != '/') {
+        return;
+    }
+
+    nftw(output_path, remove_tree_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+enum input_manifest_result
+input_manifest_record(struct input_manifest *__notnull const manifest,
+                      const char *__notnull const path,
+                      const uint64_t path_length,
+                      const struct stat *__notnull const sbuf,
+                      const char *const output_path,
+                      const uint64_t output_path_length)
+{
+    /*
+     * Paths with tabs or newlines can't be stored in the manifest, and are
+     * simply parsed every time.
+     */
+
+    if (memchr(path, '\t', path_length) != NULL ||
+        memchr(path, '\n', path_length) != NULL)
+    {
+        return E_INPUT_MANIFEST_OK;
+    }
+
+    char *output_path_copy = NULL;
+    if (output_path != NULL) {
+        if (memchr(output_path, '\t', output_path_length) != NULL ||
+            memchr(output_path, '\n', output_path_length) != NULL)
+        {
+            return E_INPUT_MANIFEST_OK;
+        }
+
+        output_path_copy = alloc_and_copy(output_path, output_path_length);
+        if (output_path_copy == NULL) {
+            return E_INPUT_MANIFEST_ALLOC_FAIL;
+        }
+    }
+
+    struct array_cached_index_info info = {};
+    struct input_manifest_entry *const existing =
+        find_entry(manifest, path, path_length, &info);
+
+    if (existing != NULL) {
+        if (existing->output_path != NULL) {
+            const bool same_output =
+                output_path != NULL &&
+                existing->output_path_length == output_path_length &&
+                memcmp(existing->output_path,
+                       output_path,
+                       output_path_length) == 0;
+
+            if (!same_output) {
+                remove_output(manifest,
+                              existing->output_path,
+                              existing->output_path_length);
+            }
+
+            free(existing->output_path);
+        }
+
+        existing->output_path = output_path_copy;
+        existing->output_path_length = output_path_length;
+        existing->fingerprint = manifest->fingerprint;
+        existing->seen = true;
+
+        set_stat_info(existing, sbuf);
+        return E_INPUT_MANIFEST_OK;
+    }
+
+    char *const path_copy = alloc_and_copy(path, path_length);
+    if (path_copy == NULL) {
+        free(output_path_copy);
+        return E_INPUT_MANIFEST_ALLOC_FAIL;
+    }
+
+    struct input_manifest_entry entry = {
+        .path = path_copy,
+        .path_length = path_length,
+
+        .output_path = output_path_copy,
+        .output_path_length = output_path_length,
+
+        .fingerprint = manifest->fingerprint,
+        .seen = true
+    };
+
+    set_stat_info(&entry, sbuf);
+
+    const enum array_result add_entry_result =
+        array_add_item_with_cached_index_info(&manifest->entries,
+                                              sizeof(entry),
+                                              &entry,
+                                              &info,
+                                              NULL);
+
+    if (add_entry_result != E_ARRAY_OK) {
+        destroy_entry(&entry);
+        return E_INPUT_MANIFEST_ALLOC_FAIL;
+    }
+
+    return E_INPUT_MANIFEST_OK;
+}
+
+static bool
+entry_has_vanished(const struct input_manifest_entry *__notnull const entry,
+                   const char *__notnull const dir_path,
+                   const uint64_t dir_path_length)
+{
+    if (entry->seen) {
+        return false;
+    }
+
+    if (entry->path_length <= dir_path_length) {
+        return false;
+    }
+
+    if (memcmp(entry->path, dir_path, dir_path_length) != 0) {
+        return false;
+    }
+
+    if (entry->path[dir_path_length] != '/') {
+        return false;
+    }
+
+    /*
+     * Inputs not seen may have simply failed to open, so are only removed if
+     * they no longer exist.
+     */
+
+    struct stat sbuf = {};
+    return (lstat(entry->path, &sbuf) != 0 && errno == ENOENT);
+}
+
+uint64_t
+input_manifest_remove_vanished(struct input_manifest *__notnull const manifest,
+                               const char *__notnull const dir_path,
+                               const uint64_t dir_path_length)
+{
+    struct input_manifest_entry *const begin = manifest->entries.data;
+    const struct input_manifest_entry *const end = manifest->entries.data_end;
+
+    struct input_manifest_entry *kept = begin;
+    uint64_t removed_count = 0;
+
+    for (struct input_manifest_entry *entry = begin; entry != end; entry++) {
+        if (!entry_has_vanished(entry, dir_path, dir_path_length)) {
+            *(kept++) = *entry;
+            continue;
+        }
+
+        if (entry->output_path != NULL) {
+            remove_output(manifest,
+                          entry->output_path,
+                          entry->output_path_length);
+        }
+
+        destroy_entry(entry);
+        removed_count++;
+    }
+
+    array_trim_to_item_count(&manifest->entries,
+                             sizeof(struct input_manifest_entry),
+                             (uint64_t)(kept - begin));
+
+    return removed_count;
+}
+
+static bool
+add_entry_line(struct string_buffer *__notnull const sb,
+               const struct input_manifest_entry *__notnull const entry)
+{
+    char numbers[160] = {};
+    const int numbers_length =
+        snprintf(numbers,
+                 sizeof(numbers),
+                 "%" PRIu64 "\t%" PRIu64 "\t%" PRIu64 "\t%" PRId64 "\t%" PRId64
+                 "\t%016" PRIx64 "\t",
+                 entry->device,
+                 entry->inode,
+                 entry->size,
+                 entry->mtime_sec,
+                 entry->mtime_nsec,
+                 entry->fingerprint);
+
+    const struct {
+        const char *string;
+        uint64_t length;
+    } parts[] = {
+        { numbers, (uint64_t)numbers_length },
+        { entry->path, entry->path_length },
+        { "\t", 1 },
+        { entry->output_path, entry->output_path_length },
+        { "\n", 1 }
+    };
+
+    for (uint64_t i = 0; i != sizeof(parts) / sizeof(*parts); i++) {
+        if (parts[i].length == 0) {
+            continue;
+        }
+
+        const enum string_buffer_result add_part_result =
+            sb_add_c_str(sb, parts[i].string, parts[i].length);
+
+        if (add_part_result != E_STRING_BUFFER_OK) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+enum input_manifest_result
+input_manifest_write(const struct input_manifest *__notnull const manifest) {
+    struct string_buffer sb = {};
+    const uint64_t header_length = sizeof(manifest_header) - 1;
+
+    const enum string_buffer_result add_header_result =
+        sb_add_c_str(&sb, manifest_header, header_length);
+
+    if (add_header_result != E_STRING_BUFFER_OK) {
+        sb_destroy(&sb);
+        return E_INPUT_MANIFEST_ALLOC_FAIL;
+    }
+
+    const struct input_manifest_entry *entry = manifest->entries.data;
+    const struct input_manifest_entry *const end = manifest->entries.data_end;
+
+    for (; entry != end; entry++) {
+        if (!add_entry_line(&sb, entry)) {
+            sb_destroy(&sb);
+            return E_INPUT_MANIFEST_ALLOC_FAIL;
+        }
+    }
+
+    const enum write_if_changed_result write_result =
+        write_if_changed(manifest->path,
+                         manifest->path_length,
+                         sb.data,
+                         sb.length,
+                         false);
+
+    sb_destroy(&sb);
+
+    switch (write_result) {
+        case E_WRITE_IF_CHANGED_OK:
+        case E_WRITE_IF_CHANGED_UNCHANGED:
+            return E_INPUT_MANIFEST_OK;
+
+        default:
+            return E_INPUT_MANIFEST_WRITE_FAIL;
+    }
+}
+
+void input_manifest_destroy(struct input_manifest *__notnull const manifest) {
+    struct input_manifest_entry *entry = manifest->entries.data;
+    const struct input_manifest_entry *const end = manifest->entries.data_end;
+
+    for (; entry != end; entry++) {
+        destroy_entry(entry);
+    }
+
+    array_destroy(&manifest->entries);
+    free(manifest->path);
+
+    manifest->path = NULL;
+}
@@ -0,0 +1,243 @@
+//
+//  src/job_pool.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "job_pool.h"
+
+/*
+ * Allow each worker to have a few jobs queued up, so workers aren't left
+ * waiting while the adding thread commits.
+ */
+
+static const uint64_t JOBS_PER_WORKER = 4;
+
+static inline void *
+get_job_at_index(const struct job_pool *__notnull const pool,
+                 const uint64_t index)
+{
+    return pool->ring + ((index % pool->ring_count) * pool->job_size);
+}
+
+static inline bool *
+get_done_at_index(const struct job_pool *__notnull const pool,
+                  const uint64_t index)
+{
+    return pool->ring_done + (index % pool->ring_count);
+}
+
+static void *thread_main(void *__notnull const arg) {
+    const struct job_pool_thread *const thread =
+        (const struct job_pool_thread *)arg;
+
+    struct job_pool *const pool = thread->pool;
+    pthread_mutex_lock(&pool->lock);
+
+    do {
+        const uint64_t index = pool->claimed_count;
+        if (index == pool->added_count) {
+            if (pool->is_finished) {
+                break;
+            }
+
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+            continue;
+        }
+
+        void *const job = get_job_at_index(pool, index);
+
+        pool->claimed_count = index + 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        pool->work(job, thread->worker_info);
+        pthread_mutex_lock(&pool->lock);
+
+        *get_done_at_index(pool, index) = true;
+        pthread_cond_broadcast(&pool->done_cond);
+    } while (true);
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void stop_threads(struct job_pool *__notnull const pool) {
+    pthread_mutex_lock(&pool->lock);
+
+    pool->is_finished = true;
+    pthread_cond_broadcast(&pool->work_cond);
+
+    pthread_mutex_unlock(&pool->lock);
+
+    const struct job_pool_thread *thread = pool->threads;
+    const struct job_pool_thread *const end = thread + pool->thread_count;
+
+    for (; thread != end; thread++) {
+        pthread_join(thread->thread, NULL);
+    }
+
+    free(pool->threads);
+    free(pool->ring_done);
+    free(pool->ring);
+
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+enum job_pool_result
+job_pool_create(struct job_pool *__notnull const pool,
+                void *__notnull const workers,
+                const uint64_t worker_info_size,
+                const uint32_t worker_count,
+                const uint64_t job_size,
+                __notnull const job_pool_work_callback work,
+                __notnull const job_pool_commit_callback commit,
+                void *const commit_info)
+{
+    const uint64_t ring_count = worker_count * JOBS_PER_WORKER;
+
+    uint8_t *const ring = calloc(ring_count, job_size);
+    if (ring == NULL) {
+        return E_JOB_POOL_ALLOC_FAIL;
+    }
+
+    bool *const ring_done = calloc(ring_count, sizeof(bool));
+    if (ring_done == NULL) {
+        free(ring);
+        return E_JOB_POOL_ALLOC_FAIL;
+    }
+
+    struct job_pool_thread *const threads =
+        calloc(worker_count, sizeof(*threads));
+
+    if (threads == NULL) {
+        free(ring_done);
+        free(ring);
+
+        return E_JOB_POOL_ALLOC_FAIL;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    pool->ring = ring;
+    pool->ring_done = ring_done;
+    pool->ring_count = ring_count;
+    pool->job_size = job_size;
+    pool->threads = threads;
+    pool->work = work;
+    pool->commit = commit;
+    pool->commit_info = commit_info;
+
+    uint8_t *worker_info = (uint8_t *)workers;
+
+    struct job_pool_thread *thread = threads;
+    const struct job_pool_thread *const end = threads + worker_count;
+
+    for (; thread != end; thread++, worker_info += worker_info_size) {
+        thread->pool = pool;
+        thread->worker_info = worker_info;
+
+        const int create_result =
+            pthread_create(&thread->thread, NULL, thread_main, thread);
+
+        if (create_result != 0) {
+            stop_threads(pool);
+            return E_JOB_POOL_THREAD_CREATE_FAIL;
+        }
+
+        pool->thread_count += 1;
+    }
+
+    return E_JOB_POOL_OK;
+}
+
+/*
+ * Commit jobs in the order they were added until we reach a job that hasn't
+ * finished.
+ *
+ * If fewer than wait_count jobs have been committed, we instead wait on the
+ * unfinished job.
+ */
+
+static void
+commit_jobs(struct job_pool *__notnull const pool, const uint64_t wait_count) {
+    pthread_mutex_lock(&pool->lock);
+
+    uint64_t index = pool->committed_count;
+    while (index != pool->added_count) {
+        bool *const done = get_done_at_index(pool, index);
+        if (!*done) {
+            if (index >= wait_count) {
+                break;
+            }
+
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+            continue;
+        }
+
+        /*
+         * Committing may request user-input, so we don't hold the lock while
+         * doing so.
+         */
+
+        pthread_mutex_unlock(&pool->lock);
+        pool->commit(get_job_at_index(pool, index), pool->commit_info);
+        pthread_mutex_lock(&pool->lock);
+
+        *done = false;
+
+        index += 1;
+        pool->committed_count = index;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void job_pool_add(struct job_pool *__notnull const pool, const void *const job)
+{
+    /*
+     * Make room in the ring by committing the oldest job, if necessary.
+     *
+     * Only the adding thread modifies committed_count and added_count, so we
+     * don't need to lock here.
+     */
+
+    const uint64_t committed_count = pool->committed_count;
+    if (pool->added_count - committed_count == pool->ring_count) {
+        commit_jobs(pool, committed_count + 1);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    const uint64_t index = pool->added_count;
+    memcpy(get_job_at_index(pool, index), job, pool->job_size);
+
+    pool->added_count = index + 1;
+    pthread_cond_signal(&pool->work_cond);
+
+    pthread_mutex_unlock(&pool->lock);
+    commit_jobs(pool, 0);
+}
+
+void job_pool_commit_oldest(struct job_pool *__notnull const pool) {
+    commit_jobs(pool, pool->committed_count + 1);
+}
+
+void job_pool_commit_all(struct job_pool *__notnull const pool) {
+    commit_jobs(pool, UINT64_MAX);
+}
+
+void job_pool_finish_and_destroy(struct job_pool *__notnull const pool) {
+    commit_jobs(pool, UINT64_MAX);
+    stop_threads(pool);
+}
@@ -6,6 +6,7 @@
 //  Copyright © 2018 - 2020 inoahdev. All rights reserved.
 //
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <errno.h>
@@ -22,10 +23,13 @@
 #include "macho_file.h"
 #include "macho_file_parse_load_commands.h"
 
+#include "job_pool.h"
 #include "our_io.h"
+#include "string_buffer.h"
 #include "swap.h"
 #include "target_list.h"
 #include "tbd.h"
+#include "unused.h"
 
 static bool magic_is_thin(const uint32_t magic) {
     switch (magic) {
@@ -179,6 +183,7 @@ call_callback(struct tbd_create_info *__notnull const info_in,
 static enum macho_file_parse_result
 parse_thin_file(struct tbd_create_info *__notnull const info_in,
                 const int fd,
+                const uint8_t *const map,
                 const struct range container_range,
                 const struct mach_header *const header,
                 const struct arch_info *const arch,
@@ -186,7 +191,8 @@ parse_thin_file(struct tbd_create_info *__notnull const info_in,
                 const bool is_big_endian,
                 const uint64_t arch_index,
                 const struct tbd_parse_options tbd_options,
-                const struct macho_file_parse_options options)
+                const struct macho_file_parse_options options,
+                struct mf_parse_symbols_from_map_info *const symbols_info_out)
 {
     const uint32_t magic = header->magic;
     const bool is_64 = magic_is_64_bit(magic);
@@ -206,13 +212,6 @@ parse_thin_file(struct tbd_create_info *__notnull const info_in,
          * mach_header.
          */
 
-        const uint64_t offset =
-            container_range.begin + sizeof(struct mach_header_64);
-
-        if (our_lseek(fd, offset, SEEK_SET) < 0) {
-            return E_MACHO_FILE_PARSE_SEEK_FAIL;
-        }
-
         lc_flags.is_64 = true;
         header_size = sizeof(struct mach_header_64);
     }
@@ -276,47 +275,361 @@ parse_thin_file(struct tbd_create_info *__notnull const info_in,
         }
     }
 
-    const struct range lc_available_range = {
-        .begin = container_range.begin + header_size,
-        .end = container_range.end,
+    /*
+     * The load-commands of a mapped file are parsed from the map, with its
+     * symbols then parsed separately, either below, or later by the caller if
+     * symbols_info_out is provided.
+     */
+
+    struct mf_parse_symbols_from_map_info symbols_info = {};
+    struct mf_parse_symbols_from_map_info *symbols_info_ptr = symbols_info_out;
+
+    if (map != NULL && symbols_info_ptr == NULL) {
+        symbols_info_ptr = &symbols_info;
+    }
+
+    struct macho_file_parse_options lc_options = options;
+    struct macho_file_lc_info_out *lc_info_out = NULL;
+
+    if (symbols_info_ptr != NULL) {
+        lc_options.dont_parse_symbols = true;
+        lc_info_out = &symbols_info_ptr->lc_info;
+    }
+
+    const uint64_t macho_size = range_get_size(container_range);
+    const struct range symbols_available_range = {
+        .begin = header_size + header->sizeofcmds,
+        .end = macho_size
     };
 
+    enum macho_file_parse_result ret = E_MACHO_FILE_PARSE_OK;
+    if (map != NULL) {
+        /*
+         * The map is unmapped once the file is parsed, so any strings have to
+         * be copied.
+         */
+
+        lc_options.copy_strings_in_map = true;
+
+        const uint8_t *const macho = map + container_range.begin;
+        const struct mf_parse_lc_from_map_info info = {
+            .map = macho,
+            .map_size = macho_size,
+
+            .macho = macho,
+            .macho_size = macho_size,
+
+            .arch = arch,
+            .arch_index = arch_index,
+
+            .available_map_range = symbols_available_range,
+
+            .ncmds = header->ncmds,
+            .sizeofcmds = header->sizeofcmds,
+            .header_size = header_size,
+
+            .tbd_options = tbd_options,
+            .options = lc_options,
+
+            .flags = lc_flags
+        };
+
+        ret = macho_file_parse_load_commands_from_map(info_in,
+                                                      &info,
+                                                      extra,
+                                                      lc_info_out);
+
+        symbols_info_ptr->map = macho;
+    } else {
+        const struct range lc_available_range = {
+            .begin = container_range.begin + header_size,
+            .end = container_range.end,
+        };
+
+        /*
+         * Ignore if arch is NULL, as arch_index would be ignored as well.
+         */
+
+        const struct mf_parse_lc_from_file_info info = {
+            .fd = fd,
+
+            .arch = arch,
+            .arch_index = arch_index,
+
+            .macho_range = container_range,
+            .available_range = lc_available_range,
+
+            .ncmds = header->ncmds,
+            .sizeofcmds = header->sizeofcmds,
+            .header_size = header_size,
+
+            .tbd_options = tbd_options,
+            .options = lc_options,
+
+            .flags = lc_flags
+        };
+
+        ret = macho_file_parse_load_commands_from_file(info_in,
+                                                       &info,
+                                                       extra,
+                                                       lc_info_out);
+    }
+
+    if (ret != E_MACHO_FILE_PARSE_OK) {
+        return ret;
+    }
+
+    if (symbols_info_ptr == NULL) {
+        return E_MACHO_FILE_PARSE_OK;
+    }
+
     /*
-     * Ignore if arch is NULL, as arch_index would be ignored as well.
+     * Have the symbols read ahead, which, for a fat mach-o file, lets the
+     * symbols of later architectures be read while earlier ones are parsed.
      */
 
-    struct mf_parse_lc_from_file_info info = {
-        .fd = fd,
+    macho_file_advise_linkedit(fd,
+                               container_range.begin,
+                               &symbols_info_ptr->lc_info,
+                               lc_flags.is_64,
+                               tbd_options,
+                               options);
 
-        .arch = arch,
-        .arch_index = arch_index,
+    symbols_info_ptr->available_range = symbols_available_range;
+    symbols_info_ptr->arch_index = arch_index;
 
-        .macho_range = container_range,
-        .available_range = lc_available_range,
+    symbols_info_ptr->tbd_options = tbd_options;
+    symbols_info_ptr->options = options;
+    symbols_info_ptr->flags = lc_flags;
 
-        .ncmds = header->ncmds,
-        .sizeofcmds = header->sizeofcmds,
-        .header_size = header_size,
+    /*
+     * The file's map is unmapped once every architecture is parsed, so the
+     * symbols can't borrow their strings from it.
+     */
 
-        .tbd_options = tbd_options,
-        .options = options,
+    symbols_info_ptr->options.copy_strings_in_map = true;
+    if (symbols_info_out != NULL) {
+        return E_MACHO_FILE_PARSE_OK;
+    }
 
-        .flags = lc_flags
-    };
+    ret = macho_file_parse_symbols_from_map(info_in,
+                                            &symbols_info,
+                                            extra.export_trie_sb);
+
+    if (ret != E_MACHO_FILE_PARSE_OK) {
+        return ret;
+    }
+
+    return E_MACHO_FILE_PARSE_OK;
+}
+
+/*
+ * To parse the architectures of a fat mach-o file concurrently, the
+ * load-commands of every architecture are first parsed in order on the calling
+ * thread, so any callbacks are still called in order.
+ *
+ * The symbols of each architecture are then parsed from a map of the file on
+ * their own thread into their own tbd_create_info, to be merged into info_in
+ * afterwards.
+ */
+
+struct fat_arch_job {
+    struct tbd_create_info info;
+    struct mf_parse_symbols_from_map_info parse_info;
+    struct string_buffer export_trie_sb;
+
+    enum macho_file_parse_result result;
+};
+
+struct fat_arch_jobs {
+    struct fat_arch_job *list;
+    struct tbd_create_info **infos;
+
+    uint32_t count;
+};
+
+static bool
+create_fat_arch_jobs(struct fat_arch_jobs *__notnull const jobs,
+                     const uint32_t nfat_arch)
+{
+    struct fat_arch_job *const list = calloc(nfat_arch, sizeof(*list));
+    if (list == NULL) {
+        return false;
+    }
+
+    struct tbd_create_info **const infos = calloc(nfat_arch, sizeof(*infos));
+    if (infos == NULL) {
+        free(list);
+        return false;
+    }
+
+    jobs->list = list;
+    jobs->infos = infos;
+    jobs->count = 0;
+
+    return true;
+}
+
+static void run_fat_arch_job(struct fat_arch_job *__notnull const job) {
+    job->result =
+        macho_file_parse_symbols_from_map(&job->info,
+                                          &job->parse_info,
+                                          &job->export_trie_sb);
+
+    /*
+     * Sort the architecture's lists on its own thread, so they can be merged
+     * in a single pass afterwards.
+     */
+
+    tbd_ci_finish_ingesting(&job->info);
+}
+
+/*
+ * The job-pool's jobs are pointers to the fat_arch_jobs, which are only
+ * collected once every job has finished, so there's nothing to commit.
+ */
+
+static void
+work_fat_arch_job(void *__notnull const job_ptr,
+                  __unused void *__notnull const worker_ptr)
+{
+    run_fat_arch_job(*(struct fat_arch_job **)job_ptr);
+}
+
+static void
+commit_fat_arch_job(__unused void *__notnull const job_ptr,
+                    __unused void *const info)
+{
+    return;
+}
+
+static enum macho_file_parse_result
+parse_fat_arch_jobs(struct tbd_create_info *__notnull const info_in,
+                    const struct fat_arch_jobs *__notnull const jobs,
+                    const struct macho_file_parse_extra_args extra,
+                    const uint32_t jobs_count)
+{
+    if (jobs->count == 0) {
+        return E_MACHO_FILE_PARSE_OK;
+    }
+
+    /*
+     * The first architecture is parsed directly into info_in on this thread,
+     * while every other architecture is parsed into a copy of info_in without
+     * any metadata or symbols.
+     */
+
+    struct fat_arch_job *const first = jobs->list;
+    const struct fat_arch_job *const end = first + jobs->count;
+
+    for (struct fat_arch_job *job = first + 1; job != end; job++) {
+        job->info = *info_in;
+
+        memset(&job->info.fields.metadata, 0, sizeof(struct array));
+        memset(&job->info.fields.symbols, 0, sizeof(struct array));
+        memset(&job->info.fields.uuids, 0, sizeof(struct array));
+        memset(&job->info.arena, 0, sizeof(struct arena));
 
-    const enum macho_file_parse_result parse_load_commands_result =
-        macho_file_parse_load_commands_from_file(info_in,
-                                                 &info,
-                                                 extra,
-                                                 NULL);
+        tbd_ci_begin_ingesting(&job->info);
+    }
 
-    if (parse_load_commands_result != E_MACHO_FILE_PARSE_OK) {
-        return parse_load_commands_result;
+    /*
+     * This thread counts as one of the jobs, so only jobs_count - 1 workers
+     * are created, and never more than there are architectures to give them.
+     */
+
+    uint32_t worker_count = jobs->count - 1;
+    if (jobs_count != 0 && worker_count > jobs_count - 1) {
+        worker_count = jobs_count - 1;
+    }
+
+    struct job_pool pool = {};
+    bool has_pool = false;
+
+    if (worker_count != 0) {
+        /*
+         * The workers don't have any info of their own, so they're all given
+         * the same empty worker-info.
+         */
+
+        char worker_info = 0;
+        const enum job_pool_result create_pool_result =
+            job_pool_create(&pool,
+                            &worker_info,
+                            0,
+                            worker_count,
+                            sizeof(struct fat_arch_job *),
+                            work_fat_arch_job,
+                            commit_fat_arch_job,
+                            NULL);
+
+        has_pool = (create_pool_result == E_JOB_POOL_OK);
+    }
+
+    /*
+     * If we fail to create the job-pool, we simply fall back to parsing every
+     * architecture on this thread.
+     */
+
+    if (has_pool) {
+        for (struct fat_arch_job *job = first + 1; job != end; job++) {
+            job_pool_add(&pool, &job);
+        }
+    }
+
+    enum macho_file_parse_result ret =
+        macho_file_parse_symbols_from_map(info_in,
+                                          &first->parse_info,
+                                          extra.export_trie_sb);
+
+    if (has_pool) {
+        job_pool_finish_and_destroy(&pool);
+    } else {
+        for (struct fat_arch_job *job = first + 1; job != end; job++) {
+            run_fat_arch_job(job);
+        }
+    }
+
+    struct tbd_create_info **infos = jobs->infos;
+    for (struct fat_arch_job *job = first + 1; job != end; job++) {
+        sb_destroy(&job->export_trie_sb);
+
+        *infos = &job->info;
+        infos++;
+
+        if (ret == E_MACHO_FILE_PARSE_OK) {
+            ret = job->result;
+        }
+    }
+
+    /*
+     * Merge every architecture's info even after a failure, so their lists
+     * are freed along with info_in's.
+     */
+
+    const enum tbd_ci_add_data_result merge_result =
+        tbd_ci_merge_data(info_in, jobs->infos, jobs->count - 1);
+
+    if (ret != E_MACHO_FILE_PARSE_OK) {
+        return ret;
+    }
+
+    if (merge_result != E_TBD_CI_ADD_DATA_OK) {
+        return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
     return E_MACHO_FILE_PARSE_OK;
 }
 
+static void destroy_fat_arch_jobs(struct fat_arch_jobs *__notnull const jobs) {
+    free(jobs->list);
+    free(jobs->infos);
+
+    jobs->list = NULL;
+    jobs->infos = NULL;
+    jobs->count = 0;
+}
+
 static enum macho_file_parse_result
 verify_fat_32_arch(struct fat_arch *__notnull const arch,
                    const uint64_t macho_base,
@@ -416,12 +729,14 @@ static inline bool is_invalid_filetype(const uint32_t filetype) {
 static enum macho_file_parse_result
 handle_fat_32_file(struct tbd_create_info *__notnull const info_in,
                    const int fd,
+                   const uint8_t *const map,
                    const struct range macho_range,
                    const uint32_t nfat_arch,
                    const bool is_big_endian,
                    struct macho_file_parse_extra_args extra,
                    const struct tbd_parse_options tbd_options,
-                   const struct macho_file_parse_options options)
+                   const struct macho_file_parse_options options,
+                   struct fat_arch_jobs *const jobs)
 {
     /*
      * Calculate the total-size of the architectures given.
@@ -451,7 +766,18 @@ handle_fat_32_file(struct tbd_create_info *__notnull const info_in,
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
-    if (our_read(fd, arch_list, archs_size) < 0) {
+    /*
+     * The arch-table directly follows the fat-header. Read it at its offset,
+     * rather than from the fd's current position, which may be shared.
+     */
+
+    const off_t archs_offset =
+        (off_t)(macho_range.begin + sizeof(struct fat_header));
+
+    const ssize_t archs_read_size =
+        our_pread(fd, arch_list, archs_size, archs_offset);
+
+    if (archs_read_size != (ssize_t)archs_size) {
         free(arch_list);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
@@ -525,13 +851,9 @@ handle_fat_32_file(struct tbd_create_info *__notnull const info_in,
 
     for (arch = arch_list; arch != end; arch++, arch_index++) {
         const off_t arch_offset = (off_t)(macho_range.begin + arch->offset);
-        if (our_lseek(fd, arch_offset, SEEK_SET) < 0) {
-            free(arch_list);
-            return E_MACHO_FILE_PARSE_SEEK_FAIL;
-        }
-
         struct mach_header header = {};
-        if (our_read(fd, &header, sizeof(header)) < 0) {
+
+        if (our_pread(fd, &header, sizeof(header), arch_offset) < 0) {
             free(arch_list);
             return E_MACHO_FILE_PARSE_READ_FAIL;
         }
@@ -616,9 +938,15 @@ handle_fat_32_file(struct tbd_create_info *__notnull const info_in,
             .end = arch_offset + arch->size
         };
 
+        struct mf_parse_symbols_from_map_info *symbols_info = NULL;
+        if (jobs != NULL) {
+            symbols_info = &jobs->list[jobs->count].parse_info;
+        }
+
         const enum macho_file_parse_result handle_arch_result =
             parse_thin_file(info_in,
                             fd,
+                            map,
                             arch_range,
                             &header,
                             arch_info,
@@ -626,13 +954,18 @@ handle_fat_32_file(struct tbd_create_info *__notnull const info_in,
                             arch_is_big_endian,
                             arch_index,
                             tbd_options,
-                            options);
+                            options,
+                            symbols_info);
 
         if (handle_arch_result != E_MACHO_FILE_PARSE_OK) {
             free(arch_list);
             return handle_arch_result;
         }
 
+        if (jobs != NULL) {
+            jobs->count += 1;
+        }
+
         parsed_one_arch = true;
     }
 
@@ -737,12 +1070,14 @@ verify_fat_64_arch(struct fat_arch_64 *__notnull const arch,
 static enum macho_file_parse_result
 handle_fat_64_file(struct tbd_create_info *__notnull const info_in,
                    const int fd,
+                   const uint8_t *const map,
                    const struct range macho_range,
                    const uint32_t nfat_arch,
                    const bool is_big_endian,
                    struct macho_file_parse_extra_args extra,
                    const struct tbd_parse_options tbd_options,
-                   const struct macho_file_parse_options options)
+                   const struct macho_file_parse_options options,
+                   struct fat_arch_jobs *const jobs)
 {
     /*
      * Calculate the total-size of the architectures given.
@@ -772,7 +1107,18 @@ handle_fat_64_file(struct tbd_create_info *__notnull const info_in,
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
-    if (our_read(fd, arch_list, archs_size) < 0) {
+    /*
+     * The arch-table directly follows the fat-header. Read it at its offset,
+     * rather than from the fd's current position, which may be shared.
+     */
+
+    const off_t archs_offset =
+        (off_t)(macho_range.begin + sizeof(struct fat_header));
+
+    const ssize_t archs_read_size =
+        our_pread(fd, arch_list, archs_size, archs_offset);
+
+    if (archs_read_size != (ssize_t)archs_size) {
         free(arch_list);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
@@ -846,13 +1192,9 @@ handle_fat_64_file(struct tbd_create_info *__notnull const info_in,
 
     for (arch = arch_list; arch != end; arch++, arch_index++) {
         const off_t arch_offset = (off_t)(macho_range.begin + arch->offset);
-        if (our_lseek(fd, arch_offset, SEEK_SET) < 0) {
-            free(arch_list);
-            return E_MACHO_FILE_PARSE_SEEK_FAIL;
-        }
-
         struct mach_header header = {};
-        if (our_read(fd, &header, sizeof(header)) < 0) {
+
+        if (our_pread(fd, &header, sizeof(header), arch_offset) < 0) {
             free(arch_list);
             return E_MACHO_FILE_PARSE_READ_FAIL;
         }
@@ -938,9 +1280,15 @@ handle_fat_64_file(struct tbd_create_info *__notnull const info_in,
             .end = arch_offset + arch->size
         };
 
+        struct mf_parse_symbols_from_map_info *symbols_info = NULL;
+        if (jobs != NULL) {
+            symbols_info = &jobs->list[jobs->count].parse_info;
+        }
+
         const enum macho_file_parse_result handle_arch_result =
             parse_thin_file(info_in,
                             fd,
+                            map,
                             arch_range,
                             &header,
                             arch_info,
@@ -948,13 +1296,18 @@ handle_fat_64_file(struct tbd_create_info *__notnull const info_in,
                             arch_is_big_endian,
                             arch_index,
                             tbd_options,
-                            options);
+                            options,
+                            symbols_info);
 
         if (handle_arch_result != E_MACHO_FILE_PARSE_OK) {
             free(arch_list);
             return handle_arch_result;
         }
 
+        if (jobs != NULL) {
+            jobs->count += 1;
+        }
+
         parsed_one_arch = true;
     }
 
@@ -978,12 +1331,34 @@ static bool magic_is_fat_64(const uint32_t magic) {
     }
 }
 
-enum macho_file_parse_result
-macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
-                           struct macho_file *__notnull const macho,
-                           struct macho_file_parse_extra_args extra,
-                           const struct tbd_parse_options tbd_options,
-                           const struct macho_file_parse_options options)
+/*
+ * Map the entire file, so that every architecture can be parsed from the map,
+ * instead of with a read for every load-command, export-trie and string-table.
+ *
+ * A mach-o embedded within another file, or a file that can't be mapped, such
+ * as a pipe, is still parsed with reads, and NULL is returned.
+ */
+
+static uint8_t *map_file(const int fd, const struct range range) {
+    if (range.begin != 0) {
+        return NULL;
+    }
+
+    void *const map = mmap(NULL, range.end, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    return map;
+}
+
+static enum macho_file_parse_result
+parse_from_file(struct tbd_create_info *__notnull const info_in,
+                struct macho_file *__notnull const macho,
+                const uint8_t *const map,
+                const struct macho_file_parse_extra_args extra,
+                const struct tbd_parse_options tbd_options,
+                const struct macho_file_parse_options options)
 {
     enum macho_file_parse_result ret = E_MACHO_FILE_PARSE_OK;
 
@@ -999,24 +1374,52 @@ macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
             return E_MACHO_FILE_PARSE_ALLOC_FAIL;
         }
 
+        struct fat_arch_jobs jobs = {};
+        struct fat_arch_jobs *jobs_ptr = NULL;
+
+        /*
+         * Without a map, the architectures are left to be parsed serially.
+         */
+
+        if (options.parse_archs_concurrently && map != NULL) {
+            if (create_fat_arch_jobs(&jobs, nfat_arch)) {
+                jobs_ptr = &jobs;
+            }
+        }
+
         if (magic_is_fat_64(magic)) {
             ret = handle_fat_64_file(info_in,
                                      fd,
+                                     map,
                                      macho->range,
                                      nfat_arch,
                                      magic_is_big_endian(magic),
                                      extra,
                                      tbd_options,
-                                     options);
+                                     options,
+                                     jobs_ptr);
         } else {
             ret = handle_fat_32_file(info_in,
                                      fd,
+                                     map,
                                      macho->range,
                                      nfat_arch,
                                      magic_is_big_endian(magic),
                                      extra,
                                      tbd_options,
-                                     options);
+                                     options,
+                                     jobs_ptr);
+        }
+
+        if (jobs_ptr != NULL) {
+            if (ret == E_MACHO_FILE_PARSE_OK) {
+                ret = parse_fat_arch_jobs(info_in,
+                                          jobs_ptr,
+                                          extra,
+                                          options.archs_jobs_count);
+            }
+
+            destroy_fat_arch_jobs(jobs_ptr);
         }
 
         if (ret != E_MACHO_FILE_PARSE_OK) {
@@ -1071,6 +1474,7 @@ macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
 
         ret = parse_thin_file(info_in,
                               fd,
+                              map,
                               macho->range,
                               &header,
                               arch,
@@ -1078,7 +1482,8 @@ macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
                               magic_is_big_endian(magic),
                               0,
                               tbd_options,
-                              options);
+                              options,
+                              NULL);
 
         if (ret != E_MACHO_FILE_PARSE_OK) {
             return ret;
@@ -1102,6 +1507,35 @@ macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
     return E_MACHO_FILE_PARSE_OK;
 }
 
+enum macho_file_parse_result
+macho_file_parse_from_file(struct tbd_create_info *__notnull const info_in,
+                           struct macho_file *__notnull const macho,
+                           struct macho_file_parse_extra_args extra,
+                           const struct tbd_parse_options tbd_options,
+                           const struct macho_file_parse_options options)
+{
+    /*
+     * Ingest the metadata and symbols of every architecture unsorted, and only
+     * sort them once at the end, if tbd_ci_sort_info() hasn't already sorted
+     * them.
+     */
+
+    tbd_ci_begin_ingesting(info_in);
+
+    const struct range range = macho->range;
+    uint8_t *const map = map_file(macho->fd, range);
+
+    const enum macho_file_parse_result ret =
+        parse_from_file(info_in, macho, map, extra, tbd_options, options);
+
+    if (map != NULL) {
+        munmap(map, range.end);
+    }
+
+    tbd_ci_finish_ingesting(info_in);
+    return ret;
+}
+
 static bool magic_is_fat_32(const uint32_t magic) {
     switch (magic) {
         case FAT_MAGIC:
@@ -1312,3 +1746,234 @@ void macho_file_print_archs(const int fd) {
         exit(1);
     }
 }
+
+/*
+ * Find the uuid of the thin mach-o file at offset, by reading only its header
+ * and load-commands.
+ */
+
+static bool
+read_thin_uuid(const int fd,
+               const uint64_t offset,
+               const uint64_t size,
+               uint8_t *__notnull const uuid_out)
+{
+    struct mach_header header = {};
+    if (size < sizeof(header)) {
+        return false;
+    }
+
+    /*
+     * A short read would leave the header, or load-commands below, partly
+     * uninitialized, so only full reads are accepted.
+     */
+
+    const ssize_t header_read_size =
+        our_pread(fd, &header, sizeof(header), (off_t)offset);
+
+    if (header_read_size != (ssize_t)sizeof(header)) {
+        return false;
+    }
+
+    const uint32_t magic = header.magic;
+    if (!magic_is_thin(magic)) {
+        return false;
+    }
+
+    const bool is_big_endian = magic_is_big_endian(magic);
+
+    uint32_t ncmds = header.ncmds;
+    uint32_t sizeofcmds = header.sizeofcmds;
+
+    if (is_big_endian) {
+        ncmds = swap_uint32(ncmds);
+        sizeofcmds = swap_uint32(sizeofcmds);
+    }
+
+    uint64_t header_size = sizeof(struct mach_header);
+    if (magic_is_64_bit(magic)) {
+        header_size = sizeof(struct mach_header_64);
+    }
+
+    /*
+     * The 64-bit header is larger than the one read above, so size is checked
+     * again before it's subtracted from.
+     */
+
+    if (size < header_size || sizeofcmds > size - header_size) {
+        return false;
+    }
+
+    uint8_t *const load_cmds = malloc(sizeofcmds);
+    if (load_cmds == NULL) {
+        return false;
+    }
+
+    const off_t load_cmds_offset = (off_t)(offset + header_size);
+    const ssize_t load_cmds_read_size =
+        our_pread(fd, load_cmds, sizeofcmds, load_cmds_offset);
+
+    if (load_cmds_read_size != (ssize_t)sizeofcmds) {
+        free(load_cmds);
+        return false;
+    }
+
+    const uint8_t *iter = load_cmds;
+    uint32_t size_left = sizeofcmds;
+
+    for (uint32_t i = 0; i != ncmds; i++) {
+        if (size_left < sizeof(struct load_command)) {
+            break;
+        }
+
+        struct load_command load_cmd = *(const struct load_command *)iter;
+        if (is_big_endian) {
+            load_cmd.cmd = swap_uint32(load_cmd.cmd);
+            load_cmd.cmdsize = swap_uint32(load_cmd.cmdsize);
+        }
+
+        if (load_cmd.cmdsize < sizeof(struct load_command) ||
+            load_cmd.cmdsize > size_left)
+        {
+            break;
+        }
+
+        if (load_cmd.cmd == LC_UUID) {
+            if (load_cmd.cmdsize < sizeof(struct uuid_command)) {
+                break;
+            }
+
+            const struct uuid_command *const uuid_cmd =
+                (const struct uuid_command *)iter;
+
+            memcpy(uuid_out, uuid_cmd->uuid, sizeof(uuid_cmd->uuid));
+            free(load_cmds);
+
+            return true;
+        }
+
+        iter += load_cmd.cmdsize;
+        size_left -= load_cmd.cmdsize;
+    }
+
+    free(load_cmds);
+    return false;
+}
+
+bool
+macho_file_read_uuids(const struct macho_file *__notnull const macho,
+                      uint8_t **__notnull const uuids_out,
+                      uint32_t *__notnull const count_out)
+{
+    const int fd = macho->fd;
+    const uint32_t magic = macho->magic;
+    const struct range range = macho->range;
+
+    if (!magic_is_fat(magic)) {
+        uint8_t *const uuids = malloc(16);
+        if (uuids == NULL) {
+            return false;
+        }
+
+        if (!read_thin_uuid(fd, range.begin, range_get_size(range), uuids)) {
+            free(uuids);
+            return false;
+        }
+
+        *uuids_out = uuids;
+        *count_out = 1;
+
+        return true;
+    }
+
+    const uint32_t nfat_arch = macho->nfat_arch;
+    if (nfat_arch == 0) {
+        return false;
+    }
+
+    const bool is_fat_64 = magic_is_fat_64(magic);
+    const bool is_big_endian = magic_is_big_endian(magic);
+
+    uint64_t arch_size = sizeof(struct fat_arch);
+    if (is_fat_64) {
+        arch_size = sizeof(struct fat_arch_64);
+    }
+
+    uint64_t archs_size = arch_size;
+    if (guard_overflow_mul(&archs_size, nfat_arch)) {
+        return false;
+    }
+
+    if (archs_size > range_get_size(range) - sizeof(struct fat_header)) {
+        return false;
+    }
+
+    uint8_t *const archs = malloc(archs_size);
+    if (archs == NULL) {
+        return false;
+    }
+
+    const off_t archs_offset = (off_t)(range.begin + sizeof(struct fat_header));
+    if (our_pread(fd, archs, archs_size, archs_offset) < 0) {
+        free(archs);
+        return false;
+    }
+
+    uint8_t *const uuids = malloc(16 * (uint64_t)nfat_arch);
+    if (uuids == NULL) {
+        free(archs);
+        return false;
+    }
+
+    for (uint32_t i = 0; i != nfat_arch; i++) {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+
+        if (is_fat_64) {
+            const struct fat_arch_64 *const arch =
+                (const struct fat_arch_64 *)archs + i;
+
+            offset = arch->offset;
+            size = arch->size;
+
+            if (is_big_endian) {
+                offset = swap_uint64(offset);
+                size = swap_uint64(size);
+            }
+        } else {
+            const struct fat_arch *const arch =
+                (const struct fat_arch *)archs + i;
+
+            offset = arch->offset;
+            size = arch->size;
+
+            if (is_big_endian) {
+                offset = swap_uint32((uint32_t)offset);
+                size = swap_uint32((uint32_t)size);
+            }
+        }
+
+        const uint64_t macho_size = range_get_size(range);
+        if (offset > macho_size || size > macho_size - offset) {
+            free(archs);
+            free(uuids);
+
+            return false;
+        }
+
+        const uint64_t arch_offset = range.begin + offset;
+        if (!read_thin_uuid(fd, arch_offset, size, uuids + (16 * i))) {
+            free(archs);
+            free(uuids);
+
+            return false;
+        }
+    }
+
+    free(archs);
+
+    *uuids_out = uuids;
+    *count_out = nfat_arch;
+
+    return true;
+}
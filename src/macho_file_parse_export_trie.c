@@ -670,16 +670,13 @@ macho_file_parse_export_trie_from_file(
         return E_MACHO_FILE_PARSE_INVALID_RANGE;
     }
 
-    if (our_lseek(fd, full_export_off, SEEK_SET) < 0) {
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
-
     uint8_t *const export_trie = malloc(args.export_size);
     if (export_trie == NULL) {
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
-    if (our_read(fd, export_trie, args.export_size) < 0) {
+    const off_t export_off = (off_t)full_export_off;
+    if (our_pread(fd, export_trie, args.export_size, export_off) < 0) {
         free(export_trie);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
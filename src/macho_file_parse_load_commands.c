@@ -13,6 +13,7 @@
 #include "arch_info.h"
 #include "copy.h"
 #include "guard_overflow.h"
+#include "mach-o/nlist.h"
 #include "macho_file.h"
 #include "objc.h"
 
@@ -166,7 +167,6 @@ parse_section_from_file(struct tbd_create_info *__notnull const info_in,
                         const struct range macho_available_range,
                         const uint32_t sect_offset,
                         const uint64_t sect_size,
-                        const off_t position,
                         const macho_file_parse_error_callback callback,
                         void *const cb_info,
                         const struct tbd_parse_options tbd_options,
@@ -190,24 +190,13 @@ parse_section_from_file(struct tbd_create_info *__notnull const info_in,
         return E_MACHO_FILE_PARSE_INVALID_SECTION;
     }
 
-    /*
-     * Keep an offset to our original position, so we can seek the file back to
-     * its original protection after we're done.
-     */
-
-    if (options.sect_off_absolute) {
-        if (our_lseek(fd, sect_offset, SEEK_SET) < 0) {
-            return E_MACHO_FILE_PARSE_SEEK_FAIL;
-        }
-    } else {
-        const off_t absolute = (off_t)(base + sect_offset);
-        if (our_lseek(fd, absolute, SEEK_SET) < 0) {
-            return E_MACHO_FILE_PARSE_SEEK_FAIL;
-        }
+    off_t absolute = (off_t)sect_offset;
+    if (!options.sect_off_absolute) {
+        absolute += base;
     }
 
     struct objc_image_info image_info = {};
-    if (our_read(fd, &image_info, sizeof(image_info)) < 0) {
+    if (our_pread(fd, &image_info, sizeof(image_info), absolute) < 0) {
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
 
@@ -266,10 +255,6 @@ parse_section_from_file(struct tbd_create_info *__notnull const info_in,
         }
     }
 
-    if (our_lseek(fd, position, SEEK_SET) < 0) {
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
-
     return E_MACHO_FILE_PARSE_OK;
 }
 
@@ -398,6 +383,44 @@ handle_targets_platform_and_uuid(
     return E_MACHO_FILE_PARSE_OK;
 }
 
+void
+macho_file_advise_linkedit(
+    const int fd,
+    const uint64_t base,
+    const struct macho_file_lc_info_out *__notnull const lc_info,
+    const bool is_64,
+    const struct tbd_parse_options tbd_options,
+    const struct macho_file_parse_options options)
+{
+    const uint32_t export_size = lc_info->export_size;
+    bool parse_symtab = true;
+
+    if (!options.use_symbol_table && export_size != 0) {
+        const off_t export_off = (off_t)(base + lc_info->export_off);
+        our_advise_willneed(fd, export_off, export_size);
+
+        parse_symtab = should_parse_symtab(options, tbd_options);
+    }
+
+    const struct symtab_command symtab = lc_info->symtab;
+    if (!parse_symtab || symtab.nsyms == 0) {
+        return;
+    }
+
+    uint64_t symbol_table_size = sizeof(struct nlist);
+    if (is_64) {
+        symbol_table_size = sizeof(struct nlist_64);
+    }
+
+    symbol_table_size *= symtab.nsyms;
+
+    const off_t symoff = (off_t)(base + symtab.symoff);
+    const off_t stroff = (off_t)(base + symtab.stroff);
+
+    our_advise_willneed(fd, symoff, symbol_table_size);
+    our_advise_willneed(fd, stroff, symtab.strsize);
+}
+
 enum macho_file_parse_result
 macho_file_parse_load_commands_from_file(
     struct tbd_create_info *__notnull const info_in,
@@ -478,8 +501,14 @@ macho_file_parse_load_commands_from_file(
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
+    /*
+     * Mach-o load-commands are stored right after the mach-o header.
+     */
+
     const int fd = parse_info->fd;
-    if (our_read(fd, load_cmd_buffer, sizeofcmds) < 0) {
+    const off_t lc_offset = (off_t)available_range_in.begin;
+
+    if (our_pread(fd, load_cmd_buffer, sizeofcmds, lc_offset) < 0) {
         free(load_cmd_buffer);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
@@ -521,12 +550,6 @@ macho_file_parse_load_commands_from_file(
     };
 
     uint8_t *lc_iter = load_cmd_buffer;
-
-    /*
-     * Mach-o load-commands are stored right after the mach-o header.
-     */
-
-    uint64_t lc_position = available_range_in.begin;
     uint32_t size_left = sizeofcmds;
 
     for (uint32_t i = 0; i != ncmds; i++) {
@@ -633,7 +656,6 @@ macho_file_parse_load_commands_from_file(
                 }
 
                 uint32_t swift_version = 0;
-                lc_position += sizeof(struct segment_command);
 
                 const struct section *sect =
                     (const struct section *)(segment + 1);
@@ -668,7 +690,6 @@ macho_file_parse_load_commands_from_file(
                                                 relative_range,
                                                 sect_offset,
                                                 sect_size,
-                                                (off_t)lc_position,
                                                 extra.callback,
                                                 extra.cb_info,
                                                 tbd_options,
@@ -678,8 +699,6 @@ macho_file_parse_load_commands_from_file(
                         free(load_cmd_buffer);
                         return parse_section_result;
                     }
-
-                    lc_position += sizeof(struct section);
                 }
 
                 break;
@@ -748,7 +767,6 @@ macho_file_parse_load_commands_from_file(
                 }
 
                 uint32_t swift_version = 0;
-                lc_position += sizeof(struct segment_command_64);
 
                 const struct section_64 *sect =
                     (const struct section_64 *)(segment + 1);
@@ -783,7 +801,6 @@ macho_file_parse_load_commands_from_file(
                                                 relative_range,
                                                 sect_offset,
                                                 sect_size,
-                                                (off_t)lc_position,
                                                 extra.callback,
                                                 extra.cb_info,
                                                 tbd_options,
@@ -793,8 +810,6 @@ macho_file_parse_load_commands_from_file(
                         free(load_cmd_buffer);
                         return parse_section_result;
                     }
-
-                    lc_position += sizeof(struct section_64);
                 }
 
                 break;
@@ -814,7 +829,6 @@ macho_file_parse_load_commands_from_file(
                     return parse_load_command_result;
                 }
 
-                lc_position += load_cmd.cmdsize;
                 break;
             }
         }
@@ -849,6 +863,38 @@ macho_file_parse_load_commands_from_file(
         return handle_targets_platform_uuid_result;
     }
 
+    if (flags.is_big_endian) {
+        export_off = swap_uint32(export_off);
+        export_size = swap_uint32(export_size);
+
+        symtab.symoff = swap_uint32(symtab.symoff);
+        symtab.nsyms = swap_uint32(symtab.nsyms);
+
+        symtab.stroff = swap_uint32(symtab.stroff);
+        symtab.strsize = swap_uint32(symtab.strsize);
+    }
+
+    const struct macho_file_lc_info_out lc_info = {
+        .export_off = export_off,
+        .export_size = export_size,
+        .symtab = symtab
+    };
+
+    if (options.dont_parse_symbols) {
+        if (lc_info_out != NULL) {
+            *lc_info_out = lc_info;
+        }
+
+        return E_MACHO_FILE_PARSE_OK;
+    }
+
+    macho_file_advise_linkedit(fd,
+                               macho_range.begin,
+                               &lc_info,
+                               flags.is_64,
+                               tbd_options,
+                               options);
+
     enum macho_file_parse_result ret = E_MACHO_FILE_PARSE_OK;
 
     bool parsed_export_trie = false;
@@ -856,11 +902,6 @@ macho_file_parse_load_commands_from_file(
 
     if (!options.use_symbol_table) {
         if (export_off != 0 && export_size != 0) {
-            if (flags.is_big_endian) {
-                export_off = swap_uint32(export_off);
-                export_size = swap_uint32(export_size);
-            }
-
             if (lc_info_out != NULL) {
                 lc_info_out->export_off = export_off;
                 lc_info_out->export_size = export_size;
@@ -902,14 +943,6 @@ macho_file_parse_load_commands_from_file(
     }
 
     if (parse_symtab) {
-        if (flags.is_big_endian) {
-            symtab.symoff = swap_uint32(symtab.symoff);
-            symtab.nsyms = swap_uint32(symtab.nsyms);
-
-            symtab.stroff = swap_uint32(symtab.stroff);
-            symtab.strsize = swap_uint32(symtab.strsize);
-        }
-
         if (lc_info_out != NULL) {
             lc_info_out->symtab = symtab;
         }
@@ -964,17 +997,18 @@ macho_file_parse_load_commands_from_file(
 }
 
 static enum macho_file_parse_result
-parse_section_from_map(struct tbd_create_info *__notnull const info_in,
-                       const struct range map_available_range,
-                       const struct range macho_available_range,
-                       const uint8_t *__notnull const map,
-                       const uint8_t *__notnull const macho,
-                       const uint32_t sect_offset,
-                       const uint64_t sect_size,
-                       const macho_file_parse_error_callback callback,
-                       void *const cb_info,
-                       const struct tbd_parse_options tbd_options,
-                       const struct macho_file_parse_options options)
+parse_section_from_map(
+    struct tbd_create_info *__notnull const info_in,
+    const struct mf_parse_lc_from_map_info *__notnull const parse_info,
+    const struct range macho_available_range,
+    const uint8_t *__notnull const macho,
+    const uint64_t sect_addr,
+    const uint32_t sect_offset,
+    const uint64_t sect_size,
+    const macho_file_parse_error_callback callback,
+    void *const cb_info,
+    const struct tbd_parse_options tbd_options,
+    const struct macho_file_parse_options options)
 {
     if (sect_size != sizeof(struct objc_image_info)) {
         return E_MACHO_FILE_PARSE_INVALID_SECTION;
@@ -991,11 +1025,27 @@ parse_section_from_map(struct tbd_create_info *__notnull const info_in,
         .end = sect_end
     };
 
-    if (options.sect_off_absolute) {
+    if (parse_info->get_data_at_address != NULL) {
+        const uint8_t *const data =
+            parse_info->get_data_at_address(
+                parse_info->get_data_at_address_info,
+                sect_addr,
+                sect_size);
+
+        if (data == NULL) {
+            return E_MACHO_FILE_PARSE_INVALID_SECTION;
+        }
+
+        image_info = (const struct objc_image_info *)data;
+    } else if (options.sect_off_absolute) {
+        const struct range map_available_range =
+            parse_info->available_map_range;
+
         if (!range_contains_other(map_available_range, sect_range)) {
             return E_MACHO_FILE_PARSE_INVALID_SECTION;
         }
 
+        const uint8_t *const map = parse_info->map;
         image_info = (const struct objc_image_info *)(map + sect_offset);
     } else {
         if (!range_contains_other(macho_available_range, sect_range)) {
@@ -1134,8 +1184,6 @@ macho_file_parse_load_commands_from_map(
 
     const uint8_t *const map = parse_info->map;
     const uint64_t arch_index = parse_info->arch_index;
-
-    const struct range available_map_range = parse_info->available_map_range;
     uint32_t size_left = sizeofcmds;
 
     struct macho_file_parse_single_lc_info parse_lc_info = {
@@ -1268,6 +1316,7 @@ macho_file_parse_load_commands_from_map(
                      * section-size is zero.
                      */
 
+                    uint32_t sect_addr = sect->addr;
                     uint32_t sect_offset = sect->offset;
                     uint32_t sect_size = sect->size;
 
@@ -1276,16 +1325,17 @@ macho_file_parse_load_commands_from_map(
                     }
 
                     if (flags.is_big_endian) {
+                        sect_addr = swap_uint32(sect_addr);
                         sect_offset = swap_uint32(sect_offset);
                         sect_size = swap_uint32(sect_size);
                     }
 
                     const enum macho_file_parse_result parse_section_result =
                         parse_section_from_map(info_in,
-                                               available_map_range,
+                                               parse_info,
                                                relative_range,
-                                               map,
                                                macho,
+                                               sect_addr,
                                                sect_offset,
                                                sect_size,
                                                extra.callback,
@@ -1374,6 +1424,7 @@ macho_file_parse_load_commands_from_map(
                      * section-size is zero.
                      */
 
+                    uint64_t sect_addr = sect->addr;
                     uint32_t sect_offset = sect->offset;
                     uint64_t sect_size = sect->size;
 
@@ -1382,16 +1433,17 @@ macho_file_parse_load_commands_from_map(
                     }
 
                     if (flags.is_big_endian) {
+                        sect_addr = swap_uint64(sect_addr);
                         sect_offset = swap_uint32(sect_offset);
                         sect_size = swap_uint64(sect_size);
                     }
 
                     const enum macho_file_parse_result parse_section_result =
                         parse_section_from_map(info_in,
-                                               available_map_range,
+                                               parse_info,
                                                relative_range,
-                                               map,
                                                macho,
+                                               sect_addr,
                                                sect_offset,
                                                sect_size,
                                                extra.callback,
@@ -1453,6 +1505,27 @@ macho_file_parse_load_commands_from_map(
         return handle_targets_platform_uuid_result;
     }
 
+    if (options.dont_parse_symbols) {
+        if (flags.is_big_endian) {
+            export_off = swap_uint32(export_off);
+            export_size = swap_uint32(export_size);
+
+            symtab.symoff = swap_uint32(symtab.symoff);
+            symtab.nsyms = swap_uint32(symtab.nsyms);
+
+            symtab.stroff = swap_uint32(symtab.stroff);
+            symtab.strsize = swap_uint32(symtab.strsize);
+        }
+
+        if (lc_info_out != NULL) {
+            lc_info_out->export_off = export_off;
+            lc_info_out->export_size = export_size;
+            lc_info_out->symtab = symtab;
+        }
+
+        return E_MACHO_FILE_PARSE_OK;
+    }
+
     enum macho_file_parse_result ret = E_MACHO_FILE_PARSE_OK;
 
     bool parsed_export_trie = false;
@@ -1531,7 +1604,9 @@ macho_file_parse_load_commands_from_map(
                 .available_range = parse_info->available_map_range,
 
                 .arch_index = arch_index,
+
                 .is_big_endian = flags.is_big_endian,
+                .copy_strings = options.copy_strings_in_map,
 
                 .symoff = symtab.symoff,
                 .nsyms = symtab.nsyms,
@@ -1570,3 +1645,107 @@ macho_file_parse_load_commands_from_map(
 
     return E_MACHO_FILE_PARSE_OK;
 }
+
+enum macho_file_parse_result
+macho_file_parse_symbols_from_map(
+    struct tbd_create_info *__notnull const info_in,
+    const struct mf_parse_symbols_from_map_info *__notnull const parse_info,
+    struct string_buffer *__notnull const export_trie_sb)
+{
+    const uint8_t *const map = parse_info->map;
+    const struct range available_range = parse_info->available_range;
+
+    const uint64_t arch_index = parse_info->arch_index;
+    const struct macho_file_lc_info_out lc_info = parse_info->lc_info;
+
+    const struct tbd_parse_options tbd_options = parse_info->tbd_options;
+    const struct macho_file_parse_options options = parse_info->options;
+    const struct macho_file_parse_lc_flags flags = parse_info->flags;
+
+    enum macho_file_parse_result ret = E_MACHO_FILE_PARSE_OK;
+
+    bool parsed_export_trie = false;
+    bool parse_symtab = true;
+
+    const uint32_t nsyms = lc_info.symtab.nsyms;
+    if (!options.use_symbol_table) {
+        if (lc_info.export_off != 0 && lc_info.export_size != 0) {
+            const struct macho_file_parse_export_trie_args args = {
+                .info_in = info_in,
+                .available_range = available_range,
+
+                .arch_index = arch_index,
+
+                .is_64 = flags.is_64,
+                .is_big_endian = flags.is_big_endian,
+
+                .export_off = lc_info.export_off,
+                .export_size = lc_info.export_size,
+
+                .sb_buffer = export_trie_sb,
+                .tbd_options = tbd_options
+            };
+
+            ret = macho_file_parse_export_trie_from_map(args, map);
+            if (ret != E_MACHO_FILE_PARSE_OK) {
+                return ret;
+            }
+
+            parsed_export_trie = true;
+            if (nsyms != 0) {
+                parse_symtab = should_parse_symtab(options, tbd_options);
+            } else {
+                parse_symtab = false;
+            }
+        } else if (nsyms == 0) {
+            return E_MACHO_FILE_PARSE_NO_SYMBOL_TABLE;
+        }
+    } else if (nsyms == 0) {
+        return E_MACHO_FILE_PARSE_NO_SYMBOL_TABLE;
+    }
+
+    if (parse_symtab) {
+        if (options.dont_parse_exports) {
+            return E_MACHO_FILE_PARSE_OK;
+        }
+
+        const struct macho_file_parse_symtab_args args = {
+            .info_in = info_in,
+            .available_range = available_range,
+
+            .arch_index = arch_index,
+
+            .is_big_endian = flags.is_big_endian,
+            .copy_strings = options.copy_strings_in_map,
+
+            .symoff = lc_info.symtab.symoff,
+            .nsyms = nsyms,
+
+            .stroff = lc_info.symtab.stroff,
+            .strsize = lc_info.symtab.strsize,
+
+            .tbd_options = tbd_options
+        };
+
+        if (flags.is_64) {
+            ret = macho_file_parse_symtab_64_from_map(&args, map);
+        } else {
+            ret = macho_file_parse_symtab_from_map(&args, map);
+        }
+    } else if (!parsed_export_trie) {
+        const uint64_t ignore_missing_exports =
+            (tbd_options.ignore_exports || tbd_options.ignore_missing_exports);
+
+        if (ignore_missing_exports) {
+            return E_MACHO_FILE_PARSE_OK;
+        }
+
+        return E_MACHO_FILE_PARSE_NO_DATA;
+    }
+
+    if (ret != E_MACHO_FILE_PARSE_OK) {
+        return ret;
+    }
+
+    return E_MACHO_FILE_PARSE_OK;
+}
@@ -57,6 +57,7 @@ handle_symbol(struct tbd_create_info *__notnull const info_in,
               const uint16_t n_desc,
               const uint8_t n_type,
               const bool is_undef,
+              const bool copy_string,
               const struct tbd_parse_options options)
 {
     /*
@@ -105,6 +106,7 @@ handle_symbol(struct tbd_create_info *__notnull const info_in,
                                     predefined_type,
                                     meta_type,
                                     (is_not_exported == 0),
+                                    copy_string,
                                     options);
 
     if (add_symbol_result != E_TBD_CI_ADD_DATA_OK) {
@@ -135,7 +137,8 @@ loop_nlist_32(struct tbd_create_info *__notnull const info_in,
               const uint32_t strsize,
               const uint64_t arch_index,
               const struct tbd_parse_options options,
-              const bool is_big_endian)
+              const bool is_big_endian,
+              const bool copy_strings)
 {
     const enum tbd_version version = info_in->version;
 
@@ -199,6 +202,7 @@ loop_nlist_32(struct tbd_create_info *__notnull const info_in,
                               (uint16_t)n_desc,
                               n_type,
                               is_undef,
+                              copy_strings,
                               options);
 
             if (unlikely(handle_symbol_result != E_MACHO_FILE_PARSE_OK)) {
@@ -262,6 +266,7 @@ loop_nlist_32(struct tbd_create_info *__notnull const info_in,
                               (uint16_t)n_desc,
                               n_type,
                               is_undef,
+                              copy_strings,
                               options);
 
             if (unlikely(handle_symbol_result != E_MACHO_FILE_PARSE_OK)) {
@@ -281,7 +286,8 @@ loop_nlist_64(struct tbd_create_info *__notnull const info_in,
               const uint32_t strsize,
               const uint64_t arch_index,
               const struct tbd_parse_options options,
-              const bool is_big_endian)
+              const bool is_big_endian,
+              const bool copy_strings)
 {
     const enum tbd_version version = info_in->version;
 
@@ -345,6 +351,7 @@ loop_nlist_64(struct tbd_create_info *__notnull const info_in,
                               n_desc,
                               n_type,
                               is_undef,
+                              copy_strings,
                               options);
 
             if (unlikely(handle_symbol_result != E_MACHO_FILE_PARSE_OK)) {
@@ -408,6 +415,7 @@ loop_nlist_64(struct tbd_create_info *__notnull const info_in,
                               n_desc,
                               n_type,
                               is_undef,
+                              copy_strings,
                               options);
 
             if (unlikely(handle_symbol_result != E_MACHO_FILE_PARSE_OK)) {
@@ -499,32 +507,31 @@ macho_file_parse_symtab_from_file(
         return E_MACHO_FILE_PARSE_INVALID_SYMBOL_TABLE;
     }
 
-    if (our_lseek(fd, absolute_symoff, SEEK_SET) < 0) {
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
+    /*
+     * Have the string-table read ahead while the symbol-table is read.
+     */
+
+    our_advise_willneed(fd, (off_t)absolute_stroff, strsize);
 
     struct nlist *const symbol_table = malloc(symbol_table_size);
     if (symbol_table == NULL) {
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
-    if (our_read(fd, symbol_table, symbol_table_size) < 0) {
+    const off_t symoff = (off_t)absolute_symoff;
+    if (our_pread(fd, symbol_table, symbol_table_size, symoff) < 0) {
         free(symbol_table);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
 
-    if (our_lseek(fd, absolute_stroff, SEEK_SET) < 0) {
-        free(symbol_table);
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
-
     char *const string_table = malloc(strsize);
     if (string_table == NULL) {
         free(symbol_table);
         return E_MACHO_FILE_PARSE_SEEK_FAIL;
     }
 
-    if (our_read(fd, string_table, strsize) < 0) {
+    const off_t stroff = (off_t)absolute_stroff;
+    if (our_pread(fd, string_table, strsize, stroff) < 0) {
         free(symbol_table);
         free(string_table);
 
@@ -539,7 +546,8 @@ macho_file_parse_symtab_from_file(
                       strsize,
                       args->arch_index,
                       args->tbd_options,
-                      args->is_big_endian);
+                      args->is_big_endian,
+                      true);
 
     free(symbol_table);
     free(string_table);
@@ -631,32 +639,31 @@ macho_file_parse_symtab_64_from_file(
         return E_MACHO_FILE_PARSE_INVALID_SYMBOL_TABLE;
     }
 
-    if (our_lseek(fd, absolute_symoff, SEEK_SET) < 0) {
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
+    /*
+     * Have the string-table read ahead while the symbol-table is read.
+     */
+
+    our_advise_willneed(fd, (off_t)absolute_stroff, strsize);
 
     struct nlist_64 *const symbol_table = malloc(symbol_table_size);
     if (symbol_table == NULL) {
         return E_MACHO_FILE_PARSE_ALLOC_FAIL;
     }
 
-    if (our_read(fd, symbol_table, symbol_table_size) < 0) {
+    const off_t symoff = (off_t)absolute_symoff;
+    if (our_pread(fd, symbol_table, symbol_table_size, symoff) < 0) {
         free(symbol_table);
         return E_MACHO_FILE_PARSE_READ_FAIL;
     }
 
-    if (our_lseek(fd, absolute_stroff, SEEK_SET) < 0) {
-        free(symbol_table);
-        return E_MACHO_FILE_PARSE_SEEK_FAIL;
-    }
-
     char *const string_table = malloc(strsize);
     if (string_table == NULL) {
         free(symbol_table);
         return E_MACHO_FILE_PARSE_SEEK_FAIL;
     }
 
-    if (our_read(fd, string_table, strsize) < 0) {
+    const off_t stroff = (off_t)absolute_stroff;
+    if (our_pread(fd, string_table, strsize, stroff) < 0) {
         free(symbol_table);
         free(string_table);
 
@@ -671,7 +678,8 @@ macho_file_parse_symtab_64_from_file(
                       strsize,
                       args->arch_index,
                       args->tbd_options,
-                      args->is_big_endian);
+                      args->is_big_endian,
+                      true);
 
     free(symbol_table);
     free(string_table);
@@ -752,7 +760,8 @@ macho_file_parse_symtab_from_map(
                       strsize,
                       args->arch_index,
                       args->tbd_options,
-                      args->is_big_endian);
+                      args->is_big_endian,
+                      args->copy_strings);
 
     if (loop_nlist_result != E_MACHO_FILE_PARSE_OK) {
         return loop_nlist_result;
@@ -830,7 +839,8 @@ macho_file_parse_symtab_64_from_map(
                       strsize,
                       args->arch_index,
                       args->tbd_options,
-                      args->is_big_endian);
+                      args->is_big_endian,
+                      args->copy_strings);
 
     if (loop_nlist_result != E_MACHO_FILE_PARSE_OK) {
         return loop_nlist_result;
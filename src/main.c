@@ -16,8 +16,13 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "mach-o/fat.h"
+#include "mach-o/loader.h"
+
+#include "compressed_file.h"
 #include "copy.h"
 #include "dir_recurse.h"
+#include "input_manifest.h"
 #include "macho_file.h"
 #include "our_io.h"
 #include "path.h"
@@ -25,11 +30,13 @@
 #include "parse_or_list_fields.h"
 #include "parse_dsc_for_main.h"
 #include "parse_macho_for_main.h"
+#include "parse_zip_for_main.h"
 
+#include "recurse_jobs.h"
 #include "request_user_input.h"
 #include "tbd.h"
 #include "tbd_for_main.h"
-#include "tbd_write.h"
+#include "tbd_writer.h"
 #include "unused.h"
 #include "usage.h"
 #include "util.h"
@@ -39,32 +46,154 @@ struct recurse_callback_info {
     struct tbd_for_main *orig;
 
     FILE *combine_file;
+
     uint64_t files_parsed;
+    uint64_t files_unchanged;
 
     struct retained_user_info *retained;
     struct string_buffer *export_trie_sb;
+
+    struct recurse_jobs *jobs;
+    struct tbd_writer *writer;
+    struct parse_dsc_for_main_batch *dsc_batch;
+
+    struct input_manifest *manifest;
 };
 
-static bool
-recurse_directory_callback(const char *__notnull const dir_path,
-                           const uint64_t dir_path_length,
-                           const int fd,
-                           struct dirent *const dirent,
-                           const uint64_t name_length,
-                           void *__notnull const callback_info)
+enum recursed_file_type {
+    RECURSED_FILE_TYPE_NONE,
+    RECURSED_FILE_TYPE_MACHO,
+    RECURSED_FILE_TYPE_DSC,
+    RECURSED_FILE_TYPE_ZIP
+};
+
+/*
+ * Record a successfully parsed file in the manifest, along with its output.
+ *
+ * The .tbds of a zip archive's members are written out individually, possibly
+ * alongside other files' .tbds, so aren't tracked as the archive's output.
+ */
+
+static void
+record_recursed_file(
+    const struct recurse_callback_info *__notnull const recurse_info,
+    const char *__notnull const dir_path,
+    const uint64_t dir_path_length,
+    const int fd,
+    const char *__notnull const name,
+    const uint64_t name_length,
+    const enum recursed_file_type type)
 {
-    struct recurse_callback_info *const recurse_info =
-        (struct recurse_callback_info *)callback_info;
+    struct input_manifest *const manifest = recurse_info->manifest;
+    if (manifest == NULL) {
+        return;
+    }
+
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0) {
+        return;
+    }
+
+    uint64_t path_length = 0;
+    char *const path =
+        path_append_component(dir_path,
+                              dir_path_length,
+                              name,
+                              name_length,
+                              &path_length);
+
+    if (path == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        exit(1);
+    }
 
+    const struct tbd_for_main *const tbd = recurse_info->tbd;
+
+    char *output_path = NULL;
+    uint64_t output_path_length = 0;
+
+    switch (type) {
+        case RECURSED_FILE_TYPE_NONE:
+        case RECURSED_FILE_TYPE_ZIP:
+            break;
+
+        case RECURSED_FILE_TYPE_MACHO:
+            output_path =
+                tbd_for_main_create_write_path_for_recursing(
+                    tbd,
+                    dir_path,
+                    dir_path_length,
+                    name,
+                    name_length,
+                    "tbd",
+                    3,
+                    &output_path_length);
+
+            break;
+
+        case RECURSED_FILE_TYPE_DSC:
+            output_path =
+                tbd_for_main_create_dsc_folder_path(tbd,
+                                                    dir_path,
+                                                    dir_path_length,
+                                                    name,
+                                                    name_length,
+                                                    "tbds",
+                                                    4,
+                                                    &output_path_length);
+
+            break;
+    }
+
+    const enum input_manifest_result record_result =
+        input_manifest_record(manifest,
+                              path,
+                              path_length,
+                              &sbuf,
+                              output_path,
+                              output_path_length);
+
+    if (record_result != E_INPUT_MANIFEST_OK) {
+        fputs("Failed to allocate memory\n", stderr);
+        exit(1);
+    }
+
+    free(output_path);
+    free(path);
+}
+
+static void
+parse_file_while_recursing(
+    struct recurse_callback_info *__notnull const recurse_info,
+    const char *__notnull const dir_path,
+    const uint64_t dir_path_length,
+    const int fd,
+    const char *__notnull const name,
+    const uint64_t name_length,
+    struct parse_macho_for_main_buffered *const buffered)
+{
     struct tbd_for_main *const orig = recurse_info->orig;
     struct tbd_for_main *const tbd = recurse_info->tbd;
 
     struct retained_user_info *const retained = recurse_info->retained;
     struct magic_buffer magic_buffer = {};
 
-    const char *const name = dirent->d_name;
-    const bool should_combine = tbd->options.combine_tbds;
+    /*
+     * Shared-caches in the batch have to be committed before we print any
+     * messages for this file, which we know we won't do if the file was found
+     * to not be a mach-o file.
+     */
+
+    struct parse_dsc_for_main_batch *const dsc_batch = recurse_info->dsc_batch;
+    if (dsc_batch != NULL) {
+        if (buffered == NULL ||
+            buffered->result != E_PARSE_MACHO_FOR_MAIN_BUFFERED_NOT_A_MACHO)
+        {
+            parse_dsc_for_main_batch_commit_all(dsc_batch);
+        }
+    }
 
+    const bool should_combine = tbd->options.combine_tbds;
     if (tbd->filetypes.macho) {
         struct parse_macho_for_main_args args = {
             .fd = fd,
@@ -88,10 +217,20 @@ recurse_directory_callback(const char *__notnull const dir_path,
 
         if (should_combine) {
             args.combine_file = recurse_info->combine_file;
+        } else {
+            args.writer = recurse_info->writer;
         }
 
-        const enum parse_macho_for_main_result parse_as_macho_result =
-            parse_macho_file_for_main_while_recursing(&args);
+        enum parse_macho_for_main_result parse_as_macho_result =
+            E_PARSE_MACHO_FOR_MAIN_OK;
+
+        if (buffered != NULL) {
+            parse_as_macho_result =
+                parse_macho_file_for_main_from_buffered(&args, buffered);
+        } else {
+            parse_as_macho_result =
+                parse_macho_file_for_main_while_recursing(&args);
+        }
 
         switch (parse_as_macho_result) {
             case E_PARSE_MACHO_FOR_MAIN_OK: {
@@ -99,18 +238,23 @@ recurse_directory_callback(const char *__notnull const dir_path,
                     recurse_info->combine_file = args.combine_file;
                 }
 
-                recurse_info->files_parsed += 1;
-                close(fd);
+                record_recursed_file(recurse_info,
+                                     dir_path,
+                                     dir_path_length,
+                                     fd,
+                                     name,
+                                     name_length,
+                                     RECURSED_FILE_TYPE_MACHO);
 
-                return true;
+                recurse_info->files_parsed += 1;
+                return;
             }
 
             case E_PARSE_MACHO_FOR_MAIN_NOT_A_MACHO:
                 break;
 
             case E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR:
-                close(fd);
-                return true;
+                return;
         }
     }
 
@@ -138,6 +282,8 @@ recurse_directory_callback(const char *__notnull const dir_path,
 
         if (should_combine) {
             args.combine_file = recurse_info->combine_file;
+        } else {
+            args.batch = dsc_batch;
         }
 
         const enum parse_dsc_for_main_result parse_as_dsc_result =
@@ -149,17 +295,22 @@ recurse_directory_callback(const char *__notnull const dir_path,
                     recurse_info->combine_file = args.combine_file;
                 }
 
-                recurse_info->files_parsed += 1;
-                close(fd);
+                record_recursed_file(recurse_info,
+                                     dir_path,
+                                     dir_path_length,
+                                     fd,
+                                     name,
+                                     name_length,
+                                     RECURSED_FILE_TYPE_DSC);
 
-                return true;
+                recurse_info->files_parsed += 1;
+                return;
 
             case E_PARSE_DSC_FOR_MAIN_NOT_A_SHARED_CACHE:
                 break;
 
             case E_PARSE_DSC_FOR_MAIN_OTHER_ERROR:
-                close(fd);
-                return true;
+                return;
 
             /*
              * This error shouldn't be returned while recursing.
@@ -170,10 +321,247 @@ recurse_directory_callback(const char *__notnull const dir_path,
         }
     }
 
+    if (tbd->filetypes.zip) {
+        if (dsc_batch != NULL) {
+            parse_dsc_for_main_batch_commit_all(dsc_batch);
+        }
+
+        struct parse_zip_for_main_args args = {
+            .fd = fd,
+            .retained = retained,
+
+            .tbd = tbd,
+            .orig = orig,
+
+            .dir_path = dir_path,
+            .dir_path_length = dir_path_length,
+
+            .name = name,
+            .name_length = name_length,
+
+            .dont_handle_non_zip_error = true,
+            .print_paths = true,
+
+            .export_trie_sb = recurse_info->export_trie_sb
+        };
+
+        if (should_combine) {
+            args.combine_file = recurse_info->combine_file;
+        } else {
+            args.writer = recurse_info->writer;
+        }
+
+        const enum parse_zip_for_main_result parse_as_zip_result =
+            parse_zip_for_main_while_recursing(&args);
+
+        if (should_combine) {
+            recurse_info->combine_file = args.combine_file;
+        }
+
+        switch (parse_as_zip_result) {
+            case E_PARSE_ZIP_FOR_MAIN_OK:
+                record_recursed_file(recurse_info,
+                                     dir_path,
+                                     dir_path_length,
+                                     fd,
+                                     name,
+                                     name_length,
+                                     RECURSED_FILE_TYPE_ZIP);
+
+                recurse_info->files_parsed += 1;
+                return;
+
+            case E_PARSE_ZIP_FOR_MAIN_NOT_A_ZIP:
+                break;
+
+            case E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR:
+                return;
+        }
+    }
+
+    /*
+     * Files that aren't among the provided filetypes are recorded as well, so
+     * they aren't read again either.
+     */
+
+    record_recursed_file(recurse_info,
+                         dir_path,
+                         dir_path_length,
+                         fd,
+                         name,
+                         name_length,
+                         RECURSED_FILE_TYPE_NONE);
+}
+
+/*
+ * Return whether the file at dir_path/name is unchanged since it was last
+ * parsed, according to the manifest.
+ */
+
+static bool
+recursed_file_is_unchanged(struct input_manifest *__notnull const manifest,
+                           const char *__notnull const dir_path,
+                           const uint64_t dir_path_length,
+                           const int fd,
+                           const char *__notnull const name,
+                           const uint64_t name_length)
+{
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0) {
+        return false;
+    }
+
+    uint64_t path_length = 0;
+    char *const path =
+        path_append_component(dir_path,
+                              dir_path_length,
+                              name,
+                              name_length,
+                              &path_length);
+
+    if (path == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        exit(1);
+    }
+
+    const bool unchanged =
+        input_manifest_input_unchanged(manifest, path, path_length, &sbuf);
+
+    free(path);
+    return unchanged;
+}
+
+static bool
+recurse_directory_callback(const char *__notnull const dir_path,
+                           const uint64_t dir_path_length,
+                           const int fd,
+                           struct dirent *const dirent,
+                           const uint64_t name_length,
+                           void *__notnull const callback_info)
+{
+    struct recurse_callback_info *const recurse_info =
+        (struct recurse_callback_info *)callback_info;
+
+    const char *const name = dirent->d_name;
+    struct input_manifest *const manifest = recurse_info->manifest;
+
+    if (manifest != NULL) {
+        const bool unchanged =
+            recursed_file_is_unchanged(manifest,
+                                       dir_path,
+                                       dir_path_length,
+                                       fd,
+                                       name,
+                                       name_length);
+
+        if (unchanged) {
+            recurse_info->files_unchanged += 1;
+
+            close(fd);
+            return true;
+        }
+    }
+
+    struct recurse_jobs *const jobs = recurse_info->jobs;
+    if (jobs != NULL) {
+        const enum recurse_jobs_result add_job_result =
+            recurse_jobs_add(jobs,
+                             dir_path,
+                             dir_path_length,
+                             name,
+                             name_length,
+                             fd);
+
+        if (add_job_result != E_RECURSE_JOBS_OK) {
+            fprintf(stderr,
+                    "Failed to allocate memory for file (at path %s/%s)\n",
+                    dir_path,
+                    name);
+
+            close(fd);
+        }
+
+        return true;
+    }
+
+    parse_file_while_recursing(recurse_info,
+                               dir_path,
+                               dir_path_length,
+                               fd,
+                               name,
+                               name_length,
+                               NULL);
+
     close(fd);
     return true;
 }
 
+static void
+commit_recurse_job(struct recurse_job *__notnull const job,
+                   void *__notnull const callback_info)
+{
+    struct recurse_callback_info *const recurse_info =
+        (struct recurse_callback_info *)callback_info;
+
+    parse_file_while_recursing(recurse_info,
+                               job->dir_path,
+                               job->dir_path_length,
+                               job->fd,
+                               job->name,
+                               job->name_length,
+                               &job->buffered);
+}
+
+/*
+ * Reject only the files we know for sure would be silently skipped while
+ * recursing, keeping any file with a head too small to tell.
+ */
+
+static bool
+recurse_directory_filter(const uint8_t *__notnull const head,
+                         const uint64_t head_size,
+                         void *__notnull const callback_info)
+{
+    const struct recurse_callback_info *const recurse_info =
+        (const struct recurse_callback_info *)callback_info;
+
+    if (head_size < 16) {
+        return true;
+    }
+
+    const struct tbd_for_main *const tbd = recurse_info->tbd;
+    if (tbd->filetypes.macho) {
+        switch (*(const uint32_t *)head) {
+            case MH_MAGIC:
+            case MH_CIGAM:
+            case MH_MAGIC_64:
+            case MH_CIGAM_64:
+            case FAT_MAGIC:
+            case FAT_CIGAM:
+            case FAT_MAGIC_64:
+            case FAT_CIGAM_64:
+                return true;
+
+            default:
+                break;
+        }
+    }
+
+    if (tbd->filetypes.dyld_shared_cache) {
+        if (memcmp(head, "dyld_v1", 7) == 0) {
+            return true;
+        }
+    }
+
+    if (tbd->filetypes.zip) {
+        if (memcmp(head, "PK\x03\x04", 4) == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static bool
 recurse_directory_fail_callback(const char *const dir_path,
                                 __unused const uint64_t dir_path_length,
@@ -216,6 +604,19 @@ recurse_directory_fail_callback(const char *const dir_path,
     return true;
 }
 
+/*
+ * "stdin" may be a pipe, which can't be seeked or mapped, so it's read in full
+ * into an anonymous file first, and then parsed like any other file.
+ */
+
+static int open_parse_path(const char *__notnull const path) {
+    if (strcmp(path, "stdin") == 0) {
+        return our_spool_to_seekable_file(STDIN_FILENO, "tbd-stdin");
+    }
+
+    return our_open(path, O_RDONLY, 0);
+}
+
 static void destroy_tbds_array(struct array *const tbds) {
     struct tbd_for_main *tbd = tbds->data;
     const struct tbd_for_main *const end = tbds->data_end;
@@ -500,6 +901,105 @@ verify_tbd_for_main(struct tbd_for_main *__notnull const tbd,
 
             result = 1;
         }
+
+        /*
+         * Store "stdin" itself as the path, which is recognized again when the
+         * file is opened.
+         */
+
+        tbd->parse_path = (char *)path;
+        tbd->parse_path_length = strlen(path);
+    }
+
+    /*
+     * When not recursing, jobs are instead used to parse the architectures of a
+     * fat mach-o file.
+     */
+
+    if (tbd->jobs_count > 1 && !tbd->options.recurse_directories) {
+        tbd->macho_options.parse_archs_concurrently = true;
+        tbd->macho_options.archs_jobs_count = tbd->jobs_count;
+    }
+
+    if (tbd->dsc_previous_path != NULL) {
+        /*
+         * The previous shared-cache is looked up in the write-path's manifest
+         * by its full path, as the shared-cache being parsed is recorded.
+         */
+
+        char *const previous_path = tbd->dsc_previous_path;
+        uint64_t previous_path_length = strlen(previous_path);
+
+        char *const full_previous_path =
+            path_get_absolute_path(previous_path,
+                                   previous_path_length,
+                                   &previous_path_length);
+
+        if (full_previous_path == NULL) {
+            fputs("Failed to allocate memory\n", stderr);
+            exit(1);
+        }
+
+        if (full_previous_path != previous_path) {
+            free(previous_path);
+            tbd->dsc_previous_path = full_previous_path;
+        }
+
+        if (tbd->options.recurse_directories) {
+            fputs("Option --dsc-previous-cache is only supported when parsing "
+                  "a single dyld_shared_cache file, and not while recursing\n",
+                  stderr);
+
+            result = 1;
+        }
+
+        /*
+         * Only when every image is extracted are the .tbd files of unchanged
+         * images known to be kept from the previous run.
+         */
+
+        if (tbd->dsc_image_filters.item_count != 0 ||
+            tbd->dsc_image_numbers.item_count != 0)
+        {
+            fputs("Option --dsc-previous-cache can't be provided along with "
+                  "image filters or image-numbers, as it's only supported "
+                  "when extracting every image\n",
+                  stderr);
+
+            result = 1;
+        }
+    }
+
+    const uint64_t merge_paths_count = tbd->dsc_merge_paths.item_count;
+    if (merge_paths_count != 0) {
+        if (tbd->options.recurse_directories) {
+            fputs("Option --dsc-merge-cache is only supported when parsing a "
+                  "single dyld_shared_cache file, and not while recursing\n",
+                  stderr);
+
+            result = 1;
+        }
+
+        if (tbd->dsc_previous_path != NULL) {
+            fputs("Option --dsc-merge-cache can't be provided along with "
+                  "option --dsc-previous-cache\n",
+                  stderr);
+
+            result = 1;
+        }
+
+        /*
+         * Each merged shared-cache adds a target to the .tbds created, and the
+         * targets of each symbol are only able to hold 63 bits.
+         */
+
+        if (merge_paths_count > 62) {
+            fputs("At most 62 dyld_shared_cache files can be merged into the "
+                  "dyld_shared_cache being parsed\n",
+                  stderr);
+
+            result = 1;
+        }
     }
 
     if (tbd->dsc_image_filters.item_count != 0) {
@@ -531,6 +1031,146 @@ verify_tbd_for_main(struct tbd_for_main *__notnull const tbd,
     return result;
 }
 
+/*
+ * Options that only change how inputs are parsed or skipped, and not the .tbds
+ * created from them, are left out of the options' fingerprint.
+ */
+
+static bool option_affects_output(const char *__notnull const option) {
+    static const char *const options[] = {
+        "cache-dir",
+        "dsc-drop-pages",
+        "dsc-memory-limit",
+        "dsc-previous-cache",
+        "incremental",
+        "j",
+        "jobs"
+    };
+
+    for (uint64_t i = 0; i != sizeof(options) / sizeof(*options); i++) {
+        if (strcmp(option, options[i]) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Load the manifest for tbd's write-path, returning 1 on failure.
+ */
+
+static int
+load_manifest(const struct tbd_for_main *__notnull const tbd,
+              struct input_manifest *__notnull const manifest,
+              const bool print_paths)
+{
+    if (tbd->write_path == NULL) {
+        fputs("Option --incremental needs a path to write out to, and can't be "
+              "used when writing to stdout\n",
+              stderr);
+
+        return 1;
+    }
+
+    if (tbd->options.combine_tbds || tbd->options.tar_output) {
+        fputs("Option --incremental can't be used when combining .tbds into a "
+              "single file or archive, as every input is needed to write it\n",
+              stderr);
+
+        return 1;
+    }
+
+    const uint64_t write_path_length =
+        remove_end_slashes(tbd->write_path, tbd->write_path_length);
+
+    const enum input_manifest_result load_result =
+        input_manifest_load(manifest,
+                            tbd->write_path,
+                            write_path_length,
+                            tbd->options_fingerprint);
+
+    switch (load_result) {
+        case E_INPUT_MANIFEST_OK:
+            return 0;
+
+        case E_INPUT_MANIFEST_ALLOC_FAIL:
+            fputs("Failed to allocate memory\n", stderr);
+            break;
+
+        case E_INPUT_MANIFEST_READ_FAIL:
+        case E_INPUT_MANIFEST_WRITE_FAIL:
+            if (print_paths) {
+                fprintf(stderr,
+                        "Failed to read manifest (at path %s), error: %s\n",
+                        manifest->path,
+                        strerror(errno));
+            } else {
+                fprintf(stderr,
+                        "Failed to read the manifest of the provided "
+                        "write-path, error: %s\n",
+                        strerror(errno));
+            }
+
+            break;
+    }
+
+    input_manifest_destroy(manifest);
+    return 1;
+}
+
+static void
+finish_manifest(struct input_manifest *__notnull const manifest,
+                const bool print_paths)
+{
+    const enum input_manifest_result write_result =
+        input_manifest_write(manifest);
+
+    if (write_result != E_INPUT_MANIFEST_OK) {
+        if (print_paths) {
+            fprintf(stderr,
+                    "Failed to write out manifest (at path %s), error: %s\n",
+                    manifest->path,
+                    strerror(errno));
+        } else {
+            fprintf(stderr,
+                    "Failed to write out the manifest of the provided "
+                    "write-path, error: %s\n",
+                    strerror(errno));
+        }
+    }
+
+    input_manifest_destroy(manifest);
+}
+
+/*
+ * A single file's output is simply the write-path, which is never removed.
+ */
+
+static void
+record_single_file(struct input_manifest *__notnull const manifest,
+                   const struct tbd_for_main *__notnull const tbd,
+                   const int fd)
+{
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0) {
+        return;
+    }
+
+    const enum input_manifest_result record_result =
+        input_manifest_record(manifest,
+                              tbd->parse_path,
+                              tbd->parse_path_length,
+                              &sbuf,
+                              tbd->write_path,
+                              tbd->write_path_length);
+
+    if (record_result != E_INPUT_MANIFEST_OK) {
+        fputs("Failed to allocate memory\n", stderr);
+        exit(1);
+    }
+}
+
 int main(const int argc, char *const argv[]) {
     if (argc < 2) {
         print_usage();
@@ -641,6 +1281,28 @@ int main(const int argc, char *const argv[]) {
                         tbd->options.replace_path_extension = true;
                     } else if (strcmp(in_opt, "combine-tbds") == 0) {
                         tbd->options.combine_tbds = true;
+                    } else if (strcmp(in_opt, "write-if-changed") == 0) {
+                        tbd->options.write_if_changed = true;
+                    } else if (strcmp(in_opt, "incremental") == 0) {
+                        tbd->options.incremental = true;
+                    } else if (strcmp(in_opt, "tar") == 0) {
+                        tbd->options.tar_output = true;
+                    } else if (strcmp(in_opt, "gzip") == 0) {
+                        tbd->options.gzip_output = true;
+                    } else if (strcmp(in_opt, "zstd") == 0) {
+                        const enum compressed_file_format format =
+                            COMPRESSED_FILE_FORMAT_ZSTD;
+
+                        if (!compressed_file_format_is_supported(format)) {
+                            fputs("This build of tbd doesn't support zstd "
+                                  "compression\n",
+                                  stderr);
+
+                            destroy_tbds_array(&tbds);
+                            return 1;
+                        }
+
+                        tbd->options.zstd_output = true;
                     } else {
                         fprintf(stderr, "Unrecognized option: %s\n", in_arg);
                         destroy_tbds_array(&tbds);
@@ -648,9 +1310,63 @@ int main(const int argc, char *const argv[]) {
                         return 1;
                     }
 
+                    if (option_affects_output(in_opt)) {
+                        tbd->options_fingerprint =
+                            input_manifest_fingerprint_add(
+                                tbd->options_fingerprint,
+                                in_arg);
+                    }
+
                     continue;
                 }
 
+                if (tbd->options.gzip_output && tbd->options.zstd_output) {
+                    fputs("Options --gzip and --zstd cannot both be provided\n",
+                          stderr);
+
+                    destroy_tbds_array(&tbds);
+                    return 1;
+                }
+
+                if (tbd->options.tar_output) {
+                    if (tbd->options.recurse_directories) {
+                        fputs("Option --tar cannot be provided when recursing "
+                              "directories\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
+
+                    if (tbd->options.combine_tbds ||
+                        tbd->options.write_if_changed)
+                    {
+                        fputs("Option --tar cannot be provided along with "
+                              "--combine-tbds or --write-if-changed\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
+                }
+
+                /*
+                 * The .tbd files of unchanged images are only kept from a
+                 * previous run when each image is written to its own file.
+                 */
+
+                if (tbd->dsc_previous_path != NULL) {
+                    if (tbd->options.combine_tbds || tbd->options.tar_output) {
+                        fputs("Option --dsc-previous-cache cannot be provided "
+                              "along with --combine-tbds or --tar, as every "
+                              "image is needed to write them out\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
+                }
+
                 /*
                  * We only allow printing to stdout for single-files, and
                  * not when recursing directories.
@@ -668,6 +1384,16 @@ int main(const int argc, char *const argv[]) {
                         return 1;
                     }
 
+                    if (tbd->dsc_previous_path != NULL) {
+                        fputs("Option --dsc-previous-cache needs a directory "
+                              "to write out to, and can't be used when "
+                              "writing to stdout\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
+
                     if (has_stdout) {
                         fputs("Printing more than one file to stdout is not "
                               "allowed\n",
@@ -680,21 +1406,44 @@ int main(const int argc, char *const argv[]) {
                     found_path = true;
                     has_stdout = true;
 
-                    continue;
+                    break;
                 }
 
                 /*
                  * Ensure options for recursing directories are not being
                  * provided for other contexts and circumstances.
                  *
-                 * We allow dyld_shared_cache files to slip through as they can
-                 * be exported to a directory due to the fact that they store
-                 * multiple mach-o images.
+                 * We allow dyld_shared_cache files and zip archives to slip
+                 * through as they can be exported to a directory due to the
+                 * fact that they store multiple mach-o images.
                  */
 
                 const struct tbd_for_main_options options = tbd->options;
+                if (options.write_if_changed && options.combine_tbds) {
+                    fputs("Option --write-if-changed cannot be provided when "
+                          "combining all tbds into a single file\n",
+                          stderr);
+
+                    destroy_tbds_array(&tbds);
+                    return 1;
+                }
+
+                if (options.gzip_output || options.zstd_output) {
+                    if (!options.combine_tbds && !options.tar_output) {
+                        fputs("Options --gzip and --zstd can only be provided "
+                              "when combining all tbds into a single file, "
+                              "writing a tar archive, or when writing to "
+                              "stdout\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
+                }
+
                 if (!options.recurse_directories &&
-                    !tbd->filetypes.dyld_shared_cache)
+                    !tbd->filetypes.dyld_shared_cache &&
+                    !tbd->filetypes.zip)
                 {
                     if (options.preserve_directory_subdirs) {
                         fputs("Option --preserve-subdirs can only be provided "
@@ -727,6 +1476,15 @@ int main(const int argc, char *const argv[]) {
                         destroy_tbds_array(&tbds);
                         return 1;
                     }
+
+                    if (options.tar_output) {
+                        fputs("Option --tar can only be provided when parsing "
+                              "dyld_shared_cache files\n",
+                              stderr);
+
+                        destroy_tbds_array(&tbds);
+                        return 1;
+                    }
                 }
 
                 /*
@@ -777,7 +1535,8 @@ int main(const int argc, char *const argv[]) {
                         }
                     } else if (S_ISDIR(info.st_mode)) {
                         if (!options.recurse_directories &&
-                            !tbd->filetypes.dyld_shared_cache)
+                            !tbd->filetypes.dyld_shared_cache &&
+                            !tbd->filetypes.zip)
                         {
                             fputs("Writing to a directory while parsing a "
                                   "single mach-o file is not supported.\n"
@@ -807,6 +1566,20 @@ int main(const int argc, char *const argv[]) {
                             destroy_tbds_array(&tbds);
                             return 1;
                         }
+
+                        if (options.tar_output) {
+                            fputs("We cannot write a tar archive to a "
+                                  "directory.\nPlease provide a path to a file "
+                                  "to write the archive to\n",
+                                  stderr);
+
+                            if (full_path != path) {
+                                free(full_path);
+                            }
+
+                            destroy_tbds_array(&tbds);
+                            return 1;
+                        }
                     }
                 }
 
@@ -870,6 +1643,7 @@ int main(const int argc, char *const argv[]) {
                         inner_opt += 1;
                     }
 
+                    const int option_index = index;
                     const bool ret =
                         tbd_for_main_parse_option(&index,
                                                   &tbd,
@@ -878,6 +1652,22 @@ int main(const int argc, char *const argv[]) {
                                                   inner_opt);
 
                     if (ret) {
+                        if (!option_affects_output(inner_opt)) {
+                            continue;
+                        }
+
+                        /*
+                         * Options can take arguments of their own, which are
+                         * part of the fingerprint as well.
+                         */
+
+                        for (int i = option_index; i <= index; i++) {
+                            tbd.options_fingerprint =
+                                input_manifest_fingerprint_add(
+                                    tbd.options_fingerprint,
+                                    argv[i]);
+                        }
+
                         continue;
                     }
 
@@ -972,7 +1762,7 @@ int main(const int argc, char *const argv[]) {
                 const char *const path = argv[2];
 
                 char *const full_path = path_get_absolute_path(path, 0, NULL);
-                const int fd = our_open(full_path, O_RDONLY, 0);
+                const int fd = open_parse_path(path);
 
                 if (fd < 0) {
                     fprintf(stderr,
@@ -1012,7 +1802,7 @@ int main(const int argc, char *const argv[]) {
             const char *const path = argv[2];
 
             char *const full_path = path_get_absolute_path(path, 0, NULL);
-            const int fd = our_open(full_path, O_RDONLY, 0);
+            const int fd = open_parse_path(path);
 
             if (fd < 0) {
                 fprintf(stderr,
@@ -1148,6 +1938,18 @@ int main(const int argc, char *const argv[]) {
         struct tbd_for_main copy = *tbd;
         const struct tbd_for_main_options options = tbd->options;
 
+        struct input_manifest manifest = {};
+        struct input_manifest *manifest_ptr = NULL;
+
+        if (options.incremental) {
+            if (load_manifest(tbd, &manifest, should_print_paths)) {
+                destroy_tbds_array(&tbds);
+                return 1;
+            }
+
+            manifest_ptr = &manifest;
+        }
+
         if (options.recurse_directories) {
             /*
              * We have to check write_path here, as its possible the
@@ -1168,18 +1970,101 @@ int main(const int argc, char *const argv[]) {
                 .tbd = &copy,
                 .orig = tbd,
                 .retained = &retained,
-                .export_trie_sb = &export_trie_sb
+                .export_trie_sb = &export_trie_sb,
+                .manifest = manifest_ptr
             };
 
+            /*
+             * With more than one job, files are parsed on worker threads, and
+             * committed back on this thread in the order they were found.
+             *
+             * If we fail to create the jobs, we simply parse every file on
+             * this thread.
+             */
+
+            struct recurse_jobs jobs = {};
+            if (tbd->jobs_count > 1) {
+                const bool tbd_parses_export_trie =
+                    !tbd->parse_options.ignore_exports &&
+                    !tbd->macho_options.use_symbol_table;
+
+                const enum recurse_jobs_result create_jobs_result =
+                    recurse_jobs_create(&jobs,
+                                        &copy,
+                                        tbd,
+                                        tbd->jobs_count,
+                                        tbd_parses_export_trie,
+                                        commit_recurse_job,
+                                        &recurse_info);
+
+                if (create_jobs_result == E_RECURSE_JOBS_OK) {
+                    recurse_info.jobs = &jobs;
+                }
+            }
+
+            /*
+             * Separate .tbd files are also written out on a writer-thread, so
+             * that writing out one file overlaps with parsing the next.
+             *
+             * If we fail to create the writer, we simply write out every file
+             * on this thread.
+             */
+
+            struct tbd_writer writer = {};
+            if (tbd->jobs_count > 1 && !tbd->options.combine_tbds) {
+                const enum tbd_writer_result create_writer_result =
+                    tbd_writer_create(&writer);
+
+                if (create_writer_result == E_TBD_WRITER_OK) {
+                    recurse_info.writer = &writer;
+                }
+            }
+
+            /*
+             * With a memory-limit, shared-caches are extracted on a batch,
+             * which is likewise skipped if we fail to create it.
+             */
+
+            struct parse_dsc_for_main_batch dsc_batch = {};
+            if (recurse_info.writer != NULL &&
+                tbd->filetypes.dyld_shared_cache &&
+                tbd->dsc_mapped_size_limit != 0)
+            {
+                const enum parse_dsc_for_main_batch_result create_batch_result =
+                    parse_dsc_for_main_batch_create(&dsc_batch,
+                                                    &copy,
+                                                    tbd,
+                                                    tbd->jobs_count,
+                                                    tbd->dsc_mapped_size_limit);
+
+                if (create_batch_result == E_PARSE_DSC_FOR_MAIN_BATCH_OK) {
+                    recurse_info.dsc_batch = &dsc_batch;
+                }
+            }
+
             enum dir_recurse_result recurse_dir_result = E_DIR_RECURSE_OK;
             if (options.recurse_subdirectories) {
-                recurse_dir_result =
-                    dir_recurse_with_subdirs(tbd->parse_path,
-                                             tbd->parse_path_length,
-                                             O_RDONLY,
-                                             &recurse_info,
-                                             recurse_directory_callback,
-                                             recurse_directory_fail_callback);
+                if (tbd->jobs_count > 1) {
+                    recurse_dir_result =
+                        dir_recurse_with_subdirs_parallel(
+                            tbd->parse_path,
+                            tbd->parse_path_length,
+                            O_RDONLY,
+                            tbd->jobs_count,
+                            &recurse_info,
+                            recurse_directory_filter,
+                            recurse_directory_callback,
+                            recurse_directory_fail_callback);
+                } else {
+                    recurse_dir_result =
+                        dir_recurse_with_subdirs(
+                            tbd->parse_path,
+                            tbd->parse_path_length,
+                            O_RDONLY,
+                            &recurse_info,
+                            recurse_directory_callback,
+                            recurse_directory_fail_callback);
+                }
             } else {
                 recurse_dir_result =
                     dir_recurse(tbd->parse_path,
@@ -1190,6 +2075,31 @@ int main(const int argc, char *const argv[]) {
                                 recurse_directory_fail_callback);
             }
 
+            if (recurse_info.jobs != NULL) {
+                recurse_jobs_finish_and_destroy(&jobs);
+            }
+
+            if (recurse_info.dsc_batch != NULL) {
+                parse_dsc_for_main_batch_finish_and_destroy(&dsc_batch);
+            }
+
+            if (recurse_info.writer != NULL) {
+                tbd_writer_finish_and_destroy(&writer);
+            }
+
+            /*
+             * The outputs of inputs that no longer exist are only removed once
+             * every file has been found.
+             */
+
+            if (manifest_ptr != NULL) {
+                input_manifest_remove_vanished(&manifest,
+                                               tbd->parse_path,
+                                               tbd->parse_path_length);
+
+                finish_manifest(&manifest, should_print_paths);
+            }
+
             if (recurse_dir_result != E_DIR_RECURSE_OK) {
                 if (should_print_paths) {
                     fprintf(stderr,
@@ -1205,7 +2115,9 @@ int main(const int argc, char *const argv[]) {
                 }
             }
 
-            if (recurse_info.files_parsed == 0) {
+            if (recurse_info.files_parsed == 0 &&
+                recurse_info.files_unchanged == 0)
+            {
                 if (should_print_paths) {
                     fprintf(stderr,
                             "No new .tbd files were created while parsing "
@@ -1219,7 +2131,11 @@ int main(const int argc, char *const argv[]) {
             }
 
             if (tbd->options.combine_tbds) {
-                if (tbd_write_footer(recurse_info.combine_file)) {
+                FILE *const combine_file = recurse_info.combine_file;
+                const enum tbd_create_result write_footer_result =
+                    tbd_for_main_write_footer(combine_file);
+
+                if (write_footer_result != E_TBD_CREATE_OK) {
                     if (should_print_paths) {
                         fprintf(stderr,
                                 "Failed to write footer for combined .tbd file "
@@ -1253,9 +2169,37 @@ int main(const int argc, char *const argv[]) {
             memset(tbd, 0, sizeof(*tbd));
         } else {
             char *const parse_path = tbd->parse_path;
-            const int fd = our_open(parse_path, O_RDONLY, 0);
 
+            /*
+             * Input from stdin has no identity to be recorded with.
+             */
+
+            if (manifest_ptr != NULL && strcmp(parse_path, "stdin") == 0) {
+                input_manifest_destroy(&manifest);
+                manifest_ptr = NULL;
+            }
+
+            if (manifest_ptr != NULL) {
+                struct stat sbuf = {};
+                const bool unchanged =
+                    stat(parse_path, &sbuf) == 0 &&
+                    input_manifest_input_unchanged(&manifest,
+                                                   parse_path,
+                                                   tbd->parse_path_length,
+                                                   &sbuf);
+
+                if (unchanged) {
+                    finish_manifest(&manifest, should_print_paths);
+                    continue;
+                }
+            }
+
+            const int fd = open_parse_path(parse_path);
             if (fd < 0) {
+                if (manifest_ptr != NULL) {
+                    input_manifest_destroy(&manifest);
+                }
+
                 if (should_print_paths) {
                     fprintf(stderr,
                             "Failed to open file (at path %s), error: %s\n",
@@ -1276,6 +2220,10 @@ int main(const int argc, char *const argv[]) {
              */
 
             struct magic_buffer magic_buffer = {};
+
+            bool handled = false;
+            bool parsed = false;
+
             if (tbd->filetypes.macho) {
                 struct parse_macho_for_main_args args = {
                     .fd = fd,
@@ -1300,7 +2248,7 @@ int main(const int argc, char *const argv[]) {
                  * filetypes are enabled.
                  */
 
-                if (tbd->filetypes.dyld_shared_cache) {
+                if (tbd->filetypes.dyld_shared_cache || tbd->filetypes.zip) {
                     args.dont_handle_non_macho_error = true;
                 }
 
@@ -1308,11 +2256,12 @@ int main(const int argc, char *const argv[]) {
                     parse_macho_file_for_main(args);
 
                 if (parse_result != E_PARSE_MACHO_FOR_MAIN_NOT_A_MACHO) {
-                    continue;
+                    handled = true;
+                    parsed = (parse_result == E_PARSE_MACHO_FOR_MAIN_OK);
                 }
             }
 
-            if (tbd->filetypes.dyld_shared_cache) {
+            if (!handled && tbd->filetypes.dyld_shared_cache) {
                 struct parse_dsc_for_main_args args = {
                     .fd = fd,
                     .magic_buffer = &magic_buffer,
@@ -1324,7 +2273,7 @@ int main(const int argc, char *const argv[]) {
                     .dsc_dir_path = parse_path,
                     .dsc_dir_path_length = tbd->parse_path_length,
 
-                    .dont_handle_non_dsc_error = false,
+                    .dont_handle_non_dsc_error = tbd->filetypes.zip,
                     .print_paths = should_print_paths,
 
                     .export_trie_sb = &export_trie_sb,
@@ -1335,10 +2284,50 @@ int main(const int argc, char *const argv[]) {
                     parse_dsc_for_main(args);
 
                 if (parse_result != E_PARSE_DSC_FOR_MAIN_NOT_A_SHARED_CACHE) {
-                    continue;
+                    handled = true;
+                    parsed = (parse_result == E_PARSE_DSC_FOR_MAIN_OK);
+                }
+            }
+
+            if (!handled && tbd->filetypes.zip) {
+                struct parse_zip_for_main_args args = {
+                    .fd = fd,
+                    .retained = &retained,
+
+                    .tbd = &copy,
+                    .orig = tbd,
+
+                    .dir_path = parse_path,
+                    .dir_path_length = tbd->parse_path_length,
+
+                    .dont_handle_non_zip_error = false,
+                    .print_paths = should_print_paths,
+
+                    .export_trie_sb = &export_trie_sb,
+                    .options.verify_write_path = true
+                };
+
+                const enum parse_zip_for_main_result parse_result =
+                    parse_zip_for_main(args);
+
+                if (parse_result != E_PARSE_ZIP_FOR_MAIN_NOT_A_ZIP) {
+                    handled = true;
+                    parsed = (parse_result == E_PARSE_ZIP_FOR_MAIN_OK);
                 }
             }
 
+            if (manifest_ptr != NULL) {
+                if (parsed) {
+                    record_single_file(&manifest, tbd, fd);
+                }
+
+                finish_manifest(&manifest, should_print_paths);
+            }
+
+            if (handled) {
+                continue;
+            }
+
             if (!tbd->filetypes.user_provided) {
                 if (should_print_paths) {
                     fputs("File (at path %s) is not among any of the provided "
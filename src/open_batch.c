@@ -0,0 +1,681 @@
+//
+//  src/open_batch.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(SYS_io_uring_setup) && defined(SYS_io_uring_register) && \
+    defined(IO_URING_OP_SUPPORTED)
+#define HAS_IO_URING 1
+#endif
+
+#endif
+#endif
+
+#include "open_batch.h"
+#include "our_io.h"
+#include "unused.h"
+
+#if defined(HAS_IO_URING)
+
+static inline int
+io_uring_enter(const int ring_fd,
+               const uint32_t to_submit,
+               const uint32_t min_complete,
+               const uint32_t flags)
+{
+    return (int)syscall(SYS_io_uring_enter,
+                        ring_fd,
+                        to_submit,
+                        min_complete,
+                        flags,
+                        NULL,
+                        0);
+}
+
+/*
+ * Return whether the kernel supports every operation a batch is run with,
+ * which IORING_REGISTER_PROBE itself is too old to report on older kernels.
+ */
+
+static bool ring_supports_ops(const int ring_fd) {
+    static const uint8_t required_ops[] = {
+        IORING_OP_OPENAT,
+        IORING_OP_READ,
+        IORING_OP_ASYNC_CANCEL
+    };
+
+    const uint32_t ops_count = 256;
+    struct io_uring_probe *const probe =
+        calloc(1,
+               sizeof(struct io_uring_probe) +
+               (ops_count * sizeof(struct io_uring_probe_op)));
+
+    if (probe == NULL) {
+        return false;
+    }
+
+    const int ret =
+        (int)syscall(SYS_io_uring_register,
+                     ring_fd,
+                     IORING_REGISTER_PROBE,
+                     probe,
+                     ops_count);
+
+    bool supported = (ret == 0);
+    for (uint32_t i = 0; supported && i != sizeof(required_ops); i++) {
+        const uint8_t op = required_ops[i];
+        if (op >= probe->ops_len ||
+            !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+        {
+            supported = false;
+        }
+    }
+
+    free(probe);
+    return supported;
+}
+
+bool open_batch_create(struct open_batch *__notnull const batch) {
+    /*
+     * Every file in a batch has at most one operation in flight at a time, so
+     * the ring never needs to be larger than a batch.
+     */
+
+    struct io_uring_params params = {};
+    const int ring_fd =
+        (int)syscall(SYS_io_uring_setup, OPEN_BATCH_MAX_COUNT, &params);
+
+    if (ring_fd < 0) {
+        return false;
+    }
+
+    if (!ring_supports_ops(ring_fd)) {
+        close(ring_fd);
+        return false;
+    }
+
+    uint64_t sq_ring_size =
+        params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+
+    uint64_t cq_ring_size =
+        params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP);
+    if (single_mmap) {
+        if (cq_ring_size > sq_ring_size) {
+            sq_ring_size = cq_ring_size;
+        }
+
+        cq_ring_size = sq_ring_size;
+    }
+
+    void *const sq_ring =
+        mmap(NULL,
+             sq_ring_size,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ring_fd,
+             IORING_OFF_SQ_RING);
+
+    if (sq_ring == MAP_FAILED) {
+        close(ring_fd);
+        return false;
+    }
+
+    void *cq_ring = sq_ring;
+    if (!single_mmap) {
+        cq_ring =
+            mmap(NULL,
+                 cq_ring_size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE,
+                 ring_fd,
+                 IORING_OFF_CQ_RING);
+
+        if (cq_ring == MAP_FAILED) {
+            munmap(sq_ring, sq_ring_size);
+            close(ring_fd);
+
+            return false;
+        }
+    }
+
+    const uint64_t sqes_size =
+        params.sq_entries * sizeof(struct io_uring_sqe);
+
+    void *const sqes =
+        mmap(NULL,
+             sqes_size,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ring_fd,
+             IORING_OFF_SQES);
+
+    if (sqes == MAP_FAILED) {
+        if (!single_mmap) {
+            munmap(cq_ring, cq_ring_size);
+        }
+
+        munmap(sq_ring, sq_ring_size);
+        close(ring_fd);
+
+        return false;
+    }
+
+    uint8_t *const heads = malloc(OPEN_BATCH_MAX_COUNT * OPEN_BATCH_HEAD_SIZE);
+    if (heads == NULL) {
+        munmap(sqes, sqes_size);
+        if (!single_mmap) {
+            munmap(cq_ring, cq_ring_size);
+        }
+
+        munmap(sq_ring, sq_ring_size);
+        close(ring_fd);
+
+        return false;
+    }
+
+    uint8_t *const sq_ptr = (uint8_t *)sq_ring;
+    uint8_t *const cq_ptr = (uint8_t *)cq_ring;
+
+    batch->ring_fd = ring_fd;
+
+    batch->sq_ring = sq_ring;
+    batch->sq_ring_size = sq_ring_size;
+
+    batch->cq_ring = (single_mmap) ? NULL : cq_ring;
+    batch->cq_ring_size = (single_mmap) ? 0 : cq_ring_size;
+
+    batch->sqes = sqes;
+    batch->sqes_size = sqes_size;
+
+    batch->sq_head = (uint32_t *)(sq_ptr + params.sq_off.head);
+    batch->sq_tail = (uint32_t *)(sq_ptr + params.sq_off.tail);
+    batch->sq_array = (uint32_t *)(sq_ptr + params.sq_off.array);
+    batch->sq_mask = *(const uint32_t *)(sq_ptr + params.sq_off.ring_mask);
+
+    batch->cq_head = (uint32_t *)(cq_ptr + params.cq_off.head);
+    batch->cq_tail = (uint32_t *)(cq_ptr + params.cq_off.tail);
+    batch->cqes = cq_ptr + params.cq_off.cqes;
+    batch->cq_mask = *(const uint32_t *)(cq_ptr + params.cq_off.ring_mask);
+
+    batch->heads = heads;
+
+    batch->failed = false;
+    batch->undrained = false;
+
+    return true;
+}
+
+/*
+ * The entries of a batch queued on the ring, in the order they were queued,
+ * and which of them are still in flight, so that those can be cancelled if
+ * the ring fails before they complete.
+ */
+
+struct ring_entries {
+    uint32_t queued[OPEN_BATCH_MAX_COUNT];
+    uint32_t queued_count;
+
+    bool in_flight[OPEN_BATCH_MAX_COUNT];
+    uint32_t in_flight_count;
+};
+
+/*
+ * A cancellation is given the index of the entry it cancels with the top bit
+ * set, to tell its completion apart from the completions of entries.
+ */
+
+static const uint64_t CANCEL_USER_DATA = 1ull << 63;
+
+static void
+queue_sqe(struct open_batch *__notnull const batch,
+          const struct io_uring_sqe *__notnull const sqe)
+{
+    const uint32_t tail = *batch->sq_tail;
+    const uint32_t index = tail & batch->sq_mask;
+
+    ((struct io_uring_sqe *)batch->sqes)[index] = *sqe;
+    batch->sq_array[index] = index;
+
+    __atomic_store_n(batch->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void
+queue_entry(struct open_batch *__notnull const batch,
+            struct ring_entries *__notnull const entries,
+            const struct io_uring_sqe *__notnull const sqe)
+{
+    queue_sqe(batch, sqe);
+
+    entries->queued[entries->queued_count] = (uint32_t)sqe->user_data;
+    entries->queued_count += 1;
+}
+
+/*
+ * Returns the number of entries the kernel took, which is less than count if
+ * submitting failed partway through.
+ */
+
+static uint32_t
+submit(struct open_batch *__notnull const batch, const uint32_t count) {
+    uint32_t left = count;
+    while (left != 0) {
+        const int ret = io_uring_enter(batch->ring_fd, left, 0, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        left -= (uint32_t)ret;
+    }
+
+    if (left != 0) {
+        /*
+         * Take the entries the kernel didn't take back off the ring, so that
+         * they aren't submitted along with whatever is queued next.
+         */
+
+        const uint32_t head = __atomic_load_n(batch->sq_head, __ATOMIC_ACQUIRE);
+        __atomic_store_n(batch->sq_tail, head, __ATOMIC_RELEASE);
+    }
+
+    return count - left;
+}
+
+/*
+ * Submit every queued entry, marking the entries the kernel took as in flight.
+ * Returns false if submitting failed partway through.
+ */
+
+static bool
+submit_entries(struct open_batch *__notnull const batch,
+               struct ring_entries *__notnull const entries)
+{
+    const uint32_t submitted = submit(batch, entries->queued_count);
+    for (uint32_t i = 0; i != submitted; i++) {
+        entries->in_flight[entries->queued[i]] = true;
+    }
+
+    entries->in_flight_count = submitted;
+    return (submitted == entries->queued_count);
+}
+
+static bool
+peek_cqe(struct open_batch *__notnull const batch,
+         struct io_uring_cqe *__notnull const cqe_out)
+{
+    const struct io_uring_cqe *const cqes =
+        (const struct io_uring_cqe *)batch->cqes;
+
+    const uint32_t head = *batch->cq_head;
+    const uint32_t tail = __atomic_load_n(batch->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == tail) {
+        return false;
+    }
+
+    *cqe_out = cqes[head & batch->cq_mask];
+    __atomic_store_n(batch->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static bool
+wait_cqe(struct open_batch *__notnull const batch,
+         struct io_uring_cqe *__notnull const cqe_out)
+{
+    do {
+        if (peek_cqe(batch, cqe_out)) {
+            return true;
+        }
+
+        const int ret =
+            io_uring_enter(batch->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+        if (ret < 0 && errno != EINTR) {
+            return false;
+        }
+    } while (true);
+}
+
+typedef void
+(*record_cqe_callback)(const struct io_uring_cqe *__notnull cqe, void *info);
+
+static void
+complete_entry(struct ring_entries *__notnull const entries,
+               const struct io_uring_cqe *__notnull const cqe)
+{
+    entries->in_flight[cqe->user_data] = false;
+    entries->in_flight_count -= 1;
+}
+
+/*
+ * Reap the completion of every entry in flight, calling record for each.
+ */
+
+static bool
+reap_entries(struct open_batch *__notnull const batch,
+             struct ring_entries *__notnull const entries,
+             __notnull const record_cqe_callback record,
+             void *const record_info)
+{
+    struct io_uring_cqe cqe = {};
+    while (entries->in_flight_count != 0) {
+        if (!wait_cqe(batch, &cqe)) {
+            return false;
+        }
+
+        complete_entry(entries, &cqe);
+        record(&cqe, record_info);
+    }
+
+    return true;
+}
+
+/*
+ * Cancel every entry still in flight, and wait until each has completed,
+ * cancelled or not, calling discard for each, so that nothing is left in
+ * flight, to write to a file's head or open a file, once the ring is given up
+ * on. The entries are left pending, to be handled as if the ring never took
+ * them.
+ *
+ * If even this fails, the batch is marked as undrained.
+ */
+
+static void
+cancel_entries(struct open_batch *__notnull const batch,
+               struct ring_entries *__notnull const entries,
+               const record_cqe_callback discard)
+{
+    uint32_t cancel_count = 0;
+    for (uint32_t i = 0; i != OPEN_BATCH_MAX_COUNT; i++) {
+        if (!entries->in_flight[i]) {
+            continue;
+        }
+
+        const struct io_uring_sqe sqe = {
+            .opcode = IORING_OP_ASYNC_CANCEL,
+            .addr = i,
+            .user_data = CANCEL_USER_DATA | i
+        };
+
+        queue_sqe(batch, &sqe);
+        cancel_count += 1;
+    }
+
+    /*
+     * Entries whose cancellation couldn't be submitted still complete on
+     * their own, and so are waited on all the same.
+     */
+
+    uint32_t cancels_left = submit(batch, cancel_count);
+    struct io_uring_cqe cqe = {};
+
+    while (entries->in_flight_count != 0 || cancels_left != 0) {
+        if (!wait_cqe(batch, &cqe)) {
+            batch->undrained = true;
+            return;
+        }
+
+        if (cqe.user_data & CANCEL_USER_DATA) {
+            cancels_left -= 1;
+            continue;
+        }
+
+        complete_entry(entries, &cqe);
+        if (discard != NULL) {
+            discard(&cqe, NULL);
+        }
+    }
+}
+
+static void
+record_open_cqe(const struct io_uring_cqe *__notnull const cqe,
+                void *const info)
+{
+    struct open_batch_result *const results = (struct open_batch_result *)info;
+    struct open_batch_result *const result = results + cqe->user_data;
+
+    if (cqe->res < 0) {
+        result->fd = -1;
+        result->error = -cqe->res;
+    } else {
+        result->fd = cqe->res;
+        result->error = 0;
+    }
+}
+
+static void
+discard_open_cqe(const struct io_uring_cqe *__notnull const cqe,
+                 __unused void *const info)
+{
+    if (cqe->res >= 0) {
+        close(cqe->res);
+    }
+}
+
+static void
+record_read_cqe(const struct io_uring_cqe *__notnull const cqe,
+                void *const info)
+{
+    int64_t *const head_sizes = (int64_t *)info;
+    head_sizes[cqe->user_data] = (cqe->res < 0) ? -1 : cqe->res;
+}
+
+/*
+ * Even if submitting fails partway through, the entries the kernel did take
+ * are still reaped, and those reaped before a failure are kept. Only entries
+ * still in flight when the ring fails are cancelled and left pending.
+ */
+
+static bool
+open_with_ring(struct open_batch *__notnull const batch,
+               const int dir_fd,
+               const char *__notnull const *__notnull const names,
+               const uint32_t count,
+               const int flags,
+               struct open_batch_result *__notnull const results)
+{
+    struct ring_entries entries = {};
+    for (uint32_t i = 0; i != count; i++) {
+        const struct io_uring_sqe sqe = {
+            .opcode = IORING_OP_OPENAT,
+            .fd = dir_fd,
+            .addr = (uint64_t)(uintptr_t)names[i],
+            .open_flags = (uint32_t)flags,
+            .user_data = i
+        };
+
+        queue_entry(batch, &entries, &sqe);
+    }
+
+    const bool submitted = submit_entries(batch, &entries);
+    if (!reap_entries(batch, &entries, record_open_cqe, results)) {
+        cancel_entries(batch, &entries, discard_open_cqe);
+        return false;
+    }
+
+    return submitted;
+}
+
+static bool
+read_with_ring(struct open_batch *__notnull const batch,
+               const uint32_t count,
+               const struct open_batch_result *__notnull const results,
+               int64_t *__notnull const head_sizes)
+{
+    struct ring_entries entries = {};
+    for (uint32_t i = 0; i != count; i++) {
+        const int fd = results[i].fd;
+        if (fd < 0) {
+            continue;
+        }
+
+        const struct io_uring_sqe sqe = {
+            .opcode = IORING_OP_READ,
+            .fd = fd,
+            .addr = (uint64_t)(uintptr_t)(batch->heads +
+                                          (i * OPEN_BATCH_HEAD_SIZE)),
+            .len = OPEN_BATCH_HEAD_SIZE,
+            .off = 0,
+            .user_data = i
+        };
+
+        queue_entry(batch, &entries, &sqe);
+    }
+
+    const bool submitted = submit_entries(batch, &entries);
+    if (!reap_entries(batch, &entries, record_read_cqe, head_sizes)) {
+        cancel_entries(batch, &entries, NULL);
+        return false;
+    }
+
+    return submitted;
+}
+
+void open_batch_destroy(struct open_batch *__notnull const batch) {
+    munmap(batch->sqes, batch->sqes_size);
+    if (batch->cq_ring != NULL) {
+        munmap(batch->cq_ring, batch->cq_ring_size);
+    }
+
+    munmap(batch->sq_ring, batch->sq_ring_size);
+    close(batch->ring_fd);
+
+    /*
+     * Reads left in flight may still write to the heads after the ring is
+     * closed, so the heads are leaked instead.
+     */
+
+    if (!batch->undrained) {
+        free(batch->heads);
+    }
+
+    memset(batch, 0, sizeof(*batch));
+}
+
+#else
+
+bool open_batch_create(struct open_batch *__notnull const batch) {
+    (void)batch;
+    return false;
+}
+
+void open_batch_destroy(struct open_batch *__notnull const batch) {
+    (void)batch;
+}
+
+#endif
+
+/*
+ * The results and head-sizes of files not yet handled by the ring are marked
+ * as pending, so that they can instead be handled here if the ring fails.
+ * Files the ring did finish with are kept, and aren't opened again.
+ */
+
+/*
+ * Files are opened with the same flags whether through the ring or not.
+ */
+
+static int get_open_flags(const int open_flags) {
+#ifdef O_CLOEXEC
+    return open_flags | O_CLOEXEC;
+#else
+    return open_flags;
+#endif
+}
+
+static const int PENDING_ERROR = -1;
+static const int64_t PENDING_HEAD_SIZE = -2;
+
+void
+open_batch_run(struct open_batch *__notnull const batch,
+               const int dir_fd,
+               const char *__notnull const *__notnull const names,
+               const uint32_t count,
+               const int open_flags,
+               const open_batch_filter filter,
+               void *const filter_info,
+               struct open_batch_result *__notnull const results)
+{
+    const int flags = get_open_flags(open_flags);
+
+    int64_t head_sizes[OPEN_BATCH_MAX_COUNT];
+    for (uint32_t i = 0; i != count; i++) {
+        results[i].fd = -1;
+        results[i].error = PENDING_ERROR;
+
+        head_sizes[i] = PENDING_HEAD_SIZE;
+    }
+
+#if defined(HAS_IO_URING)
+    if (!batch->failed) {
+        if (!open_with_ring(batch, dir_fd, names, count, flags, results)) {
+            batch->failed = true;
+        } else if (!read_with_ring(batch, count, results, head_sizes)) {
+            batch->failed = true;
+        }
+    }
+#endif
+
+    uint8_t head_buffer[OPEN_BATCH_HEAD_SIZE];
+    for (uint32_t i = 0; i != count; i++) {
+        struct open_batch_result *const result = results + i;
+        if (result->error == PENDING_ERROR) {
+            result->fd = our_openat(dir_fd, names[i], flags);
+            result->error = (result->fd < 0) ? errno : 0;
+        }
+
+        const int fd = result->fd;
+        if (fd < 0) {
+            continue;
+        }
+
+        /*
+         * A head not read by the ring is read into a buffer of its own, as a
+         * read the ring failed to drain may still write to the batch's heads.
+         */
+
+        uint8_t *head = batch->heads + (i * OPEN_BATCH_HEAD_SIZE);
+        if (head_sizes[i] == PENDING_HEAD_SIZE) {
+            head = head_buffer;
+            head_sizes[i] = our_pread(fd, head, OPEN_BATCH_HEAD_SIZE, 0);
+        }
+
+        /*
+         * Keep files whose head couldn't be read, so the error is reported
+         * when the file is parsed.
+         */
+
+        if (filter == NULL || head_sizes[i] < 0) {
+            continue;
+        }
+
+        if (!filter(head, (uint64_t)head_sizes[i], filter_info)) {
+            close(fd);
+
+            result->fd = -1;
+            result->error = 0;
+        }
+    }
+}
@@ -8,9 +8,17 @@
 
 #include <sys/stat.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 #include "our_io.h"
@@ -47,6 +55,27 @@ int our_openat(const int dirfd, const char *const path, const int flags) {
     return -1;
 }
 
+int
+our_openat_with_mode(const int dirfd,
+                     const char *const path,
+                     const int flags,
+                     const int mode)
+{
+    do {
+#ifdef O_CLOEXEC
+        const int fd = openat(dirfd, path, flags | O_CLOEXEC, mode);
+#else
+        const int fd = openat(dirfd, path, flags, mode);
+#endif
+
+        if (fd != -1) {
+            return fd;
+        }
+    } while (errno == EINTR);
+
+    return -1;
+}
+
 int our_mkdir(const char *const path, const mode_t mode) {
     do {
         const int ret = mkdir(path, mode);
@@ -58,6 +87,17 @@ int our_mkdir(const char *const path, const mode_t mode) {
     return -1;
 }
 
+int our_mkdirat(const int dirfd, const char *const path, const mode_t mode) {
+    do {
+        const int ret = mkdirat(dirfd, path, mode);
+        if (ret == 0) {
+            return ret;
+        }
+    } while (errno == EINTR);
+
+    return -1;
+}
+
 int our_unlink(const char *const path) {
     do {
         const int ret = unlink(path);
@@ -102,6 +142,259 @@ ssize_t our_read(const int fd, void *const buf, const size_t size) {
     return -1;
 }
 
+int our_write_all(const int fd, const void *const buf, size_t size) {
+    const char *data = (const char *)buf;
+    while (size != 0) {
+        const ssize_t num = write(fd, data, size);
+        if (num < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return -1;
+        }
+
+        data += num;
+        size -= (size_t)num;
+    }
+
+    return 0;
+}
+
+ssize_t
+our_pread(const int fd, void *const buf, const size_t size, const off_t offset)
+{
+    do {
+        const ssize_t num = pread(fd, buf, size, offset);
+        if (num != -1) {
+            return num;
+        }
+    } while (errno == EINTR);
+
+    return -1;
+}
+
+void our_advise_willneed(const int fd, const off_t offset, const size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+#if defined(__APPLE__)
+    struct radvisory advisory = {
+        .ra_offset = offset,
+        .ra_count = (size > INT_MAX) ? INT_MAX : (int)size
+    };
+
+    fcntl(fd, F_RDADVISE, &advisory);
+#elif defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd, offset, (off_t)size, POSIX_FADV_WILLNEED);
+#else
+    (void)fd;
+    (void)offset;
+#endif
+}
+
+/*
+ * Create a file that only lives in memory, returning -1 with errno set to
+ * ENOSYS if that isn't available.
+ */
+
+static int open_memory_file(const char *const name) {
+#if defined(__linux__) && defined(SYS_memfd_create)
+    /*
+     * 1 is MFD_CLOEXEC, which may not be declared by older headers.
+     */
+
+    do {
+        const int fd = (int)syscall(SYS_memfd_create, name, 1);
+        if (fd != -1) {
+            return fd;
+        }
+    } while (errno == EINTR);
+
+    return -1;
+#else
+    (void)name;
+
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*
+ * Create an already unlinked temporary file in $TMPDIR, or /tmp.
+ */
+
+static int open_temporary_file(void) {
+    const char *dir = getenv("TMPDIR");
+    if (dir == NULL || dir[0] == '\0') {
+        dir = "/tmp";
+    }
+
+    char path[PATH_MAX];
+    const int length = snprintf(path, sizeof(path), "%s/tbd-XXXXXX", dir);
+
+    if (length < 0 || (size_t)length >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    const int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+
+    our_unlink(path);
+
+#ifdef FD_CLOEXEC
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+    return fd;
+}
+
+int our_open_anonymous_file(const char *const name) {
+    const int fd = open_memory_file(name);
+    if (fd >= 0 || errno != ENOSYS) {
+        return fd;
+    }
+
+    /*
+     * Fall back to a temporary file on kernels without memfd_create().
+     */
+
+    return open_temporary_file();
+}
+
+/*
+ * Input is spooled into memory until it grows past SPOOL_MEMORY_LIMIT, and is
+ * then moved to a temporary file on disk, as a dyld_shared_cache can easily be
+ * several gigabytes.
+ */
+
+static const size_t SPOOL_CHUNK_SIZE = 1024 * 1024;
+static const uint64_t SPOOL_MEMORY_LIMIT = 64 * 1024 * 1024;
+
+/*
+ * Copy the first size bytes of memory_fd into a new temporary file, using
+ * chunk as a buffer, and return the temporary file's fd.
+ */
+
+static int
+move_to_temporary_file(const int memory_fd,
+                       const uint64_t size,
+                       char *const chunk)
+{
+    const int fd = open_temporary_file();
+    if (fd < 0) {
+        return -1;
+    }
+
+    for (uint64_t offset = 0; offset != size;) {
+        size_t read_size = SPOOL_CHUNK_SIZE;
+        if (read_size > size - offset) {
+            read_size = (size_t)(size - offset);
+        }
+
+        const ssize_t num = our_pread(memory_fd, chunk, read_size, offset);
+        if (num <= 0 || our_write_all(fd, chunk, (size_t)num) != 0) {
+            const int error = (num == 0) ? EIO : errno;
+
+            close(fd);
+            errno = error;
+
+            return -1;
+        }
+
+        offset += (uint64_t)num;
+    }
+
+    return fd;
+}
+
+int our_spool_to_seekable_file(const int fd, const char *const name) {
+    struct stat info = {};
+    if (fstat(fd, &info) != 0) {
+        return -1;
+    }
+
+    if (S_ISREG(info.st_mode)) {
+        return fd;
+    }
+
+    bool in_memory = true;
+    int spool_fd = open_memory_file(name);
+
+    if (spool_fd < 0) {
+        if (errno != ENOSYS) {
+            return -1;
+        }
+
+        spool_fd = open_temporary_file();
+        if (spool_fd < 0) {
+            return -1;
+        }
+
+        in_memory = false;
+    }
+
+    char *const chunk = malloc(SPOOL_CHUNK_SIZE);
+    if (chunk == NULL) {
+        close(spool_fd);
+        return -1;
+    }
+
+    uint64_t spooled_size = 0;
+    do {
+        const ssize_t num = our_read(fd, chunk, SPOOL_CHUNK_SIZE);
+        if (num == 0) {
+            break;
+        }
+
+        if (num < 0 || our_write_all(spool_fd, chunk, (size_t)num) != 0) {
+            const int error = errno;
+
+            free(chunk);
+            close(spool_fd);
+
+            errno = error;
+            return -1;
+        }
+
+        spooled_size += (uint64_t)num;
+        if (in_memory && spooled_size > SPOOL_MEMORY_LIMIT) {
+            const int file_fd =
+                move_to_temporary_file(spool_fd, spooled_size, chunk);
+
+            const int error = errno;
+            close(spool_fd);
+
+            if (file_fd < 0) {
+                free(chunk);
+
+                errno = error;
+                return -1;
+            }
+
+            spool_fd = file_fd;
+            in_memory = false;
+        }
+    } while (true);
+
+    free(chunk);
+
+    if (our_lseek(spool_fd, 0, SEEK_SET) < 0) {
+        const int error = errno;
+
+        close(spool_fd);
+        errno = error;
+
+        return -1;
+    }
+
+    return spool_fd;
+}
+
 DIR *our_fdopendir(const int fd) {
     do {
         DIR *const dir = fdopendir(fd);
@@ -124,6 +417,21 @@ struct dirent *our_readdir(DIR *const dir) {
     return NULL;
 }
 
+#if defined(__linux__)
+
+ssize_t our_getdents64(const int fd, void *const buf, const size_t size) {
+    do {
+        const ssize_t num = syscall(SYS_getdents64, fd, buf, size);
+        if (num != -1) {
+            return num;
+        }
+    } while (errno == EINTR);
+
+    return -1;
+}
+
+#endif
+
 ssize_t our_getline(char **const lineptr, size_t *const n, FILE *const stream) {
     do {
         const ssize_t ret = getline(lineptr, n, stream);
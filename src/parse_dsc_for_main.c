@@ -17,7 +17,11 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "dsc_image.h"
 #include "handle_dsc_parse_result.h"
+#include "handle_macho_file_parse_result.h"
+#include "input_manifest.h"
+#include "job_pool.h"
 #include "magic_buffer.h"
 #include "parse_dsc_for_main.h"
 
@@ -26,10 +30,41 @@
 #include "path.h"
 
 #include "recursive.h"
+#include "tar_writer.h"
 #include "tbd_for_main.h"
-#include "tbd_write.h"
+#include "tbd_writer.h"
 #include "unused.h"
+#include "util.h"
 
+/*
+ * An image of a shared-cache being merged, whose path points into the
+ * shared-cache's map.
+ */
+
+struct dsc_merge_image {
+    const char *path;
+    struct dyld_cache_image_info *image;
+};
+
+/*
+ * A shared-cache, of another architecture, whose images are merged into the
+ * .tbds of the images of the shared-cache being parsed that have the same
+ * install-name.
+ */
+
+struct dsc_merge_cache {
+    struct dyld_shared_cache_info dsc_info;
+    const char *path;
+
+    /*
+     * The shared-cache's images, sorted by their install-name.
+     */
+
+    struct dsc_merge_image *images;
+    uint64_t images_count;
+};
+
+struct dsc_image_job;
 struct dsc_iterate_images_info {
     struct dyld_shared_cache_info *dsc_info;
 
@@ -53,6 +88,14 @@ struct dsc_iterate_images_info {
     struct array images;
     FILE *combine_file;
 
+    /*
+     * The shared-caches whose images are parsed into the .tbd of each image
+     * with the same install-name, each for its own target.
+     */
+
+    struct dsc_merge_cache *merge_caches;
+    uint32_t merge_caches_count;
+
     macho_file_parse_error_callback callback;
     struct handle_dsc_image_parse_error_cb_info *callback_info;
 
@@ -62,6 +105,83 @@ struct dsc_iterate_images_info {
 
     struct retained_user_info *retained;
     struct string_buffer *export_trie_sb;
+
+    /*
+     * When not NULL, the .tbd for the current image has already been created
+     * by a job, and only has to be written out.
+     */
+
+    struct dsc_image_job *job;
+
+    /*
+     * When not NULL, images are written out on writer, with output holding the
+     * current image's .tbd once it has been handed off to the writer.
+     */
+
+    struct tbd_writer *writer;
+    struct tbd_writer_output *output;
+
+    /*
+     * When not NULL, images are written out as entries of archive, named after
+     * their write-paths relative to the tbd's write-path.
+     */
+
+    struct tar_writer *archive;
+};
+
+/*
+ * When --jobs is provided, images are parsed and their .tbds created on a
+ * job-pool, while the main thread commits each job in image order.
+ *
+ * Filter statuses, and the already-extracted pad-flag, are only ever touched by
+ * the main thread.
+ */
+
+struct dsc_batch_cache;
+struct dsc_image_job {
+    struct dyld_shared_cache_info *dsc_info;
+    struct dsc_iterate_images_info *iterate_info;
+
+    /*
+     * When image is NULL, the job instead marks the end of the images of a
+     * shared-cache in a batch, which is finished once the job is committed.
+     */
+
+    struct dyld_cache_image_info *image;
+    const char *image_path;
+
+    struct dsc_batch_cache *cache;
+
+    enum dsc_image_parse_result parse_result;
+
+    bool needs_callback;
+    bool create_failed;
+
+    char *data;
+    size_t size;
+};
+
+struct dsc_image_jobs_worker {
+    const struct tbd_for_main *orig;
+
+    struct tbd_for_main tbd;
+    struct string_buffer export_trie_sb;
+};
+
+/*
+ * A shared-cache whose images have been added to a batch, which stays mapped
+ * until the last of its images has been committed.
+ */
+
+struct dsc_batch_cache {
+    struct parse_dsc_for_main_batch *batch;
+
+    struct dyld_shared_cache_info dsc_info;
+    struct dsc_iterate_images_info iterate_info;
+    struct handle_dsc_image_parse_error_cb_info cb_info;
+
+    struct tbd_writer writer;
+    char *write_path;
 };
 
 enum dyld_cache_image_info_pad {
@@ -203,12 +323,167 @@ open_file_for_path(struct dsc_iterate_images_info *__notnull const info,
     return file;
 }
 
+/*
+ * Hand off the current image's .tbd to the writer, which may then be written
+ * out to several paths before it's released.
+ */
+
+static struct tbd_writer_output *
+get_writer_output(struct dsc_iterate_images_info *__notnull const iterate_info)
+{
+    struct tbd_writer_output *output = iterate_info->output;
+    if (output != NULL) {
+        return output;
+    }
+
+    struct tbd_for_main *const tbd = iterate_info->tbd;
+    const bool ignore_warnings = tbd->options.ignore_warnings;
+
+    struct dsc_image_job *const job = iterate_info->job;
+    if (job != NULL) {
+        output =
+            tbd_writer_output_create_from_data(job->data,
+                                               job->size,
+                                               ignore_warnings);
+
+        if (output != NULL) {
+            job->data = NULL;
+        }
+    } else {
+        output =
+            tbd_writer_output_create_from_info(&tbd->info,
+                                               tbd->write_options,
+                                               ignore_warnings);
+    }
+
+    iterate_info->output = output;
+    return output;
+}
+
+static void
+release_writer_output(
+    struct dsc_iterate_images_info *__notnull const iterate_info)
+{
+    struct tbd_writer_output *const output = iterate_info->output;
+    if (output == NULL) {
+        return;
+    }
+
+    tbd_writer_release_output(iterate_info->writer, output);
+    iterate_info->output = NULL;
+}
+
+static void
+write_to_archive(struct dsc_iterate_images_info *__notnull const iterate_info,
+                 const struct tbd_for_main *__notnull const tbd,
+                 const char *__notnull const write_path,
+                 const uint64_t write_path_length)
+{
+    const char *name = write_path + tbd->write_path_length;
+    const char *const end = write_path + write_path_length;
+
+    while (name != end && *name == '/') {
+        name++;
+    }
+
+    char *data = NULL;
+    size_t size = 0;
+
+    const struct dsc_image_job *const job = iterate_info->job;
+    if (job != NULL) {
+        data = job->data;
+        size = job->size;
+    } else {
+        const enum tbd_create_result create_tbd_result =
+            tbd_for_main_write_to_buffer(tbd, &data, &size);
+
+        if (create_tbd_result != E_TBD_CREATE_OK) {
+            print_write_file_result(iterate_info,
+                                    tbd,
+                                    E_TBD_FOR_MAIN_OPEN_WRITE_FILE_FAILED);
+
+            return;
+        }
+    }
+
+    const int write_ret =
+        tar_writer_write_file(iterate_info->archive,
+                              name,
+                              (uint64_t)(end - name),
+                              data,
+                              size);
+
+    if (write_ret != 0) {
+        print_write_file_result(iterate_info,
+                                tbd,
+                                E_TBD_FOR_MAIN_OPEN_WRITE_FILE_FAILED);
+    }
+
+    if (job == NULL) {
+        free(data);
+    }
+}
+
+static void
+write_to_path_if_changed(
+    struct dsc_iterate_images_info *__notnull const iterate_info,
+    const struct tbd_for_main *__notnull const tbd,
+    char *__notnull const write_path,
+    const uint64_t write_path_length)
+{
+    const bool print_paths = iterate_info->print_paths;
+    if (iterate_info->writer != NULL) {
+        struct tbd_writer_output *const output =
+            get_writer_output(iterate_info);
+
+        if (output != NULL) {
+            tbd_writer_add_if_changed(iterate_info->writer,
+                                      output,
+                                      write_path,
+                                      write_path_length,
+                                      tbd->options.no_overwrite,
+                                      print_paths);
+
+            return;
+        }
+    }
+
+    const struct dsc_image_job *const job = iterate_info->job;
+    if (job != NULL) {
+        tbd_for_main_write_buffer_to_path_if_changed(tbd,
+                                                     write_path,
+                                                     write_path_length,
+                                                     job->data,
+                                                     job->size,
+                                                     print_paths);
+    } else {
+        tbd_for_main_write_to_path_if_changed(tbd,
+                                              write_path,
+                                              write_path_length,
+                                              print_paths);
+    }
+}
+
 static void
 write_to_path(struct dsc_iterate_images_info *__notnull const iterate_info,
               const struct tbd_for_main *__notnull const tbd,
               char *__notnull const write_path,
               const uint64_t write_path_length)
 {
+    if (iterate_info->archive != NULL) {
+        write_to_archive(iterate_info, tbd, write_path, write_path_length);
+        return;
+    }
+
+    if (tbd->options.write_if_changed) {
+        write_to_path_if_changed(iterate_info,
+                                 tbd,
+                                 write_path,
+                                 write_path_length);
+
+        return;
+    }
+
     char *terminator = NULL;
     const bool should_combine = tbd->options.combine_tbds;
 
@@ -224,12 +499,41 @@ write_to_path(struct dsc_iterate_images_info *__notnull const iterate_info,
         return;
     }
 
-    tbd_for_main_write_to_file(tbd,
-                               write_path,
-                               write_path_length,
-                               terminator,
-                               file,
-                               iterate_info->print_paths);
+    if (iterate_info->writer != NULL) {
+        struct tbd_writer_output *const output =
+            get_writer_output(iterate_info);
+
+        if (output != NULL) {
+            tbd_writer_add(iterate_info->writer,
+                           output,
+                           file,
+                           write_path,
+                           write_path_length,
+                           terminator,
+                           iterate_info->print_paths);
+
+            return;
+        }
+    }
+
+    const struct dsc_image_job *const job = iterate_info->job;
+    if (job != NULL) {
+        tbd_for_main_write_buffer_to_file(tbd,
+                                          write_path,
+                                          write_path_length,
+                                          terminator,
+                                          file,
+                                          job->data,
+                                          job->size,
+                                          iterate_info->print_paths);
+    } else {
+        tbd_for_main_write_to_file(tbd,
+                                   write_path,
+                                   write_path_length,
+                                   terminator,
+                                   file,
+                                   iterate_info->print_paths);
+    }
 
     if (!should_combine) {
         fclose(file);
@@ -429,6 +733,105 @@ write_out_tbd_info(struct dsc_iterate_images_info *__notnull const info,
     }
 }
 
+static int
+compare_merge_images(const void *__notnull const left,
+                     const void *__notnull const right)
+{
+    const struct dsc_merge_image *const lhs =
+        (const struct dsc_merge_image *)left;
+
+    const struct dsc_merge_image *const rhs =
+        (const struct dsc_merge_image *)right;
+
+    return strcmp(lhs->path, rhs->path);
+}
+
+static const struct dsc_merge_image *
+find_merge_image(const struct dsc_merge_image *const list,
+                 const uint64_t count,
+                 const char *__notnull const image_path)
+{
+    const struct dsc_merge_image key = {
+        .path = image_path
+    };
+
+    return bsearch(&key, list, count, sizeof(*list), compare_merge_images);
+}
+
+/*
+ * Parse the images of the merged shared-caches with the same install-name as
+ * the image just parsed into tbd's create-info, with each image added for the
+ * target of its own shared-cache.
+ */
+
+static enum dsc_image_parse_result
+parse_merged_images(
+    struct tbd_for_main *__notnull const tbd,
+    const struct dsc_iterate_images_info *__notnull const iterate_info,
+    const char *__notnull const image_path,
+    const macho_file_parse_error_callback callback,
+    void *const cb_info,
+    struct string_buffer *__notnull const export_trie_sb)
+{
+    struct tbd_create_info *const info = &tbd->info;
+    struct dsc_image_parse_options options = tbd->dsc_image_options;
+
+    const bool ignore_targets = tbd->parse_options.ignore_targets;
+    bool merged_image = false;
+
+    struct dsc_merge_cache *cache = iterate_info->merge_caches;
+    const struct dsc_merge_cache *const end =
+        cache + iterate_info->merge_caches_count;
+
+    for (; cache != end; cache++) {
+        const struct dsc_merge_image *const merge_image =
+            find_merge_image(cache->images, cache->images_count, image_path);
+
+        if (merge_image == NULL) {
+            continue;
+        }
+
+        /*
+         * The image's target is added right after the targets of the images
+         * parsed before it.
+         */
+
+        if (!ignore_targets) {
+            options.target_index = info->fields.targets.set_count;
+        }
+
+        const enum dsc_image_parse_result parse_image_result =
+            dsc_image_parse(info,
+                            &cache->dsc_info,
+                            merge_image->image,
+                            callback,
+                            cb_info,
+                            export_trie_sb,
+                            tbd->macho_options,
+                            tbd->parse_options,
+                            options);
+
+        if (parse_image_result != E_DSC_IMAGE_PARSE_OK) {
+            return parse_image_result;
+        }
+
+        merged_image = true;
+    }
+
+    /*
+     * Like the architectures of a fat mach-o file, the metadata and symbols no
+     * longer all have the full set of targets, and have to be sorted by their
+     * targets.
+     */
+
+    if (merged_image && !ignore_targets) {
+        info->flags.uses_full_targets = false;
+        tbd_ci_sort_info(info);
+    }
+
+    return E_DSC_IMAGE_PARSE_OK;
+}
+
 static int
 actually_parse_image(
     struct dsc_iterate_images_info *__notnull const iterate_info,
@@ -446,8 +849,7 @@ actually_parse_image(
     cb_info->did_print_messages_header =
         iterate_info->did_print_messages_header;
 
-    struct dsc_image_parse_options options = {};
-    const enum dsc_image_parse_result parse_image_result =
+    enum dsc_image_parse_result parse_image_result =
         dsc_image_parse(info,
                         iterate_info->dsc_info,
                         image,
@@ -456,7 +858,17 @@ actually_parse_image(
                         iterate_info->export_trie_sb,
                         tbd->macho_options,
                         tbd->parse_options,
-                        options);
+                        tbd->dsc_image_options);
+
+    if (parse_image_result == E_DSC_IMAGE_PARSE_OK) {
+        parse_image_result =
+            parse_merged_images(tbd,
+                                iterate_info,
+                                image_path,
+                                iterate_info->callback,
+                                cb_info,
+                                iterate_info->export_trie_sb);
+    }
 
     iterate_info->did_print_messages_header =
         cb_info->did_print_messages_header;
@@ -477,6 +889,8 @@ actually_parse_image(
     }
 
     write_out_tbd_info(iterate_info, tbd, image_path, image_path_length);
+    release_writer_output(iterate_info);
+
     tbd_create_info_clear_fields_and_create_from(info, &orig->info);
 
     return 0;
@@ -597,162 +1011,1182 @@ print_missing_filter(
                             "filter (a file named: %s)\r\n",
                             filter->string);
 
-                    break;
+                    break;
+
+                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_DIRECTORY:
+                    fprintf(stderr,
+                            "\tNo images were found that passed the provided "
+                            "filter (a directory named: %s)\r\n",
+                            filter->string);
+
+                    break;
+
+                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_PATH:
+                    fprintf(stderr,
+                            "\tNo images were found with the provided "
+                            "path (%s)\r\n",
+                            filter->string);
+
+                    break;
+            }
+
+            break;
+
+        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_FOUND:
+            switch (filter->type) {
+                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_FILE:
+                    fprintf(stderr,
+                            "\tAt least one image that passed the provided "
+                            "filter (a file named: %s) was not successfully "
+                            "parsed\r\n",
+                            filter->string);
+
+                    break;
+
+                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_DIRECTORY:
+                    fprintf(stderr,
+                            "\tAt least one image that passed the provided "
+                            "filter (a directory named: %s) was not "
+                            "successfully parsed\r\n",
+                            filter->string);
+
+                    break;
+
+                /*
+                 * Since only one image corresponds to a path, the user already
+                 * knows that this filter failed.
+                 */
+
+                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_PATH:
+                    break;
+            }
+
+            break;
+
+        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_OK:
+        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_HAPPENING:
+            break;
+    }
+}
+
+/*
+ * Iterate over every filter to print out errors if at least one image wasn't
+ * found for every filter.
+ *
+ * We verify this here, rather that in
+ * dyld_shared_cache_iterate_images_with_callback as we don't want to loop over
+ * the filters once for the error-code, then again here to print out.
+ */
+
+static void
+print_missing_filter_list(const struct array *__notnull const filters) {
+    const struct tbd_for_main_dsc_image_filter *filter = filters->data;
+    const struct tbd_for_main_dsc_image_filter *const end = filters->data_end;
+
+    for (; filter != end; filter++) {
+        if (filter_was_parsed(filter)) {
+            continue;
+        }
+
+        print_missing_filter(filter);
+    }
+}
+
+/*
+ * Print out any errors we may have received after parsing all images from the
+ * dyld shared-cache file.
+ */
+
+static void
+print_dsc_warnings(struct dsc_iterate_images_info *__notnull const iterate_info,
+                   const struct array *__notnull const filters)
+{
+    if (found_entire_filter_list(filters)) {
+        return;
+    }
+
+    print_messages_header(iterate_info);
+    print_missing_filter_list(filters);
+}
+
+/*
+ * Unlike should_parse_image(), don't mark any filters as happening, as the
+ * image will only be written out once its job is committed.
+ */
+
+static bool
+image_passes_filter_list(struct dsc_iterate_images_info *__notnull const info,
+                         const struct array *__notnull const list,
+                         const char *__notnull const path)
+{
+    struct tbd_for_main_dsc_image_filter *filter = list->data;
+    const struct tbd_for_main_dsc_image_filter *const end = list->data_end;
+
+    for (; filter != end; filter++) {
+        if (image_path_passes_through_filter(info, path, filter)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+parse_image_job(void *__notnull const job_ptr, void *__notnull const worker_ptr)
+{
+    struct dsc_image_job *const job = (struct dsc_image_job *)job_ptr;
+    if (job->image == NULL) {
+        return;
+    }
+
+    struct dsc_image_jobs_worker *const worker =
+        (struct dsc_image_jobs_worker *)worker_ptr;
+
+    struct tbd_for_main *const tbd = &worker->tbd;
+    struct tbd_create_info *const info = &tbd->info;
+
+    /*
+     * We cannot print or request user-input from a job, so instead any call to
+     * the callback stops the parse, and leaves the image to be parsed again on
+     * the main thread.
+     */
+
+    job->parse_result =
+        dsc_image_parse(info,
+                        job->dsc_info,
+                        job->image,
+                        handle_macho_file_defer_error_callback,
+                        &job->needs_callback,
+                        &worker->export_trie_sb,
+                        tbd->macho_options,
+                        tbd->parse_options,
+                        tbd->dsc_image_options);
+
+    if (job->parse_result == E_DSC_IMAGE_PARSE_OK) {
+        job->parse_result =
+            parse_merged_images(tbd,
+                                job->iterate_info,
+                                job->image_path,
+                                handle_macho_file_defer_error_callback,
+                                &job->needs_callback,
+                                &worker->export_trie_sb);
+    }
+
+    if (job->parse_result == E_DSC_IMAGE_PARSE_OK) {
+        tbd_for_main_handle_post_parse(tbd);
+
+        const enum tbd_create_result create_tbd_result =
+            tbd_for_main_write_to_buffer(tbd, &job->data, &job->size);
+
+        job->create_failed = (create_tbd_result != E_TBD_CREATE_OK);
+    }
+
+    tbd_create_info_clear_fields_and_create_from(info, &worker->orig->info);
+}
+
+static int
+commit_image(struct dsc_iterate_images_info *__notnull const iterate_info,
+             struct dsc_image_job *__notnull const job)
+{
+    const char *const image_path = job->image_path;
+    if (job->needs_callback) {
+        return actually_parse_image(iterate_info, job->image, image_path);
+    }
+
+    if (job->parse_result != E_DSC_IMAGE_PARSE_OK) {
+        print_image_error(iterate_info, image_path, job->parse_result);
+        return 1;
+    }
+
+    if (job->create_failed) {
+        print_messages_header(iterate_info);
+        fprintf(stderr,
+                "\tImage (with path %s) could not be parsed and written out "
+                "due to a write fail\r\n",
+                image_path);
+
+        return 1;
+    }
+
+    const uint64_t image_path_length = strlen(image_path);
+    iterate_info->image_path_length = image_path_length;
+
+    iterate_info->job = job;
+    write_out_tbd_info(iterate_info,
+                       iterate_info->tbd,
+                       image_path,
+                       image_path_length);
+
+    release_writer_output(iterate_info);
+    iterate_info->job = NULL;
+
+    return 0;
+}
+
+static void finish_batch_cache(struct dsc_batch_cache *__notnull const cache) {
+    struct dsc_iterate_images_info *const info = &cache->iterate_info;
+    if (info->writer != NULL) {
+        tbd_writer_finish_and_destroy(&cache->writer);
+    }
+
+    print_dsc_warnings(info, &info->tbd->dsc_image_filters);
+
+    struct parse_dsc_for_main_batch *const batch = cache->batch;
+
+    batch->mapped_size -=
+        cache->dsc_info.size + cache->dsc_info.subcaches_size;
+    batch->caches_count -= 1;
+
+    dyld_shared_cache_info_destroy(&cache->dsc_info);
+
+    free(cache->write_path);
+    free(cache);
+}
+
+static void
+commit_image_job(void *__notnull const job_ptr, __unused void *const info) {
+    struct dsc_image_job *const job = (struct dsc_image_job *)job_ptr;
+    if (job->image == NULL) {
+        finish_batch_cache(job->cache);
+        return;
+    }
+
+    struct dsc_iterate_images_info *const iterate_info = job->iterate_info;
+    const struct array *const filters = &iterate_info->tbd->dsc_image_filters;
+
+    iterate_info->image_path = job->image_path;
+    iterate_info->image_path_length = 0;
+
+    /*
+     * Mark the filters the image passes as happening only now, as the filters
+     * of images committed before this one had to be written out first.
+     */
+
+    if (!iterate_info->parse_all_images) {
+        should_parse_image(iterate_info, filters, job->image_path);
+    }
+
+    if (commit_image(iterate_info, job)) {
+        unmark_happening_filters(filters);
+    } else {
+        job->image->pad |= F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED;
+    }
+
+    free(job->data);
+}
+
+static void
+destroy_image_jobs_workers(struct dsc_image_jobs *__notnull const jobs) {
+    struct dsc_image_jobs_worker *worker = jobs->workers;
+    const struct dsc_image_jobs_worker *const end = worker + jobs->worker_count;
+
+    for (; worker != end; worker++) {
+        tbd_for_main_destroy_job_copy(&worker->tbd, worker->orig);
+        sb_destroy(&worker->export_trie_sb);
+    }
+
+    free(jobs->workers);
+}
+
+/*
+ * If we fail to create the jobs, we simply fall back to parsing every image on
+ * the main thread.
+ */
+
+static bool
+create_image_jobs(struct dsc_image_jobs *__notnull const jobs,
+                  const struct tbd_for_main *__notnull const tbd,
+                  const struct tbd_for_main *__notnull const orig,
+                  const uint32_t worker_count)
+{
+    struct dsc_image_jobs_worker *const workers =
+        calloc(worker_count, sizeof(*workers));
+
+    if (workers == NULL) {
+        return false;
+    }
+
+    struct dsc_image_jobs_worker *worker = workers;
+    const struct dsc_image_jobs_worker *const end = workers + worker_count;
+
+    for (; worker != end; worker++) {
+        worker->orig = orig;
+        tbd_for_main_create_job_copy(&worker->tbd, tbd);
+    }
+
+    jobs->workers = workers;
+    jobs->worker_count = worker_count;
+
+    const enum job_pool_result create_pool_result =
+        job_pool_create(&jobs->pool,
+                        workers,
+                        sizeof(*workers),
+                        worker_count,
+                        sizeof(struct dsc_image_job),
+                        parse_image_job,
+                        commit_image_job,
+                        NULL);
+
+    if (create_pool_result != E_JOB_POOL_OK) {
+        destroy_image_jobs_workers(jobs);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Add a job for every image that should be parsed. Unlike should_parse_image(),
+ * filters are only marked once each job is committed.
+ */
+
+static void
+add_image_jobs(struct job_pool *__notnull const pool,
+               struct dyld_shared_cache_info *__notnull const dsc_info,
+               struct dsc_iterate_images_info *__notnull const info)
+{
+    const struct array *const filters = &info->tbd->dsc_image_filters;
+    const uint64_t images_count = dsc_info->images_count;
+
+    struct dyld_cache_image_info *image = dsc_info->images;
+    const struct dyld_cache_image_info *const end = image + images_count;
+
+    for (; image != end; image++) {
+        if (image->pad & F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED) {
+            continue;
+        }
+
+        const char *const image_path =
+            (const char *)(dsc_info->map + image->pathFileOffset);
+
+        if (unlikely(image_path[0] == '\0')) {
+            continue;
+        }
+
+        info->image_path = image_path;
+        info->image_path_length = 0;
+
+        if (!info->parse_all_images) {
+            if (!image_passes_filter_list(info, filters, image_path)) {
+                continue;
+            }
+        }
+
+        const struct dsc_image_job job = {
+            .dsc_info = dsc_info,
+            .iterate_info = info,
+
+            .image = image,
+            .image_path = image_path
+        };
+
+        job_pool_add(pool, &job);
+    }
+}
+
+static void
+dsc_iterate_images_on_jobs(
+    struct dyld_shared_cache_info *__notnull const dsc_info,
+    struct dsc_iterate_images_info *__notnull const info,
+    struct dsc_image_jobs *__notnull const jobs)
+{
+    const struct tbd_for_main *const tbd = info->tbd;
+
+    /*
+     * Images written out to separate files are also written out on a
+     * writer-thread, which has to be finished before the shared-cache is
+     * unmapped, as the images' install-names and symbols may point into the
+     * map.
+     */
+
+    struct tbd_writer writer = {};
+    if (!tbd->options.combine_tbds && info->archive == NULL) {
+        if (tbd_writer_create(&writer) == E_TBD_WRITER_OK) {
+            info->writer = &writer;
+        }
+    }
+
+    add_image_jobs(&jobs->pool, dsc_info, info);
+
+    job_pool_finish_and_destroy(&jobs->pool);
+    destroy_image_jobs_workers(jobs);
+
+    if (info->writer != NULL) {
+        tbd_writer_finish_and_destroy(&writer);
+        info->writer = NULL;
+    }
+
+    print_dsc_warnings(info, &tbd->dsc_image_filters);
+}
+
+static void
+dsc_iterate_images(struct dyld_shared_cache_info *__notnull const dsc_info,
+                   struct dsc_iterate_images_info *__notnull const info)
+{
+    const struct tbd_for_main *const tbd = info->tbd;
+    const struct array *const filters = &tbd->dsc_image_filters;
+    const uint64_t images_count = dsc_info->images_count;
+
+    /*
+     * Images are only parsed on jobs when they're written out to files, as only
+     * a single image can be written out to stdout.
+     */
+
+    if (tbd->jobs_count > 1 && tbd->write_path != NULL) {
+        struct dsc_image_jobs jobs = {};
+        if (create_image_jobs(&jobs, tbd, info->orig, tbd->jobs_count)) {
+            dsc_iterate_images_on_jobs(dsc_info, info, &jobs);
+            return;
+        }
+    }
+
+    struct dyld_cache_image_info *image = dsc_info->images;
+    const struct dyld_cache_image_info *const end = image + images_count;
+
+    for (uint32_t i = 0; image != end; i++, image++) {
+        if (image->pad & F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED) {
+            continue;
+        }
+
+        const char *const image_path =
+            (const char *)(dsc_info->map + image->pathFileOffset);
+
+        /*
+         * We never expect to encounter an empty image-path string, but we
+         * check regardless as a general precaution.
+         */
+
+        if (unlikely(image_path[0] == '\0')) {
+            continue;
+        }
+
+        info->image_path = image_path;
+        info->image_path_length = 0;
+
+        /*
+         * If we're not parsing all images, we need to verify that our image
+         * passes through either a name-filter or a path-filter.
+         */
+
+        if (!info->parse_all_images) {
+            if (!should_parse_image(info, filters, image_path)) {
+                continue;
+            }
+        }
+
+        if (actually_parse_image(info, image, image_path)) {
+            /*
+             * actually_parse_image() would usually unmark the happening status
+             * flag through write_out_tbd_info(), but the function was never
+             * called, and so we have to manually unmark the status ourselves.
+             */
+
+            unmark_happening_filters(filters);
+            continue;
+        }
+
+        image->pad |= F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED;
+    }
+
+    print_dsc_warnings(info, filters);
+}
+
+enum parse_dsc_for_main_batch_result
+parse_dsc_for_main_batch_create(
+    struct parse_dsc_for_main_batch *__notnull const batch,
+    const struct tbd_for_main *__notnull const tbd,
+    const struct tbd_for_main *__notnull const orig,
+    const uint32_t worker_count,
+    const uint64_t mapped_size_limit)
+{
+    if (!create_image_jobs(&batch->jobs, tbd, orig, worker_count)) {
+        return E_PARSE_DSC_FOR_MAIN_BATCH_CREATE_FAIL;
+    }
+
+    batch->mapped_size = 0;
+    batch->mapped_size_limit = mapped_size_limit;
+    batch->caches_count = 0;
+
+    return E_PARSE_DSC_FOR_MAIN_BATCH_OK;
+}
+
+void
+parse_dsc_for_main_batch_commit_all(
+    struct parse_dsc_for_main_batch *__notnull const batch)
+{
+    if (batch->caches_count == 0) {
+        return;
+    }
+
+    job_pool_commit_all(&batch->jobs.pool);
+}
+
+void
+parse_dsc_for_main_batch_finish_and_destroy(
+    struct parse_dsc_for_main_batch *__notnull const batch)
+{
+    job_pool_finish_and_destroy(&batch->jobs.pool);
+    destroy_image_jobs_workers(&batch->jobs);
+}
+
+/*
+ * On success, ownership of dsc_info and write_path is passed to the batch.
+ */
+
+static bool
+add_cache_to_batch(struct parse_dsc_for_main_batch *__notnull const batch,
+                   const struct parse_dsc_for_main_args *__notnull const args,
+                   struct dyld_shared_cache_info *__notnull const dsc_info,
+                   char *__notnull const write_path,
+                   const uint64_t write_path_length)
+{
+    /*
+     * Wait for the shared-caches found before this one to be committed, and
+     * unmapped, until this shared-cache fits within the limit.
+     */
+
+    const uint64_t size = dsc_info->size + dsc_info->subcaches_size;
+    while (batch->caches_count != 0) {
+        if (batch->mapped_size + size <= batch->mapped_size_limit) {
+            break;
+        }
+
+        job_pool_commit_oldest(&batch->jobs.pool);
+    }
+
+    /*
+     * The paths are only valid until we return, so we have to copy them into
+     * the same allocation as the cache.
+     */
+
+    const uint64_t dir_path_length = args->dsc_dir_path_length;
+    const uint64_t name_length = args->dsc_name_length;
+
+    struct dsc_batch_cache *const cache =
+        calloc(1, sizeof(*cache) + dir_path_length + name_length + 2);
+
+    if (cache == NULL) {
+        return false;
+    }
+
+    char *const dsc_dir_path = (char *)(cache + 1);
+    char *const dsc_name = dsc_dir_path + dir_path_length + 1;
+
+    memcpy(dsc_dir_path, args->dsc_dir_path, dir_path_length);
+    memcpy(dsc_name, args->dsc_name, name_length);
+
+    struct tbd_for_main *const tbd = args->tbd;
+    struct tbd_for_main *const orig = args->orig;
+
+    cache->batch = batch;
+    cache->dsc_info = *dsc_info;
+    cache->write_path = write_path;
+
+    cache->cb_info = (struct handle_dsc_image_parse_error_cb_info){
+        .tbd = tbd,
+        .orig = orig,
+
+        .dsc_dir_path = dsc_dir_path,
+        .dsc_name = dsc_name,
+
+        .print_paths = args->print_paths
+    };
+
+    cache->iterate_info = (struct dsc_iterate_images_info){
+        .dsc_info = &cache->dsc_info,
+        .dsc_dir_path = dsc_dir_path,
+        .dsc_name = dsc_name,
+
+        .write_path = write_path,
+        .write_path_length = write_path_length,
+
+        .tbd = tbd,
+        .orig = orig,
+
+        .retained = args->retained,
+
+        .callback = handle_dsc_image_parse_error_callback,
+        .callback_info = &cache->cb_info,
+
+        .print_paths = args->print_paths,
+        .parse_all_images = (tbd->dsc_image_filters.item_count == 0),
+
+        .export_trie_sb = args->export_trie_sb
+    };
+
+    struct dsc_iterate_images_info *const info = &cache->iterate_info;
+    if (tbd_writer_create(&cache->writer) == E_TBD_WRITER_OK) {
+        info->writer = &cache->writer;
+    }
+
+    batch->mapped_size += size;
+    batch->caches_count += 1;
+
+    add_image_jobs(&batch->jobs.pool, &cache->dsc_info, info);
+
+    const struct dsc_image_job end_job = {
+        .cache = cache
+    };
+
+    job_pool_add(&batch->jobs.pool, &end_job);
+    return true;
+}
+
+/*
+ * The install-name and uuid of an image of the previous dyld_shared_cache,
+ * whose path points into the previous shared-cache's map.
+ */
+
+struct previous_image {
+    const char *path;
+    uint8_t uuid[16];
+};
+
+static int
+compare_previous_images(const void *__notnull const left,
+                        const void *__notnull const right)
+{
+    const struct previous_image *const lhs =
+        (const struct previous_image *)left;
+
+    const struct previous_image *const rhs =
+        (const struct previous_image *)right;
+
+    return strcmp(lhs->path, rhs->path);
+}
+
+/*
+ * Collect the images of the previous shared-cache that have a uuid, sorted by
+ * their install-name.
+ */
+
+static struct previous_image *
+collect_previous_images(
+    const struct dyld_shared_cache_info *__notnull const dsc_info,
+    uint64_t *__notnull const count_out)
+{
+    const uint64_t images_count = dsc_info->images_count;
+    struct previous_image *const list =
+        calloc(images_count + 1, sizeof(*list));
+
+    if (list == NULL) {
+        return NULL;
+    }
+
+    uint64_t count = 0;
+
+    const struct dyld_cache_image_info *image = dsc_info->images;
+    const struct dyld_cache_image_info *const end = image + images_count;
+
+    for (; image != end; image++) {
+        const char *const image_path =
+            (const char *)(dsc_info->map + image->pathFileOffset);
+
+        if (unlikely(image_path[0] == '\0')) {
+            continue;
+        }
+
+        struct previous_image *const previous = list + count;
+        if (!dsc_image_get_uuid(dsc_info, image, previous->uuid)) {
+            continue;
+        }
+
+        previous->path = image_path;
+        count++;
+    }
+
+    qsort(list, count, sizeof(*list), compare_previous_images);
+
+    *count_out = count;
+    return list;
+}
+
+static void
+print_previous_cache_error(const char *__notnull const path,
+                           const char *__notnull const reason)
+{
+    fprintf(stderr,
+            "Failed to compare against the previous dyld_shared_cache (at path "
+            "%s): %s.\nAll images will be extracted\n",
+            path,
+            reason);
+}
+
+/*
+ * Return whether the write-path's manifest records the previous shared-cache,
+ * unchanged since, as extracted to the write-path with the same options, so
+ * that the .tbd files found there can be kept.
+ */
+
+static bool
+previous_cache_outputs_match(
+    const struct dsc_iterate_images_info *__notnull const info)
+{
+    const struct tbd_for_main *const tbd = info->tbd;
+    const char *const previous_path = tbd->dsc_previous_path;
+
+    struct stat sbuf = {};
+    if (stat(previous_path, &sbuf) != 0) {
+        return false;
+    }
+
+    const uint64_t write_path_length =
+        remove_end_slashes(info->write_path, info->write_path_length);
+
+    struct input_manifest manifest = {};
+    const enum input_manifest_result load_result =
+        input_manifest_load(&manifest,
+                            info->write_path,
+                            write_path_length,
+                            tbd->options_fingerprint);
+
+    if (load_result != E_INPUT_MANIFEST_OK) {
+        input_manifest_destroy(&manifest);
+        return false;
+    }
+
+    const bool unchanged =
+        input_manifest_input_unchanged(&manifest,
+                                       previous_path,
+                                       strlen(previous_path),
+                                       &sbuf);
+
+    input_manifest_destroy(&manifest);
+    return unchanged;
+}
+
+/*
+ * Mark the images whose install-name and uuid are unchanged since the previous
+ * shared-cache, and whose .tbd file from a previous run is still at its
+ * write-path, as already extracted, so that only new or changed images are
+ * parsed and written out.
+ */
+
+static void
+mark_unchanged_images(
+    struct dsc_iterate_images_info *__notnull const info,
+    struct dyld_shared_cache_info *__notnull const dsc_info)
+{
+    const struct tbd_for_main *const tbd = info->tbd;
+    const char *const previous_path = tbd->dsc_previous_path;
+
+    if (!previous_cache_outputs_match(info)) {
+        print_previous_cache_error(previous_path,
+                                   "its images weren't extracted to the "
+                                   "write-path with the same options");
+
+        return;
+    }
+
+    const int fd = our_open(previous_path, O_RDONLY, 0);
+    if (fd < 0) {
+        print_previous_cache_error(previous_path, strerror(errno));
+        return;
+    }
+
+    /*
+     * The rest of the header is read sequentially, right after the magic.
+     */
+
+    char magic[16] = {};
+    if (our_read(fd, magic, sizeof(magic)) != sizeof(magic)) {
+        print_previous_cache_error(previous_path, "failed to read magic");
+        close(fd);
+
+        return;
+    }
+
+    const struct dyld_shared_cache_parse_options options = {};
+
+    struct dyld_shared_cache_info previous = {};
+    const enum dyld_shared_cache_parse_result parse_result =
+        dyld_shared_cache_parse_from_file(&previous,
+                                          fd,
+                                          previous_path,
+                                          magic,
+                                          options);
+
+    close(fd);
+
+    if (parse_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+        print_previous_cache_error(previous_path,
+                                   "file is not a valid dyld_shared_cache");
+
+        return;
+    }
+
+    uint64_t previous_count = 0;
+    struct previous_image *const previous_list =
+        collect_previous_images(&previous, &previous_count);
+
+    if (previous_list == NULL) {
+        dyld_shared_cache_info_destroy(&previous);
+        print_previous_cache_error(previous_path, "failed to allocate memory");
+
+        return;
+    }
+
+    struct dyld_cache_image_info *image = dsc_info->images;
+    const struct dyld_cache_image_info *const end =
+        image + dsc_info->images_count;
+
+    for (; image != end; image++) {
+        if (image->pad & F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED) {
+            continue;
+        }
+
+        const char *const image_path =
+            (const char *)(dsc_info->map + image->pathFileOffset);
+
+        if (unlikely(image_path[0] == '\0')) {
+            continue;
+        }
+
+        const struct previous_image key = {
+            .path = image_path
+        };
+
+        const struct previous_image *const found =
+            bsearch(&key,
+                    previous_list,
+                    previous_count,
+                    sizeof(*previous_list),
+                    compare_previous_images);
+
+        if (found == NULL) {
+            continue;
+        }
+
+        uint8_t uuid[16];
+        if (!dsc_image_get_uuid(dsc_info, image, uuid)) {
+            continue;
+        }
+
+        if (memcmp(uuid, found->uuid, sizeof(uuid)) != 0) {
+            continue;
+        }
+
+        uint64_t write_path_length = 0;
+        char *const write_path =
+            tbd_for_main_create_dsc_image_write_path(tbd,
+                                                     info->write_path,
+                                                     info->write_path_length,
+                                                     image_path,
+                                                     strlen(image_path),
+                                                     "tbd",
+                                                     3,
+                                                     &write_path_length);
+
+        /*
+         * An image whose write-path can't be created is simply extracted
+         * again.
+         */
+
+        if (write_path == NULL) {
+            continue;
+        }
+
+        if (access(write_path, F_OK) == 0) {
+            image->pad |= F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED;
+        }
+
+        free(write_path);
+    }
+
+    free(previous_list);
+    dyld_shared_cache_info_destroy(&previous);
+}
+
+/*
+ * Record the shared-cache being parsed in the write-path's manifest, so that
+ * the .tbd files of its images can be kept when it's later provided as the
+ * previous shared-cache.
+ */
+
+static void
+record_cache_in_manifest(
+    const struct parse_dsc_for_main_args *__notnull const args,
+    const struct dsc_iterate_images_info *__notnull const info)
+{
+    struct stat sbuf = {};
+    if (fstat(args->fd, &sbuf) != 0) {
+        return;
+    }
+
+    const uint64_t write_path_length =
+        remove_end_slashes(info->write_path, info->write_path_length);
+
+    struct input_manifest manifest = {};
+    enum input_manifest_result result =
+        input_manifest_load(&manifest,
+                            info->write_path,
+                            write_path_length,
+                            args->tbd->options_fingerprint);
+
+    if (result == E_INPUT_MANIFEST_OK) {
+        result =
+            input_manifest_record(&manifest,
+                                  args->dsc_dir_path,
+                                  args->dsc_dir_path_length,
+                                  &sbuf,
+                                  info->write_path,
+                                  info->write_path_length);
+    }
+
+    if (result == E_INPUT_MANIFEST_OK) {
+        result = input_manifest_write(&manifest);
+    }
+
+    switch (result) {
+        case E_INPUT_MANIFEST_OK:
+            break;
+
+        case E_INPUT_MANIFEST_ALLOC_FAIL:
+            fputs("Failed to allocate memory\n", stderr);
+            break;
+
+        case E_INPUT_MANIFEST_READ_FAIL:
+        case E_INPUT_MANIFEST_WRITE_FAIL:
+            if (args->print_paths) {
+                fprintf(stderr,
+                        "Failed to write out manifest (at path %s), error: "
+                        "%s\n",
+                        manifest.path,
+                        strerror(errno));
+            } else {
+                fprintf(stderr,
+                        "Failed to write out the manifest of the provided "
+                        "write-path, error: %s\n",
+                        strerror(errno));
+            }
+
+            break;
+    }
+
+    input_manifest_destroy(&manifest);
+}
+
+/*
+ * Collect the images of a shared-cache, sorted by their install-name.
+ */
+
+static struct dsc_merge_image *
+collect_merge_images(struct dyld_shared_cache_info *__notnull const dsc_info,
+                     uint64_t *__notnull const count_out)
+{
+    const uint64_t images_count = dsc_info->images_count;
+    struct dsc_merge_image *const list =
+        calloc(images_count + 1, sizeof(*list));
+
+    if (list == NULL) {
+        return NULL;
+    }
+
+    uint64_t count = 0;
+
+    struct dyld_cache_image_info *image = dsc_info->images;
+    const struct dyld_cache_image_info *const end = image + images_count;
+
+    for (; image != end; image++) {
+        const char *const image_path =
+            (const char *)(dsc_info->map + image->pathFileOffset);
+
+        if (unlikely(image_path[0] == '\0')) {
+            continue;
+        }
+
+        list[count].path = image_path;
+        list[count].image = image;
 
-                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_DIRECTORY:
-                    fprintf(stderr,
-                            "\tNo images were found that passed the provided "
-                            "filter (a directory named: %s)\r\n",
-                            filter->string);
+        count++;
+    }
 
-                    break;
+    qsort(list, count, sizeof(*list), compare_merge_images);
 
-                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_PATH:
-                    fprintf(stderr,
-                            "\tNo images were found with the provided "
-                            "path (%s)\r\n",
-                            filter->string);
+    *count_out = count;
+    return list;
+}
 
-                    break;
-            }
+static void
+close_merge_caches(struct dsc_merge_cache *__notnull const caches,
+                   const uint32_t count)
+{
+    struct dsc_merge_cache *cache = caches;
+    const struct dsc_merge_cache *const end = caches + count;
 
-            break;
+    for (; cache != end; cache++) {
+        dyld_shared_cache_info_destroy(&cache->dsc_info);
+        free(cache->images);
+    }
 
-        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_FOUND:
-            switch (filter->type) {
-                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_FILE:
-                    fprintf(stderr,
-                            "\tAt least one image that passed the provided "
-                            "filter (a file named: %s) was not successfully "
-                            "parsed\r\n",
-                            filter->string);
+    free(caches);
+}
 
-                    break;
+static bool
+open_merge_cache(struct dsc_merge_cache *__notnull const cache,
+                 const char *__notnull const path,
+                 const struct dyld_shared_cache_parse_options options)
+{
+    const int fd = our_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr,
+                "Failed to open dyld_shared_cache file (at path %s) to merge, "
+                "error: %s\n",
+                path,
+                strerror(errno));
 
-                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_DIRECTORY:
-                    fprintf(stderr,
-                            "\tAt least one image that passed the provided "
-                            "filter (a directory named: %s) was not "
-                            "successfully parsed\r\n",
-                            filter->string);
+        return false;
+    }
 
-                    break;
+    /*
+     * The rest of the header is read sequentially, right after the magic.
+     */
 
-                /*
-                 * Since only one image corresponds to a path, the user already
-                 * knows that this filter failed.
-                 */
+    char magic[16] = {};
+    enum dyld_shared_cache_parse_result parse_result =
+        E_DYLD_SHARED_CACHE_PARSE_READ_FAIL;
 
-                case TBD_FOR_MAIN_DSC_IMAGE_FILTER_TYPE_PATH:
-                    break;
-            }
+    if (our_read(fd, magic, sizeof(magic)) == sizeof(magic)) {
+        parse_result =
+            dyld_shared_cache_parse_from_file(&cache->dsc_info,
+                                              fd,
+                                              path,
+                                              magic,
+                                              options);
+    }
 
-            break;
+    close(fd);
 
-        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_OK:
-        case TBD_FOR_MAIN_DSC_IMAGE_FILTER_PARSE_HAPPENING:
-            break;
+    if (parse_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+        handle_dsc_file_parse_result(path, NULL, parse_result, true, false);
+        return false;
+    }
+
+    cache->path = path;
+    cache->images = collect_merge_images(&cache->dsc_info,
+                                         &cache->images_count);
+
+    if (cache->images == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return false;
     }
+
+    return true;
 }
 
 /*
- * Iterate over every filter to print out errors if at least one image wasn't
- * found for every filter.
- *
- * We verify this here, rather that in
- * dyld_shared_cache_iterate_images_with_callback as we don't want to loop over
- * the filters once for the error-code, then again here to print out.
+ * Open the shared-caches to merge into dsc_info, which must each be of a
+ * different architecture, as each image can only have a single target for
+ * each architecture.
  */
 
-static void
-print_missing_filter_list(const struct array *__notnull const filters) {
-    const struct tbd_for_main_dsc_image_filter *filter = filters->data;
-    const struct tbd_for_main_dsc_image_filter *const end = filters->data_end;
+static struct dsc_merge_cache *
+open_merge_caches(const struct tbd_for_main *__notnull const tbd,
+                  const struct dyld_shared_cache_info *__notnull const dsc_info)
+{
+    const struct array *const paths = &tbd->dsc_merge_paths;
+    const uint64_t count = paths->item_count;
 
-    for (; filter != end; filter++) {
-        if (filter_was_parsed(filter)) {
-            continue;
+    struct dsc_merge_cache *const caches = calloc(count, sizeof(*caches));
+    if (caches == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return NULL;
+    }
+
+    struct dyld_shared_cache_parse_options options = tbd->dsc_options;
+    options.zero_image_pads = true;
+
+    for (uint64_t i = 0; i != count; i++) {
+        const char *const path = ((const char *const *)paths->data)[i];
+        struct dsc_merge_cache *const cache = caches + i;
+
+        if (!open_merge_cache(cache, path, options)) {
+            close_merge_caches(caches, (uint32_t)i + 1);
+            return NULL;
         }
 
-        print_missing_filter(filter);
+        bool is_duplicate_arch = (cache->dsc_info.arch == dsc_info->arch);
+        for (uint64_t j = 0; j != i && !is_duplicate_arch; j++) {
+            is_duplicate_arch =
+                (caches[j].dsc_info.arch == cache->dsc_info.arch);
+        }
+
+        if (is_duplicate_arch) {
+            fprintf(stderr,
+                    "dyld_shared_cache file (at path %s) has the same "
+                    "architecture as another of the dyld_shared_caches being "
+                    "merged\n",
+                    path);
+
+            close_merge_caches(caches, (uint32_t)i + 1);
+            return NULL;
+        }
     }
+
+    return caches;
 }
 
 /*
- * Print out any errors we may have received after parsing all images from the
- * dyld shared-cache file.
+ * Parse the images of the merged shared-caches that are neither in dsc_info,
+ * nor in an earlier merged shared-cache, with the images of every later merged
+ * shared-cache merged into them.
  */
 
 static void
-print_dsc_warnings(struct dsc_iterate_images_info *__notnull const iterate_info,
-                   const struct array *__notnull const filters)
+dsc_iterate_merge_only_images(
+    struct dsc_iterate_images_info *__notnull const info,
+    struct dyld_shared_cache_info *__notnull const dsc_info)
 {
-    if (found_entire_filter_list(filters)) {
+    uint64_t images_count = 0;
+    struct dsc_merge_image *const images =
+        collect_merge_images(dsc_info, &images_count);
+
+    if (images == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
         return;
     }
 
-    print_messages_header(iterate_info);
-    print_missing_filter_list(filters);
-}
-
-static void
-dsc_iterate_images(
-    const struct dyld_shared_cache_info *__notnull const dsc_info,
-    struct dsc_iterate_images_info *__notnull const info)
-{
-    const struct tbd_for_main *const tbd = info->tbd;
-    const struct array *const filters = &tbd->dsc_image_filters;
-    const uint64_t images_count = dsc_info->images_count;
-
-    struct dyld_cache_image_info *image = dsc_info->images;
-    const struct dyld_cache_image_info *const end = image + images_count;
-
-    for (uint32_t i = 0; image != end; i++, image++) {
-        if (image->pad & F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED) {
-            continue;
-        }
-
-        const char *const image_path =
-            (const char *)(dsc_info->map + image->pathFileOffset);
+    struct dsc_merge_cache *const caches = info->merge_caches;
+    const uint32_t caches_count = info->merge_caches_count;
 
-        /*
-         * We never expect to encounter an empty image-path string, but we
-         * check regardless as a general precaution.
-         */
+    for (uint32_t i = 0; i != caches_count; i++) {
+        struct dsc_merge_cache *const cache = caches + i;
 
-        if (unlikely(image_path[0] == '\0')) {
-            continue;
-        }
+        const struct dsc_merge_image *image = cache->images;
+        const struct dsc_merge_image *const end = image + cache->images_count;
 
-        info->image_path = image_path;
-        info->image_path_length = 0;
+        for (; image != end; image++) {
+            const char *const path = image->path;
+            bool was_parsed =
+                (find_merge_image(images, images_count, path) != NULL);
 
-        /*
-         * If we're not parsing all images, we need to verify that our image
-         * passes through either a name-filter or a path-filter.
-         */
+            for (uint32_t j = 0; j != i && !was_parsed; j++) {
+                const struct dsc_merge_cache *const prev = caches + j;
+                was_parsed =
+                    (find_merge_image(prev->images, prev->images_count, path)
+                        != NULL);
+            }
 
-        if (!info->parse_all_images) {
-            if (!should_parse_image(info, filters, image_path)) {
-                continue;
+            if (was_parsed) {
+                image->image->pad |=
+                    F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED;
             }
         }
 
-        if (actually_parse_image(info, image, image_path)) {
-            /*
-             * actually_parse_image() would usually unmark the happening status
-             * flag through write_out_tbd_info(), but the function was never
-             * called, and so we have to manually unmark the status ourselves.
-             */
+        info->dsc_info = &cache->dsc_info;
+        info->dsc_dir_path = cache->path;
+        info->callback_info->dsc_dir_path = cache->path;
 
-            unmark_happening_filters(filters);
-            continue;
-        }
+        info->merge_caches = cache + 1;
+        info->merge_caches_count = caches_count - i - 1;
 
-        image->pad |= F_DYLD_CACHE_IMAGE_INFO_PAD_ALREADY_EXTRACTED;
+        dsc_iterate_images(&cache->dsc_info, info);
     }
 
-    print_dsc_warnings(info, filters);
+    info->merge_caches = caches;
+    info->merge_caches_count = caches_count;
+
+    free(images);
 }
 
 enum read_magic_result {
@@ -913,6 +2347,84 @@ static void verify_write_path(struct tbd_for_main *__notnull const tbd) {
     return;
 }
 
+/*
+ * Images written out to an archive are named after the write-paths they would
+ * have had in this directory, with the directory's own path then stripped.
+ */
+
+static char archive_write_path[] = ".";
+
+static int
+open_archive(const struct parse_dsc_for_main_args *__notnull const args,
+             struct tar_writer *__notnull const archive)
+{
+    struct tbd_for_main *const tbd = args->tbd;
+
+    FILE *file = NULL;
+    if (tbd->write_path != NULL) {
+        char *terminator = NULL;
+        const enum tbd_for_main_open_write_file_result open_file_result =
+            tbd_for_main_open_write_file_for_path(tbd,
+                                                  tbd->write_path,
+                                                  tbd->write_path_length,
+                                                  &file,
+                                                  &terminator);
+
+        if (open_file_result != E_TBD_FOR_MAIN_OPEN_WRITE_FILE_OK) {
+            fprintf(stderr,
+                    "Failed to open archive (at path %s), error: %s\n",
+                    tbd->write_path,
+                    strerror(errno));
+
+            return 1;
+        }
+    } else {
+        file = tbd_for_main_open_output_stream(tbd, stdout, false);
+        if (file == NULL) {
+            fputs("Failed to open archive for stdout\n", stderr);
+            return 1;
+        }
+    }
+
+    tar_writer_create(archive, file);
+    return 0;
+}
+
+static enum parse_dsc_for_main_result
+close_archive(const struct parse_dsc_for_main_args *__notnull const args,
+              struct tar_writer *__notnull const archive,
+              char *const write_path,
+              const uint64_t write_path_length)
+{
+    struct tbd_for_main *const tbd = args->tbd;
+
+    tbd->write_path = write_path;
+    tbd->write_path_length = write_path_length;
+
+    bool failed = (tar_writer_finish(archive) != 0);
+    if (archive->file != stdout) {
+        if (fclose(archive->file) != 0) {
+            failed = true;
+        }
+    } else if (fflush(stdout) != 0) {
+        failed = true;
+    }
+
+    if (failed) {
+        if (write_path != NULL) {
+            fprintf(stderr,
+                    "Failed to finish writing out archive (at path %s)\n",
+                    write_path);
+        } else {
+            fputs("Failed to finish writing out archive to stdout\n", stderr);
+        }
+
+        return E_PARSE_DSC_FOR_MAIN_CLOSE_COMBINE_FILE_FAIL;
+    }
+
+    return E_PARSE_DSC_FOR_MAIN_OK;
+}
+
 enum parse_dsc_for_main_result
 parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
     const enum magic_buffer_result get_magic_result =
@@ -931,10 +2443,21 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
     struct dyld_shared_cache_parse_options dsc_options = args.tbd->dsc_options;
     dsc_options.zero_image_pads = true;
 
+    /*
+     * The subcaches of a split dyld_shared_cache are found next to the main
+     * cache-file, which isn't possible when reading from stdin.
+     */
+
+    const char *dsc_path = args.dsc_dir_path;
+    if (strcmp(dsc_path, "stdin") == 0) {
+        dsc_path = NULL;
+    }
+
     struct dyld_shared_cache_info dsc_info = {};
     const enum dyld_shared_cache_parse_result parse_dsc_file_result =
         dyld_shared_cache_parse_from_file(&dsc_info,
                                           args.fd,
+                                          dsc_path,
                                           (const char *)args.magic_buffer->buff,
                                           dsc_options);
 
@@ -962,9 +2485,39 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
         return E_PARSE_DSC_FOR_MAIN_OTHER_ERROR;
     }
 
+    struct dsc_merge_cache *merge_caches = NULL;
+    const uint32_t merge_caches_count =
+        (uint32_t)args.tbd->dsc_merge_paths.item_count;
+
+    if (merge_caches_count != 0) {
+        merge_caches = open_merge_caches(args.tbd, &dsc_info);
+        if (merge_caches == NULL) {
+            dyld_shared_cache_info_destroy(&dsc_info);
+            return E_PARSE_DSC_FOR_MAIN_OTHER_ERROR;
+        }
+    }
+
+    struct tar_writer archive = {};
+
+    char *const archive_path = args.tbd->write_path;
+    const uint64_t archive_path_length = args.tbd->write_path_length;
+
+    const bool tar_output = args.tbd->options.tar_output;
     if (args.tbd->options.combine_tbds) {
         args.tbd->flags.dsc_write_path_is_file = true;
         args.tbd->write_options.ignore_footer = true;
+    } else if (tar_output) {
+        if (open_archive(&args, &archive) != 0) {
+            if (merge_caches != NULL) {
+                close_merge_caches(merge_caches, merge_caches_count);
+            }
+
+            dyld_shared_cache_info_destroy(&dsc_info);
+            return E_PARSE_DSC_FOR_MAIN_OTHER_ERROR;
+        }
+
+        args.tbd->write_path = archive_write_path;
+        args.tbd->write_path_length = sizeof(archive_write_path) - 1;
     } else if (args.options.verify_write_path) {
         verify_write_path(args.tbd);
     }
@@ -992,9 +2545,14 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
         .combine_file = args.combine_file,
         .retained = args.retained,
 
+        .merge_caches = merge_caches,
+        .merge_caches_count = merge_caches_count,
+
         .callback = handle_dsc_image_parse_error_callback,
         .callback_info = &cb_info,
 
+        .archive = tar_output ? &archive : NULL,
+
         .print_paths = args.print_paths,
         .parse_all_images = true,
 
@@ -1064,8 +2622,19 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
 
         if (filters->item_count == 0) {
             print_dsc_warnings(&iterate_info, filters);
+            if (merge_caches != NULL) {
+                close_merge_caches(merge_caches, merge_caches_count);
+            }
+
             dyld_shared_cache_info_destroy(&dsc_info);
 
+            if (tar_output) {
+                return close_archive(&args,
+                                     &archive,
+                                     archive_path,
+                                     archive_path_length);
+            }
+
             return E_PARSE_DSC_FOR_MAIN_OK;
         }
     } else {
@@ -1081,14 +2650,61 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
         }
     }
 
+    /*
+     * Images are only compared against a previous shared-cache when each is
+     * written out to its own file, as the files of unchanged images are kept
+     * from a previous run.
+     */
+
+    const bool compare_previous =
+        args.tbd->dsc_previous_path != NULL &&
+        iterate_info.parse_all_images &&
+        iterate_info.write_path != NULL &&
+        !tar_output &&
+        !args.tbd->flags.dsc_write_path_is_file;
+
+    if (compare_previous) {
+        mark_unchanged_images(&iterate_info, &dsc_info);
+    }
+
     /*
      * Only create the write-path directory at the last-moment to avoid
      * unnecessary mkdir() calls.
      */
 
     dsc_iterate_images(&dsc_info, &iterate_info);
+
+    /*
+     * In incremental mode, main() already records the shared-cache in the
+     * manifest once it's parsed.
+     */
+
+    if (compare_previous && !args.tbd->options.incremental) {
+        record_cache_in_manifest(&args, &iterate_info);
+    }
+
+    /*
+     * Images found only in the merged shared-caches are only extracted when
+     * all images are, as filters and image-numbers select images of dsc_info.
+     */
+
+    if (merge_caches != NULL) {
+        if (iterate_info.parse_all_images) {
+            dsc_iterate_merge_only_images(&iterate_info, &dsc_info);
+        }
+
+        close_merge_caches(merge_caches, merge_caches_count);
+    }
+
     dyld_shared_cache_info_destroy(&dsc_info);
 
+    if (tar_output) {
+        return close_archive(&args,
+                             &archive,
+                             archive_path,
+                             archive_path_length);
+    }
+
     /*
      * After iterating over all our images, we need to cleanup after
      * combine_file.
@@ -1102,7 +2718,7 @@ parse_dsc_for_main(const struct parse_dsc_for_main_args args) {
 
     FILE *const combine_file = iterate_info.combine_file;
     if (combine_file != NULL) {
-        if (tbd_write_footer(combine_file)) {
+        if (tbd_for_main_write_footer(combine_file) != E_TBD_CREATE_OK) {
             if (args.print_paths) {
                 fprintf(stderr,
                         "Failed to write footer for combined .tbd file for "
@@ -1131,7 +2747,12 @@ parse_dsc_for_main_while_recursing(
     const enum magic_buffer_result get_magic_result =
         magic_buffer_read_n(magic_buffer, args->fd, 16);
 
+    struct parse_dsc_for_main_batch *const batch = args->batch;
     if (get_magic_result != E_MAGIC_BUFFER_OK) {
+        if (batch != NULL) {
+            parse_dsc_for_main_batch_commit_all(batch);
+        }
+
         handle_dsc_file_parse_result(args->dsc_dir_path,
                                      args->dsc_name,
                                      E_DYLD_SHARED_CACHE_PARSE_READ_FAIL,
@@ -1148,18 +2769,47 @@ parse_dsc_for_main_while_recursing(
 
     dsc_options.zero_image_pads = true;
 
+    uint64_t dsc_path_length = 0;
+    char *const dsc_path =
+        path_append_component(args->dsc_dir_path,
+                              args->dsc_dir_path_length,
+                              args->dsc_name,
+                              args->dsc_name_length,
+                              &dsc_path_length);
+
+    if (dsc_path == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        exit(1);
+    }
+
     struct dyld_shared_cache_info dsc_info = {};
     const enum dyld_shared_cache_parse_result parse_dsc_file_result =
         dyld_shared_cache_parse_from_file(&dsc_info,
                                           args->fd,
+                                          dsc_path,
                                           magic,
                                           dsc_options);
 
+    free(dsc_path);
+
+    /*
+     * The subcaches of a split dyld_shared_cache are parsed along with their
+     * main cache-file, so are skipped when found on their own.
+     */
+
+    if (parse_dsc_file_result == E_DYLD_SHARED_CACHE_PARSE_IS_SUBCACHE) {
+        return E_PARSE_DSC_FOR_MAIN_OK;
+    }
+
     if (parse_dsc_file_result == E_DYLD_SHARED_CACHE_PARSE_NOT_A_CACHE) {
         if (args->dont_handle_non_dsc_error) {
             return E_PARSE_DSC_FOR_MAIN_NOT_A_SHARED_CACHE;
         }
 
+        if (batch != NULL) {
+            parse_dsc_for_main_batch_commit_all(batch);
+        }
+
         handle_dsc_file_parse_result(args->dsc_dir_path,
                                      args->dsc_name,
                                      parse_dsc_file_result,
@@ -1170,6 +2820,10 @@ parse_dsc_for_main_while_recursing(
     }
 
     if (parse_dsc_file_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
+        if (batch != NULL) {
+            parse_dsc_for_main_batch_commit_all(batch);
+        }
+
         handle_dsc_file_parse_result(args->dsc_dir_path,
                                      args->dsc_name,
                                      parse_dsc_file_result,
@@ -1208,6 +2862,28 @@ parse_dsc_for_main_while_recursing(
                                             4,
                                             &write_path_length);
 
+    /*
+     * Image-numbers are parsed directly on this thread, so any shared-caches
+     * in the batch have to be committed first.
+     */
+
+    if (batch != NULL) {
+        if (tbd->dsc_image_numbers.item_count == 0) {
+            const bool added_to_batch =
+                add_cache_to_batch(batch,
+                                   args,
+                                   &dsc_info,
+                                   write_path,
+                                   write_path_length);
+
+            if (added_to_batch) {
+                return E_PARSE_DSC_FOR_MAIN_OK;
+            }
+        }
+
+        parse_dsc_for_main_batch_commit_all(batch);
+    }
+
     struct tbd_for_main *const orig = args->orig;
     const bool print_paths = args->print_paths;
 
@@ -1365,7 +3041,11 @@ void print_list_of_dsc_images(const int fd) {
     struct dyld_shared_cache_parse_options options = {};
 
     const enum dyld_shared_cache_parse_result parse_dsc_file_result =
-        dyld_shared_cache_parse_from_file(&dsc_info, fd, magic, options);
+        dyld_shared_cache_parse_from_file(&dsc_info,
+                                          fd,
+                                          NULL,
+                                          magic,
+                                          options);
 
     if (parse_dsc_file_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
         handle_dsc_file_parse_result(NULL,
@@ -1420,7 +3100,11 @@ void print_list_of_dsc_images_ordered(const int fd) {
     struct dyld_shared_cache_parse_options options = {};
 
     const enum dyld_shared_cache_parse_result parse_dsc_file_result =
-        dyld_shared_cache_parse_from_file(&dsc_info, fd, magic, options);
+        dyld_shared_cache_parse_from_file(&dsc_info,
+                                          fd,
+                                          NULL,
+                                          magic,
+                                          options);
 
     if (parse_dsc_file_result != E_DYLD_SHARED_CACHE_PARSE_OK) {
         handle_dsc_file_parse_result(NULL,
@@ -20,8 +20,11 @@
 #include "our_io.h"
 #include "parse_macho_for_main.h"
 #include "recursive.h"
+#include "result_cache.h"
 #include "tbd.h"
 #include "tbd_for_main.h"
+#include "tbd_writer.h"
+#include "unused.h"
 
 static void verify_write_path(const struct tbd_for_main *__notnull const tbd) {
     const char *const write_path = tbd->write_path;
@@ -165,6 +168,161 @@ open_file_for_path_while_recursing(struct parse_macho_for_main_args *const args,
     return file;
 }
 
+/*
+ * Write out the .tbd of the file being parsed, either from buffered, or from
+ * the tbd's create-info if buffered is NULL, only if it has changed, handing it
+ * off to the writer-thread if we have one.
+ */
+
+static void
+write_to_path_if_changed(
+    const struct parse_macho_for_main_args *__notnull const args,
+    char *__notnull const write_path,
+    const uint64_t write_path_length,
+    struct parse_macho_for_main_buffered *const buffered)
+{
+    struct tbd_for_main *const tbd = args->tbd;
+    const bool ignore_warnings = tbd->options.ignore_warnings;
+
+    struct tbd_writer *const writer = args->writer;
+    if (writer != NULL) {
+        struct tbd_writer_output *output = NULL;
+        if (buffered != NULL) {
+            output =
+                tbd_writer_output_create_from_data(buffered->data,
+                                                   buffered->size,
+                                                   ignore_warnings);
+
+            if (output != NULL) {
+                buffered->data = NULL;
+            }
+        } else {
+            output =
+                tbd_writer_output_create_from_info(&tbd->info,
+                                                   tbd->write_options,
+                                                   ignore_warnings);
+        }
+
+        if (output != NULL) {
+            tbd_writer_add_if_changed(writer,
+                                      output,
+                                      write_path,
+                                      write_path_length,
+                                      tbd->options.no_overwrite,
+                                      args->print_paths);
+
+            tbd_writer_release_output(writer, output);
+            return;
+        }
+    }
+
+    if (buffered != NULL) {
+        tbd_for_main_write_buffer_to_path_if_changed(tbd,
+                                                     write_path,
+                                                     write_path_length,
+                                                     buffered->data,
+                                                     buffered->size,
+                                                     args->print_paths);
+    } else {
+        tbd_for_main_write_to_path_if_changed(tbd,
+                                              write_path,
+                                              write_path_length,
+                                              args->print_paths);
+    }
+}
+
+/*
+ * Results can't be cached if the parse called the error-callback, as the user's
+ * response may have changed what was created.
+ */
+
+struct cache_callback_info {
+    macho_file_parse_error_callback callback;
+    void *cb_info;
+
+    bool called;
+};
+
+static bool
+note_callback_called(struct tbd_create_info *__notnull const info_in,
+                     const enum macho_file_parse_callback_type type,
+                     void *const cb_info)
+{
+    struct cache_callback_info *const info =
+        (struct cache_callback_info *)cb_info;
+
+    info->called = true;
+    return info->callback(info_in, type, info->cb_info);
+}
+
+/*
+ * Create the result-cache key for macho, if tbd has a result-cache, and the
+ * file can be cached.
+ */
+
+static bool
+create_cache_key(const struct tbd_for_main *__notnull const tbd,
+                 const struct macho_file *__notnull const macho,
+                 struct result_cache_key *__notnull const key_out)
+{
+    if (tbd->cache_dir_path == NULL) {
+        return false;
+    }
+
+    /*
+     * The footer of a combined .tbd file is left out of each of its .tbds.
+     */
+
+    struct tbd_create_options create_options = tbd->write_options;
+    if (tbd->options.combine_tbds) {
+        create_options.ignore_footer = true;
+    }
+
+    return result_cache_key_create(key_out,
+                                   macho,
+                                   tbd->options_fingerprint,
+                                   create_options.value);
+}
+
+static bool
+find_cached_result(
+    const struct tbd_for_main *__notnull const tbd,
+    const struct result_cache_key *__notnull const key,
+    struct parse_macho_for_main_buffered *__notnull const buffered)
+{
+    const enum result_cache_result lookup_result =
+        result_cache_lookup(tbd->cache_dir_path,
+                            tbd->cache_dir_path_length,
+                            key,
+                            &buffered->data,
+                            &buffered->size);
+
+    if (lookup_result != E_RESULT_CACHE_OK) {
+        return false;
+    }
+
+    buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_OK;
+    return true;
+}
+
+/*
+ * Failing to store a result isn't fatal, as the file can simply be parsed
+ * again next time.
+ */
+
+static void
+store_result(const struct tbd_for_main *__notnull const tbd,
+             const struct result_cache_key *__notnull const key,
+             const char *__notnull const data,
+             const size_t size)
+{
+    result_cache_store(tbd->cache_dir_path,
+                       tbd->cache_dir_path_length,
+                       key,
+                       data,
+                       size);
+}
+
 enum parse_macho_for_main_result
 parse_macho_file_for_main(const struct parse_macho_for_main_args args) {
     struct macho_file macho = {};
@@ -247,13 +405,27 @@ parse_macho_file_for_main(const struct parse_macho_for_main_args args) {
         verify_write_path(args.tbd);
     }
 
+    if (args.tbd->options.tar_output) {
+        tbd_create_info_clear_fields_and_create_from(info, orig);
+        fputs("Option --tar is only supported for dyld_shared_cache files, and "
+              "not for a single mach-o file\n",
+              stderr);
+
+        return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+    }
+
     char *const write_path = args.tbd->write_path;
     const uint64_t write_path_length = args.tbd->write_path_length;
 
     FILE *file = NULL;
     char *terminator = NULL;
 
-    if (write_path != NULL) {
+    if (write_path != NULL && args.tbd->options.write_if_changed) {
+        tbd_for_main_write_to_path_if_changed(args.tbd,
+                                              write_path,
+                                              write_path_length,
+                                              args.print_paths);
+    } else if (write_path != NULL) {
         file = open_file_for_path(&args,
                                   write_path,
                                   write_path_length,
@@ -346,12 +518,43 @@ parse_macho_file_for_main_while_recursing(
         .is_recursing = true
     };
 
+    /*
+     * A file found in the result-cache is written out like a file parsed by a
+     * job, skipping its parse entirely.
+     */
+
+    struct result_cache_key key = {};
+    const bool has_key = create_cache_key(tbd, &macho, &key);
+
+    if (has_key) {
+        struct parse_macho_for_main_buffered buffered = {};
+        if (find_cached_result(tbd, &key, &buffered)) {
+            result_cache_key_destroy(&key);
+
+            const enum parse_macho_for_main_result result =
+                parse_macho_file_for_main_from_buffered(args, &buffered);
+
+            free(buffered.data);
+            return result;
+        }
+    }
+
+    struct cache_callback_info cache_cb_info = {
+        .callback = handle_macho_file_for_main_error_callback,
+        .cb_info = (void *)&cb_info
+    };
+
     struct macho_file_parse_extra_args extra = {
         .callback = handle_macho_file_for_main_error_callback,
         .cb_info = (void *)&cb_info,
         .export_trie_sb = args->export_trie_sb
     };
 
+    if (has_key) {
+        extra.callback = note_callback_called;
+        extra.cb_info = &cache_cb_info;
+    }
+
     const enum macho_file_parse_result parse_macho_result =
         macho_file_parse_from_file(info,
                                    &macho,
@@ -360,6 +563,10 @@ parse_macho_file_for_main_while_recursing(
                                    tbd->macho_options);
 
     if (parse_macho_result != E_MACHO_FILE_PARSE_OK) {
+        if (has_key) {
+            result_cache_key_destroy(&key);
+        }
+
         tbd_create_info_clear_fields_and_create_from(info, orig_info);
         handle_macho_file_parse_result(dir_path,
                                        name,
@@ -373,6 +580,36 @@ parse_macho_file_for_main_while_recursing(
 
     tbd_for_main_handle_post_parse(tbd);
 
+    /*
+     * The .tbd of a file to be cached is created in memory, to both store, and
+     * then write out.
+     */
+
+    if (has_key) {
+        if (tbd->options.combine_tbds) {
+            tbd->write_options.ignore_footer = true;
+        }
+
+        struct parse_macho_for_main_buffered buffered = {};
+        const enum tbd_create_result create_tbd_result =
+            tbd_for_main_write_to_buffer(tbd, &buffered.data, &buffered.size);
+
+        tbd_create_info_clear_fields_and_create_from(info, orig_info);
+        if (create_tbd_result != E_TBD_CREATE_OK) {
+            buffered.result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_CREATE_FAIL;
+        } else if (!cache_cb_info.called) {
+            store_result(tbd, &key, buffered.data, buffered.size);
+        }
+
+        result_cache_key_destroy(&key);
+
+        const enum parse_macho_for_main_result result =
+            parse_macho_file_for_main_from_buffered(args, &buffered);
+
+        free(buffered.data);
+        return result;
+    }
+
     char *write_path = NULL;
     uint64_t write_path_length = 0;
 
@@ -394,6 +631,19 @@ parse_macho_file_for_main_while_recursing(
         tbd->write_options.ignore_footer = true;
     }
 
+    /*
+     * Combining .tbds isn't supported with --write-if-changed, so write_path is
+     * always our own copy here.
+     */
+
+    if (tbd->options.write_if_changed) {
+        write_to_path_if_changed(args, write_path, write_path_length, NULL);
+        free(write_path);
+
+        tbd_create_info_clear_fields_and_create_from(info, orig_info);
+        return E_PARSE_MACHO_FOR_MAIN_OK;
+    }
+
     char *terminator = NULL;
     FILE *const file =
         open_file_for_path_while_recursing(args,
@@ -410,6 +660,30 @@ parse_macho_file_for_main_while_recursing(
         return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
     }
 
+    struct tbd_writer *const writer = args->writer;
+    if (writer != NULL) {
+        struct tbd_writer_output *const output =
+            tbd_writer_output_create_from_info(info,
+                                               tbd->write_options,
+                                               tbd->options.ignore_warnings);
+
+        if (output != NULL) {
+            tbd_writer_add(writer,
+                           output,
+                           file,
+                           write_path,
+                           write_path_length,
+                           terminator,
+                           print_paths);
+
+            tbd_writer_release_output(writer, output);
+            free(write_path);
+
+            tbd_create_info_clear_fields_and_create_from(info, orig_info);
+            return E_PARSE_MACHO_FOR_MAIN_OK;
+        }
+    }
+
     tbd_for_main_write_to_file(tbd,
                                write_path,
                                write_path_length,
@@ -425,3 +699,282 @@ parse_macho_file_for_main_while_recursing(
     tbd_create_info_clear_fields_and_create_from(info, orig_info);
     return E_PARSE_MACHO_FOR_MAIN_OK;
 }
+
+void
+parse_macho_file_for_main_to_buffer(
+    struct tbd_for_main *__notnull const tbd,
+    const struct tbd_for_main *__notnull const orig,
+    const int fd,
+    struct string_buffer *__notnull const export_trie_sb,
+    struct parse_macho_for_main_buffered *__notnull const buffered)
+{
+    struct magic_buffer magic_buffer = {};
+    struct macho_file macho = {};
+    struct range range = {};
+
+    const enum macho_file_open_result open_macho_result =
+        macho_file_open(&macho, &magic_buffer, fd, range);
+
+    switch (open_macho_result) {
+        case E_MACHO_FILE_OPEN_OK:
+            break;
+
+        case E_MACHO_FILE_OPEN_NOT_A_MACHO:
+            buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_NOT_A_MACHO;
+            return;
+
+        default:
+            buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_OPEN_FAIL;
+            buffered->open_result = open_macho_result;
+
+            return;
+    }
+
+    struct result_cache_key key = {};
+    const bool has_key = create_cache_key(tbd, &macho, &key);
+
+    if (has_key && find_cached_result(tbd, &key, buffered)) {
+        result_cache_key_destroy(&key);
+        return;
+    }
+
+    struct tbd_create_info *const info = &tbd->info;
+    const struct tbd_create_info *const orig_info = &orig->info;
+
+    /*
+     * We cannot print or request user-input from a job, so instead any call to
+     * the callback stops the parse, and leaves the file to be parsed again on
+     * the main thread.
+     */
+
+    bool needs_callback = false;
+    struct macho_file_parse_extra_args extra = {
+        .callback = handle_macho_file_defer_error_callback,
+        .cb_info = &needs_callback,
+        .export_trie_sb = export_trie_sb
+    };
+
+    const enum macho_file_parse_result parse_macho_result =
+        macho_file_parse_from_file(info,
+                                   &macho,
+                                   extra,
+                                   tbd->parse_options,
+                                   tbd->macho_options);
+
+    if (parse_macho_result != E_MACHO_FILE_PARSE_OK) {
+        if (has_key) {
+            result_cache_key_destroy(&key);
+        }
+
+        tbd_create_info_clear_fields_and_create_from(info, orig_info);
+        if (needs_callback) {
+            buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_NEEDS_CALLBACK;
+            return;
+        }
+
+        buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_PARSE_FAIL;
+        buffered->parse_result = parse_macho_result;
+
+        return;
+    }
+
+    tbd_for_main_handle_post_parse(tbd);
+
+    /*
+     * The footer of a combined .tbd file is written by main once all files have
+     * been committed.
+     */
+
+    if (tbd->options.combine_tbds) {
+        tbd->write_options.ignore_footer = true;
+    }
+
+    const enum tbd_create_result create_tbd_result =
+        tbd_for_main_write_to_buffer(tbd, &buffered->data, &buffered->size);
+
+    tbd_create_info_clear_fields_and_create_from(info, orig_info);
+    if (create_tbd_result != E_TBD_CREATE_OK) {
+        if (has_key) {
+            result_cache_key_destroy(&key);
+        }
+
+        buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_CREATE_FAIL;
+        return;
+    }
+
+    if (has_key) {
+        store_result(tbd, &key, buffered->data, buffered->size);
+        result_cache_key_destroy(&key);
+    }
+
+    buffered->result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_OK;
+}
+
+static bool
+rewind_file(const struct parse_macho_for_main_args *__notnull const args) {
+    if (our_lseek(args->fd, 0, SEEK_SET) < 0) {
+        fprintf(stderr,
+                "Failed to seek to the beginning of file (at path %s/%s), "
+                "error: %s\n",
+                args->dir_path,
+                args->name,
+                strerror(errno));
+
+        return false;
+    }
+
+    return true;
+}
+
+enum parse_macho_for_main_result
+parse_macho_file_for_main_from_buffered(
+    struct parse_macho_for_main_args *__notnull const args,
+    struct parse_macho_for_main_buffered *__notnull const buffered)
+{
+    struct tbd_for_main *const tbd = args->tbd;
+
+    const char *const dir_path = args->dir_path;
+    const char *const name = args->name;
+    const bool print_paths = args->print_paths;
+
+    switch (buffered->result) {
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_OK:
+            break;
+
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_NOT_A_MACHO:
+            /*
+             * Rewind the file so it can be parsed as another filetype.
+             */
+
+            if (!rewind_file(args)) {
+                return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+            }
+
+            if (!args->dont_handle_non_macho_error) {
+                handle_macho_file_open_result(E_MACHO_FILE_OPEN_NOT_A_MACHO,
+                                              dir_path,
+                                              name,
+                                              print_paths,
+                                              true);
+            }
+
+            return E_PARSE_MACHO_FOR_MAIN_NOT_A_MACHO;
+
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_OPEN_FAIL:
+            handle_macho_file_open_result(buffered->open_result,
+                                          dir_path,
+                                          name,
+                                          print_paths,
+                                          true);
+
+            return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_PARSE_FAIL:
+            handle_macho_file_parse_result(dir_path,
+                                           name,
+                                           buffered->parse_result,
+                                           print_paths,
+                                           true,
+                                           tbd->options.ignore_warnings);
+
+            return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_CREATE_FAIL:
+            if (!tbd->options.ignore_warnings) {
+                fprintf(stderr,
+                        "Failed to create .tbd for file (at path %s/%s)\n",
+                        dir_path,
+                        name);
+            }
+
+            return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+
+        case E_PARSE_MACHO_FOR_MAIN_BUFFERED_NEEDS_CALLBACK:
+            if (!rewind_file(args)) {
+                return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+            }
+
+            return parse_macho_file_for_main_while_recursing(args);
+    }
+
+    char *write_path = NULL;
+    uint64_t write_path_length = 0;
+
+    const bool should_combine = tbd->options.combine_tbds;
+    if (!should_combine) {
+        write_path =
+            tbd_for_main_create_write_path_for_recursing(tbd,
+                                                         dir_path,
+                                                         args->dir_path_length,
+                                                         name,
+                                                         args->name_length,
+                                                         "tbd",
+                                                         3,
+                                                         &write_path_length);
+    } else {
+        write_path = tbd->write_path;
+        write_path_length = tbd->write_path_length;
+    }
+
+    if (tbd->options.write_if_changed) {
+        write_to_path_if_changed(args, write_path, write_path_length, buffered);
+        free(write_path);
+
+        return E_PARSE_MACHO_FOR_MAIN_OK;
+    }
+
+    char *terminator = NULL;
+    FILE *const file =
+        open_file_for_path_while_recursing(args,
+                                           write_path,
+                                           write_path_length,
+                                           &terminator);
+
+    if (file == NULL) {
+        if (!should_combine) {
+            free(write_path);
+        }
+
+        return E_PARSE_MACHO_FOR_MAIN_OTHER_ERROR;
+    }
+
+    struct tbd_writer *const writer = args->writer;
+    if (writer != NULL) {
+        struct tbd_writer_output *const output =
+            tbd_writer_output_create_from_data(buffered->data,
+                                               buffered->size,
+                                               tbd->options.ignore_warnings);
+
+        if (output != NULL) {
+            buffered->data = NULL;
+            tbd_writer_add(writer,
+                           output,
+                           file,
+                           write_path,
+                           write_path_length,
+                           terminator,
+                           print_paths);
+
+            tbd_writer_release_output(writer, output);
+            free(write_path);
+
+            return E_PARSE_MACHO_FOR_MAIN_OK;
+        }
+    }
+
+    tbd_for_main_write_buffer_to_file(tbd,
+                                      write_path,
+                                      write_path_length,
+                                      terminator,
+                                      file,
+                                      buffered->data,
+                                      buffered->size,
+                                      print_paths);
+
+    if (!should_combine) {
+        fclose(file);
+        free(write_path);
+    }
+
+    return E_PARSE_MACHO_FOR_MAIN_OK;
+}
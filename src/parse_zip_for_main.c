@@ -0,0 +1,550 @@
+//
+//  src/parse_zip_for_main.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mach-o/fat.h"
+#include "mach-o/loader.h"
+
+#include "copy.h"
+#include "magic_buffer.h"
+#include "our_io.h"
+#include "parse_macho_for_main.h"
+#include "parse_zip_for_main.h"
+#include "path.h"
+#include "zip_archive.h"
+
+struct zip_iterate_info {
+    struct parse_zip_for_main_args *args;
+
+    const char *archive_path;
+    uint64_t archive_path_length;
+
+    uint64_t files_parsed;
+    bool failed_to_alloc;
+};
+
+static bool magic_is_macho(const uint32_t magic) {
+    switch (magic) {
+        case MH_MAGIC:
+        case MH_CIGAM:
+        case MH_MAGIC_64:
+        case MH_CIGAM_64:
+        case FAT_MAGIC:
+        case FAT_CIGAM:
+        case FAT_MAGIC_64:
+        case FAT_CIGAM_64:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static const char *
+get_zip_archive_result_string(const enum zip_archive_result result) {
+    switch (result) {
+        case E_ZIP_ARCHIVE_OK:
+        case E_ZIP_ARCHIVE_NOT_A_ZIP:
+            break;
+
+        case E_ZIP_ARCHIVE_READ_FAIL:
+            return "failed to read data";
+
+        case E_ZIP_ARCHIVE_WRITE_FAIL:
+            return "failed to write out decompressed data";
+
+        case E_ZIP_ARCHIVE_ALLOC_FAIL:
+            return "failed to allocate memory";
+
+        case E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY:
+            return "central-directory is invalid";
+
+        case E_ZIP_ARCHIVE_INVALID_ENTRY:
+            return "entry is invalid";
+
+        case E_ZIP_ARCHIVE_MULTIPLE_DISKS:
+            return "archives split across multiple disks are not supported";
+
+        case E_ZIP_ARCHIVE_ENCRYPTED_ENTRY:
+            return "encrypted entries are not supported";
+
+        case E_ZIP_ARCHIVE_UNSUPPORTED_METHOD:
+            return "entry's compression-method is not supported";
+
+        case E_ZIP_ARCHIVE_INFLATE_FAIL:
+            return "entry's compressed data is invalid";
+
+        case E_ZIP_ARCHIVE_CRC_MISMATCH:
+            return "entry's checksum doesn't match its data";
+    }
+
+    return "not a zip archive";
+}
+
+static void
+print_zip_archive_error(
+    const struct parse_zip_for_main_args *__notnull const args,
+    const char *__notnull const archive_path,
+    const enum zip_archive_result result)
+{
+    const char *const reason = get_zip_archive_result_string(result);
+    if (args->print_paths) {
+        fprintf(stderr,
+                "Failed to parse zip archive (at path %s): %s\n",
+                archive_path,
+                reason);
+    } else {
+        fprintf(stderr,
+                "Failed to parse the zip archive at the provided path: %s\n",
+                reason);
+    }
+}
+
+static void
+print_member_error(const struct zip_iterate_info *__notnull const info,
+                   const char *__notnull const member_path,
+                   const enum zip_archive_result result)
+{
+    const char *const reason = get_zip_archive_result_string(result);
+    if (info->args->print_paths) {
+        fprintf(stderr,
+                "Failed to extract member (at path %s) of zip archive (at "
+                "path %s): %s\n",
+                member_path,
+                info->archive_path,
+                reason);
+    } else {
+        fprintf(stderr,
+                "Failed to extract member (at path %s) of the zip archive at "
+                "the provided path: %s\n",
+                member_path,
+                reason);
+    }
+}
+
+/*
+ * Running out of memory stops the archive from being parsed any further, but
+ * is left for the caller to handle, so the rest of a recursion can continue.
+ */
+
+static void
+print_alloc_error(struct zip_iterate_info *__notnull const info) {
+    if (info->args->print_paths) {
+        fprintf(stderr,
+                "Failed to allocate memory while parsing zip archive (at path "
+                "%s)\n",
+                info->archive_path);
+    } else {
+        fputs("Failed to allocate memory while parsing the zip archive at the "
+              "provided path\n",
+              stderr);
+    }
+
+    info->failed_to_alloc = true;
+}
+
+/*
+ * Members with a parent-directory component would otherwise be written out
+ * outside of the write-path's directory.
+ */
+
+static bool
+member_path_is_safe(const char *__notnull const path, const uint64_t length) {
+    const char *iter = path;
+    const char *const end = path + length;
+
+    while (iter != end) {
+        const char *component_end = memchr(iter, '/', (size_t)(end - iter));
+        if (component_end == NULL) {
+            component_end = end;
+        }
+
+        if (component_end - iter == 2 && iter[0] == '.' && iter[1] == '.') {
+            return false;
+        }
+
+        if (component_end == end) {
+            break;
+        }
+
+        iter = component_end + 1;
+    }
+
+    return true;
+}
+
+/*
+ * Decompress the member into a file in memory, which can then be mapped and
+ * parsed like any other mach-o file.
+ */
+
+static int
+extract_member(const struct zip_archive *__notnull const archive,
+               const struct zip_archive_entry *__notnull const entry,
+               enum zip_archive_result *__notnull const result_out)
+{
+    const int fd = our_open_anonymous_file("tbd-zip-member");
+    if (fd < 0) {
+        *result_out = E_ZIP_ARCHIVE_WRITE_FAIL;
+        return -1;
+    }
+
+    const enum zip_archive_result extract_result =
+        zip_archive_extract_entry(archive, entry, fd);
+
+    if (extract_result != E_ZIP_ARCHIVE_OK) {
+        close(fd);
+
+        *result_out = extract_result;
+        return -1;
+    }
+
+    if (our_lseek(fd, 0, SEEK_SET) < 0) {
+        close(fd);
+
+        *result_out = E_ZIP_ARCHIVE_READ_FAIL;
+        return -1;
+    }
+
+    return fd;
+}
+
+static bool
+parse_member(struct zip_iterate_info *__notnull const info,
+             const int fd,
+             const char *__notnull const member_path,
+             const uint64_t member_path_length)
+{
+    struct parse_zip_for_main_args *const args = info->args;
+
+    /*
+     * The member's directories within the archive are treated as
+     * sub-directories of the archive's path.
+     */
+
+    const char *name = member_path;
+    uint64_t name_length = member_path_length;
+
+    char *dir_path = (char *)info->archive_path;
+    uint64_t dir_path_length = info->archive_path_length;
+
+    const char *const slash = strrchr(member_path, '/');
+    if (slash != NULL) {
+        name = slash + 1;
+        name_length = member_path_length - (uint64_t)(name - member_path);
+
+        uint64_t dirs_length = (uint64_t)(slash - member_path);
+        while (dirs_length != 0 && member_path[dirs_length - 1] == '/') {
+            dirs_length--;
+        }
+
+        if (dirs_length != 0) {
+            dir_path =
+                path_append_component(info->archive_path,
+                                      info->archive_path_length,
+                                      member_path,
+                                      dirs_length,
+                                      &dir_path_length);
+
+            if (dir_path == NULL) {
+                print_alloc_error(info);
+                return false;
+            }
+        }
+    }
+
+    struct magic_buffer magic_buffer = {};
+    struct parse_macho_for_main_args macho_args = {
+        .fd = fd,
+        .magic_buffer = &magic_buffer,
+        .retained = args->retained,
+
+        .tbd = args->tbd,
+        .orig = args->orig,
+
+        .dir_path = dir_path,
+        .dir_path_length = dir_path_length,
+
+        .name = name,
+        .name_length = name_length,
+
+        .combine_file = args->combine_file,
+        .writer = args->writer,
+
+        .dont_handle_non_macho_error = true,
+        .print_paths = true,
+
+        .export_trie_sb = args->export_trie_sb
+    };
+
+    const enum parse_macho_for_main_result parse_result =
+        parse_macho_file_for_main_while_recursing(&macho_args);
+
+    if (parse_result == E_PARSE_MACHO_FOR_MAIN_OK) {
+        info->files_parsed += 1;
+    }
+
+    args->combine_file = macho_args.combine_file;
+    if (dir_path != info->archive_path) {
+        free(dir_path);
+    }
+
+    return true;
+}
+
+static bool
+iterate_member_callback(struct zip_archive *__notnull const archive,
+                        const struct zip_archive_entry *__notnull const entry,
+                        void *const cb_info)
+{
+    struct zip_iterate_info *const info = (struct zip_iterate_info *)cb_info;
+    if (!zip_archive_entry_is_file(entry)) {
+        return true;
+    }
+
+    if (entry->size < sizeof(struct mach_header)) {
+        return true;
+    }
+
+    /*
+     * Only the first few bytes of a member are decompressed to check if it's a
+     * mach-o file, before decompressing all of it.
+     */
+
+    uint32_t magic = 0;
+    uint64_t magic_size = 0;
+
+    const enum zip_archive_result read_head_result =
+        zip_archive_read_entry_head(archive,
+                                    entry,
+                                    &magic,
+                                    sizeof(magic),
+                                    &magic_size);
+
+    if (read_head_result != E_ZIP_ARCHIVE_OK) {
+        return true;
+    }
+
+    if (magic_size != sizeof(magic) || !magic_is_macho(magic)) {
+        return true;
+    }
+
+    char *const member_path = alloc_and_copy(entry->path, entry->path_length);
+    if (member_path == NULL) {
+        print_alloc_error(info);
+        return false;
+    }
+
+    const uint64_t member_path_length = entry->path_length;
+    if (!member_path_is_safe(member_path, member_path_length)) {
+        if (!info->args->tbd->options.ignore_warnings) {
+            fprintf(stderr,
+                    "Skipping member (at path %s) of zip archive (at path "
+                    "%s), as its path leaves the archive's directory\n",
+                    member_path,
+                    info->archive_path);
+        }
+
+        free(member_path);
+        return true;
+    }
+
+    enum zip_archive_result extract_result = E_ZIP_ARCHIVE_OK;
+    const int fd = extract_member(archive, entry, &extract_result);
+
+    if (fd < 0) {
+        print_member_error(info, member_path, extract_result);
+        free(member_path);
+
+        return true;
+    }
+
+    const bool parsed_member =
+        parse_member(info, fd, member_path, member_path_length);
+
+    close(fd);
+    free(member_path);
+
+    return parsed_member;
+}
+
+static enum parse_zip_for_main_result
+parse_archive(struct parse_zip_for_main_args *__notnull const args,
+              const char *__notnull const archive_path,
+              const uint64_t archive_path_length,
+              uint64_t *__notnull const files_parsed_out)
+{
+    struct zip_archive archive = {};
+    const enum zip_archive_result open_result =
+        zip_archive_open(&archive, args->fd);
+
+    if (open_result != E_ZIP_ARCHIVE_OK) {
+        if (open_result == E_ZIP_ARCHIVE_NOT_A_ZIP) {
+            if (!args->dont_handle_non_zip_error) {
+                print_zip_archive_error(args, archive_path, open_result);
+            }
+
+            return E_PARSE_ZIP_FOR_MAIN_NOT_A_ZIP;
+        }
+
+        print_zip_archive_error(args, archive_path, open_result);
+        return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+    }
+
+    struct zip_iterate_info info = {
+        .args = args,
+
+        .archive_path = archive_path,
+        .archive_path_length = archive_path_length
+    };
+
+    const enum zip_archive_result iterate_result =
+        zip_archive_iterate(&archive, iterate_member_callback, &info);
+
+    zip_archive_destroy(&archive);
+
+    if (iterate_result != E_ZIP_ARCHIVE_OK) {
+        print_zip_archive_error(args, archive_path, iterate_result);
+        return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+    }
+
+    if (info.failed_to_alloc) {
+        return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+    }
+
+    *files_parsed_out = info.files_parsed;
+    return E_PARSE_ZIP_FOR_MAIN_OK;
+}
+
+static bool
+verify_write_path(const struct tbd_for_main *__notnull const tbd) {
+    const char *const write_path = tbd->write_path;
+    if (write_path == NULL) {
+        fputs("Writing to stdout while parsing a zip archive is not supported."
+              "\nPlease provide a directory to write all created files to\n",
+              stderr);
+
+        return false;
+    }
+
+    if (tbd->options.combine_tbds) {
+        return true;
+    }
+
+    struct stat sbuf = {};
+    if (stat(write_path, &sbuf) < 0) {
+        /*
+         * The write-directory doesn't have to exist.
+         */
+
+        return true;
+    }
+
+    if (!S_ISDIR(sbuf.st_mode)) {
+        fputs("Writing to a regular file while parsing a zip archive is not "
+              "supported.\nPlease provide a directory to write all created "
+              "files to, or provide the --combine-tbds option\n",
+              stderr);
+
+        return false;
+    }
+
+    return true;
+}
+
+enum parse_zip_for_main_result
+parse_zip_for_main(struct parse_zip_for_main_args args) {
+    struct tbd_for_main *const tbd = args.tbd;
+    if (tbd->options.tar_output) {
+        fputs("Option --tar is only supported for dyld_shared_cache files, and "
+              "not for a zip archive\n",
+              stderr);
+
+        return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+    }
+
+    if (args.options.verify_write_path) {
+        if (!verify_write_path(tbd)) {
+            return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+        }
+    }
+
+    uint64_t files_parsed = 0;
+    const enum parse_zip_for_main_result parse_result =
+        parse_archive(&args,
+                      args.dir_path,
+                      args.dir_path_length,
+                      &files_parsed);
+
+    if (parse_result != E_PARSE_ZIP_FOR_MAIN_OK) {
+        return parse_result;
+    }
+
+    if (files_parsed == 0) {
+        if (args.print_paths) {
+            fprintf(stderr,
+                    "No .tbd files were created from the zip archive (at path "
+                    "%s)\n",
+                    args.dir_path);
+        } else {
+            fputs("No .tbd files were created from the zip archive at the "
+                  "provided path\n",
+                  stderr);
+        }
+    }
+
+    /*
+     * Finish the combined .tbd file ourselves, as it was only created for this
+     * archive.
+     */
+
+    FILE *const combine_file = args.combine_file;
+    if (combine_file != NULL) {
+        if (tbd_for_main_write_footer(combine_file) != E_TBD_CREATE_OK) {
+            fputs("Failed to write footer for combined .tbd file\n", stderr);
+            fclose(combine_file);
+
+            return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+        }
+
+        fclose(combine_file);
+    }
+
+    return E_PARSE_ZIP_FOR_MAIN_OK;
+}
+
+enum parse_zip_for_main_result
+parse_zip_for_main_while_recursing(
+    struct parse_zip_for_main_args *__notnull const args)
+{
+    uint64_t archive_path_length = 0;
+    char *const archive_path =
+        path_append_component(args->dir_path,
+                              args->dir_path_length,
+                              args->name,
+                              args->name_length,
+                              &archive_path_length);
+
+    if (archive_path == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return E_PARSE_ZIP_FOR_MAIN_OTHER_ERROR;
+    }
+
+    uint64_t files_parsed = 0;
+    const enum parse_zip_for_main_result parse_result =
+        parse_archive(args, archive_path, archive_path_length, &files_parsed);
+
+    free(archive_path);
+    return parse_result;
+}
@@ -0,0 +1,167 @@
+//
+//  src/recurse_jobs.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "recurse_jobs.h"
+
+static void
+parse_job(void *__notnull const job_ptr, void *__notnull const worker_ptr) {
+    struct recurse_job *const job = (struct recurse_job *)job_ptr;
+    struct recurse_jobs_worker *const worker =
+        (struct recurse_jobs_worker *)worker_ptr;
+
+    if (!worker->tbd.filetypes.macho) {
+        job->buffered.result = E_PARSE_MACHO_FOR_MAIN_BUFFERED_NOT_A_MACHO;
+        return;
+    }
+
+    parse_macho_file_for_main_to_buffer(&worker->tbd,
+                                        worker->jobs->orig,
+                                        job->fd,
+                                        &worker->export_trie_sb,
+                                        &job->buffered);
+}
+
+static void commit_job(void *__notnull const job_ptr, void *const info) {
+    struct recurse_job *const job = (struct recurse_job *)job_ptr;
+    struct recurse_jobs *const jobs = (struct recurse_jobs *)info;
+
+    jobs->commit(job, jobs->commit_info);
+
+    free(job->buffered.data);
+    free(job->dir_path);
+
+    close(job->fd);
+}
+
+static void destroy_workers(struct recurse_jobs *__notnull const jobs) {
+    struct recurse_jobs_worker *worker = jobs->workers;
+    const struct recurse_jobs_worker *const end = worker + jobs->worker_count;
+
+    for (; worker != end; worker++) {
+        tbd_for_main_destroy_job_copy(&worker->tbd, jobs->orig);
+        sb_destroy(&worker->export_trie_sb);
+    }
+
+    free(jobs->workers);
+}
+
+enum recurse_jobs_result
+recurse_jobs_create(struct recurse_jobs *__notnull const jobs,
+                    const struct tbd_for_main *__notnull const tbd,
+                    const struct tbd_for_main *__notnull const orig,
+                    const uint32_t worker_count,
+                    const bool will_parse_export_trie,
+                    __notnull const recurse_jobs_commit_callback commit,
+                    void *const commit_info)
+{
+    struct recurse_jobs_worker *const workers =
+        calloc(worker_count, sizeof(*workers));
+
+    if (workers == NULL) {
+        return E_RECURSE_JOBS_ALLOC_FAIL;
+    }
+
+    jobs->orig = orig;
+    jobs->workers = workers;
+    jobs->worker_count = worker_count;
+    jobs->commit = commit;
+    jobs->commit_info = commit_info;
+
+    struct recurse_jobs_worker *worker = workers;
+    const struct recurse_jobs_worker *const end = workers + worker_count;
+
+    for (; worker != end; worker++) {
+        worker->jobs = jobs;
+        tbd_for_main_create_job_copy(&worker->tbd, tbd);
+
+        if (will_parse_export_trie) {
+            const enum string_buffer_result reserve_sb_result =
+                sb_reserve_space(&worker->export_trie_sb, 512);
+
+            if (reserve_sb_result != E_STRING_BUFFER_OK) {
+                destroy_workers(jobs);
+                return E_RECURSE_JOBS_ALLOC_FAIL;
+            }
+        }
+    }
+
+    const enum job_pool_result create_pool_result =
+        job_pool_create(&jobs->pool,
+                        workers,
+                        sizeof(*workers),
+                        worker_count,
+                        sizeof(struct recurse_job),
+                        parse_job,
+                        commit_job,
+                        jobs);
+
+    switch (create_pool_result) {
+        case E_JOB_POOL_OK:
+            break;
+
+        case E_JOB_POOL_ALLOC_FAIL:
+            destroy_workers(jobs);
+            return E_RECURSE_JOBS_ALLOC_FAIL;
+
+        case E_JOB_POOL_THREAD_CREATE_FAIL:
+            destroy_workers(jobs);
+            return E_RECURSE_JOBS_THREAD_CREATE_FAIL;
+    }
+
+    return E_RECURSE_JOBS_OK;
+}
+
+enum recurse_jobs_result
+recurse_jobs_add(struct recurse_jobs *__notnull const jobs,
+                 const char *__notnull const dir_path,
+                 const uint64_t dir_path_length,
+                 const char *__notnull const name,
+                 const uint64_t name_length,
+                 const int fd)
+{
+    /*
+     * Copy the paths as they're only valid for the duration of the
+     * dir_recurse callback.
+     */
+
+    const uint64_t alloc_size = dir_path_length + name_length + 2;
+    char *const paths = malloc(alloc_size);
+
+    if (paths == NULL) {
+        return E_RECURSE_JOBS_ALLOC_FAIL;
+    }
+
+    char *const name_copy = paths + dir_path_length + 1;
+
+    memcpy(paths, dir_path, dir_path_length);
+    memcpy(name_copy, name, name_length);
+
+    paths[dir_path_length] = '\0';
+    name_copy[name_length] = '\0';
+
+    const struct recurse_job job = {
+        .dir_path = paths,
+        .dir_path_length = dir_path_length,
+        .name = name_copy,
+        .name_length = name_length,
+        .fd = fd
+    };
+
+    job_pool_add(&jobs->pool, &job);
+    return E_RECURSE_JOBS_OK;
+}
+
+void recurse_jobs_finish_and_destroy(struct recurse_jobs *__notnull const jobs)
+{
+    job_pool_finish_and_destroy(&jobs->pool);
+    destroy_workers(jobs);
+}
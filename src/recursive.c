@@ -8,9 +8,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include "likely.h"
 #include "our_io.h"
@@ -245,6 +248,355 @@ reverse_mkdir_ignoring_last(char *__notnull const path,
     return 0;
 }
 
+/*
+ * The directories of the output-tree are kept open once found or created, so
+ * that files, and any directories below them, are opened relative to their
+ * deepest cached parent, instead of walking, and trying to create, every
+ * path-component of the full path again.
+ *
+ * Only a limited number of directories are kept open, with the least recently
+ * used directory closed first.
+ */
+
+struct dir_cache_entry {
+    /*
+     * path is NULL for a free entry, or for an entry that was forgotten while
+     * still in use, whose fd is closed once released.
+     */
+
+    char *path;
+    uint64_t path_length;
+
+    int fd;
+
+    uint64_t ref_count;
+    uint64_t last_used;
+};
+
+static struct dir_cache_entry dir_cache[64];
+static uint64_t dir_cache_clock = 0;
+
+static pthread_mutex_t dir_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const uint64_t DIR_CACHE_CAPACITY =
+    sizeof(dir_cache) / sizeof(*dir_cache);
+
+/*
+ * An open directory, either held in the cache, or owned by the caller when
+ * entry is NULL.
+ */
+
+struct dir_handle {
+    int fd;
+    struct dir_cache_entry *entry;
+};
+
+static struct dir_cache_entry *
+dir_cache_find(const char *__notnull const path, const uint64_t length) {
+    struct dir_cache_entry *entry = dir_cache;
+    const struct dir_cache_entry *const end = entry + DIR_CACHE_CAPACITY;
+
+    for (; entry != end; entry++) {
+        if (entry->path == NULL || entry->path_length != length) {
+            continue;
+        }
+
+        if (memcmp(entry->path, path, length) == 0) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Add the directory at path to the cache, evicting the least recently used
+ * directory not in use if the cache is full.
+ *
+ * Returns NULL if the directory couldn't be cached, in which case fd is left
+ * to the caller.
+ */
+
+static struct dir_cache_entry *
+dir_cache_add(const char *__notnull const path,
+              const uint64_t length,
+              const int fd)
+{
+    struct dir_cache_entry *slot = NULL;
+    struct dir_cache_entry *entry = dir_cache;
+
+    const struct dir_cache_entry *const end = entry + DIR_CACHE_CAPACITY;
+    for (; entry != end; entry++) {
+        if (entry->ref_count != 0) {
+            continue;
+        }
+
+        if (entry->path == NULL) {
+            slot = entry;
+            break;
+        }
+
+        if (slot == NULL || entry->last_used < slot->last_used) {
+            slot = entry;
+        }
+    }
+
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    char *const path_copy = malloc(length);
+    if (path_copy == NULL) {
+        return NULL;
+    }
+
+    memcpy(path_copy, path, length);
+
+    if (slot->path != NULL) {
+        close(slot->fd);
+        free(slot->path);
+    }
+
+    slot->path = path_copy;
+    slot->path_length = length;
+    slot->fd = fd;
+    slot->ref_count = 1;
+    slot->last_used = ++dir_cache_clock;
+
+    return slot;
+}
+
+/*
+ * Remove entry from the cache, closing its fd once it's no longer in use.
+ */
+
+static void dir_cache_forget(struct dir_cache_entry *__notnull const entry) {
+    free(entry->path);
+    entry->path = NULL;
+
+    if (entry->ref_count == 0) {
+        close(entry->fd);
+    }
+}
+
+static void dir_cache_forget_all(void) {
+    struct dir_cache_entry *entry = dir_cache;
+    const struct dir_cache_entry *const end = entry + DIR_CACHE_CAPACITY;
+
+    for (; entry != end; entry++) {
+        if (entry->path != NULL) {
+            dir_cache_forget(entry);
+        }
+    }
+}
+
+/*
+ * Must be called with dir_cache_lock held, unless the handle isn't cached.
+ */
+
+static void release_dir_handle(const struct dir_handle *__notnull handle) {
+    struct dir_cache_entry *const entry = handle->entry;
+    if (entry == NULL) {
+        if (handle->fd != AT_FDCWD) {
+            close(handle->fd);
+        }
+
+        return;
+    }
+
+    entry->ref_count -= 1;
+    if (entry->ref_count == 0 && entry->path == NULL) {
+        close(entry->fd);
+    }
+}
+
+static void close_dir_handle(const struct dir_handle *__notnull const handle) {
+    const int error = errno;
+
+    pthread_mutex_lock(&dir_cache_lock);
+    release_dir_handle(handle);
+    pthread_mutex_unlock(&dir_cache_lock);
+
+    errno = error;
+}
+
+/*
+ * Open the directory at the first length characters of path, creating every
+ * directory in its hierarchy not found in the cache.
+ *
+ * first_terminator_out is set to the slash following the first directory that
+ * had to be created, if any were.
+ */
+
+static int
+open_dir_r(char *__notnull const path,
+           const uint64_t length,
+           const mode_t mode,
+           char **const first_terminator_out,
+           struct dir_handle *__notnull const handle_out)
+{
+    pthread_mutex_lock(&dir_cache_lock);
+
+    /*
+     * Find the deepest directory in path's hierarchy that's already cached.
+     */
+
+    struct dir_cache_entry *entry = NULL;
+    uint64_t found_length = length;
+
+    do {
+        entry = dir_cache_find(path, found_length);
+        if (entry != NULL) {
+            break;
+        }
+
+        const char *const slash =
+            find_last_row_of_slashes(path, path + found_length);
+
+        if (slash == NULL || slash == path) {
+            found_length = 0;
+            break;
+        }
+
+        found_length = (uint64_t)(slash - path);
+    } while (true);
+
+    struct dir_handle handle = {
+        .fd = AT_FDCWD,
+        .entry = entry
+    };
+
+    if (entry != NULL) {
+        entry->ref_count += 1;
+        entry->last_used = ++dir_cache_clock;
+
+        handle.fd = entry->fd;
+    }
+
+    /*
+     * The directories below are opened and created without holding the lock,
+     * so other threads aren't kept waiting on our syscalls. The handle we hold
+     * keeps its entry's fd from being closed meanwhile.
+     */
+
+    pthread_mutex_unlock(&dir_cache_lock);
+
+    char *const end = path + length;
+    char *first_terminator = NULL;
+
+    char *iter = path + found_length;
+
+    bool created_parent = false;
+    int ret = 0;
+
+    while (iter != end) {
+        /*
+         * Directories below the first are opened relative to their parent, but
+         * the first keeps any leading slashes, to be opened from the root.
+         */
+
+        char *const name =
+            (handle.fd != AT_FDCWD) ?
+                (char *)get_end_of_slashes_with_end(iter, end) :
+                iter;
+
+        if (name == end) {
+            break;
+        }
+
+        char *slash = memchr(name + 1, '/', (uint64_t)(end - name - 1));
+        if (slash == NULL) {
+            slash = end;
+        }
+
+        terminate_c_str(slash);
+
+        /*
+         * A directory is only created if opening it fails, except below a
+         * directory we just created, where it can't already exist.
+         */
+
+        int fd = -1;
+        if (!created_parent) {
+            fd = our_openat(handle.fd, name, O_RDONLY | O_DIRECTORY);
+        }
+
+        if (created_parent || (fd < 0 && errno == ENOENT)) {
+            created_parent = false;
+
+            if (our_mkdirat(handle.fd, name, mode) == 0) {
+                if (first_terminator == NULL) {
+                    first_terminator = slash;
+                }
+
+                created_parent = true;
+                fd = our_openat(handle.fd, name, O_RDONLY | O_DIRECTORY);
+            } else if (errno == EEXIST) {
+                fd = our_openat(handle.fd, name, O_RDONLY | O_DIRECTORY);
+            }
+        }
+
+        restore_slash_c_str(slash);
+
+        if (fd < 0) {
+            ret = 1;
+            break;
+        }
+
+        /*
+         * Another thread may have cached the same directory while we weren't
+         * holding the lock, in which case we use its entry instead.
+         */
+
+        const uint64_t dir_length = (uint64_t)(slash - path);
+        const struct dir_handle parent = handle;
+
+        pthread_mutex_lock(&dir_cache_lock);
+
+        if (parent.entry != NULL) {
+            release_dir_handle(&parent);
+        }
+
+        struct dir_cache_entry *const cached = dir_cache_find(path, dir_length);
+        if (cached != NULL) {
+            close(fd);
+
+            cached->ref_count += 1;
+            cached->last_used = ++dir_cache_clock;
+
+            handle.fd = cached->fd;
+            handle.entry = cached;
+        } else {
+            handle.fd = fd;
+            handle.entry = dir_cache_add(path, dir_length, fd);
+        }
+
+        pthread_mutex_unlock(&dir_cache_lock);
+
+        /*
+         * A parent that wasn't cached is closed outside of the lock.
+         */
+
+        if (parent.entry == NULL) {
+            release_dir_handle(&parent);
+        }
+
+        iter = slash;
+    }
+
+    if (ret != 0) {
+        close_dir_handle(&handle);
+    } else {
+        *handle_out = handle;
+    }
+
+    if (first_terminator_out != NULL && first_terminator != NULL) {
+        *first_terminator_out = first_terminator;
+    }
+
+    return ret;
+}
+
 int
 open_r(char *__notnull const path,
        const uint64_t length,
@@ -253,32 +605,51 @@ open_r(char *__notnull const path,
        const mode_t dir_mode,
        char **const terminator_out)
 {
-    int fd = our_open(path, O_CREAT | flags, mode);
+    const char *const last_slash = find_last_slash(path, path + length);
+    if (last_slash == NULL) {
+        return our_open(path, O_CREAT | flags, mode);
+    }
+
+    const char *const parent_end = get_front_of_slashes(path, last_slash);
+    if (parent_end == path) {
+        return our_open(path, O_CREAT | flags, mode);
+    }
+
+    const uint64_t parent_length = (uint64_t)(parent_end - path);
+    const char *const name = last_slash + 1;
+
+    struct dir_handle parent = {};
+    if (open_dir_r(path, parent_length, dir_mode, terminator_out, &parent)) {
+        return -1;
+    }
+
+    int fd = our_openat_with_mode(parent.fd, name, O_CREAT | flags, mode);
+    close_dir_handle(&parent);
+
     if (likely(fd >= 0)) {
         return fd;
     }
 
     /*
-     * The only error supported is ENOENT (when a directory in the hierarchy
-     * doesn't exist - which is the whole point of this function).
-     *
-     * Other errors are beyond the scope of this function, and so we error out
-     * immediately.
+     * A cached directory may have been removed since it was opened, in which
+     * case the cache is cleared, and the hierarchy is opened again.
      */
 
-    if (unlikely(errno != ENOENT)) {
+    if (errno != ENOENT || parent.entry == NULL) {
         return -1;
     }
 
-    if (reverse_mkdir_ignoring_last(path, length, dir_mode, terminator_out)) {
-        return -1;
-    }
+    pthread_mutex_lock(&dir_cache_lock);
+    dir_cache_forget_all();
+    pthread_mutex_unlock(&dir_cache_lock);
 
-    fd = our_open(path, O_CREAT | flags, mode);
-    if (unlikely(fd < 0)) {
+    if (open_dir_r(path, parent_length, dir_mode, terminator_out, &parent)) {
         return -1;
     }
 
+    fd = our_openat_with_mode(parent.fd, name, O_CREAT | flags, mode);
+    close_dir_handle(&parent);
+
     return fd;
 }
 
@@ -352,6 +723,21 @@ remove_file_r(char *__notnull const path,
             return 1;
         }
 
+        /*
+         * The removed directory can no longer be found through the cache.
+         */
+
+        const uint64_t dir_length = (uint64_t)(last_slash - path);
+
+        pthread_mutex_lock(&dir_cache_lock);
+
+        struct dir_cache_entry *const entry = dir_cache_find(path, dir_length);
+        if (entry != NULL) {
+            dir_cache_forget(entry);
+        }
+
+        pthread_mutex_unlock(&dir_cache_lock);
+
         last_slash = (char *)find_last_row_of_slashes(path, last_slash);
     } while (last_slash != NULL);
 
@@ -0,0 +1,334 @@
+//
+//  src/result_cache.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "our_io.h"
+#include "path.h"
+#include "result_cache.h"
+#include "write_if_changed.h"
+
+/*
+ * The version of tbd is stored in each entry's key, so that a cache-directory
+ * shared with a tbd built from a different version, which may write out
+ * different .tbds, isn't used to serve the other's entries.
+ *
+ * The Makefile passes the version in TBD_VERSION.
+ */
+
+#ifndef TBD_VERSION
+#define TBD_VERSION "unknown"
+#endif
+
+static const char entry_header_prefix[] = "tbd-result-cache";
+static const char tbd_version[] = TBD_VERSION;
+
+/*
+ * Bump whenever the layout of an entry changes.
+ */
+
+static const uint32_t RESULT_CACHE_FORMAT = 2;
+
+/*
+ * Room for a 16-digit hexadecimal name, followed by ".tbd".
+ */
+
+static const uint64_t ENTRY_NAME_MAX_LENGTH = 24;
+
+static int compare_uuids(const void *const left, const void *const right) {
+    return memcmp(left, right, 16);
+}
+
+bool
+result_cache_key_create(struct result_cache_key *__notnull const key,
+                        const struct macho_file *__notnull const macho,
+                        const uint64_t fingerprint,
+                        const uint32_t create_options)
+{
+    uint8_t *uuids = NULL;
+    uint32_t uuid_count = 0;
+
+    if (!macho_file_read_uuids(macho, &uuids, &uuid_count)) {
+        return false;
+    }
+
+    /*
+     * The same file may have its architectures stored in a different order.
+     */
+
+    qsort(uuids, uuid_count, 16, compare_uuids);
+
+    key->uuids = uuids;
+    key->uuid_count = uuid_count;
+    key->create_options = create_options;
+    key->fingerprint = fingerprint;
+
+    return true;
+}
+
+static void write_hex(char *__notnull dst, const uint8_t *__notnull const src) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i != 16; i++) {
+        *dst++ = digits[src[i] >> 4];
+        *dst++ = digits[src[i] & 0xf];
+    }
+}
+
+/*
+ * Each entry starts with a header-line storing the full key, along with the
+ * entry's format and the version of tbd that wrote it, so that entries whose
+ * names collide are never mistaken for one another.
+ *
+ * As entries are named after the hash of this header-line, a different format
+ * or version of tbd also looks up an entry under a different name.
+ */
+
+static char *
+create_entry_header(const struct result_cache_key *__notnull const key,
+                    uint64_t *__notnull const length_out)
+{
+    const uint64_t max_length =
+        sizeof(entry_header_prefix) + sizeof(tbd_version) + 39 +
+        (33 * (uint64_t)key->uuid_count);
+
+    char *const header = malloc(max_length);
+    if (header == NULL) {
+        return NULL;
+    }
+
+    const int prefix_length =
+        snprintf(header,
+                 max_length,
+                 "%s-v%u %s %08x %016llx",
+                 entry_header_prefix,
+                 RESULT_CACHE_FORMAT,
+                 tbd_version,
+                 key->create_options,
+                 (unsigned long long)key->fingerprint);
+
+    char *iter = header + prefix_length;
+    for (uint32_t i = 0; i != key->uuid_count; i++) {
+        *iter++ = (i == 0) ? ' ' : ',';
+
+        write_hex(iter, key->uuids + (16 * i));
+        iter += 32;
+    }
+
+    *iter++ = '\n';
+
+    *length_out = (uint64_t)(iter - header);
+    return header;
+}
+
+static char *
+create_entry_path(const char *__notnull const dir_path,
+                  const uint64_t dir_path_length,
+                  const char *__notnull const header,
+                  const uint64_t header_length,
+                  uint64_t *__notnull const length_out)
+{
+    /*
+     * Entries are named after the FNV-1a hash of their header.
+     */
+
+    uint64_t hash = 0xcbf29ce484222325;
+    for (uint64_t i = 0; i != header_length; i++) {
+        hash ^= (uint8_t)header[i];
+        hash *= 0x100000001b3;
+    }
+
+    char name[ENTRY_NAME_MAX_LENGTH];
+    const int name_length =
+        snprintf(name,
+                 sizeof(name),
+                 "%016llx.tbd",
+                 (unsigned long long)hash);
+
+    return path_append_component(dir_path,
+                                 dir_path_length,
+                                 name,
+                                 (uint64_t)name_length,
+                                 length_out);
+}
+
+static bool
+read_all(const int fd, char *__notnull buffer, uint64_t size, off_t offset) {
+    while (size != 0) {
+        const ssize_t read_size = our_pread(fd, buffer, size, offset);
+        if (read_size <= 0) {
+            return false;
+        }
+
+        buffer += read_size;
+        size -= (uint64_t)read_size;
+        offset += read_size;
+    }
+
+    return true;
+}
+
+enum result_cache_result
+result_cache_lookup(const char *__notnull const dir_path,
+                    const uint64_t dir_path_length,
+                    const struct result_cache_key *__notnull const key,
+                    char **__notnull const data_out,
+                    size_t *__notnull const size_out)
+{
+    uint64_t header_length = 0;
+    char *const header = create_entry_header(key, &header_length);
+
+    if (header == NULL) {
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    uint64_t path_length = 0;
+    char *const path =
+        create_entry_path(dir_path,
+                          dir_path_length,
+                          header,
+                          header_length,
+                          &path_length);
+
+    if (path == NULL) {
+        free(header);
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    const int fd = our_open(path, O_RDONLY, 0);
+    free(path);
+
+    if (fd < 0) {
+        free(header);
+        return E_RESULT_CACHE_MISS;
+    }
+
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0 || (uint64_t)sbuf.st_size <= header_length) {
+        close(fd);
+        free(header);
+
+        return E_RESULT_CACHE_MISS;
+    }
+
+    char *const found_header = malloc(header_length);
+    if (found_header == NULL) {
+        close(fd);
+        free(header);
+
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    const bool header_matches =
+        read_all(fd, found_header, header_length, 0) &&
+        memcmp(found_header, header, header_length) == 0;
+
+    free(found_header);
+    free(header);
+
+    if (!header_matches) {
+        close(fd);
+        return E_RESULT_CACHE_MISS;
+    }
+
+    const uint64_t size = (uint64_t)sbuf.st_size - header_length;
+    char *const data = malloc(size);
+
+    if (data == NULL) {
+        close(fd);
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    if (!read_all(fd, data, size, (off_t)header_length)) {
+        close(fd);
+        free(data);
+
+        return E_RESULT_CACHE_MISS;
+    }
+
+    close(fd);
+
+    *data_out = data;
+    *size_out = size;
+
+    return E_RESULT_CACHE_OK;
+}
+
+enum result_cache_result
+result_cache_store(const char *__notnull const dir_path,
+                   const uint64_t dir_path_length,
+                   const struct result_cache_key *__notnull const key,
+                   const char *__notnull const data,
+                   const size_t size)
+{
+    uint64_t header_length = 0;
+    char *const header = create_entry_header(key, &header_length);
+
+    if (header == NULL) {
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    uint64_t path_length = 0;
+    char *const path =
+        create_entry_path(dir_path,
+                          dir_path_length,
+                          header,
+                          header_length,
+                          &path_length);
+
+    if (path == NULL) {
+        free(header);
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    const uint64_t entry_size = header_length + size;
+    char *const entry = realloc(header, entry_size);
+
+    if (entry == NULL) {
+        free(header);
+        free(path);
+
+        return E_RESULT_CACHE_ALLOC_FAIL;
+    }
+
+    memcpy(entry + header_length, data, size);
+
+    /*
+     * The entry is renamed into place once fully written out, so processes
+     * storing the same entry at once simply replace one another's identical
+     * copy.
+     */
+
+    const enum write_if_changed_result write_result =
+        write_if_changed(path, path_length, entry, entry_size, false);
+
+    free(entry);
+    free(path);
+
+    switch (write_result) {
+        case E_WRITE_IF_CHANGED_OK:
+        case E_WRITE_IF_CHANGED_UNCHANGED:
+            return E_RESULT_CACHE_OK;
+
+        default:
+            return E_RESULT_CACHE_WRITE_FAIL;
+    }
+}
+
+void result_cache_key_destroy(struct result_cache_key *__notnull const key) {
+    free(key->uuids);
+
+    key->uuids = NULL;
+    key->uuid_count = 0;
+}
@@ -0,0 +1,276 @@
+//
+//  src/tar_writer.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tar_writer.h"
+
+struct ustar_header {
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char checksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+
+static const uint64_t BLOCK_SIZE = 512;
+static const char ZERO_BLOCK[512] = {};
+
+static const char pax_header_name[] = "././@PaxHeader";
+static const char pax_path_keyword[] = " path=";
+
+void
+tar_writer_create(struct tar_writer *__notnull const writer,
+                  FILE *__notnull const file)
+{
+    writer->file = file;
+    writer->mtime = (uint64_t)time(NULL);
+}
+
+/*
+ * Write value in octal, padded with zeros to fill field, which is always
+ * terminated with a null-character.
+ */
+
+static void
+write_octal(char *__notnull const field,
+            const uint64_t field_size,
+            const uint64_t value)
+{
+    snprintf(field,
+             field_size,
+             "%0*llo",
+             (int)(field_size - 1),
+             (unsigned long long)value);
+}
+
+static void
+fill_header(struct ustar_header *__notnull const header,
+            const char typeflag,
+            const uint64_t size,
+            const uint64_t mtime)
+{
+    write_octal(header->mode, sizeof(header->mode), 0644);
+    write_octal(header->uid, sizeof(header->uid), 0);
+    write_octal(header->gid, sizeof(header->gid), 0);
+    write_octal(header->size, sizeof(header->size), size);
+    write_octal(header->mtime, sizeof(header->mtime), mtime);
+
+    header->typeflag = typeflag;
+
+    memcpy(header->magic, "ustar", sizeof(header->magic));
+    memcpy(header->version, "00", sizeof(header->version));
+
+    /*
+     * The checksum is calculated with the checksum-field itself filled with
+     * spaces.
+     */
+
+    memset(header->checksum, ' ', sizeof(header->checksum));
+
+    const unsigned char *const bytes = (const unsigned char *)header;
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i != sizeof(*header); i++) {
+        checksum += bytes[i];
+    }
+
+    snprintf(header->checksum,
+             sizeof(header->checksum),
+             "%06llo",
+             (unsigned long long)checksum);
+
+    header->checksum[sizeof(header->checksum) - 1] = ' ';
+}
+
+static int
+write_data_and_padding(FILE *__notnull const file,
+                       const char *__notnull const data,
+                       const uint64_t size)
+{
+    if (fwrite(data, 1, size, file) != size) {
+        return 1;
+    }
+
+    const uint64_t remainder = size % BLOCK_SIZE;
+    if (remainder == 0) {
+        return 0;
+    }
+
+    const uint64_t padding = BLOCK_SIZE - remainder;
+    if (fwrite(ZERO_BLOCK, 1, padding, file) != padding) {
+        return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * ustar stores a path in two fields, a prefix, and a name, split at a slash,
+ * which together fit paths of up to 256 characters.
+ *
+ * Returns the length of the prefix, or -1 if path can't be split to fit.
+ */
+
+static int64_t
+split_path(const char *__notnull const path, const uint64_t path_length) {
+    const uint64_t name_max = 100;
+    const uint64_t prefix_max = 155;
+
+    if (path_length <= name_max) {
+        return 0;
+    }
+
+    uint64_t index = path_length - 1;
+    if (index > prefix_max) {
+        index = prefix_max;
+    }
+
+    for (; index != 0; index--) {
+        if (path[index] != '/') {
+            continue;
+        }
+
+        const uint64_t name_length = path_length - index - 1;
+        if (name_length == 0 || name_length > name_max) {
+            return -1;
+        }
+
+        return (int64_t)index;
+    }
+
+    return -1;
+}
+
+static uint64_t count_digits(uint64_t value) {
+    uint64_t digits = 1;
+    for (; value >= 10; value /= 10) {
+        digits++;
+    }
+
+    return digits;
+}
+
+/*
+ * Write out a pax extended-header, holding a record of the form
+ * "<length> path=<path>\n", where length includes its own digits.
+ */
+
+static int
+write_pax_path(struct tar_writer *__notnull const writer,
+               const char *__notnull const path,
+               const uint64_t path_length)
+{
+    const uint64_t keyword_length = sizeof(pax_path_keyword) - 1;
+    const uint64_t base_length = keyword_length + path_length + 1;
+
+    uint64_t digits = count_digits(base_length);
+    while (count_digits(base_length + digits) != digits) {
+        digits++;
+    }
+
+    const uint64_t record_length = base_length + digits;
+    char *const record = malloc(record_length + 1);
+
+    if (record == NULL) {
+        return 1;
+    }
+
+    snprintf(record,
+             digits + 1,
+             "%llu",
+             (unsigned long long)record_length);
+
+    char *iter = record + digits;
+
+    memcpy(iter, pax_path_keyword, keyword_length);
+    iter += keyword_length;
+
+    memcpy(iter, path, path_length);
+    iter[path_length] = '\n';
+
+    struct ustar_header header = {};
+    memcpy(header.name, pax_header_name, sizeof(pax_header_name) - 1);
+
+    fill_header(&header, 'x', record_length, writer->mtime);
+
+    FILE *const file = writer->file;
+    int ret = 1;
+
+    if (fwrite(&header, sizeof(header), 1, file) == 1) {
+        ret = write_data_and_padding(file, record, record_length);
+    }
+
+    free(record);
+    return ret;
+}
+
+int
+tar_writer_write_file(struct tar_writer *__notnull const writer,
+                      const char *__notnull const path,
+                      const uint64_t path_length,
+                      const char *__notnull const data,
+                      const uint64_t size)
+{
+    struct ustar_header header = {};
+
+    const int64_t prefix_length = split_path(path, path_length);
+    if (prefix_length < 0) {
+        if (write_pax_path(writer, path, path_length)) {
+            return 1;
+        }
+
+        /*
+         * Readers without pax support still get a usable, if truncated, path.
+         */
+
+        memcpy(header.name, path, sizeof(header.name));
+    } else if (prefix_length == 0) {
+        memcpy(header.name, path, path_length);
+    } else {
+        const uint64_t name_length = path_length - (uint64_t)prefix_length - 1;
+
+        memcpy(header.prefix, path, (uint64_t)prefix_length);
+        memcpy(header.name, path + prefix_length + 1, name_length);
+    }
+
+    fill_header(&header, '0', size, writer->mtime);
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        return 1;
+    }
+
+    return write_data_and_padding(writer->file, data, size);
+}
+
+int tar_writer_finish(struct tar_writer *__notnull const writer) {
+    /*
+     * An archive ends with two blocks of zeros.
+     */
+
+    for (int i = 0; i != 2; i++) {
+        if (fwrite(ZERO_BLOCK, sizeof(ZERO_BLOCK), 1, writer->file) != 1) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
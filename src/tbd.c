@@ -8,11 +8,12 @@
 
 #include <sys/types.h>
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "copy.h"
+#include "arena.h"
 #include "likely.h"
 #include "target_list.h"
 #include "tbd.h"
@@ -384,6 +385,442 @@ tbd_metadata_info_comparator(const void *__notnull const array_item,
     }
 }
 
+/*
+ * The initial capacity of an ingest-table, which is always kept a power of two
+ * so that a hash can be masked into a slot-index.
+ */
+
+static const uint64_t INGEST_TABLE_INITIAL_CAPACITY = 256;
+
+static uint32_t
+hash_string(const char *__notnull const string,
+            const uint64_t length,
+            const uint64_t seed)
+{
+    /*
+     * Use FNV-1a, seeded with the types of the item, so that items of different
+     * types with the same string end up in different slots.
+     */
+
+    uint64_t hash = 14695981039346656037ULL ^ seed;
+
+    const uint8_t *iter = (const uint8_t *)string;
+    const uint8_t *const end = iter + length;
+
+    for (; iter != end; iter++) {
+        hash ^= *iter;
+        hash *= 1099511628211ULL;
+    }
+
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static uint32_t hash_metadata_info(const void *__notnull const item) {
+    const struct tbd_metadata_info *const info =
+        (const struct tbd_metadata_info *)item;
+
+    return hash_string(info->string, info->length, info->type);
+}
+
+static uint32_t hash_symbol_info(const void *__notnull const item) {
+    const struct tbd_symbol_info *const info =
+        (const struct tbd_symbol_info *)item;
+
+    const uint64_t seed = ((uint64_t)info->meta_type << 32) | info->type;
+    return hash_string(info->string, info->length, seed);
+}
+
+/*
+ * Find the slot of item in table, or the empty slot item would be placed in if
+ * it isn't in list.
+ */
+
+static struct tbd_ci_ingest_slot *
+ingest_table_find_slot(const struct tbd_ci_ingest_table *__notnull const table,
+                       const struct array *__notnull const list,
+                       const size_t item_size,
+                       const void *__notnull const item,
+                       const uint32_t hash,
+                       __notnull const array_item_sort_comparator comparator)
+{
+    const uint64_t mask = table->capacity - 1;
+    uint64_t slot_index = hash & mask;
+
+    do {
+        struct tbd_ci_ingest_slot *const slot = table->slots + slot_index;
+        const uint32_t index = slot->index;
+
+        if (index == 0) {
+            return slot;
+        }
+
+        if (slot->hash == hash) {
+            const void *const list_item =
+                array_get_item_at_index_unsafe(list, item_size, index - 1);
+
+            if (comparator(list_item, item) == 0) {
+                return slot;
+            }
+        }
+
+        slot_index = (slot_index + 1) & mask;
+    } while (true);
+}
+
+/*
+ * Grow table, if needed, to keep its load-factor at or below one-half once an
+ * item is added to list.
+ */
+
+static bool
+ingest_table_reserve(struct tbd_ci_ingest_table *__notnull const table,
+                     const struct array *__notnull const list)
+{
+    const uint64_t new_count = list->item_count + 1;
+    if (unlikely(new_count >= UINT32_MAX)) {
+        return false;
+    }
+
+    const uint64_t capacity = table->capacity;
+    if (new_count <= capacity / 2) {
+        return true;
+    }
+
+    uint64_t new_capacity = INGEST_TABLE_INITIAL_CAPACITY;
+    if (capacity != 0) {
+        new_capacity = capacity * 2;
+    }
+
+    while (new_count > new_capacity / 2) {
+        new_capacity *= 2;
+    }
+
+    struct tbd_ci_ingest_slot *const new_slots =
+        calloc(new_capacity, sizeof(*new_slots));
+
+    if (new_slots == NULL) {
+        return false;
+    }
+
+    /*
+     * Every item in list is already in table, so the table is rebuilt by
+     * re-inserting every occupied slot.
+     */
+
+    const uint64_t new_mask = new_capacity - 1;
+    if (capacity != 0) {
+        const struct tbd_ci_ingest_slot *slot = table->slots;
+        const struct tbd_ci_ingest_slot *const end = slot + capacity;
+
+        for (; slot != end; slot++) {
+            if (slot->index == 0) {
+                continue;
+            }
+
+            uint64_t slot_index = slot->hash & new_mask;
+            while (new_slots[slot_index].index != 0) {
+                slot_index = (slot_index + 1) & new_mask;
+            }
+
+            new_slots[slot_index] = *slot;
+        }
+
+        free(table->slots);
+    }
+
+    table->slots = new_slots;
+    table->capacity = new_capacity;
+
+    return true;
+}
+
+static void ingest_table_destroy(struct tbd_ci_ingest_table *__notnull table) {
+    free(table->slots);
+
+    table->slots = NULL;
+    table->capacity = 0;
+}
+
+/*
+ * A lookup records where an item was searched for, so that adding the item
+ * afterwards doesn't have to repeat the search.
+ */
+
+struct list_lookup {
+    struct array_cached_index_info cached_info;
+
+    struct tbd_ci_ingest_slot *slot;
+    uint32_t hash;
+};
+
+typedef uint32_t (*item_hash_func)(const void *__notnull item);
+
+/*
+ * Find item in list, through table if info_in is being ingested (with table
+ * non-null), and otherwise through a binary-search of the sorted list.
+ */
+
+static void *
+find_item(const struct tbd_ci_ingest_table *const table,
+          const struct array *__notnull const list,
+          const size_t item_size,
+          const void *__notnull const item,
+          __notnull const item_hash_func hash_item,
+          __notnull const array_item_sort_comparator comparator,
+          struct list_lookup *__notnull const lookup)
+{
+    if (table == NULL) {
+        return array_find_item_in_sorted(list,
+                                         item_size,
+                                         item,
+                                         comparator,
+                                         &lookup->cached_info);
+    }
+
+    lookup->hash = hash_item(item);
+    if (table->capacity == 0) {
+        return NULL;
+    }
+
+    struct tbd_ci_ingest_slot *const slot =
+        ingest_table_find_slot(table,
+                               list,
+                               item_size,
+                               item,
+                               lookup->hash,
+                               comparator);
+
+    lookup->slot = slot;
+    if (slot->index == 0) {
+        return NULL;
+    }
+
+    return array_get_item_at_index_unsafe(list, item_size, slot->index - 1);
+}
+
+static enum array_result
+add_item(struct tbd_ci_ingest_table *const table,
+         struct array *__notnull const list,
+         const size_t item_size,
+         const void *__notnull const item,
+         __notnull const array_item_sort_comparator comparator,
+         struct list_lookup *__notnull const lookup)
+{
+    if (table == NULL) {
+        return array_add_item_with_cached_index_info(list,
+                                                     item_size,
+                                                     item,
+                                                     &lookup->cached_info,
+                                                     NULL);
+    }
+
+    /*
+     * The slot found by find_item() is no longer valid if the table had to be
+     * grown.
+     */
+
+    const uint64_t capacity = table->capacity;
+    if (!ingest_table_reserve(table, list)) {
+        return E_ARRAY_ALLOC_FAIL;
+    }
+
+    struct tbd_ci_ingest_slot *slot = lookup->slot;
+    if (table->capacity != capacity) {
+        slot =
+            ingest_table_find_slot(table,
+                                   list,
+                                   item_size,
+                                   item,
+                                   lookup->hash,
+                                   comparator);
+    }
+
+    const uint64_t index = list->item_count;
+    const enum array_result add_item_result =
+        array_add_item(list, item_size, item, NULL);
+
+    if (add_item_result != E_ARRAY_OK) {
+        return add_item_result;
+    }
+
+    slot->index = (uint32_t)(index + 1);
+    slot->hash = lookup->hash;
+
+    return E_ARRAY_OK;
+}
+
+static inline struct tbd_ci_ingest_table *
+get_ingest_table(struct tbd_create_info *__notnull const info_in,
+                 struct tbd_ci_ingest_table *__notnull const table)
+{
+    if (!info_in->ingest.is_active) {
+        return NULL;
+    }
+
+    return table;
+}
+
+static struct tbd_metadata_info *
+find_metadata(struct tbd_create_info *__notnull const info_in,
+              const struct tbd_metadata_info *__notnull const info,
+              struct list_lookup *__notnull const lookup)
+{
+    const struct tbd_ci_ingest_table *const table =
+        get_ingest_table(info_in, &info_in->ingest.metadata);
+
+    struct tbd_metadata_info *const existing_info =
+        find_item(table,
+                  &info_in->fields.metadata,
+                  sizeof(*info),
+                  info,
+                  hash_metadata_info,
+                  tbd_metadata_info_no_targets_comparator,
+                  lookup);
+
+    return existing_info;
+}
+
+static enum array_result
+add_metadata(struct tbd_create_info *__notnull const info_in,
+             const struct tbd_metadata_info *__notnull const info,
+             struct list_lookup *__notnull const lookup)
+{
+    struct tbd_ci_ingest_table *const table =
+        get_ingest_table(info_in, &info_in->ingest.metadata);
+
+    struct array *const metadata = &info_in->fields.metadata;
+    const enum array_result add_item_result =
+        add_item(table,
+                 metadata,
+                 sizeof(*info),
+                 info,
+                 tbd_metadata_info_no_targets_comparator,
+                 lookup);
+
+    if (add_item_result != E_ARRAY_OK) {
+        return add_item_result;
+    }
+
+    if (table != NULL) {
+        struct tbd_create_info_ingest *const ingest = &info_in->ingest;
+        if (info->type == TBD_METADATA_TYPE_PARENT_UMBRELLA) {
+            if (ingest->parent_umbrella_index == 0) {
+                ingest->parent_umbrella_index = metadata->item_count;
+            }
+        }
+    }
+
+    return E_ARRAY_OK;
+}
+
+static struct tbd_symbol_info *
+find_symbol(struct tbd_create_info *__notnull const info_in,
+            const struct tbd_symbol_info *__notnull const info,
+            struct list_lookup *__notnull const lookup)
+{
+    const struct tbd_ci_ingest_table *const table =
+        get_ingest_table(info_in, &info_in->ingest.symbols);
+
+    struct tbd_symbol_info *const existing_info =
+        find_item(table,
+                  &info_in->fields.symbols,
+                  sizeof(*info),
+                  info,
+                  hash_symbol_info,
+                  tbd_symbol_info_no_targets_comparator,
+                  lookup);
+
+    return existing_info;
+}
+
+static enum array_result
+add_symbol(struct tbd_create_info *__notnull const info_in,
+           const struct tbd_symbol_info *__notnull const info,
+           struct list_lookup *__notnull const lookup)
+{
+    struct tbd_ci_ingest_table *const table =
+        get_ingest_table(info_in, &info_in->ingest.symbols);
+
+    const enum array_result add_item_result =
+        add_item(table,
+                 &info_in->fields.symbols,
+                 sizeof(*info),
+                 info,
+                 tbd_symbol_info_no_targets_comparator,
+                 lookup);
+
+    return add_item_result;
+}
+
+void tbd_ci_begin_ingesting(struct tbd_create_info *__notnull const info_in) {
+    memset(&info_in->ingest, 0, sizeof(info_in->ingest));
+
+    /*
+     * Items already in info_in's lists would have to be added to the tables
+     * first, so ingestion is only started for empty lists, with info_in
+     * otherwise simply staying sorted throughout.
+     */
+
+    const struct array *const metadata = &info_in->fields.metadata;
+    const struct array *const symbols = &info_in->fields.symbols;
+
+    if (metadata->item_count != 0 || symbols->item_count != 0) {
+        return;
+    }
+
+    info_in->ingest.is_active = true;
+}
+
+static void end_ingesting(struct tbd_create_info *__notnull const info_in) {
+    struct tbd_create_info_ingest *const ingest = &info_in->ingest;
+    if (!ingest->is_active) {
+        return;
+    }
+
+    ingest_table_destroy(&ingest->metadata);
+    ingest_table_destroy(&ingest->symbols);
+
+    ingest->parent_umbrella_index = 0;
+    ingest->is_active = false;
+}
+
+void tbd_ci_finish_ingesting(struct tbd_create_info *__notnull const info_in) {
+    if (!info_in->ingest.is_active) {
+        return;
+    }
+
+    array_sort_with_comparator(&info_in->fields.metadata,
+                               sizeof(struct tbd_metadata_info),
+                               tbd_metadata_info_no_targets_comparator);
+
+    array_sort_with_comparator(&info_in->fields.symbols,
+                               sizeof(struct tbd_symbol_info),
+                               tbd_symbol_info_no_targets_comparator);
+
+    end_ingesting(info_in);
+}
+
+static bool
+create_targets_in_arena(struct arena *__notnull const arena,
+                        struct bit_list *__notnull const targets,
+                        const uint64_t targets_count)
+{
+    const uint64_t size = bit_list_get_buffer_size_for_capacity(targets_count);
+    if (size == 0) {
+        return true;
+    }
+
+    uint64_t *const buffer = arena_alloc(arena, size);
+    if (unlikely(buffer == NULL)) {
+        return false;
+    }
+
+    memset(buffer, 0, size);
+    bit_list_create_with_buffer(targets, buffer);
+
+    return true;
+}
+
 static enum tbd_ci_add_data_result
 add_metadata_with_type(struct tbd_create_info *__notnull const info_in,
                        const char *__notnull const string,
@@ -398,13 +835,9 @@ add_metadata_with_type(struct tbd_create_info *__notnull const info_in,
         .type = type,
     };
 
-    struct array_cached_index_info cached_info = {};
+    struct list_lookup lookup = {};
     struct tbd_metadata_info *const existing_info =
-        array_find_item_in_sorted(&info_in->fields.metadata,
-                                  sizeof(info),
-                                  &info,
-                                  tbd_metadata_info_no_targets_comparator,
-                                  &cached_info);
+        find_metadata(info_in, &info, &lookup);
 
     if (existing_info != NULL) {
         if (options.ignore_targets) {
@@ -415,7 +848,9 @@ add_metadata_with_type(struct tbd_create_info *__notnull const info_in,
         return E_TBD_CI_ADD_DATA_OK;
     }
 
-    info.string = alloc_and_copy(info.string, info.length);
+    struct arena *const arena = &info_in->arena;
+
+    info.string = arena_alloc_and_copy(arena, info.string, info.length);
     if (unlikely(info.string == NULL)) {
         return E_TBD_CI_ADD_DATA_ALLOC_FAIL;
     }
@@ -425,11 +860,7 @@ add_metadata_with_type(struct tbd_create_info *__notnull const info_in,
     }
 
     const uint64_t targets_count = info_in->fields.targets.set_count;
-    const enum bit_list_result create_bits_result =
-        bit_list_create_with_capacity(&info.targets, targets_count);
-
-    if (create_bits_result != E_BIT_LIST_OK) {
-        free(info.string);
+    if (!create_targets_in_arena(arena, &info.targets, targets_count)) {
         return E_TBD_CI_ADD_DATA_ALLOC_FAIL;
     }
 
@@ -439,30 +870,36 @@ add_metadata_with_type(struct tbd_create_info *__notnull const info_in,
         bit_list_set_bit(&info.targets, bit_index);
     }
 
-    struct array *const metadata = &info_in->fields.metadata;
     const enum array_result add_export_info_result =
-        array_add_item_with_cached_index_info(metadata,
-                                              sizeof(info),
-                                              &info,
-                                              &cached_info,
-                                              NULL);
+        add_metadata(info_in, &info, &lookup);
 
     if (unlikely(add_export_info_result != E_ARRAY_OK)) {
-        free(info.string);
         return E_TBD_CI_ADD_DATA_ARRAY_FAIL;
     }
 
     return E_TBD_CI_ADD_DATA_OK;
 }
 
-static const struct tbd_metadata_info *
-get_parent_umbrella(struct array *__notnull const list) {
+static struct tbd_metadata_info *
+get_parent_umbrella(const struct tbd_create_info *__notnull const info_in) {
+    const struct array *const list = &info_in->fields.metadata;
+    if (info_in->ingest.is_active) {
+        const uint64_t index = info_in->ingest.parent_umbrella_index;
+        if (index == 0) {
+            return NULL;
+        }
+
+        return array_get_item_at_index_unsafe(list,
+                                              sizeof(struct tbd_metadata_info),
+                                              index - 1);
+    }
+
     if (list->item_count == 0) {
         return NULL;
     }
 
-    const struct tbd_metadata_info *const item =
-        (const struct tbd_metadata_info *)list->data;
+    struct tbd_metadata_info *const item =
+        (struct tbd_metadata_info *)list->data;
 
     if (item->type != TBD_METADATA_TYPE_PARENT_UMBRELLA) {
         return NULL;
@@ -484,7 +921,7 @@ tbd_ci_add_parent_umbrella(struct tbd_create_info *__notnull const info_in,
 
     if (tbd_uses_archs(info_in->version)) {
         const struct tbd_metadata_info *const parent_umbrella =
-            get_parent_umbrella(&info_in->fields.metadata);
+            get_parent_umbrella(info_in);
 
         if (parent_umbrella != NULL) {
             if (parent_umbrella->length != length) {
@@ -523,19 +960,7 @@ struct tbd_metadata_info *
 tbd_ci_get_single_parent_umbrella(
     const struct tbd_create_info *__notnull const info_in)
 {
-    const struct array *const metadata = &info_in->fields.metadata;
-    if (metadata->item_count == 0) {
-        return NULL;
-    }
-
-    struct tbd_metadata_info *const umbrella_info =
-        (struct tbd_metadata_info *)metadata->data;
-
-    if (umbrella_info->type != TBD_METADATA_TYPE_PARENT_UMBRELLA) {
-        return NULL;
-    }
-
-    return umbrella_info;
+    return get_parent_umbrella(info_in);
 }
 
 void
@@ -561,14 +986,15 @@ tbd_ci_get_single_platform(const struct tbd_create_info *__notnull const info) {
     return platform;
 }
 
-enum tbd_ci_add_data_result
-tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
-                            const char *__notnull const string,
-                            const uint64_t length,
-                            const uint64_t arch_index,
-                            const enum tbd_symbol_type type,
-                            enum tbd_symbol_meta_type meta_type,
-                            const struct tbd_parse_options options)
+static enum tbd_ci_add_data_result
+add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
+                     const char *__notnull const string,
+                     const uint64_t length,
+                     const uint64_t arch_index,
+                     const enum tbd_symbol_type type,
+                     enum tbd_symbol_meta_type meta_type,
+                     const bool copy_string,
+                     const struct tbd_parse_options options)
 {
     const enum tbd_version version = info_in->version;
     switch (version) {
@@ -672,13 +1098,9 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
         .meta_type = meta_type
     };
 
-    struct array_cached_index_info cached_info = {};
+    struct list_lookup lookup = {};
     struct tbd_symbol_info *const existing_info =
-        array_find_item_in_sorted(&info_in->fields.symbols,
-                                  sizeof(symbol_info),
-                                  &symbol_info,
-                                  tbd_symbol_info_no_targets_comparator,
-                                  &cached_info);
+        find_symbol(info_in, &symbol_info, &lookup);
 
     if (existing_info != NULL) {
         if (options.ignore_targets) {
@@ -689,9 +1111,19 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
         return E_TBD_CI_ADD_DATA_OK;
     }
 
-    symbol_info.string = alloc_and_copy(symbol_info.string, symbol_info.length);
-    if (unlikely(symbol_info.string == NULL)) {
-        return E_TBD_CI_ADD_DATA_ALLOC_FAIL;
+    /*
+     * A borrowed string is not owned by info_in, and is simply left behind
+     * once info_in's arena is reset.
+     */
+
+    struct arena *const arena = &info_in->arena;
+    if (copy_string) {
+        symbol_info.string =
+            arena_alloc_and_copy(arena, symbol_info.string, symbol_info.length);
+
+        if (unlikely(symbol_info.string == NULL)) {
+            return E_TBD_CI_ADD_DATA_ALLOC_FAIL;
+        }
     }
 
     if (yaml_c_str_needs_quotes(string, length)) {
@@ -699,11 +1131,7 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
     }
 
     const uint64_t targets_count = info_in->fields.targets.set_count;
-    const enum bit_list_result create_bits_result =
-        bit_list_create_with_capacity(&symbol_info.targets, targets_count);
-
-    if (create_bits_result != E_BIT_LIST_OK) {
-        free(symbol_info.string);
+    if (!create_targets_in_arena(arena, &symbol_info.targets, targets_count)) {
         return E_TBD_CI_ADD_DATA_ALLOC_FAIL;
     }
 
@@ -714,14 +1142,9 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
     }
 
     const enum array_result add_export_info_result =
-        array_add_item_with_cached_index_info(&info_in->fields.symbols,
-                                              sizeof(symbol_info),
-                                              &symbol_info,
-                                              &cached_info,
-                                              NULL);
+        add_symbol(info_in, &symbol_info, &lookup);
 
     if (unlikely(add_export_info_result != E_ARRAY_OK)) {
-        free(symbol_info.string);
         return E_TBD_CI_ADD_DATA_ARRAY_FAIL;
     }
 
@@ -729,6 +1152,28 @@ tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
 }
 
 
+enum tbd_ci_add_data_result
+tbd_ci_add_symbol_with_type(struct tbd_create_info *__notnull const info_in,
+                            const char *__notnull const string,
+                            const uint64_t length,
+                            const uint64_t arch_index,
+                            const enum tbd_symbol_type type,
+                            const enum tbd_symbol_meta_type meta_type,
+                            const struct tbd_parse_options options)
+{
+    const enum tbd_ci_add_data_result add_symbol_result =
+        add_symbol_with_type(info_in,
+                             string,
+                             length,
+                             arch_index,
+                             type,
+                             meta_type,
+                             true,
+                             options);
+
+    return add_symbol_result;
+}
+
 /*
  * We compare strings by using the largest possible byte size when reading from
  * memory to maximize our performance.
@@ -939,11 +1384,18 @@ tbd_ci_add_symbol_with_info(struct tbd_create_info *__notnull const info_in,
                             const enum tbd_symbol_type predefined_type,
                             const enum tbd_symbol_meta_type meta_type,
                             const bool is_exported,
+                            const bool copy_string,
                             const struct tbd_parse_options options)
 {
     uint64_t length = 0;
     enum tbd_symbol_type type = TBD_SYMBOL_TYPE_NORMAL;
 
+    /*
+     * Every branch below bounds the string by the end of the provided range.
+     */
+
+    const char *const range_end = string + lnmax;
+
     /*
      * We can skip calls to is_objc_*_symbol if the symbol's max-length
      * disqualifies the symbol from being an objc symbol.
@@ -1042,14 +1494,21 @@ tbd_ci_add_symbol_with_info(struct tbd_create_info *__notnull const info_in,
         type = predefined_type;
     }
 
+    /*
+     * The string can only be borrowed if its null-terminator is within the
+     * provided range.
+     */
+
+    const bool is_terminated = (string + length != range_end);
     const enum tbd_ci_add_data_result add_symbol_result =
-        tbd_ci_add_symbol_with_type(info_in,
-                                    string,
-                                    length,
-                                    arch_index,
-                                    type,
-                                    meta_type,
-                                    options);
+        add_symbol_with_type(info_in,
+                             string,
+                             length,
+                             arch_index,
+                             type,
+                             meta_type,
+                             copy_string || !is_terminated,
+                             options);
 
     if (add_symbol_result != E_TBD_CI_ADD_DATA_OK) {
         return add_symbol_result;
@@ -1211,6 +1670,8 @@ void tbd_ci_sort_info(struct tbd_create_info *__notnull const info_in) {
     array_sort_with_comparator(&info_in->fields.symbols,
                                sizeof(struct tbd_symbol_info),
                                tbd_symbol_info_targets_comparator);
+
+    end_ingesting(info_in);
 }
 
 static bool
@@ -1263,11 +1724,11 @@ tbd_ci_add_uuid(struct tbd_create_info *__notnull const info_in,
 
 enum tbd_create_result
 tbd_create_with_info(const struct tbd_create_info *__notnull const info,
-                     FILE *__notnull const file,
+                     struct yaml_emitter *__notnull const emitter,
                      const struct tbd_create_options options)
 {
     const enum tbd_version version = info->version;
-    if (tbd_write_magic(file, version)) {
+    if (tbd_write_magic(emitter, version)) {
         return E_TBD_CREATE_WRITE_FAIL;
     }
 
@@ -1275,11 +1736,11 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
     const bool uses_archs = tbd_uses_archs(version);
 
     if (!uses_archs) {
-        if (tbd_write_targets_for_header(file, targets, version)) {
+        if (tbd_write_targets_for_header(emitter, targets, version)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     } else {
-        if (tbd_write_archs_for_header(file, targets)) {
+        if (tbd_write_archs_for_header(emitter, targets)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
@@ -1287,34 +1748,34 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
     if (!options.ignore_uuids) {
         const struct array *const uuids = &info->fields.uuids;
         if (!uses_archs) {
-            if (tbd_write_uuids_for_targets(file, uuids, version)) {
+            if (tbd_write_uuids_for_targets(emitter, uuids, version)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         } else if (version != TBD_VERSION_V1) {
-            if (tbd_write_uuids_for_archs(file, uuids)) {
+            if (tbd_write_uuids_for_archs(emitter, uuids)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         }
     }
 
     if (uses_archs) {
-        if (tbd_write_platform(file, info, version)) {
+        if (tbd_write_platform(emitter, info, version)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
 
     if (version != TBD_VERSION_V1 && !options.ignore_flags) {
-        if (tbd_write_flags(file, info->fields.flags)) {
+        if (tbd_write_flags(emitter, info->fields.flags)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
 
-    if (tbd_write_install_name(file, info)) {
+    if (tbd_write_install_name(emitter, info)) {
         return E_TBD_CREATE_WRITE_FAIL;
     }
 
     if (!options.ignore_current_version) {
-        if (tbd_write_current_version(file, info->fields.current_version)) {
+        if (tbd_write_current_version(emitter, info->fields.current_version)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
@@ -1323,7 +1784,7 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
         const uint32_t compatibility_version =
             info->fields.compatibility_version;
 
-        if (tbd_write_compatibility_version(file, compatibility_version)) {
+        if (tbd_write_compatibility_version(emitter, compatibility_version)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
@@ -1331,7 +1792,7 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
     if (version != TBD_VERSION_V1) {
         if (!options.ignore_swift_version) {
             const uint32_t swift_version = info->fields.swift_version;
-            if (tbd_write_swift_version(file, version, swift_version)) {
+            if (tbd_write_swift_version(emitter, version, swift_version)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         }
@@ -1341,13 +1802,13 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
                 const enum tbd_objc_constraint objc_constraint =
                     info->fields.archs.objc_constraint;
 
-                if (tbd_write_objc_constraint(file, objc_constraint)) {
+                if (tbd_write_objc_constraint(emitter, objc_constraint)) {
                     return E_TBD_CREATE_WRITE_FAIL;
                 }
             }
 
             if (!options.ignore_parent_umbrellas) {
-                if (tbd_write_parent_umbrella_for_archs(file, info)) {
+                if (tbd_write_parent_umbrella_for_archs(emitter, info)) {
                     return E_TBD_CREATE_WRITE_FAIL;
                 }
             }
@@ -1356,36 +1817,36 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
 
     if (!uses_archs) {
         if (info->flags.uses_full_targets) {
-            if (tbd_write_metadata_with_full_targets(file, info, options)) {
+            if (tbd_write_metadata_with_full_targets(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
 
-            if (tbd_write_symbols_with_full_targets(file, info, options)) {
+            if (tbd_write_symbols_with_full_targets(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         } else {
-            if (tbd_write_metadata(file, info, options)) {
+            if (tbd_write_metadata(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
 
-            if (tbd_write_symbols_for_targets(file, info, options)) {
+            if (tbd_write_symbols_for_targets(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         }
     } else {
         if (info->flags.uses_full_targets) {
-            if (tbd_write_symbols_with_full_archs(file, info, options)) {
+            if (tbd_write_symbols_with_full_archs(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         } else {
-            if (tbd_write_symbols_for_archs(file, info, options)) {
+            if (tbd_write_symbols_for_archs(emitter, info, options)) {
                 return E_TBD_CREATE_WRITE_FAIL;
             }
         }
     }
 
     if (!options.ignore_footer) {
-        if (tbd_write_footer(file)) {
+        if (tbd_write_footer(emitter)) {
             return E_TBD_CREATE_WRITE_FAIL;
         }
     }
@@ -1393,30 +1854,6 @@ tbd_create_with_info(const struct tbd_create_info *__notnull const info,
     return E_TBD_CREATE_OK;
 }
 
-static void clear_metadata_array(struct array *__notnull const list) {
-    struct tbd_metadata_info *info = list->data;
-    const struct tbd_metadata_info *const end = list->data_end;
-
-    for (; info != end; info++) {
-        bit_list_destroy(&info->targets);
-        free(info->string);
-    }
-
-    array_clear(list);
-}
-
-static void clear_symbols_array(struct array *__notnull const list) {
-    struct tbd_symbol_info *info = list->data;
-    const struct tbd_symbol_info *const end = list->data_end;
-
-    for (; info != end; info++) {
-        bit_list_destroy(&info->targets);
-        free(info->string);
-    }
-
-    array_clear(list);
-}
-
 void
 tbd_create_info_clear_fields_and_create_from(
     struct tbd_create_info *__notnull const dst,
@@ -1426,10 +1863,18 @@ tbd_create_info_clear_fields_and_create_from(
         free((char *)dst->fields.install_name);
     }
 
-    clear_metadata_array(&dst->fields.metadata);
-    clear_symbols_array(&dst->fields.symbols);
+    /*
+     * Every string and heap bit-list of the metadata and symbols are freed at
+     * once by resetting the arena.
+     */
+
+    array_clear(&dst->fields.metadata);
+    array_clear(&dst->fields.symbols);
     array_clear(&dst->fields.uuids);
 
+    arena_reset(&dst->arena);
+    end_ingesting(dst);
+
     const struct array metadata = dst->fields.metadata;
     const struct array symbols = dst->fields.symbols;
     const struct array uuids = dst->fields.uuids;
@@ -1442,28 +1887,221 @@ tbd_create_info_clear_fields_and_create_from(
     dst->fields.uuids = uuids;
 }
 
-static void destroy_metadata_array(struct array *__notnull const list) {
-    struct tbd_metadata_info *info = list->data;
-    const struct tbd_metadata_info *const end = list->data_end;
+static void
+merge_targets(struct bit_list *__notnull const targets,
+              const struct bit_list other,
+              const uint64_t targets_count)
+{
+    for (uint64_t i = 0; i != targets_count; i++) {
+        if (bit_list_get_for_index(other, i) != 0) {
+            bit_list_set_bit(targets, i);
+        }
+    }
+}
+
+/*
+ * A sorted list being merged, with iter pointing to its next item.
+ */
+
+struct merge_list {
+    const void *iter;
+    const void *end;
+};
+
+static void
+create_merge_list(struct merge_list *__notnull const list,
+                  const struct array *__notnull const array)
+{
+    list->iter = array->data;
+    list->end = array->data_end;
+}
+
+/*
+ * Merge the sorted lists into a single sorted list in one pass, by repeatedly
+ * taking the least next-item of every list, and merging in the targets of any
+ * equal next-items of the lists that follow.
+ *
+ * Each list must be sorted with comparator, and have no duplicate items of its
+ * own, so an item is found at most once in every list.
+ */
+
+static enum tbd_ci_add_data_result
+merge_sorted_lists(struct array *__notnull const merged,
+                   struct merge_list *__notnull const lists,
+                   const uint64_t lists_count,
+                   const size_t item_size,
+                   const size_t targets_offset,
+                   const array_item_sort_comparator comparator,
+                   const uint64_t targets_count)
+{
+    struct merge_list *const end = lists + lists_count;
+    uint64_t total_count = 0;
+
+    for (const struct merge_list *list = lists; list != end; list++) {
+        total_count += (uint64_t)(list->end - list->iter) / item_size;
+    }
+
+    const enum array_result ensure_capacity_result =
+        array_ensure_item_capacity(merged, item_size, total_count);
+
+    if (unlikely(ensure_capacity_result != E_ARRAY_OK)) {
+        return E_TBD_CI_ADD_DATA_ARRAY_FAIL;
+    }
+
+    do {
+        /*
+         * On a tie, the earliest list is picked, so equal items can only be
+         * found in the lists after it.
+         */
+
+        struct merge_list *least = NULL;
+        for (struct merge_list *list = lists; list != end; list++) {
+            if (list->iter == list->end) {
+                continue;
+            }
+
+            if (least == NULL || comparator(list->iter, least->iter) < 0) {
+                least = list;
+            }
+        }
+
+        if (least == NULL) {
+            break;
+        }
+
+        void *item = NULL;
+        const enum array_result add_item_result =
+            array_add_item(merged, item_size, least->iter, &item);
+
+        if (unlikely(add_item_result != E_ARRAY_OK)) {
+            return E_TBD_CI_ADD_DATA_ARRAY_FAIL;
+        }
+
+        least->iter += item_size;
+
+        struct bit_list *const targets = item + targets_offset;
+        for (struct merge_list *list = least + 1; list != end; list++) {
+            if (list->iter == list->end) {
+                continue;
+            }
+
+            if (comparator(list->iter, item) != 0) {
+                continue;
+            }
+
+            const struct bit_list *const other = list->iter + targets_offset;
+
+            merge_targets(targets, *other, targets_count);
+            list->iter += item_size;
+        }
+    } while (true);
+
+    return E_TBD_CI_ADD_DATA_OK;
+}
+
+static enum tbd_ci_add_data_result
+merge_metadata_lists(struct tbd_create_info *__notnull const info_in,
+                     struct tbd_create_info *__notnull *__notnull const others,
+                     const uint64_t count,
+                     struct merge_list *__notnull const lists)
+{
+    create_merge_list(lists, &info_in->fields.metadata);
+    for (uint64_t i = 0; i != count; i++) {
+        create_merge_list(lists + i + 1, &others[i]->fields.metadata);
+    }
+
+    struct array merged = {};
+    const enum tbd_ci_add_data_result merge_result =
+        merge_sorted_lists(&merged,
+                           lists,
+                           count + 1,
+                           sizeof(struct tbd_metadata_info),
+                           offsetof(struct tbd_metadata_info, targets),
+                           tbd_metadata_info_no_targets_comparator,
+                           info_in->fields.targets.set_count);
 
-    for (; info != end; info++) {
-        bit_list_destroy(&info->targets);
-        free(info->string);
+    if (merge_result != E_TBD_CI_ADD_DATA_OK) {
+        array_destroy(&merged);
+        return merge_result;
     }
 
-    array_destroy(list);
+    array_destroy(&info_in->fields.metadata);
+    info_in->fields.metadata = merged;
+
+    return E_TBD_CI_ADD_DATA_OK;
 }
 
-static void destroy_symbols_array(struct array *__notnull const list) {
-    struct tbd_symbol_info *info = list->data;
-    const struct tbd_symbol_info *const end = list->data_end;
+static enum tbd_ci_add_data_result
+merge_symbols_lists(struct tbd_create_info *__notnull const info_in,
+                    struct tbd_create_info *__notnull *__notnull const others,
+                    const uint64_t count,
+                    struct merge_list *__notnull const lists)
+{
+    create_merge_list(lists, &info_in->fields.symbols);
+    for (uint64_t i = 0; i != count; i++) {
+        create_merge_list(lists + i + 1, &others[i]->fields.symbols);
+    }
 
-    for (; info != end; info++) {
-        bit_list_destroy(&info->targets);
-        free(info->string);
+    struct array merged = {};
+    const enum tbd_ci_add_data_result merge_result =
+        merge_sorted_lists(&merged,
+                           lists,
+                           count + 1,
+                           sizeof(struct tbd_symbol_info),
+                           offsetof(struct tbd_symbol_info, targets),
+                           tbd_symbol_info_no_targets_comparator,
+                           info_in->fields.targets.set_count);
+
+    if (merge_result != E_TBD_CI_ADD_DATA_OK) {
+        array_destroy(&merged);
+        return merge_result;
     }
 
-    array_destroy(list);
+    array_destroy(&info_in->fields.symbols);
+    info_in->fields.symbols = merged;
+
+    return E_TBD_CI_ADD_DATA_OK;
+}
+
+enum tbd_ci_add_data_result
+tbd_ci_merge_data(struct tbd_create_info *__notnull const info_in,
+                  struct tbd_create_info *__notnull *__notnull const others,
+                  const uint64_t count)
+{
+    /*
+     * Rather than looking up and inserting every item of others one at a time,
+     * every list is sorted the same way, and merged in a single pass.
+     *
+     * The strings and heap bit-lists of others' items are all moved over with
+     * their arenas.
+     */
+
+    tbd_ci_finish_ingesting(info_in);
+    for (uint64_t i = 0; i != count; i++) {
+        tbd_ci_finish_ingesting(others[i]);
+        arena_move(&info_in->arena, &others[i]->arena);
+    }
+
+    enum tbd_ci_add_data_result ret = E_TBD_CI_ADD_DATA_OK;
+    struct merge_list *const lists = calloc(count + 1, sizeof(*lists));
+
+    if (unlikely(lists == NULL)) {
+        ret = E_TBD_CI_ADD_DATA_ALLOC_FAIL;
+    } else {
+        ret = merge_metadata_lists(info_in, others, count, lists);
+        if (ret == E_TBD_CI_ADD_DATA_OK) {
+            ret = merge_symbols_lists(info_in, others, count, lists);
+        }
+
+        free(lists);
+    }
+
+    for (uint64_t i = 0; i != count; i++) {
+        array_destroy(&others[i]->fields.metadata);
+        array_destroy(&others[i]->fields.symbols);
+    }
+
+    return ret;
 }
 
 void tbd_create_info_destroy(struct tbd_create_info *__notnull const info) {
@@ -1471,8 +2109,11 @@ void tbd_create_info_destroy(struct tbd_create_info *__notnull const info) {
         free((char *)info->fields.install_name);
     }
 
-    destroy_metadata_array(&info->fields.metadata);
-    destroy_symbols_array(&info->fields.symbols);
+    array_destroy(&info->fields.metadata);
+    array_destroy(&info->fields.symbols);
+
+    arena_destroy(&info->arena);
+    end_ingesting(info);
 
     target_list_destroy(&info->fields.targets);
     array_destroy(&info->fields.uuids);
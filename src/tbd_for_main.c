@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "compressed_file.h"
+#include "copy.h"
 #include "macho_file.h"
 #include "parse_or_list_fields.h"
 
@@ -22,7 +24,10 @@
 #include "recursive.h"
 #include "tbd.h"
 #include "tbd_for_main.h"
+#include "tbd_write.h"
+#include "write_if_changed.h"
 #include "yaml.h"
+#include "yaml_emitter.h"
 
 static void
 add_image_filter(int *__notnull const index_in,
@@ -226,6 +231,109 @@ tbd_for_main_parse_option(int *const __notnull index_in,
         tbd->options.ignore_warnings = true;
     } else if (strcmp(option, "ignore-wrong-filetype") == 0) {
         tbd->macho_options.ignore_wrong_filetype = true;
+    } else if (strcmp(option, "cache-dir") == 0) {
+        index += 1;
+        if (index == argc) {
+            fputs("Please provide a directory to cache created .tbd files in\n",
+                  stderr);
+
+            exit(1);
+        }
+
+        const char *const argument = argv[index];
+        const uint64_t length = strlen(argument);
+
+        char *const cache_dir_path = alloc_and_copy(argument, length);
+        if (cache_dir_path == NULL) {
+            fputs("Failed to allocate memory\n", stderr);
+            exit(1);
+        }
+
+        free(tbd->cache_dir_path);
+
+        tbd->cache_dir_path = cache_dir_path;
+        tbd->cache_dir_path_length = length;
+    } else if (strcmp(option, "dsc-drop-pages") == 0) {
+        tbd->dsc_image_options.drop_pages = true;
+    } else if (strcmp(option, "dsc-previous-cache") == 0) {
+        index += 1;
+        if (index == argc) {
+            fputs("Please provide the path of the previous dyld_shared_cache "
+                  "file to compare against\n",
+                  stderr);
+
+            exit(1);
+        }
+
+        const char *const argument = argv[index];
+        const uint64_t length = strlen(argument);
+
+        char *const previous_path = alloc_and_copy(argument, length);
+        if (previous_path == NULL) {
+            fputs("Failed to allocate memory\n", stderr);
+            exit(1);
+        }
+
+        free(tbd->dsc_previous_path);
+        tbd->dsc_previous_path = previous_path;
+    } else if (strcmp(option, "dsc-merge-cache") == 0) {
+        index += 1;
+        if (index == argc) {
+            fputs("Please provide the path of a dyld_shared_cache file to "
+                  "merge images from\n",
+                  stderr);
+
+            exit(1);
+        }
+
+        const char *const merge_path = argv[index];
+        const enum array_result add_path_result =
+            array_add_item(&tbd->dsc_merge_paths,
+                           sizeof(merge_path),
+                           &merge_path,
+                           NULL);
+
+        if (add_path_result != E_ARRAY_OK) {
+            fprintf(stderr,
+                    "Experienced an array failure trying to add "
+                    "dyld_shared_cache to merge %s\n",
+                    merge_path);
+
+            exit(1);
+        }
+    } else if (strcmp(option, "dsc-memory-limit") == 0) {
+        index += 1;
+        if (index == argc) {
+            fputs("Please provide the number of megabytes of dyld_shared_cache "
+                  "files to map at once\n",
+                  stderr);
+
+            exit(1);
+        }
+
+        const char *const argument = argv[index];
+
+        char *end = NULL;
+        const unsigned long long megabytes = strtoull(argument, &end, 10);
+
+        if (*end != '\0' || megabytes == 0) {
+            fprintf(stderr,
+                    "A dyld_shared_cache memory-limit of \"%s\" is invalid\n",
+                    argument);
+
+            exit(1);
+        }
+
+        if (megabytes > (UINT64_MAX >> 20)) {
+            fprintf(stderr,
+                    "A dyld_shared_cache memory-limit of \"%s\" is too large "
+                    "to be valid\n",
+                    argument);
+
+            exit(1);
+        }
+
+        tbd->dsc_mapped_size_limit = (uint64_t)megabytes << 20;
     } else if (strcmp(option, "filter-image-directory") == 0) {
         add_image_filter(&index, tbd, argc, argv, true);
     } else if (strcmp(option, "filter-image-filename") == 0) {
@@ -248,6 +356,41 @@ tbd_for_main_parse_option(int *const __notnull index_in,
 
         tbd->filetypes.macho = true;
         tbd->filetypes.user_provided = true;
+    } else if (strcmp(option, "zip") == 0) {
+        if (!tbd->filetypes.user_provided) {
+            tbd->filetypes.value = 0;
+        }
+
+        tbd->filetypes.zip = true;
+        tbd->filetypes.user_provided = true;
+    } else if (strcmp(option, "j") == 0 || strcmp(option, "jobs") == 0) {
+        index += 1;
+        if (index == argc) {
+            fputs("Please provide the number of jobs to parse files with\n",
+                  stderr);
+
+            exit(1);
+        }
+
+        const char *const argument = argv[index];
+
+        char *end = NULL;
+        const unsigned long jobs = strtoul(argument, &end, 10);
+
+        if (*end != '\0' || jobs == 0) {
+            fprintf(stderr, "A job-count of \"%s\" is invalid\n", argument);
+            exit(1);
+        }
+
+        if (jobs > UINT32_MAX) {
+            fprintf(stderr,
+                    "A job-count of \"%s\" is too large to be valid\n",
+                    argument);
+
+            exit(1);
+        }
+
+        tbd->jobs_count = (uint32_t)jobs;
     } else if (strcmp(option, "r") == 0 || strcmp(option, "recurse") == 0) {
         tbd->options.recurse_directories = true;
 
@@ -770,6 +913,22 @@ tbd_for_main_create_dsc_folder_path(
     return write_path;
 }
 
+FILE *
+tbd_for_main_open_output_stream(
+    const struct tbd_for_main *__notnull const tbd,
+    FILE *__notnull const file,
+    const bool close_file)
+{
+    enum compressed_file_format format = COMPRESSED_FILE_FORMAT_GZIP;
+    if (tbd->options.zstd_output) {
+        format = COMPRESSED_FILE_FORMAT_ZSTD;
+    } else if (!tbd->options.gzip_output) {
+        return file;
+    }
+
+    return compressed_file_open(file, format, tbd->jobs_count, close_file);
+}
+
 enum tbd_for_main_open_write_file_result
 tbd_for_main_open_write_file_for_path(
     const struct tbd_for_main *__notnull const tbd,
@@ -818,12 +977,65 @@ tbd_for_main_open_write_file_for_path(
         return E_TBD_FOR_MAIN_OPEN_WRITE_FILE_FAILED;
     }
 
-    *file_out = file;
+    FILE *const stream = tbd_for_main_open_output_stream(tbd, file, true);
+    if (stream == NULL) {
+        fclose(file);
+        return E_TBD_FOR_MAIN_OPEN_WRITE_FILE_FAILED;
+    }
+
+    *file_out = stream;
     *terminator_out = terminator;
 
     return E_TBD_FOR_MAIN_OPEN_WRITE_FILE_OK;
 }
 
+/*
+ * Create the .tbd in memory first, so that it's written out to file with a
+ * single call.
+ */
+
+static enum tbd_create_result
+write_info_to_file(const struct tbd_create_info *__notnull const info,
+                   const struct tbd_create_options options,
+                   FILE *__notnull const file)
+{
+    struct yaml_emitter emitter = {};
+    enum tbd_create_result result =
+        tbd_create_with_info(info, &emitter, options);
+
+    if (result == E_TBD_CREATE_OK) {
+        if (yaml_emitter_flush(&emitter, file)) {
+            result = E_TBD_CREATE_WRITE_FAIL;
+        }
+    }
+
+    yaml_emitter_destroy(&emitter);
+    return result;
+}
+
+/*
+ * stdout is only wrapped for the .tbd being written out, and is left open
+ * afterwards. Each .tbd written to stdout is then a complete gzip member or
+ * zstd frame, which decompress together as a single stream.
+ */
+
+static enum tbd_create_result
+write_info_to_stdout(const struct tbd_for_main *__notnull const tbd) {
+    FILE *const file = tbd_for_main_open_output_stream(tbd, stdout, false);
+    if (file == NULL) {
+        return E_TBD_CREATE_WRITE_FAIL;
+    }
+
+    enum tbd_create_result result =
+        write_info_to_file(&tbd->info, tbd->write_options, file);
+
+    if (file != stdout && fclose(file) != 0) {
+        result = E_TBD_CREATE_WRITE_FAIL;
+    }
+
+    return result;
+}
+
 void
 tbd_for_main_write_to_file(const struct tbd_for_main *__notnull const tbd,
                            char *__notnull const write_path,
@@ -834,7 +1046,7 @@ tbd_for_main_write_to_file(const struct tbd_for_main *__notnull const tbd,
 {
     const struct tbd_create_info *const create_info = &tbd->info;
     const enum tbd_create_result create_tbd_result =
-        tbd_create_with_info(create_info, file, tbd->write_options);
+        write_info_to_file(create_info, tbd->write_options, file);
 
     if (create_tbd_result != E_TBD_CREATE_OK) {
         if (!tbd->options.ignore_warnings) {
@@ -853,14 +1065,195 @@ tbd_for_main_write_to_file(const struct tbd_for_main *__notnull const tbd,
     }
 }
 
+void
+tbd_for_main_write_buffer_to_file(
+    const struct tbd_for_main *__notnull const tbd,
+    char *__notnull const write_path,
+    const uint64_t write_path_length,
+    char *const terminator,
+    FILE *__notnull const file,
+    const char *__notnull const data,
+    const size_t size,
+    const bool print_paths)
+{
+    if (fwrite(data, 1, size, file) != size) {
+        if (!tbd->options.ignore_warnings) {
+            if (print_paths) {
+                fprintf(stderr,
+                        "Failed to write to write-file (at path %s)\n",
+                        write_path);
+            } else {
+                fputs("Failed to write to provided write-file\n", stderr);
+            }
+        }
+
+        if (terminator != NULL) {
+            remove_file_r(write_path, write_path_length, terminator);
+        }
+    }
+}
+
+static void
+print_write_if_changed_result(
+    const struct tbd_for_main *__notnull const tbd,
+    const char *__notnull const write_path,
+    const enum write_if_changed_result result,
+    const bool print_paths)
+{
+    switch (result) {
+        case E_WRITE_IF_CHANGED_OK:
+        case E_WRITE_IF_CHANGED_UNCHANGED:
+            break;
+
+        case E_WRITE_IF_CHANGED_PATH_ALREADY_EXISTS:
+            if (tbd->options.ignore_warnings) {
+                break;
+            }
+
+            if (print_paths) {
+                fprintf(stderr,
+                        "File at write-path (%s) already exists\n",
+                        write_path);
+            } else {
+                fputs("File at the provided write-path already exists\n",
+                      stderr);
+            }
+
+            break;
+
+        case E_WRITE_IF_CHANGED_OPEN_FAIL:
+            if (print_paths) {
+                fprintf(stderr,
+                        "Failed to open write-file (at path: %s), error: %s\n",
+                        write_path,
+                        strerror(errno));
+            } else {
+                fprintf(stderr,
+                        "Failed to open the provided write-file, error: %s\n",
+                        strerror(errno));
+            }
+
+            break;
+
+        case E_WRITE_IF_CHANGED_WRITE_FAIL:
+        case E_WRITE_IF_CHANGED_RENAME_FAIL:
+            if (tbd->options.ignore_warnings) {
+                break;
+            }
+
+            if (print_paths) {
+                fprintf(stderr,
+                        "Failed to write to write-file (at path %s), error: "
+                        "%s\n",
+                        write_path,
+                        strerror(errno));
+            } else {
+                fprintf(stderr,
+                        "Failed to write to provided write-file, error: %s\n",
+                        strerror(errno));
+            }
+
+            break;
+    }
+}
+
+void
+tbd_for_main_write_buffer_to_path_if_changed(
+    const struct tbd_for_main *__notnull const tbd,
+    char *__notnull const write_path,
+    const uint64_t write_path_length,
+    const char *__notnull const data,
+    const size_t size,
+    const bool print_paths)
+{
+    const enum write_if_changed_result result =
+        write_if_changed(write_path,
+                         write_path_length,
+                         data,
+                         size,
+                         tbd->options.no_overwrite);
+
+    print_write_if_changed_result(tbd, write_path, result, print_paths);
+}
+
+void
+tbd_for_main_write_to_path_if_changed(
+    const struct tbd_for_main *__notnull const tbd,
+    char *__notnull const write_path,
+    const uint64_t write_path_length,
+    const bool print_paths)
+{
+    struct yaml_emitter emitter = {};
+    const enum tbd_create_result create_tbd_result =
+        tbd_create_with_info(&tbd->info, &emitter, tbd->write_options);
+
+    if (create_tbd_result != E_TBD_CREATE_OK) {
+        if (!tbd->options.ignore_warnings) {
+            if (print_paths) {
+                fprintf(stderr,
+                        "Failed to write to write-file (at path %s)\n",
+                        write_path);
+            } else {
+                fputs("Failed to write to provided write-file\n", stderr);
+            }
+        }
+
+        yaml_emitter_destroy(&emitter);
+        return;
+    }
+
+    tbd_for_main_write_buffer_to_path_if_changed(tbd,
+                                                 write_path,
+                                                 write_path_length,
+                                                 emitter.data,
+                                                 emitter.length,
+                                                 print_paths);
+
+    yaml_emitter_destroy(&emitter);
+}
+
+enum tbd_create_result
+tbd_for_main_write_to_buffer(const struct tbd_for_main *__notnull const tbd,
+                             char **__notnull const data_out,
+                             size_t *__notnull const size_out)
+{
+    struct yaml_emitter emitter = {};
+    const enum tbd_create_result create_tbd_result =
+        tbd_create_with_info(&tbd->info, &emitter, tbd->write_options);
+
+    if (create_tbd_result != E_TBD_CREATE_OK) {
+        yaml_emitter_destroy(&emitter);
+        return E_TBD_CREATE_WRITE_FAIL;
+    }
+
+    /*
+     * The emitter's buffer is handed off as is, instead of being copied.
+     */
+
+    *data_out = emitter.data;
+    *size_out = emitter.length;
+
+    return E_TBD_CREATE_OK;
+}
+
+enum tbd_create_result tbd_for_main_write_footer(FILE *__notnull const file) {
+    struct yaml_emitter emitter = {};
+    enum tbd_create_result result = E_TBD_CREATE_OK;
+
+    if (tbd_write_footer(&emitter) || yaml_emitter_flush(&emitter, file)) {
+        result = E_TBD_CREATE_WRITE_FAIL;
+    }
+
+    yaml_emitter_destroy(&emitter);
+    return result;
+}
+
 void
 tbd_for_main_write_to_stdout(const struct tbd_for_main *__notnull const tbd,
                              const char *__notnull const input_path,
                              const bool print_paths)
 {
-    const struct tbd_create_info *const create_info = &tbd->info;
-    const enum tbd_create_result create_tbd_result =
-        tbd_create_with_info(create_info, stdout, tbd->write_options);
+    const enum tbd_create_result create_tbd_result = write_info_to_stdout(tbd);
 
     if (create_tbd_result != E_TBD_CREATE_OK) {
         if (!tbd->options.ignore_warnings) {
@@ -886,9 +1279,7 @@ tbd_for_main_write_to_stdout_for_dsc_image(
     const char *__notnull const image_path,
     const bool print_paths)
 {
-    const struct tbd_create_info *const create_info = &tbd->info;
-    const enum tbd_create_result create_tbd_result =
-        tbd_create_with_info(create_info, stdout, tbd->write_options);
+    const enum tbd_create_result create_tbd_result = write_info_to_stdout(tbd);
 
     if (create_tbd_result != E_TBD_CREATE_OK) {
         if (!tbd->options.ignore_warnings) {
@@ -912,15 +1303,58 @@ tbd_for_main_write_to_stdout_for_dsc_image(
     }
 }
 
+void
+tbd_for_main_create_job_copy(struct tbd_for_main *__notnull const copy,
+                             const struct tbd_for_main *__notnull const tbd)
+{
+    *copy = *tbd;
+
+    /*
+     * The copy must not share the arrays it will be adding to, or the arena
+     * their strings are allocated from.
+     */
+
+    struct tbd_create_info *const info = &copy->info;
+
+    memset(&info->fields.metadata, 0, sizeof(info->fields.metadata));
+    memset(&info->fields.symbols, 0, sizeof(info->fields.symbols));
+    memset(&info->fields.uuids, 0, sizeof(info->fields.uuids));
+    memset(&info->arena, 0, sizeof(info->arena));
+}
+
+void
+tbd_for_main_destroy_job_copy(struct tbd_for_main *__notnull const copy,
+                              const struct tbd_for_main *__notnull const orig)
+{
+    /*
+     * Every other field of the copy is shared with orig, so we only destroy
+     * the arrays owned by the copy.
+     */
+
+    struct tbd_create_info *const info = &copy->info;
+    tbd_create_info_clear_fields_and_create_from(info, &orig->info);
+
+    array_destroy(&info->fields.metadata);
+    array_destroy(&info->fields.symbols);
+    array_destroy(&info->fields.uuids);
+
+    arena_destroy(&info->arena);
+}
+
 void tbd_for_main_destroy(struct tbd_for_main *__notnull const tbd) {
     tbd_create_info_destroy(&tbd->info);
 
     array_destroy(&tbd->dsc_image_filters);
     array_destroy(&tbd->dsc_image_numbers);
+    array_destroy(&tbd->dsc_merge_paths);
 
     free(tbd->parse_path);
     free(tbd->write_path);
+    free(tbd->cache_dir_path);
+    free(tbd->dsc_previous_path);
 
     tbd->parse_path = NULL;
     tbd->write_path = NULL;
+    tbd->cache_dir_path = NULL;
+    tbd->dsc_previous_path = NULL;
 }
@@ -0,0 +1,453 @@
+//
+//  src/tbd_writer.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "copy.h"
+#include "recursive.h"
+#include "tbd_writer.h"
+#include "write_if_changed.h"
+
+/*
+ * Allow enough writes to be queued up that the parsing thread rarely has to
+ * wait on the writer-thread, while still bounding the memory held by outputs
+ * that have yet to be written out.
+ */
+
+static const uint64_t RING_COUNT = 32;
+
+static inline struct tbd_writer_write *
+get_write_at_index(const struct tbd_writer *__notnull const writer,
+                   const uint64_t index)
+{
+    return writer->ring + (index % writer->ring_count);
+}
+
+static void
+print_write_fail(const struct tbd_writer_write *__notnull const write) {
+    if (write->output->ignore_warnings) {
+        return;
+    }
+
+    if (write->print_paths) {
+        fprintf(stderr,
+                "Failed to write to write-file (at path %s)\n",
+                write->path);
+    } else {
+        fputs("Failed to write to provided write-file\n", stderr);
+    }
+}
+
+static void
+print_already_exists(const struct tbd_writer_write *__notnull const write) {
+    if (write->output->ignore_warnings) {
+        return;
+    }
+
+    if (write->print_paths) {
+        fprintf(stderr,
+                "File at write-path (%s) already exists\n",
+                write->path);
+    } else {
+        fputs("File at the provided write-path already exists\n", stderr);
+    }
+}
+
+static void
+write_out_if_changed(struct yaml_emitter *__notnull const emitter,
+                     const struct tbd_writer_write *__notnull const write)
+{
+    const struct tbd_writer_output *const output = write->output;
+
+    const char *data = output->data;
+    uint64_t size = output->size;
+
+    if (data == NULL) {
+        const enum tbd_create_result create_tbd_result =
+            tbd_create_with_info(&output->info,
+                                 emitter,
+                                 output->write_options);
+
+        if (create_tbd_result != E_TBD_CREATE_OK) {
+            yaml_emitter_clear(emitter);
+            print_write_fail(write);
+
+            return;
+        }
+
+        data = emitter->data;
+        size = emitter->length;
+    }
+
+    const enum write_if_changed_result result =
+        write_if_changed(write->path,
+                         write->path_length,
+                         data,
+                         size,
+                         write->no_overwrite);
+
+    yaml_emitter_clear(emitter);
+    switch (result) {
+        case E_WRITE_IF_CHANGED_OK:
+        case E_WRITE_IF_CHANGED_UNCHANGED:
+            break;
+
+        case E_WRITE_IF_CHANGED_PATH_ALREADY_EXISTS:
+            print_already_exists(write);
+            break;
+
+        case E_WRITE_IF_CHANGED_OPEN_FAIL:
+        case E_WRITE_IF_CHANGED_WRITE_FAIL:
+        case E_WRITE_IF_CHANGED_RENAME_FAIL:
+            print_write_fail(write);
+            break;
+    }
+}
+
+static void
+write_out(struct yaml_emitter *__notnull const emitter,
+          const struct tbd_writer_write *__notnull const write)
+{
+    FILE *const file = write->file;
+    if (file == NULL) {
+        write_out_if_changed(emitter, write);
+        return;
+    }
+
+    const struct tbd_writer_output *const output = write->output;
+
+    bool failed = false;
+    if (output->data != NULL) {
+        failed = (fwrite(output->data, 1, output->size, file) != output->size);
+    } else {
+        const enum tbd_create_result create_tbd_result =
+            tbd_create_with_info(&output->info,
+                                 emitter,
+                                 output->write_options);
+
+        if (create_tbd_result != E_TBD_CREATE_OK) {
+            yaml_emitter_clear(emitter);
+            failed = true;
+        } else {
+            failed = yaml_emitter_flush(emitter, file);
+        }
+    }
+
+    /*
+     * Data written to file is only flushed once the file is closed, so we
+     * have to check for a failed close as well.
+     */
+
+    if (fclose(file) != 0) {
+        failed = true;
+    }
+
+    if (failed) {
+        print_write_fail(write);
+
+        char *const terminator = write->terminator;
+        if (terminator != NULL) {
+            remove_file_r(write->path, write->path_length, terminator);
+        }
+    }
+}
+
+static void destroy_output(struct tbd_writer_output *__notnull const output) {
+    if (output->data != NULL) {
+        free(output->data);
+    } else {
+        tbd_create_info_destroy(&output->info);
+    }
+
+    free(output);
+}
+
+/*
+ * Decrement the reference-count of output, returning whether output has to be
+ * destroyed. Must be called with writer's lock held.
+ */
+
+static inline bool release_output(struct tbd_writer_output *__notnull output) {
+    output->ref_count -= 1;
+    return (output->ref_count == 0);
+}
+
+static void *thread_main(void *__notnull const arg) {
+    struct tbd_writer *const writer = (struct tbd_writer *)arg;
+    pthread_mutex_lock(&writer->lock);
+
+    do {
+        const uint64_t index = writer->written_count;
+        if (index == writer->added_count) {
+            if (writer->is_finished) {
+                break;
+            }
+
+            pthread_cond_wait(&writer->write_cond, &writer->lock);
+            continue;
+        }
+
+        const struct tbd_writer_write write =
+            *get_write_at_index(writer, index);
+
+        pthread_mutex_unlock(&writer->lock);
+
+        write_out(&writer->emitter, &write);
+        free(write.path);
+
+        pthread_mutex_lock(&writer->lock);
+
+        const bool should_destroy = release_output(write.output);
+
+        writer->written_count = index + 1;
+        pthread_cond_signal(&writer->written_cond);
+
+        if (should_destroy) {
+            pthread_mutex_unlock(&writer->lock);
+            destroy_output(write.output);
+            pthread_mutex_lock(&writer->lock);
+        }
+    } while (true);
+
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+enum tbd_writer_result
+tbd_writer_create(struct tbd_writer *__notnull const writer) {
+    struct tbd_writer_write *const ring = calloc(RING_COUNT, sizeof(*ring));
+    if (ring == NULL) {
+        return E_TBD_WRITER_ALLOC_FAIL;
+    }
+
+    writer->ring = ring;
+    writer->ring_count = RING_COUNT;
+
+    writer->added_count = 0;
+    writer->written_count = 0;
+    writer->is_finished = false;
+
+    memset(&writer->emitter, 0, sizeof(writer->emitter));
+    pthread_mutex_init(&writer->lock, NULL);
+    pthread_cond_init(&writer->write_cond, NULL);
+    pthread_cond_init(&writer->written_cond, NULL);
+
+    if (pthread_create(&writer->thread, NULL, thread_main, writer) != 0) {
+        pthread_cond_destroy(&writer->written_cond);
+        pthread_cond_destroy(&writer->write_cond);
+        pthread_mutex_destroy(&writer->lock);
+
+        free(ring);
+        return E_TBD_WRITER_THREAD_CREATE_FAIL;
+    }
+
+    return E_TBD_WRITER_OK;
+}
+
+/*
+ * The targets of a create-info may be shared with the create-info it was
+ * created from, so the output is given its own copy.
+ */
+
+static bool
+copy_targets(struct target_list *__notnull const dst,
+             const struct target_list *__notnull const src)
+{
+    *dst = *src;
+    if (src->alloc_count == 0) {
+        return true;
+    }
+
+    const uint64_t size = sizeof(uint64_t) * src->alloc_count;
+    uint64_t *const data = malloc(size);
+
+    if (data == NULL) {
+        return false;
+    }
+
+    memcpy(data, src->data, sizeof(uint64_t) * src->set_count);
+    dst->data = data;
+
+    return true;
+}
+
+struct tbd_writer_output *
+tbd_writer_output_create_from_info(
+    struct tbd_create_info *__notnull const info,
+    const struct tbd_create_options write_options,
+    const bool ignore_warnings)
+{
+    struct tbd_writer_output *const output = calloc(1, sizeof(*output));
+    if (output == NULL) {
+        return NULL;
+    }
+
+    output->info = *info;
+    if (!copy_targets(&output->info.fields.targets, &info->fields.targets)) {
+        free(output);
+        return NULL;
+    }
+
+    output->write_options = write_options;
+    output->ref_count = 1;
+    output->ignore_warnings = ignore_warnings;
+
+    /*
+     * info keeps its targets, but is left with empty arrays and an empty
+     * arena, and without ownership of its install-name.
+     */
+
+    memset(&info->fields.metadata, 0, sizeof(info->fields.metadata));
+    memset(&info->fields.symbols, 0, sizeof(info->fields.symbols));
+    memset(&info->fields.uuids, 0, sizeof(info->fields.uuids));
+    memset(&info->arena, 0, sizeof(info->arena));
+
+    info->flags.install_name_was_allocated = false;
+    return output;
+}
+
+struct tbd_writer_output *
+tbd_writer_output_create_from_data(char *__notnull const data,
+                                   const size_t size,
+                                   const bool ignore_warnings)
+{
+    struct tbd_writer_output *const output = calloc(1, sizeof(*output));
+    if (output == NULL) {
+        return NULL;
+    }
+
+    output->data = data;
+    output->size = size;
+    output->ref_count = 1;
+    output->ignore_warnings = ignore_warnings;
+
+    return output;
+}
+
+/*
+ * Copy the path of write, then queue it up for the writer-thread.
+ */
+
+static void
+add_write(struct tbd_writer *__notnull const writer,
+          struct tbd_writer_write write)
+{
+    /*
+     * If we fail to copy path, we simply write out on this thread instead.
+     */
+
+    char *const path = write.path;
+    char *const path_copy = alloc_and_copy(path, write.path_length);
+
+    if (path_copy == NULL) {
+        struct yaml_emitter emitter = {};
+
+        write_out(&emitter, &write);
+        yaml_emitter_destroy(&emitter);
+
+        return;
+    }
+
+    write.path = path_copy;
+    if (write.terminator != NULL) {
+        write.terminator = path_copy + (write.terminator - path);
+    }
+
+    pthread_mutex_lock(&writer->lock);
+
+    const uint64_t index = writer->added_count;
+    while (index - writer->written_count == writer->ring_count) {
+        pthread_cond_wait(&writer->written_cond, &writer->lock);
+    }
+
+    *get_write_at_index(writer, index) = write;
+
+    write.output->ref_count += 1;
+    writer->added_count = index + 1;
+
+    pthread_cond_signal(&writer->write_cond);
+    pthread_mutex_unlock(&writer->lock);
+}
+
+void
+tbd_writer_add(struct tbd_writer *__notnull const writer,
+               struct tbd_writer_output *__notnull const output,
+               FILE *__notnull const file,
+               char *__notnull const path,
+               const uint64_t path_length,
+               char *const terminator,
+               const bool print_paths)
+{
+    const struct tbd_writer_write write = {
+        .output = output,
+        .file = file,
+
+        .path = path,
+        .path_length = path_length,
+
+        .terminator = terminator,
+        .print_paths = print_paths
+    };
+
+    add_write(writer, write);
+}
+
+void
+tbd_writer_add_if_changed(struct tbd_writer *__notnull const writer,
+                          struct tbd_writer_output *__notnull const output,
+                          char *__notnull const path,
+                          const uint64_t path_length,
+                          const bool no_overwrite,
+                          const bool print_paths)
+{
+    const struct tbd_writer_write write = {
+        .output = output,
+
+        .path = path,
+        .path_length = path_length,
+
+        .print_paths = print_paths,
+        .no_overwrite = no_overwrite
+    };
+
+    add_write(writer, write);
+}
+
+void
+tbd_writer_release_output(struct tbd_writer *__notnull const writer,
+                          struct tbd_writer_output *__notnull const output)
+{
+    pthread_mutex_lock(&writer->lock);
+    const bool should_destroy = release_output(output);
+    pthread_mutex_unlock(&writer->lock);
+
+    if (should_destroy) {
+        destroy_output(output);
+    }
+}
+
+void tbd_writer_finish_and_destroy(struct tbd_writer *__notnull const writer) {
+    pthread_mutex_lock(&writer->lock);
+
+    writer->is_finished = true;
+    pthread_cond_signal(&writer->write_cond);
+
+    pthread_mutex_unlock(&writer->lock);
+    pthread_join(writer->thread, NULL);
+
+    pthread_cond_destroy(&writer->written_cond);
+    pthread_cond_destroy(&writer->write_cond);
+    pthread_mutex_destroy(&writer->lock);
+
+    yaml_emitter_destroy(&writer->emitter);
+    free(writer->ring);
+
+    writer->ring = NULL;
+    writer->ring_count = 0;
+}
@@ -16,7 +16,7 @@ void print_usage(void) {
     fputs("                  If provided file(s) already exists, contents will be overridden.\n", stdout);
     fputs("                  Can also provide \"stdout\" to print to stdout\n", stdout);
     fputs("    -p, --path,   Path to a mach-o or dyld_shared_cache file to convert to a tbd file.\n", stdout);
-    fputs("                  Can also provide \"stdin\" to use standard input.\n", stdout);
+    fputs("                  Can also provide \"stdin\" to use standard input, which may be a pipe.\n", stdout);
     fputs("    -u, --usage,  Print this message\n", stdout);
 
     fputc('\n', stdout);
@@ -29,6 +29,14 @@ void print_usage(void) {
     fputs("                                  writing out (Instead of simply appending .tbd)\n", stdout);
     fputs("        --combine-tbds,           Combine all tbds created (when recursing or with a dyld-shared-cache) into a\n", stdout);
     fputs("                                  single .tbd file\n", stdout);
+    fputs("        --write-if-changed,       Only write out .tbd files whose contents have changed from the existing\n", stdout);
+    fputs("                                  file at their write-path, leaving unchanged files untouched\n", stdout);
+    fputs("        --incremental,            Skip inputs left unchanged since they were last parsed into the write-path,\n", stdout);
+    fputs("                                  as recorded in <write-path>.tbd-manifest, and remove the outputs of\n", stdout);
+    fputs("                                  inputs that no longer exist\n", stdout);
+    fputs("        --tar,                    Write all .tbds created from a dyld-shared-cache into a single tar archive\n", stdout);
+    fputs("        --gzip,                   Compress the combined .tbd file, tar archive, or .tbd written to stdout, with gzip\n", stdout);
+    fputs("        --zstd,                   Compress the combined .tbd file, tar archive, or .tbd written to stdout, with zstd\n", stdout);
 
     fputc('\n', stdout);
     fputs("Path options:\n", stdout);
@@ -37,6 +45,16 @@ void print_usage(void) {
     fputs("                   Two modes exist for recursing:\n", stdout);
     fputs("                       once, Recurse only the top-level directory. This is the default mode for recursing\n", stdout);
     fputs("                       all,  Recurse both the top-level directory and over all sub-directories\n", stdout);
+    fputs("    -j, --jobs,    Specify the number of threads to list directories and parse files with when recursing,\n", stdout);
+    fputs("                   images with when parsing a dyld_shared_cache, or architectures with when parsing a fat mach-o file\n", stdout);
+    fputs("                   Created .tbd files, and any messages, are still written out in the order files, images,\n", stdout);
+    fputs("                   or architectures were found, with separate .tbd files written out on an additional thread\n", stdout);
+    fputs("        --cache-dir,                     Specify a directory to cache the .tbd files created from mach-o files\n", stdout);
+    fputs("                                         found when recursing in, keyed by the uuids of their architectures and\n", stdout);
+    fputs("                                         the options provided. Copies of the same mach-o file, whether found later\n", stdout);
+    fputs("                                         while recursing, or by a later run, are written out from the cache\n", stdout);
+    fputs("                                         without being parsed.\n", stdout);
+    fputs("                                         The directory can be shared by multiple runs of tbd at once\n", stdout);
     fputs("        --macho,                         Specify that the file(s) provided should only be parsed\n", stdout);
     fputs("                                         if the file is a mach-o file.\n", stdout);
     fputs("                                         This option can be used to limit the filetypes parsed\n", stdout);
@@ -44,6 +62,25 @@ void print_usage(void) {
     fputs("        --dsc,                           Specify that the file(s) provided should only be parsed\n", stdout);
     fputs("                                         if it is a dyld-shared-cache file.\n", stdout);
     fputs("                                         Providing --macho or --dsc limits filetypes parsed when recursing\n", stdout);
+    fputs("        --zip,                           Specify that the file(s) provided should be parsed as zip archives (such as .ipa\n", stdout);
+    fputs("                                         files, or zipped .xcframeworks), whose mach-o members are parsed as if the\n", stdout);
+    fputs("                                         archive were a directory being recursed, without extracting it to disk.\n", stdout);
+    fputs("                                         Providing --zip alone limits filetypes parsed to zip archives\n", stdout);
+    fputs("               --dsc-drop-pages,         Drop each dyld_shared_cache image's pages from memory once the image\n", stdout);
+    fputs("                                         has been parsed. Keeps memory use flat when extracting large shared-caches,\n", stdout);
+    fputs("                                         at the cost of re-reading shared pages\n", stdout);
+    fputs("               --dsc-merge-cache,        Specify the path of a dyld_shared_cache of another architecture\n", stdout);
+    fputs("                                         to merge images from.\n", stdout);
+    fputs("                                         Images with the same install-name are written out to a single .tbd file,\n", stdout);
+    fputs("                                         with a target for each dyld_shared_cache\n", stdout);
+    fputs("               --dsc-memory-limit,       Specify the number of megabytes of dyld_shared_cache files to map at once\n", stdout);
+    fputs("                                         when recursing with jobs. Multiple dyld_shared_cache files are then extracted\n", stdout);
+    fputs("                                         concurrently, while staying under the limit\n", stdout);
+    fputs("               --dsc-previous-cache,     Specify the path of a previous version of the dyld_shared_cache being parsed.\n", stdout);
+    fputs("                                         Images left unchanged since, whose .tbd file still exists at the write-path,\n", stdout);
+    fputs("                                         are not extracted again.\n", stdout);
+    fputs("                                         The previous dyld_shared_cache must have been extracted to the write-path\n", stdout);
+    fputs("                                         with the same options, while using either --dsc-previous-cache or --incremental\n", stdout);
     fputs("               --filter-image-directory, Specify a directory to filter dyld_shared_cache images from\n", stdout);
     fputs("               --filter-image-filename,  Specify a filename to filter dyld_shared_cache images from\n", stdout);
     fputs("               --filter-image-number,    Specify the number of an dyld_shared_cache image to parse out.\n", stdout);
@@ -0,0 +1,222 @@
+//
+//  src/write_if_changed.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "our_io.h"
+#include "recursive.h"
+#include "write_if_changed.h"
+
+/*
+ * Every temporary file gets a number unique to this process, which, together
+ * with the process's id, keeps multiple threads and runs from colliding.
+ */
+
+static uint64_t temp_file_count = 0;
+
+/*
+ * Room for ".tmp-", the process-id, a dash, the temporary-file's number, and a
+ * null-terminator.
+ */
+
+static const uint64_t TEMP_SUFFIX_MAX_LENGTH = 48;
+
+static bool
+file_has_contents(const int fd,
+                  const char *__notnull const data,
+                  const uint64_t size)
+{
+    char buffer[32768];
+    uint64_t offset = 0;
+
+    while (offset != size) {
+        uint64_t chunk_size = size - offset;
+        if (chunk_size > sizeof(buffer)) {
+            chunk_size = sizeof(buffer);
+        }
+
+        const ssize_t read_size =
+            our_pread(fd, buffer, chunk_size, (off_t)offset);
+
+        if (read_size <= 0) {
+            return false;
+        }
+
+        if (memcmp(buffer, data + offset, (size_t)read_size) != 0) {
+            return false;
+        }
+
+        offset += (uint64_t)read_size;
+    }
+
+    return true;
+}
+
+/*
+ * Return whether the file at path already has the exact contents of data,
+ * storing the permissions of any existing regular file in mode_out.
+ */
+
+static bool
+existing_file_matches(const char *__notnull const path,
+                      const char *__notnull const data,
+                      const uint64_t size,
+                      bool *__notnull const exists_out,
+                      mode_t *__notnull const mode_out)
+{
+    const int fd = our_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    *exists_out = true;
+
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0 || !S_ISREG(sbuf.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    *mode_out = sbuf.st_mode & 07777;
+
+    const bool matches =
+        (uint64_t)sbuf.st_size == size && file_has_contents(fd, data, size);
+
+    close(fd);
+    return matches;
+}
+
+/*
+ * Remove the temporary file, and any directories created for it, while keeping
+ * errno intact for the caller.
+ */
+
+static void
+remove_temp_file(char *__notnull const temp_path,
+                 const uint64_t temp_path_length,
+                 char *const terminator)
+{
+    const int error = errno;
+    if (terminator != NULL) {
+        remove_file_r(temp_path, temp_path_length, terminator);
+    } else {
+        our_unlink(temp_path);
+    }
+
+    errno = error;
+}
+
+enum write_if_changed_result
+write_if_changed(char *__notnull const path,
+                 const uint64_t path_length,
+                 const char *__notnull const data,
+                 const uint64_t size,
+                 const bool no_overwrite)
+{
+    bool exists = false;
+    mode_t mode = 0;
+
+    if (existing_file_matches(path, data, size, &exists, &mode)) {
+        return E_WRITE_IF_CHANGED_UNCHANGED;
+    }
+
+    if (exists && no_overwrite) {
+        errno = EEXIST;
+        return E_WRITE_IF_CHANGED_PATH_ALREADY_EXISTS;
+    }
+
+    char *const temp_path = malloc(path_length + TEMP_SUFFIX_MAX_LENGTH);
+    if (temp_path == NULL) {
+        return E_WRITE_IF_CHANGED_OPEN_FAIL;
+    }
+
+    memcpy(temp_path, path, path_length);
+
+    char *terminator = NULL;
+    uint64_t temp_path_length = 0;
+
+    int fd = -1;
+
+    do {
+        const uint64_t number =
+            __atomic_fetch_add(&temp_file_count, 1, __ATOMIC_RELAXED);
+
+        const int suffix_length =
+            snprintf(temp_path + path_length,
+                     TEMP_SUFFIX_MAX_LENGTH,
+                     ".tmp-%ld-%llu",
+                     (long)getpid(),
+                     (unsigned long long)number);
+
+        temp_path_length = path_length + (uint64_t)suffix_length;
+        fd = open_r(temp_path,
+                    temp_path_length,
+                    O_WRONLY | O_EXCL,
+                    DEFFILEMODE,
+                    0755,
+                    &terminator);
+    } while (fd < 0 && errno == EEXIST);
+
+    if (fd < 0) {
+        free(temp_path);
+        return E_WRITE_IF_CHANGED_OPEN_FAIL;
+    }
+
+    /*
+     * Keep the permissions of the file being replaced.
+     */
+
+    if (exists) {
+        fchmod(fd, mode);
+    }
+
+    const bool wrote = (our_write_all(fd, data, size) == 0);
+    if (close(fd) != 0 || !wrote) {
+        remove_temp_file(temp_path, temp_path_length, terminator);
+        free(temp_path);
+
+        return E_WRITE_IF_CHANGED_WRITE_FAIL;
+    }
+
+    /*
+     * When overwriting isn't allowed, link the temporary file into place, which
+     * fails if a file was created at path in the meantime, instead of renaming
+     * over it.
+     */
+
+    if (no_overwrite) {
+        if (link(temp_path, path) != 0) {
+            const enum write_if_changed_result result =
+                (errno == EEXIST) ?
+                    E_WRITE_IF_CHANGED_PATH_ALREADY_EXISTS :
+                    E_WRITE_IF_CHANGED_RENAME_FAIL;
+
+            remove_temp_file(temp_path, temp_path_length, terminator);
+            free(temp_path);
+
+            return result;
+        }
+
+        our_unlink(temp_path);
+    } else if (rename(temp_path, path) != 0) {
+        remove_temp_file(temp_path, temp_path_length, terminator);
+        free(temp_path);
+
+        return E_WRITE_IF_CHANGED_RENAME_FAIL;
+    }
+
+    free(temp_path);
+    return E_WRITE_IF_CHANGED_OK;
+}
@@ -0,0 +1,181 @@
+//
+//  src/yaml_emitter.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "likely.h"
+#include "yaml_emitter.h"
+
+/*
+ * Most .tbd files fit in the initial capacity, so that the buffer rarely has
+ * to be grown more than once.
+ */
+
+static const uint64_t INITIAL_CAPACITY = 16384;
+
+static const char spaces[] = "                                ";
+static const uint64_t SPACES_LENGTH = sizeof(spaces) - 1;
+
+static int
+expand_for_length(struct yaml_emitter *__notnull const emitter,
+                  const uint64_t needed)
+{
+    const uint64_t wanted = emitter->length + needed;
+
+    uint64_t new_capacity = emitter->capacity;
+    if (new_capacity == 0) {
+        new_capacity = INITIAL_CAPACITY;
+    }
+
+    while (new_capacity < wanted) {
+        new_capacity *= 2;
+    }
+
+    char *const data = realloc(emitter->data, new_capacity);
+    if (data == NULL) {
+        return 1;
+    }
+
+    emitter->data = data;
+    emitter->capacity = new_capacity;
+
+    return 0;
+}
+
+static inline char *
+reserve(struct yaml_emitter *__notnull const emitter, const uint64_t length) {
+    if (unlikely(emitter->capacity - emitter->length < length)) {
+        if (expand_for_length(emitter, length)) {
+            return NULL;
+        }
+    }
+
+    char *const ptr = emitter->data + emitter->length;
+    emitter->length += length;
+
+    return ptr;
+}
+
+int
+yaml_emitter_write(struct yaml_emitter *__notnull const emitter,
+                   const char *__notnull const data,
+                   const uint64_t length)
+{
+    char *const ptr = reserve(emitter, length);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    memcpy(ptr, data, length);
+    return 0;
+}
+
+int
+yaml_emitter_write_c_str(struct yaml_emitter *__notnull const emitter,
+                         const char *__notnull const string)
+{
+    return yaml_emitter_write(emitter, string, strlen(string));
+}
+
+int
+yaml_emitter_write_char(struct yaml_emitter *__notnull const emitter,
+                        const char ch)
+{
+    char *const ptr = reserve(emitter, 1);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    *ptr = ch;
+    return 0;
+}
+
+int
+yaml_emitter_write_padding(struct yaml_emitter *__notnull const emitter,
+                           uint64_t count)
+{
+    while (count > SPACES_LENGTH) {
+        if (yaml_emitter_write(emitter, spaces, SPACES_LENGTH)) {
+            return 1;
+        }
+
+        count -= SPACES_LENGTH;
+    }
+
+    return yaml_emitter_write(emitter, spaces, count);
+}
+
+int
+yaml_emitter_write_uint(struct yaml_emitter *__notnull const emitter,
+                        uint64_t value)
+{
+    /*
+     * Write the digits backwards from the end of the buffer, which is large
+     * enough for UINT64_MAX.
+     */
+
+    char buffer[20];
+    char *const end = buffer + sizeof(buffer);
+    char *iter = end;
+
+    do {
+        iter--;
+        *iter = (char)('0' + (value % 10));
+
+        value /= 10;
+    } while (value != 0);
+
+    return yaml_emitter_write(emitter, iter, (uint64_t)(end - iter));
+}
+
+int
+yaml_emitter_write_hex_byte(struct yaml_emitter *__notnull const emitter,
+                            const uint8_t byte)
+{
+    static const char digits[] = "0123456789ABCDEF";
+
+    char *const ptr = reserve(emitter, 2);
+    if (ptr == NULL) {
+        return 1;
+    }
+
+    ptr[0] = digits[byte >> 4];
+    ptr[1] = digits[byte & 0xf];
+
+    return 0;
+}
+
+int
+yaml_emitter_flush(struct yaml_emitter *__notnull const emitter,
+                   FILE *__notnull const file)
+{
+    const uint64_t length = emitter->length;
+    if (length == 0) {
+        return 0;
+    }
+
+    emitter->length = 0;
+    if (fwrite(emitter->data, length, 1, file) != 1) {
+        return 1;
+    }
+
+    return 0;
+}
+
+void yaml_emitter_clear(struct yaml_emitter *__notnull const emitter) {
+    emitter->length = 0;
+}
+
+void yaml_emitter_destroy(struct yaml_emitter *__notnull const emitter) {
+    free(emitter->data);
+
+    emitter->data = NULL;
+    emitter->length = 0;
+    emitter->capacity = 0;
+}
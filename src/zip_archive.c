@@ -0,0 +1,746 @@
+//
+//  src/zip_archive.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "our_io.h"
+#include "zip_archive.h"
+
+static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+static const uint32_t END_RECORD_SIGNATURE = 0x06054b50;
+static const uint32_t ZIP64_END_RECORD_SIGNATURE = 0x06064b50;
+static const uint32_t ZIP64_END_LOCATOR_SIGNATURE = 0x07064b50;
+
+static const uint64_t LOCAL_HEADER_SIZE = 30;
+static const uint64_t CENTRAL_HEADER_SIZE = 46;
+static const uint64_t END_RECORD_SIZE = 22;
+static const uint64_t ZIP64_END_RECORD_SIZE = 56;
+static const uint64_t ZIP64_END_LOCATOR_SIZE = 20;
+
+/*
+ * The end-of-central-directory record ends with a comment of up to 65535
+ * bytes, so it has to be searched for within the end of the archive.
+ */
+
+static const uint64_t END_RECORD_SEARCH_SIZE = 22 + 65535;
+
+static const uint16_t ZIP64_EXTRA_FIELD_ID = 0x0001;
+static const uint16_t UNIX_HOST = 3;
+
+static const uint16_t METHOD_STORED = 0;
+static const uint16_t METHOD_DEFLATED = 8;
+
+static const uint16_t FLAG_ENCRYPTED = 1 << 0;
+
+static const uint64_t CHUNK_SIZE = 65536;
+
+static uint16_t read_uint16(const uint8_t *__notnull const ptr) {
+    return (uint16_t)(ptr[0] | (ptr[1] << 8));
+}
+
+static uint32_t read_uint32(const uint8_t *__notnull const ptr) {
+    return (uint32_t)ptr[0] |
+           ((uint32_t)ptr[1] << 8) |
+           ((uint32_t)ptr[2] << 16) |
+           ((uint32_t)ptr[3] << 24);
+}
+
+static uint64_t read_uint64(const uint8_t *__notnull const ptr) {
+    return (uint64_t)read_uint32(ptr) | ((uint64_t)read_uint32(ptr + 4) << 32);
+}
+
+static bool
+pread_all(const int fd,
+          void *__notnull const buf,
+          const uint64_t size,
+          const uint64_t offset)
+{
+    uint64_t read_size = 0;
+    while (read_size != size) {
+        const ssize_t num =
+            our_pread(fd,
+                      (uint8_t *)buf + read_size,
+                      size - read_size,
+                      (off_t)(offset + read_size));
+
+        if (num <= 0) {
+            return false;
+        }
+
+        read_size += (uint64_t)num;
+    }
+
+    return true;
+}
+
+/*
+ * Find the end-of-central-directory record, searching backwards from the end
+ * of the archive.
+ *
+ * A record whose comment ends exactly at the end of the archive is preferred,
+ * so that a signature within the comment isn't mistaken for the record, before
+ * allowing for archives with data appended after the record.
+ */
+
+static enum zip_archive_result
+find_end_record(const int fd,
+                const uint64_t size,
+                uint8_t *__notnull const record_out,
+                uint64_t *__notnull const offset_out)
+{
+    uint64_t search_size = END_RECORD_SEARCH_SIZE;
+    if (search_size > size) {
+        search_size = size;
+    }
+
+    uint8_t *const buffer = malloc(search_size);
+    if (buffer == NULL) {
+        return E_ZIP_ARCHIVE_ALLOC_FAIL;
+    }
+
+    const uint64_t search_offset = size - search_size;
+    if (!pread_all(fd, buffer, search_size, search_offset)) {
+        free(buffer);
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    for (int pass = 0; pass != 2; pass++) {
+        uint64_t index = search_size - END_RECORD_SIZE + 1;
+        do {
+            index--;
+
+            const uint8_t *const record = buffer + index;
+            if (read_uint32(record) != END_RECORD_SIGNATURE) {
+                continue;
+            }
+
+            const uint64_t comment_length = read_uint16(record + 20);
+            const uint64_t record_end =
+                index + END_RECORD_SIZE + comment_length;
+
+            if (pass == 0) {
+                if (record_end != search_size) {
+                    continue;
+                }
+            } else if (record_end > search_size) {
+                continue;
+            }
+
+            memcpy(record_out, record, END_RECORD_SIZE);
+            *offset_out = search_offset + index;
+
+            free(buffer);
+            return E_ZIP_ARCHIVE_OK;
+        } while (index != 0);
+    }
+
+    free(buffer);
+    return E_ZIP_ARCHIVE_NOT_A_ZIP;
+}
+
+static enum zip_archive_result
+read_zip64_end_record(const int fd,
+                      const uint64_t end_record_offset,
+                      uint64_t *__notnull const entries_count_out,
+                      uint64_t *__notnull const cd_size_out,
+                      uint64_t *__notnull const cd_offset_out)
+{
+    if (end_record_offset < ZIP64_END_LOCATOR_SIZE) {
+        return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+    }
+
+    uint8_t locator[20];
+    const uint64_t locator_offset = end_record_offset - ZIP64_END_LOCATOR_SIZE;
+
+    if (!pread_all(fd, locator, sizeof(locator), locator_offset)) {
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    if (read_uint32(locator) != ZIP64_END_LOCATOR_SIGNATURE) {
+        return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+    }
+
+    const uint64_t record_offset = read_uint64(locator + 8);
+    if (locator_offset < ZIP64_END_RECORD_SIZE ||
+        record_offset > locator_offset - ZIP64_END_RECORD_SIZE)
+    {
+        return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+    }
+
+    uint8_t record[56];
+    if (!pread_all(fd, record, sizeof(record), record_offset)) {
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    if (read_uint32(record) != ZIP64_END_RECORD_SIGNATURE) {
+        return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+    }
+
+    if (read_uint32(record + 16) != 0 || read_uint32(record + 20) != 0) {
+        return E_ZIP_ARCHIVE_MULTIPLE_DISKS;
+    }
+
+    *entries_count_out = read_uint64(record + 32);
+    *cd_size_out = read_uint64(record + 40);
+    *cd_offset_out = read_uint64(record + 48);
+
+    return E_ZIP_ARCHIVE_OK;
+}
+
+enum zip_archive_result
+zip_archive_open(struct zip_archive *__notnull const archive, const int fd) {
+    struct stat sbuf = {};
+    if (fstat(fd, &sbuf) != 0) {
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    const uint64_t size = (uint64_t)sbuf.st_size;
+    if (!S_ISREG(sbuf.st_mode) || size < END_RECORD_SIZE) {
+        return E_ZIP_ARCHIVE_NOT_A_ZIP;
+    }
+
+    /*
+     * Check the archive's first signature before searching for the
+     * end-of-central-directory record, so that other files are rejected
+     * quickly.
+     */
+
+    uint8_t magic[4];
+    if (!pread_all(fd, magic, sizeof(magic), 0)) {
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    const uint32_t signature = read_uint32(magic);
+    if (signature != LOCAL_HEADER_SIGNATURE &&
+        signature != END_RECORD_SIGNATURE)
+    {
+        return E_ZIP_ARCHIVE_NOT_A_ZIP;
+    }
+
+    uint8_t record[22];
+    uint64_t record_offset = 0;
+
+    const enum zip_archive_result find_result =
+        find_end_record(fd, size, record, &record_offset);
+
+    if (find_result != E_ZIP_ARCHIVE_OK) {
+        return find_result;
+    }
+
+    const uint16_t disk = read_uint16(record + 4);
+    const uint16_t cd_disk = read_uint16(record + 6);
+
+    uint64_t entries_count = read_uint16(record + 10);
+    uint64_t cd_size = read_uint32(record + 12);
+    uint64_t cd_offset = read_uint32(record + 16);
+
+    /*
+     * Fields too large for the record are instead stored in the zip64
+     * end-of-central-directory record.
+     */
+
+    if (entries_count == UINT16_MAX ||
+        cd_size == UINT32_MAX ||
+        cd_offset == UINT32_MAX)
+    {
+        const enum zip_archive_result read_zip64_result =
+            read_zip64_end_record(fd,
+                                  record_offset,
+                                  &entries_count,
+                                  &cd_size,
+                                  &cd_offset);
+
+        if (read_zip64_result != E_ZIP_ARCHIVE_OK) {
+            return read_zip64_result;
+        }
+    } else if (disk != 0 || cd_disk != 0) {
+        return E_ZIP_ARCHIVE_MULTIPLE_DISKS;
+    }
+
+    if (cd_offset > record_offset || cd_size > record_offset - cd_offset) {
+        return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+    }
+
+    uint8_t *central_directory = NULL;
+    if (cd_size != 0) {
+        central_directory = malloc(cd_size);
+        if (central_directory == NULL) {
+            return E_ZIP_ARCHIVE_ALLOC_FAIL;
+        }
+
+        if (!pread_all(fd, central_directory, cd_size, cd_offset)) {
+            free(central_directory);
+            return E_ZIP_ARCHIVE_READ_FAIL;
+        }
+    }
+
+    archive->fd = fd;
+    archive->size = size;
+
+    archive->central_directory = central_directory;
+    archive->central_directory_size = cd_size;
+    archive->entries_count = entries_count;
+
+    return E_ZIP_ARCHIVE_OK;
+}
+
+/*
+ * Read the sizes and offset too large for an entry's central-directory header
+ * from its zip64 extra-field, in the order they're stored.
+ */
+
+static bool
+parse_zip64_extra_field(const uint8_t *__notnull iter,
+                        const uint8_t *__notnull const end,
+                        struct zip_archive_entry *__notnull const entry)
+{
+    while (end - iter >= 4) {
+        const uint16_t id = read_uint16(iter);
+        const uint16_t size = read_uint16(iter + 2);
+
+        iter += 4;
+        if ((uint64_t)(end - iter) < size) {
+            return false;
+        }
+
+        if (id != ZIP64_EXTRA_FIELD_ID) {
+            iter += size;
+            continue;
+        }
+
+        const uint8_t *field = iter;
+        const uint8_t *const field_end = iter + size;
+
+        uint64_t *const values[] = {
+            &entry->size,
+            &entry->compressed_size,
+            &entry->local_header_offset
+        };
+
+        for (uint64_t i = 0; i != sizeof(values) / sizeof(*values); i++) {
+            if (*values[i] != UINT32_MAX) {
+                continue;
+            }
+
+            if (field_end - field < 8) {
+                return false;
+            }
+
+            *values[i] = read_uint64(field);
+            field += 8;
+        }
+
+        return true;
+    }
+
+    return true;
+}
+
+enum zip_archive_result
+zip_archive_iterate(struct zip_archive *__notnull const archive,
+                    const zip_archive_entry_callback callback,
+                    void *const cb_info)
+{
+    const uint8_t *iter = archive->central_directory;
+    const uint8_t *const end = iter + archive->central_directory_size;
+
+    for (uint64_t i = 0; i != archive->entries_count; i++) {
+        if ((uint64_t)(end - iter) < CENTRAL_HEADER_SIZE) {
+            return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+        }
+
+        if (read_uint32(iter) != CENTRAL_HEADER_SIGNATURE) {
+            return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+        }
+
+        const uint64_t path_length = read_uint16(iter + 28);
+        const uint64_t extra_length = read_uint16(iter + 30);
+        const uint64_t comment_length = read_uint16(iter + 32);
+
+        const uint64_t header_size =
+            CENTRAL_HEADER_SIZE + path_length + extra_length + comment_length;
+
+        if ((uint64_t)(end - iter) < header_size) {
+            return E_ZIP_ARCHIVE_INVALID_CENTRAL_DIRECTORY;
+        }
+
+        struct zip_archive_entry entry = {
+            .path = (const char *)(iter + CENTRAL_HEADER_SIZE),
+            .path_length = path_length,
+
+            .compressed_size = read_uint32(iter + 20),
+            .size = read_uint32(iter + 24),
+            .local_header_offset = read_uint32(iter + 42),
+
+            .crc32 = read_uint32(iter + 16),
+            .external_attributes = read_uint32(iter + 38),
+
+            .method = read_uint16(iter + 10),
+            .flags = read_uint16(iter + 8),
+            .version_made_by = read_uint16(iter + 4)
+        };
+
+        const uint8_t *const extra = iter + CENTRAL_HEADER_SIZE + path_length;
+        if (!parse_zip64_extra_field(extra, extra + extra_length, &entry)) {
+            return E_ZIP_ARCHIVE_INVALID_ENTRY;
+        }
+
+        if (!callback(archive, &entry, cb_info)) {
+            break;
+        }
+
+        iter += header_size;
+    }
+
+    return E_ZIP_ARCHIVE_OK;
+}
+
+bool
+zip_archive_entry_is_file(const struct zip_archive_entry *__notnull const entry)
+{
+    const uint64_t path_length = entry->path_length;
+    if (path_length == 0 || entry->path[path_length - 1] == '/') {
+        return false;
+    }
+
+    /*
+     * Archives created on unix store the file's mode in the upper half of the
+     * external-attributes, though some archivers leave out the file's type.
+     */
+
+    if ((entry->version_made_by >> 8) == UNIX_HOST) {
+        const mode_t mode = (mode_t)(entry->external_attributes >> 16);
+        if ((mode & S_IFMT) != 0 && !S_ISREG(mode)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Find where entry's data begins, after its local-header, which may have a
+ * different extra-field than its central-directory header.
+ */
+
+static enum zip_archive_result
+get_entry_data_offset(const struct zip_archive *__notnull const archive,
+                      const struct zip_archive_entry *__notnull const entry,
+                      uint64_t *__notnull const offset_out)
+{
+    if (entry->flags & FLAG_ENCRYPTED) {
+        return E_ZIP_ARCHIVE_ENCRYPTED_ENTRY;
+    }
+
+    if (entry->method != METHOD_STORED && entry->method != METHOD_DEFLATED) {
+        return E_ZIP_ARCHIVE_UNSUPPORTED_METHOD;
+    }
+
+    const uint64_t header_offset = entry->local_header_offset;
+    if (archive->size < LOCAL_HEADER_SIZE ||
+        header_offset > archive->size - LOCAL_HEADER_SIZE)
+    {
+        return E_ZIP_ARCHIVE_INVALID_ENTRY;
+    }
+
+    uint8_t header[30];
+    if (!pread_all(archive->fd, header, sizeof(header), header_offset)) {
+        return E_ZIP_ARCHIVE_READ_FAIL;
+    }
+
+    if (read_uint32(header) != LOCAL_HEADER_SIGNATURE) {
+        return E_ZIP_ARCHIVE_INVALID_ENTRY;
+    }
+
+    const uint64_t path_length = read_uint16(header + 26);
+    const uint64_t extra_length = read_uint16(header + 28);
+
+    const uint64_t data_offset =
+        header_offset + LOCAL_HEADER_SIZE + path_length + extra_length;
+
+    if (data_offset > archive->size ||
+        entry->compressed_size > archive->size - data_offset)
+    {
+        return E_ZIP_ARCHIVE_INVALID_ENTRY;
+    }
+
+    if (entry->method == METHOD_STORED &&
+        entry->compressed_size != entry->size)
+    {
+        return E_ZIP_ARCHIVE_INVALID_ENTRY;
+    }
+
+    *offset_out = data_offset;
+    return E_ZIP_ARCHIVE_OK;
+}
+
+enum zip_archive_result
+zip_archive_read_entry_head(
+    const struct zip_archive *__notnull const archive,
+    const struct zip_archive_entry *__notnull const entry,
+    void *__notnull const buf,
+    uint64_t size,
+    uint64_t *__notnull const size_out)
+{
+    uint64_t data_offset = 0;
+    const enum zip_archive_result get_offset_result =
+        get_entry_data_offset(archive, entry, &data_offset);
+
+    if (get_offset_result != E_ZIP_ARCHIVE_OK) {
+        return get_offset_result;
+    }
+
+    if (size > entry->size) {
+        size = entry->size;
+    }
+
+    if (entry->method == METHOD_STORED) {
+        if (!pread_all(archive->fd, buf, size, data_offset)) {
+            return E_ZIP_ARCHIVE_READ_FAIL;
+        }
+
+        *size_out = size;
+        return E_ZIP_ARCHIVE_OK;
+    }
+
+    /*
+     * Only a little of the compressed data is needed for the first few bytes,
+     * so it's read in small chunks.
+     */
+
+    uint8_t input[4096];
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return E_ZIP_ARCHIVE_ALLOC_FAIL;
+    }
+
+    stream.next_out = (Bytef *)buf;
+    stream.avail_out = (uInt)size;
+
+    uint64_t input_offset = 0;
+    enum zip_archive_result ret = E_ZIP_ARCHIVE_OK;
+
+    while (stream.avail_out != 0) {
+        uint64_t input_size = entry->compressed_size - input_offset;
+        if (input_size == 0) {
+            ret = E_ZIP_ARCHIVE_INFLATE_FAIL;
+            break;
+        }
+
+        if (input_size > sizeof(input)) {
+            input_size = sizeof(input);
+        }
+
+        const uint64_t offset = data_offset + input_offset;
+        if (!pread_all(archive->fd, input, input_size, offset)) {
+            ret = E_ZIP_ARCHIVE_READ_FAIL;
+            break;
+        }
+
+        input_offset += input_size;
+
+        stream.next_in = input;
+        stream.avail_in = (uInt)input_size;
+
+        const int inflate_ret = inflate(&stream, Z_NO_FLUSH);
+        if (inflate_ret == Z_STREAM_END) {
+            break;
+        }
+
+        if (inflate_ret != Z_OK && inflate_ret != Z_BUF_ERROR) {
+            ret = E_ZIP_ARCHIVE_INFLATE_FAIL;
+            break;
+        }
+    }
+
+    *size_out = size - stream.avail_out;
+
+    inflateEnd(&stream);
+    return ret;
+}
+
+static enum zip_archive_result
+extract_stored(const struct zip_archive *__notnull const archive,
+               const struct zip_archive_entry *__notnull const entry,
+               const uint64_t data_offset,
+               uint8_t *__notnull const buffer,
+               const int fd,
+               uLong *__notnull const crc_out)
+{
+    uLong crc = *crc_out;
+    uint64_t offset = 0;
+
+    while (offset != entry->size) {
+        uint64_t size = entry->size - offset;
+        if (size > CHUNK_SIZE) {
+            size = CHUNK_SIZE;
+        }
+
+        if (!pread_all(archive->fd, buffer, size, data_offset + offset)) {
+            return E_ZIP_ARCHIVE_READ_FAIL;
+        }
+
+        if (our_write_all(fd, buffer, size) != 0) {
+            return E_ZIP_ARCHIVE_WRITE_FAIL;
+        }
+
+        crc = crc32(crc, buffer, (uInt)size);
+        offset += size;
+    }
+
+    *crc_out = crc;
+    return E_ZIP_ARCHIVE_OK;
+}
+
+static enum zip_archive_result
+extract_deflated(const struct zip_archive *__notnull const archive,
+                 const struct zip_archive_entry *__notnull const entry,
+                 const uint64_t data_offset,
+                 uint8_t *__notnull const buffer,
+                 const int fd,
+                 uLong *__notnull const crc_out)
+{
+    uint8_t *const input = buffer;
+    uint8_t *const output = buffer + CHUNK_SIZE;
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return E_ZIP_ARCHIVE_ALLOC_FAIL;
+    }
+
+    uLong crc = *crc_out;
+
+    uint64_t input_offset = 0;
+    uint64_t output_size = 0;
+
+    enum zip_archive_result ret = E_ZIP_ARCHIVE_OK;
+    int inflate_ret = Z_OK;
+
+    while (inflate_ret != Z_STREAM_END) {
+        uint64_t input_size = entry->compressed_size - input_offset;
+        if (input_size == 0) {
+            ret = E_ZIP_ARCHIVE_INFLATE_FAIL;
+            break;
+        }
+
+        if (input_size > CHUNK_SIZE) {
+            input_size = CHUNK_SIZE;
+        }
+
+        const uint64_t offset = data_offset + input_offset;
+        if (!pread_all(archive->fd, input, input_size, offset)) {
+            ret = E_ZIP_ARCHIVE_READ_FAIL;
+            break;
+        }
+
+        input_offset += input_size;
+
+        stream.next_in = input;
+        stream.avail_in = (uInt)input_size;
+
+        do {
+            stream.next_out = output;
+            stream.avail_out = (uInt)CHUNK_SIZE;
+
+            inflate_ret = inflate(&stream, Z_NO_FLUSH);
+            if (inflate_ret != Z_OK &&
+                inflate_ret != Z_STREAM_END &&
+                inflate_ret != Z_BUF_ERROR)
+            {
+                ret = E_ZIP_ARCHIVE_INFLATE_FAIL;
+                break;
+            }
+
+            const uint64_t size = CHUNK_SIZE - stream.avail_out;
+            if (our_write_all(fd, output, size) != 0) {
+                ret = E_ZIP_ARCHIVE_WRITE_FAIL;
+                break;
+            }
+
+            crc = crc32(crc, output, (uInt)size);
+            output_size += size;
+        } while (stream.avail_out == 0 && inflate_ret != Z_STREAM_END);
+
+        if (ret != E_ZIP_ARCHIVE_OK) {
+            break;
+        }
+    }
+
+    inflateEnd(&stream);
+    if (ret != E_ZIP_ARCHIVE_OK) {
+        return ret;
+    }
+
+    if (output_size != entry->size) {
+        return E_ZIP_ARCHIVE_INVALID_ENTRY;
+    }
+
+    *crc_out = crc;
+    return E_ZIP_ARCHIVE_OK;
+}
+
+enum zip_archive_result
+zip_archive_extract_entry(const struct zip_archive *__notnull const archive,
+                          const struct zip_archive_entry *__notnull const entry,
+                          const int fd)
+{
+    uint64_t data_offset = 0;
+    const enum zip_archive_result get_offset_result =
+        get_entry_data_offset(archive, entry, &data_offset);
+
+    if (get_offset_result != E_ZIP_ARCHIVE_OK) {
+        return get_offset_result;
+    }
+
+    /*
+     * Deflated entries use the first half of the buffer for compressed input,
+     * and the second half for decompressed output.
+     */
+
+    uint8_t *const buffer = malloc(CHUNK_SIZE * 2);
+    if (buffer == NULL) {
+        return E_ZIP_ARCHIVE_ALLOC_FAIL;
+    }
+
+    uLong crc = crc32(0, NULL, 0);
+    enum zip_archive_result ret = E_ZIP_ARCHIVE_OK;
+
+    if (entry->method == METHOD_STORED) {
+        ret = extract_stored(archive, entry, data_offset, buffer, fd, &crc);
+    } else {
+        ret = extract_deflated(archive, entry, data_offset, buffer, fd, &crc);
+    }
+
+    free(buffer);
+    if (ret != E_ZIP_ARCHIVE_OK) {
+        return ret;
+    }
+
+    if ((uint32_t)crc != entry->crc32) {
+        return E_ZIP_ARCHIVE_CRC_MISMATCH;
+    }
+
+    return E_ZIP_ARCHIVE_OK;
+}
+
+void zip_archive_destroy(struct zip_archive *__notnull const archive) {
+    free(archive->central_directory);
+
+    archive->central_directory = NULL;
+    archive->central_directory_size = 0;
+    archive->entries_count = 0;
+}
@@ -0,0 +1,120 @@
+#!/bin/sh
+#
+#  tests/check.sh
+#  tbd
+#
+#  Regression checks for the paths where a wrong answer is silent: parsing with
+#  several jobs, from stdin, from a split dyld_shared_cache, or from a zip
+#  archive must write out exactly what the plain path does, compressed and
+#  archived output must hold exactly the plain output, and the caches
+#  (--incremental, --cache-dir, --dsc-previous-cache) must be used when their
+#  inputs are unchanged, and must not be when they've changed.
+#
+#  Each feature's checks live in their own file in tests/checks, which are run
+#  in turn after the fixtures shared between them are written out. Files
+#  written by earlier versions of tbd, to be compared against, are kept in
+#  tests/expected.
+#
+#  Usage: tests/check.sh <path-to-tbd> <path-to-make_fixtures>
+#                        [path-to-tbd-of-another-version]
+#
+
+TBD="$1"
+MAKE_FIXTURES="$2"
+TBD_OTHER_VERSION="$3"
+CHECKS_DIR=$(dirname "$0")/checks
+
+if [ ! -x "$TBD" ] || [ ! -x "$MAKE_FIXTURES" ]; then
+    echo "Usage: $0 <path-to-tbd> <path-to-make_fixtures>" >&2
+    exit 1
+fi
+
+WORK_DIR=$(mktemp -d "${TMPDIR:-/tmp}/tbd-check.XXXXXX") || exit 1
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+FIXTURES="$WORK_DIR/fixtures"
+FAILED=0
+
+fail() {
+    echo "FAIL: $1" >&2
+    FAILED=1
+}
+
+pass() {
+    echo "PASS: $1"
+}
+
+# Run tbd, with no terminal to prompt the user on, failing the current check if
+# tbd itself fails.
+run_tbd() {
+    "$TBD" "$@" < /dev/null > "$WORK_DIR/tbd.log" 2>&1
+    status=$?
+
+    if [ $status -ne 0 ]; then
+        cat "$WORK_DIR/tbd.log" >&2
+    fi
+
+    return $status
+}
+
+# Compare two output directories, ignoring the manifests written out along with
+# them, as they record the paths of the inputs.
+same_outputs() {
+    diff -r -x '*.tbd-manifest' "$1" "$2" > "$WORK_DIR/diff.log" 2>&1
+}
+
+#
+# Fixtures
+#
+
+mkdir -p "$FIXTURES/tree" || exit 1
+
+i=0
+for dir in a b c a/d a/d/e b/f b/f/g c/h c/h/i c/h/i/j; do
+    mkdir -p "$FIXTURES/tree/$dir" || exit 1
+
+    for n in 1 2 3 4 5; do
+        i=$((i + 1))
+        "$MAKE_FIXTURES" dylib "$FIXTURES/tree/$dir/lib$i.dylib" \
+            "/usr/lib/libfixture$i.dylib" "$i" "$i" || exit 1
+    done
+
+    echo "not a mach-o file" > "$FIXTURES/tree/$dir/README"
+done
+
+"$MAKE_FIXTURES" fat "$FIXTURES/tree/a/libfat.dylib" \
+    /usr/lib/libfixturefat.dylib 7 || exit 1
+
+"$MAKE_FIXTURES" fat "$FIXTURES/fat.dylib" /usr/lib/libfixturefat.dylib 3 || \
+    exit 1
+
+"$MAKE_FIXTURES" dsc "$FIXTURES/dyld_shared_cache_v1" 1 || exit 1
+"$MAKE_FIXTURES" dsc "$FIXTURES/dyld_shared_cache_v2" 2 || exit 1
+
+# The .tbd files of the tree, as written out by a plain run with a single job,
+# which the other runs are compared against.
+REFERENCE="$WORK_DIR/reference"
+
+if ! run_tbd -p -r all -j 1 "$FIXTURES/tree" -o --preserve-subdirs \
+    "$REFERENCE"
+then
+    echo "Failed to parse the fixtures" >&2
+    exit 1
+fi
+
+count=$(find "$REFERENCE" -name '*.tbd' | wc -l)
+if [ "$count" -ne 51 ]; then
+    echo "Parsing the fixtures wrote $count .tbd files, expected 51" >&2
+    exit 1
+fi
+
+for check in "$CHECKS_DIR"/*.sh; do
+    . "$check"
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo "Some checks failed" >&2
+    exit 1
+fi
+
+echo "All checks passed"
@@ -0,0 +1,122 @@
+#
+#  tests/checks/cache_dir.sh
+#  tbd
+#
+#  With --cache-dir, the .tbd files written out must be the same on a miss and
+#  on a hit, a copy of a cached library must be written out from the cache, and
+#  a library with a new uuid must be parsed. Entries written by a build of tbd
+#  with another version must not be used.
+#
+
+check_cache_dir() {
+    cache="$WORK_DIR/cache"
+    tree="$WORK_DIR/cache-tree"
+    out="$WORK_DIR/cache-out"
+
+    # A first run fills the cache, and must write out what a run without it
+    # does.
+    if ! run_tbd -p -r all -j 4 --cache-dir "$cache" "$FIXTURES/tree" \
+        -o --preserve-subdirs "$out-miss"
+    then
+        fail "--cache-dir run with an empty cache"
+        return
+    fi
+
+    if ! same_outputs "$REFERENCE" "$out-miss"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "--cache-dir with an empty cache differs from a run without it"
+        return
+    fi
+
+    # A second run must write out the same .tbd files from the cache.
+    if ! run_tbd -p -r all -j 4 --cache-dir "$cache" "$FIXTURES/tree" \
+        -o --preserve-subdirs "$out-hit"
+    then
+        fail "--cache-dir run with a filled cache"
+        return
+    fi
+
+    if ! same_outputs "$REFERENCE" "$out-hit"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "--cache-dir with a filled cache differs from a run without it"
+        return
+    fi
+
+    pass "--cache-dir writes out the same .tbd files on a miss and on a hit"
+
+    # A library with the uuid of a cached library, but other symbols, is only
+    # written out with those of the cached library if the cache is used.
+    mkdir -p "$tree/hit" "$tree/miss" || exit 1
+
+    "$MAKE_FIXTURES" dylib "$tree/hit/lib1.dylib" /usr/lib/libfixture1.dylib \
+        1 90 || exit 1
+
+    "$MAKE_FIXTURES" dylib "$tree/miss/lib1.dylib" /usr/lib/libfixture1.dylib \
+        91 90 || exit 1
+
+    if ! run_tbd -p -r all --cache-dir "$cache" "$tree" -o --preserve-subdirs \
+        "$out"
+    then
+        fail "--cache-dir run with a copy of a cached library"
+        return
+    fi
+
+    if ! cmp -s "$out/hit/lib1.dylib.tbd" "$REFERENCE/a/lib1.dylib.tbd"
+    then
+        fail "--cache-dir didn't use the cache for a cached uuid"
+    else
+        pass "--cache-dir uses the cache for a cached uuid"
+    fi
+
+    if ! grep -q _fixture_90_1 "$out/miss/lib1.dylib.tbd"; then
+        fail "--cache-dir used the cache for a new uuid"
+    else
+        pass "--cache-dir parses libraries with new uuids"
+    fi
+}
+
+
+check_cache_dir_version() {
+    if [ -z "$TBD_OTHER_VERSION" ]; then
+        echo "SKIP: --cache-dir with another version of tbd (no build provided)"
+        return
+    fi
+
+    cache="$WORK_DIR/cache-version"
+    tree="$WORK_DIR/cache-version-tree"
+    out="$WORK_DIR/cache-version-out"
+
+    mkdir -p "$tree/first" "$tree/second" || exit 1
+
+    # The second library has the uuid of the first, but other symbols, so its
+    # .tbd only matches the first's if it's served from the cache.
+    "$MAKE_FIXTURES" dylib "$tree/first/lib1.dylib" /usr/lib/libfixture1.dylib \
+        1 1 || exit 1
+
+    if ! run_tbd -p -r all --cache-dir "$cache" "$tree/first" -o "$out-first"
+    then
+        fail "--cache-dir run filling the cache"
+        return
+    fi
+
+    "$MAKE_FIXTURES" dylib "$tree/second/lib1.dylib" \
+        /usr/lib/libfixture1.dylib 1 90 || exit 1
+
+    "$TBD_OTHER_VERSION" -p -r all --cache-dir "$cache" "$tree/second" \
+        -o "$out-second" < /dev/null > "$WORK_DIR/tbd.log" 2>&1
+
+    if [ $? -ne 0 ]; then
+        cat "$WORK_DIR/tbd.log" >&2
+        fail "--cache-dir run with another version of tbd"
+        return
+    fi
+
+    if ! grep -q _fixture_90_1 "$out-second/lib1.dylib.tbd"; then
+        fail "--cache-dir used an entry written by another version of tbd"
+    else
+        pass "--cache-dir misses entries written by another version of tbd"
+    fi
+}
+
+check_cache_dir
+check_cache_dir_version
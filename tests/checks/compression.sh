@@ -0,0 +1,78 @@
+#
+#  tests/checks/compression.sh
+#  tbd
+#
+#  A combined .tbd file, or a .tbd written to stdout, compressed with --gzip or
+#  --zstd must decompress to exactly what's written out without compression.
+#  --zstd is only checked when tbd was built with zstd support, and when the
+#  zstd tool is around to decompress with.
+#
+
+# Check that <compressed> decompresses, with the command given after it, to
+# exactly <expected>.
+check_decompresses_to() {
+    compressed="$1"
+    expected="$2"
+    name="$3"
+    shift 3
+
+    if ! "$@" < "$compressed" > "$WORK_DIR/decompressed" 2>&1; then
+        cat "$WORK_DIR/decompressed" >&2
+        fail "$name didn't write out valid compressed data"
+    elif ! cmp -s "$WORK_DIR/decompressed" "$expected"; then
+        fail "$name doesn't decompress to the uncompressed output"
+    else
+        pass "$name decompresses to the uncompressed output"
+    fi
+}
+
+check_compression() {
+    flag="$1"
+    shift
+
+    combined="$WORK_DIR/combined.tbd"
+    if ! run_tbd -p -r all -j 1 "$FIXTURES/tree" -o --combine-tbds \
+        "$combined"
+    then
+        fail "writing out a combined .tbd file"
+        return
+    fi
+
+    if ! run_tbd -p -r all -j 1 "$FIXTURES/tree" -o --combine-tbds "$flag" \
+        "$combined.$flag"
+    then
+        fail "writing out a combined .tbd file with $flag"
+        return
+    fi
+
+    check_decompresses_to "$combined.$flag" "$combined" \
+        "a combined .tbd file written with $flag" "$@"
+
+    stdout="$WORK_DIR/stdout.tbd"
+    if ! "$TBD" -p "$FIXTURES/fat.dylib" -o stdout < /dev/null > "$stdout"; then
+        fail "writing out a .tbd to stdout"
+        return
+    fi
+
+    if ! "$TBD" -p "$FIXTURES/fat.dylib" -o "$flag" stdout < /dev/null > \
+        "$stdout.$flag"
+    then
+        fail "writing out a .tbd to stdout with $flag"
+        return
+    fi
+
+    check_decompresses_to "$stdout.$flag" "$stdout" \
+        "a .tbd written to stdout with $flag" "$@"
+}
+
+check_compression --gzip gzip -dc
+
+if "$TBD" -p "$FIXTURES/fat.dylib" -o --zstd stdout < /dev/null 2>&1 | \
+    grep -q "doesn't support zstd"
+then
+    echo "SKIP: --zstd, as tbd was built without zstd support"
+elif ! command -v zstd > /dev/null 2>&1; then
+    echo "SKIP: --zstd, as the zstd tool wasn't found"
+else
+    check_compression --zstd zstd -dc
+fi
@@ -0,0 +1,70 @@
+#
+#  tests/checks/dsc_merge_cache.sh
+#  tbd
+#
+#  With --dsc-merge-cache, the images of a dyld_shared_cache of another
+#  architecture must be merged into the .tbd files of the images with the same
+#  install-name, with a target for each architecture, and a dyld_shared_cache of
+#  an architecture already being merged must be rejected.
+#
+
+check_dsc_merge_cache() {
+    arm64_dsc="$WORK_DIR/dyld_shared_cache_arm64"
+    other_x86_64_dsc="$WORK_DIR/dyld_shared_cache_x86_64_other"
+
+    "$MAKE_FIXTURES" dsc "$arm64_dsc" 1 arm64 || return
+    "$MAKE_FIXTURES" dsc "$other_x86_64_dsc" 2 x86_64 || return
+
+    out="$WORK_DIR/dsc-merge"
+    if ! run_tbd -p --dsc-merge-cache "$arm64_dsc" \
+        "$FIXTURES/dyld_shared_cache_v1" -o "$out"
+    then
+        fail "parsing with --dsc-merge-cache"
+        return
+    fi
+
+    count=$(find "$out" -type f -name '*.tbd' | wc -l)
+    if [ "$count" -ne 3 ]; then
+        fail "--dsc-merge-cache wrote out $count .tbd files, expected 3"
+        return
+    fi
+
+    # Both architectures have the same symbols, so every export is listed for
+    # both.
+    find "$out" -type f -name '*.tbd' > "$WORK_DIR/merged.list"
+
+    merged=yes
+    while IFS= read -r tbd; do
+        if ! grep -q '^archs: *\[ x86_64, arm64 \]' "$tbd" ||
+           ! grep -q "x86_64: " "$tbd" ||
+           ! grep -q "arm64: " "$tbd" ||
+           grep -q '^  - archs: *\[ x86_64 \]' "$tbd" ||
+           grep -q '^  - archs: *\[ arm64 \]' "$tbd"
+        then
+            cat "$tbd" >&2
+            merged=no
+        fi
+    done < "$WORK_DIR/merged.list"
+
+    if [ $merged = yes ]; then
+        pass "--dsc-merge-cache writes out a target for each architecture"
+    else
+        fail "--dsc-merge-cache didn't merge the images of both architectures"
+    fi
+
+    out="$WORK_DIR/dsc-merge-duplicate"
+    run_tbd -p --dsc-merge-cache "$other_x86_64_dsc" \
+        "$FIXTURES/dyld_shared_cache_v1" -o "$out"
+
+    if ! grep -q "has the same architecture" "$WORK_DIR/tbd.log"; then
+        cat "$WORK_DIR/tbd.log" >&2
+        fail "--dsc-merge-cache didn't reject a duplicate architecture"
+    elif [ -n "$(find "$out" -type f 2> /dev/null)" ]; then
+        fail "--dsc-merge-cache wrote out .tbd files for a duplicate \
+architecture"
+    else
+        pass "--dsc-merge-cache rejects a duplicate architecture"
+    fi
+}
+
+check_dsc_merge_cache
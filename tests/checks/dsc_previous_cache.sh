@@ -0,0 +1,68 @@
+#
+#  tests/checks/dsc_previous_cache.sh
+#  tbd
+#
+#  With --dsc-previous-cache, the images of a dyld_shared_cache left unchanged
+#  since the previous dyld_shared_cache must be skipped, changed images must be
+#  extracted, and every image must be extracted when the options changed.
+#
+
+check_dsc_previous_cache() {
+    out="$WORK_DIR/dsc-previous"
+    expected="$WORK_DIR/dsc-v2"
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v2" -o "$expected"; then
+        fail "parsing the second dyld_shared_cache"
+        return
+    fi
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o --incremental "$out"
+    then
+        fail "parsing the first dyld_shared_cache with --incremental"
+        return
+    fi
+
+    # The .tbd files of unchanged images are kept, so markers written over
+    # them are only kept if those images are skipped.
+    unchanged="$out/usr/lib/libfixture_a.dylib.tbd"
+    changed="$out/usr/lib/libfixture_b.dylib.tbd"
+
+    echo marker > "$unchanged"
+    echo marker > "$changed"
+
+    if ! run_tbd -p --dsc-previous-cache "$FIXTURES/dyld_shared_cache_v1" \
+        "$FIXTURES/dyld_shared_cache_v2" -o "$out"
+    then
+        fail "parsing with --dsc-previous-cache"
+        return
+    fi
+
+    if [ "$(cat "$unchanged")" != marker ]; then
+        fail "--dsc-previous-cache extracted an unchanged image again"
+    else
+        pass "--dsc-previous-cache skips unchanged images"
+    fi
+
+    if ! cmp -s "$changed" "$expected/usr/lib/libfixture_b.dylib.tbd"; then
+        fail "--dsc-previous-cache didn't extract a changed image again"
+    else
+        pass "--dsc-previous-cache extracts changed images"
+    fi
+
+    # Options other than those the previous cache was extracted with make
+    # every image be extracted again.
+    if ! run_tbd -p --dsc-previous-cache "$FIXTURES/dyld_shared_cache_v1" \
+        --ignore-uuids "$FIXTURES/dyld_shared_cache_v2" -o "$out"
+    then
+        fail "parsing with --dsc-previous-cache and other options"
+        return
+    fi
+
+    if [ "$(cat "$unchanged")" = marker ]; then
+        fail "--dsc-previous-cache kept an image extracted with other options"
+    else
+        pass "--dsc-previous-cache extracts every image with other options"
+    fi
+}
+
+check_dsc_previous_cache
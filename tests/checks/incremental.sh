@@ -0,0 +1,69 @@
+#
+#  tests/checks/incremental.sh
+#  tbd
+#
+#  With --incremental, inputs left unchanged since the last run must be
+#  skipped, changed inputs parsed again, and the outputs of removed inputs
+#  removed.
+#
+
+check_incremental() {
+    tree="$WORK_DIR/incremental-tree"
+    out="$WORK_DIR/incremental"
+
+    cp -R "$FIXTURES/tree" "$tree" || exit 1
+
+    if ! run_tbd -p -r all -j 4 "$tree" -o --preserve-subdirs --incremental \
+        "$out"
+    then
+        fail "first --incremental run"
+        return
+    fi
+
+    if ! same_outputs "$REFERENCE" "$out"; then
+        fail "first --incremental run differs from a normal run"
+        return
+    fi
+
+    # An unchanged input's .tbd is left as is, so a marker written over it is
+    # only kept if the input is skipped.
+    echo marker > "$out/a/lib1.dylib.tbd"
+
+    # Rewrite an input with different symbols, and remove another.
+    "$MAKE_FIXTURES" dylib "$tree/b/lib7.dylib" /usr/lib/libfixture7.dylib \
+        7 70 || exit 1
+
+    rm "$tree/c/lib12.dylib"
+
+    if ! run_tbd -p -r all -j 4 "$tree" -o --preserve-subdirs --incremental \
+        "$out"
+    then
+        fail "second --incremental run"
+        return
+    fi
+
+    if [ "$(cat "$out/a/lib1.dylib.tbd")" != marker ]; then
+        fail "--incremental parsed an unchanged input again"
+    else
+        pass "--incremental skips unchanged inputs"
+    fi
+
+    if [ -e "$out/c/lib12.dylib.tbd" ]; then
+        fail "--incremental kept the output of a removed input"
+    else
+        pass "--incremental removes the outputs of removed inputs"
+    fi
+
+    if ! run_tbd -p "$tree/b/lib7.dylib" -o "$WORK_DIR/lib7.tbd"; then
+        fail "parsing a changed input"
+        return
+    fi
+
+    if ! cmp -s "$WORK_DIR/lib7.tbd" "$out/b/lib7.dylib.tbd"; then
+        fail "--incremental didn't parse a changed input again"
+    else
+        pass "--incremental parses changed inputs again"
+    fi
+}
+
+check_incremental
@@ -0,0 +1,110 @@
+#
+#  tests/checks/jobs.sh
+#  tbd
+#
+#  Parsing with several jobs must write out exactly what parsing with a single
+#  job does, whether recursing, combining, parsing the architectures of a fat
+#  file, or extracting the images of a dyld_shared_cache.
+#
+
+check_jobs_recurse() {
+    jobs=$1
+    out_jobs="$WORK_DIR/recurse-j$jobs"
+
+    if ! run_tbd -p -r all -j "$jobs" "$FIXTURES/tree" -o --preserve-subdirs \
+        "$out_jobs"
+    then
+        fail "recursing with -j $jobs"
+        return
+    fi
+
+    if ! same_outputs "$REFERENCE" "$out_jobs"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "recursing with -j $jobs differs from -j 1"
+        return
+    fi
+
+    pass "recursing with -j $jobs matches -j 1"
+}
+
+check_jobs_combined() {
+    jobs=$1
+    out_serial="$WORK_DIR/combined-j1.tbd"
+    out_jobs="$WORK_DIR/combined-j$jobs.tbd"
+
+    if ! run_tbd -p -r all -j 1 "$FIXTURES/tree" -o --combine-tbds \
+        "$out_serial" ||
+       ! run_tbd -p -r all -j "$jobs" "$FIXTURES/tree" -o --combine-tbds \
+        "$out_jobs"
+    then
+        fail "combining while recursing with -j $jobs"
+        return
+    fi
+
+    if ! cmp -s "$out_serial" "$out_jobs"; then
+        fail "combining while recursing with -j $jobs differs from -j 1"
+        return
+    fi
+
+    pass "combining while recursing with -j $jobs matches -j 1"
+}
+
+check_jobs_fat() {
+    jobs=$1
+    out_serial="$WORK_DIR/fat-j1.tbd"
+    out_jobs="$WORK_DIR/fat-j$jobs.tbd"
+
+    if ! run_tbd -p -j 1 "$FIXTURES/fat.dylib" -o "$out_serial" ||
+       ! run_tbd -p -j "$jobs" "$FIXTURES/fat.dylib" -o "$out_jobs"
+    then
+        fail "parsing a fat file with -j $jobs"
+        return
+    fi
+
+    if ! grep -q arm64e "$out_serial"; then
+        fail "parsing a fat file with -j 1 is missing an architecture"
+        return
+    fi
+
+    if ! cmp -s "$out_serial" "$out_jobs"; then
+        diff "$out_serial" "$out_jobs" >&2
+        fail "parsing a fat file with -j $jobs differs from -j 1"
+        return
+    fi
+
+    pass "parsing a fat file with -j $jobs matches -j 1"
+}
+
+check_jobs_dsc() {
+    jobs=$1
+    out_serial="$WORK_DIR/dsc-j1"
+    out_jobs="$WORK_DIR/dsc-j$jobs"
+
+    if ! run_tbd -p -j 1 "$FIXTURES/dyld_shared_cache_v1" -o "$out_serial" ||
+       ! run_tbd -p -j "$jobs" "$FIXTURES/dyld_shared_cache_v1" -o "$out_jobs"
+    then
+        fail "parsing a dyld_shared_cache with -j $jobs"
+        return
+    fi
+
+    count=$(find "$out_serial" -name '*.tbd' | wc -l)
+    if [ "$count" -ne 3 ]; then
+        fail "parsing a dyld_shared_cache wrote $count .tbd files, expected 3"
+        return
+    fi
+
+    if ! same_outputs "$out_serial" "$out_jobs"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "parsing a dyld_shared_cache with -j $jobs differs from -j 1"
+        return
+    fi
+
+    pass "parsing a dyld_shared_cache with -j $jobs matches -j 1"
+}
+
+for jobs in 2 3 8; do
+    check_jobs_recurse $jobs
+    check_jobs_combined $jobs
+    check_jobs_fat $jobs
+    check_jobs_dsc $jobs
+done
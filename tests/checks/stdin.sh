@@ -0,0 +1,87 @@
+#
+#  tests/checks/stdin.sh
+#  tbd
+#
+#  Parsing "stdin" from a pipe must write out exactly what parsing the same file
+#  from its path does, both for a mach-o file and for a dyld_shared_cache, and
+#  for input large enough to be moved out of memory into a temporary file.
+#
+
+# Run tbd with the output of the command before it piped in as its input.
+run_tbd_piped() {
+    "$TBD" "$@" > "$WORK_DIR/tbd.log" 2>&1
+    status=$?
+
+    if [ $status -ne 0 ]; then
+        cat "$WORK_DIR/tbd.log" >&2
+    fi
+
+    return $status
+}
+
+check_stdin_macho() {
+    expected="$WORK_DIR/stdin-fat-expected.tbd"
+    out="$WORK_DIR/stdin-fat.tbd"
+
+    if ! run_tbd -p "$FIXTURES/fat.dylib" -o "$expected"; then
+        fail "parsing the fat file from its path"
+        return
+    fi
+
+    if ! cat "$FIXTURES/fat.dylib" | run_tbd_piped -p stdin -o "$out"; then
+        fail "parsing a piped fat file"
+        return
+    fi
+
+    if ! cmp -s "$out" "$expected"; then
+        fail "parsing a piped mach-o file doesn't match parsing its path"
+    else
+        pass "parsing a piped mach-o file matches parsing its path"
+    fi
+}
+
+check_stdin_dsc() {
+    expected="$WORK_DIR/stdin-dsc-expected"
+    out="$WORK_DIR/stdin-dsc"
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o "$expected"; then
+        fail "parsing the dyld_shared_cache from its path"
+        return
+    fi
+
+    if ! cat "$FIXTURES/dyld_shared_cache_v1" | \
+        run_tbd_piped -p stdin -o "$out"
+    then
+        fail "parsing a piped dyld_shared_cache"
+        return
+    fi
+
+    if ! same_outputs "$out" "$expected"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "parsing a piped dyld_shared_cache doesn't match parsing its path"
+    else
+        pass "parsing a piped dyld_shared_cache matches parsing its path"
+    fi
+
+    # Padding the dyld_shared_cache past the 64MiB kept in memory has the rest
+    # of it moved to a temporary file, which must be parsed all the same.
+    out="$WORK_DIR/stdin-dsc-large"
+
+    if ! { cat "$FIXTURES/dyld_shared_cache_v1";
+           dd if=/dev/zero bs=1048576 count=65 2>/dev/null; } | \
+        run_tbd_piped -p stdin -o "$out"
+    then
+        fail "parsing a large piped dyld_shared_cache"
+        return
+    fi
+
+    if ! same_outputs "$out" "$expected"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "parsing a large piped dyld_shared_cache doesn't match its path"
+    else
+        pass "parsing a large piped dyld_shared_cache matches parsing its path"
+    fi
+}
+
+check_stdin_macho
+check_stdin_dsc
@@ -0,0 +1,75 @@
+#
+#  tests/checks/subcaches.sh
+#  tbd
+#
+#  A split dyld_shared_cache, whose images are stored in subcaches next to the
+#  main cache-file, must be parsed exactly as the same dyld_shared_cache stored
+#  in a single file is, with the subcaches named either way they can be. The
+#  subcaches must be skipped when found on their own while recursing, and a
+#  missing subcache must be reported.
+#
+
+check_subcaches() {
+    dir="$WORK_DIR/split"
+    expected="$WORK_DIR/split-expected"
+
+    mkdir -p "$dir/v1" "$dir/v2" "$dir/missing"
+
+    "$MAKE_FIXTURES" split-dsc "$dir/v1/dyld_shared_cache_x86_64" 1 || return
+    "$MAKE_FIXTURES" split-dsc "$dir/v2/dyld_shared_cache_x86_64" 2 || return
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o "$expected"; then
+        fail "parsing the dyld_shared_cache"
+        return
+    fi
+
+    for version in 1 2; do
+        out="$WORK_DIR/split-v$version"
+        if ! run_tbd -p "$dir/v$version/dyld_shared_cache_x86_64" -o "$out"
+        then
+            fail "parsing a split dyld_shared_cache (entry version $version)"
+            continue
+        fi
+
+        if ! same_outputs "$out" "$expected"; then
+            cat "$WORK_DIR/diff.log" >&2
+            fail "a split dyld_shared_cache (entry version $version) doesn't \
+match the same dyld_shared_cache in one file"
+        else
+            pass "a split dyld_shared_cache (entry version $version) matches \
+the same dyld_shared_cache in one file"
+        fi
+    done
+
+    # Only the main cache-file is parsed while recursing, into a directory
+    # named after it.
+    out="$WORK_DIR/split-recurse"
+    if ! run_tbd -p -r all "$dir/v2" -o "$out"; then
+        fail "recursing a directory of a split dyld_shared_cache"
+        return
+    fi
+
+    if ! same_outputs "$out/dyld_shared_cache_x86_64.tbds" "$expected"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "recursing a split dyld_shared_cache parsed its subcaches alone"
+    else
+        pass "recursing a split dyld_shared_cache skips its subcaches"
+    fi
+
+    cp "$dir/v2/dyld_shared_cache_x86_64" "$dir/v2/dyld_shared_cache_x86_64.01" \
+        "$dir/missing/" || return
+
+    out="$WORK_DIR/split-missing"
+    run_tbd -p "$dir/missing/dyld_shared_cache_x86_64" -o "$out"
+
+    if ! grep -q "subcache" "$WORK_DIR/tbd.log"; then
+        cat "$WORK_DIR/tbd.log" >&2
+        fail "a missing subcache wasn't reported"
+    elif [ -n "$(find "$out" -type f 2> /dev/null)" ]; then
+        fail "a split dyld_shared_cache missing a subcache was written out"
+    else
+        pass "a missing subcache is reported"
+    fi
+}
+
+check_subcaches
@@ -0,0 +1,64 @@
+#
+#  tests/checks/tar.sh
+#  tbd
+#
+#  With --tar, the .tbd files of a dyld_shared_cache's images must be written
+#  into a tar archive as members named after each image's path, in the order of
+#  the images, holding exactly what's written out to a directory without --tar.
+#
+
+check_tar() {
+    archive="$WORK_DIR/dsc.tar"
+    expected="$WORK_DIR/tar-expected"
+    extracted="$WORK_DIR/tar-extracted"
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o "$expected"; then
+        fail "parsing the dyld_shared_cache"
+        return
+    fi
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o --tar "$archive"; then
+        fail "parsing the dyld_shared_cache with --tar"
+        return
+    fi
+
+    members=$(tar -tf "$archive" 2> /dev/null)
+    expected_members="usr/lib/libfixture_a.dylib.tbd
+usr/lib/libfixture_b.dylib.tbd
+System/Library/Frameworks/Fixture.framework/Fixture.tbd"
+
+    if [ "$members" != "$expected_members" ]; then
+        echo "$members" >&2
+        fail "--tar didn't write out the expected members"
+        return
+    fi
+
+    pass "--tar writes out a member for each image"
+
+    mkdir -p "$extracted"
+    if ! tar -xf "$archive" -C "$extracted"; then
+        fail "extracting the archive written with --tar"
+    elif ! same_outputs "$extracted" "$expected"; then
+        cat "$WORK_DIR/diff.log" >&2
+        fail "--tar members don't match the .tbd files written out without it"
+    else
+        pass "--tar members match the .tbd files written out without it"
+    fi
+
+    if ! run_tbd -p "$FIXTURES/dyld_shared_cache_v1" -o --tar --gzip \
+        "$archive.gz"
+    then
+        fail "parsing the dyld_shared_cache with --tar and --gzip"
+        return
+    fi
+
+    if [ "$(gzip -dc < "$archive.gz" | tar -tf - 2> /dev/null)" != \
+        "$expected_members" ]
+    then
+        fail "--tar with --gzip didn't write out the expected members"
+    else
+        pass "--tar with --gzip writes out a member for each image"
+    fi
+}
+
+check_tar
@@ -0,0 +1,67 @@
+#
+#  tests/checks/yaml_emitter.sh
+#  tbd
+#
+#  .tbd files written through the yaml-emitter must be byte-for-byte identical
+#  to those written by the stdio-based writer it replaced, for every .tbd
+#  version, and for every field a .tbd file can have.
+#
+#  The expected files in tests/expected/yaml_emitter were written by tbd as of
+#  the commit before the yaml-emitter was added, from the same fixtures, with
+#  the options listed in each case below.
+#
+
+EXPECTED_DIR=$(dirname "$0")/expected/yaml_emitter
+
+# Each case is a name, the fixture to parse, and the options to parse it with.
+yaml_emitter_cases() {
+    full="$WORK_DIR/full.dylib"
+    replaced="--replace-swift-version 5 --replace-objc-constraint retain_release"
+
+    for version in v1 v2 v3 v4; do
+        echo "fat-$version $FIXTURES/fat.dylib -v $version"
+        echo "full-$version $full -v $version"
+    done
+
+    echo "full-v3-replaced $full -v v3 $replaced --replace-current-version 2.3.4"
+    echo "full-v4-replaced $full -v v4 --replace-swift-version 5"
+    echo "dsc-v4 $FIXTURES/dyld_shared_cache_v1 -v v4"
+}
+
+check_yaml_emitter() {
+    "$MAKE_FIXTURES" full-dylib "$WORK_DIR/full.dylib" \
+        /usr/lib/libfixture_full.dylib 20 20 || return
+
+    yaml_emitter_cases > "$WORK_DIR/yaml_emitter.cases"
+
+    identical=yes
+    while read -r name fixture options; do
+        out="$WORK_DIR/yaml-emitter-$name"
+
+        # The options are split into separate arguments on purpose.
+        # shellcheck disable=SC2086
+        if ! run_tbd -p $options "$fixture" -o "$out"; then
+            fail "parsing $fixture with $options"
+            identical=no
+            continue
+        fi
+
+        if [ -d "$out" ]; then
+            if ! same_outputs "$out" "$EXPECTED_DIR/$name"; then
+                cat "$WORK_DIR/diff.log" >&2
+                fail "the .tbd files of $name differ from the previous writer's"
+                identical=no
+            fi
+        elif ! cmp -s "$out" "$EXPECTED_DIR/$name.tbd"; then
+            diff "$EXPECTED_DIR/$name.tbd" "$out" >&2
+            fail "the .tbd file of $name differs from the previous writer's"
+            identical=no
+        fi
+    done < "$WORK_DIR/yaml_emitter.cases"
+
+    if [ $identical = yes ]; then
+        pass "the yaml-emitter writes out what the previous writer did"
+    fi
+}
+
+check_yaml_emitter
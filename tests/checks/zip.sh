@@ -0,0 +1,121 @@
+#
+#  tests/checks/zip.sh
+#  tbd
+#
+#  With --zip, the mach-o members of a zip archive, stored or deflated, must be
+#  parsed exactly as the same files on disk are, a member whose checksum doesn't
+#  match its data must be reported and skipped, and same-named members of two
+#  archives must collide in a flattened output-directory just as same-named
+#  files of two directories do.
+#
+#  The archives are written with the zip tool, so these checks are skipped when
+#  it isn't installed.
+#
+
+check_zip() {
+    dir="$WORK_DIR/zip"
+    member=Payload/libzip.dylib
+
+    mkdir -p "$dir/one/Payload" "$dir/two/Payload" "$dir/archives" \
+        "$dir/corrupt" "$dir/expected"
+
+    "$MAKE_FIXTURES" dylib "$dir/one/$member" /usr/lib/libzip1.dylib 61 61 ||
+        return
+    "$MAKE_FIXTURES" dylib "$dir/two/$member" /usr/lib/libzip2.dylib 62 62 ||
+        return
+
+    # The first archive's member is stored, and the second's deflated. -X
+    # leaves out extra fields, so the stored data of the first's only member
+    # starts right after its name.
+    if ! (cd "$dir/one" && zip -q -X -0 ../archives/one.zip "$member") ||
+       ! (cd "$dir/two" && zip -q -X -9 ../archives/two.zip "$member")
+    then
+        fail "writing out the zip archives"
+        return
+    fi
+
+    for name in one two; do
+        if ! run_tbd -p "$dir/$name/$member" -o "$dir/expected/$name.tbd"
+        then
+            fail "parsing the members of the zip archives from disk"
+            return
+        fi
+    done
+
+    out="$dir/out"
+    if ! run_tbd -p --zip -r all "$dir/archives" -o --preserve-subdirs "$out"
+    then
+        fail "parsing the zip archives with --zip"
+        return
+    fi
+
+    if ! cmp -s "$out/one.zip/$member.tbd" "$dir/expected/one.tbd" ||
+       ! cmp -s "$out/two.zip/$member.tbd" "$dir/expected/two.tbd"
+    then
+        fail "--zip members don't match the same files parsed from disk"
+    else
+        pass "--zip members match the same files parsed from disk"
+    fi
+
+    # Without --preserve-subdirs, both members are written out to the same
+    # path, which one of them is left holding.
+    out="$dir/flat"
+    if ! run_tbd -p --zip -r all "$dir/archives" -o "$out"; then
+        fail "parsing the zip archives with --zip into a flat directory"
+        return
+    fi
+
+    count=$(find "$out" -type f -name '*.tbd' | wc -l)
+    if [ "$count" -ne 1 ]; then
+        fail "--zip wrote out $count .tbd files for colliding members"
+    elif ! cmp -s "$out/libzip.dylib.tbd" "$dir/expected/one.tbd" &&
+         ! cmp -s "$out/libzip.dylib.tbd" "$dir/expected/two.tbd"
+    then
+        fail "--zip wrote out neither colliding member"
+    else
+        pass "colliding --zip members are written out to a single path"
+    fi
+
+    out="$dir/flat-no-overwrite"
+    if ! run_tbd -p --zip -r all "$dir/archives" -o --no-overwrite "$out"; then
+        fail "parsing the zip archives with --zip and --no-overwrite"
+        return
+    fi
+
+    if ! grep -q "already exists" "$WORK_DIR/tbd.log"; then
+        fail "--no-overwrite didn't report colliding --zip members"
+    else
+        pass "--no-overwrite reports colliding --zip members"
+    fi
+
+    # Corrupt the last byte of the stored member's string-table padding, which
+    # leaves it a valid mach-o file, with only its checksum left to catch it.
+    cp "$dir/archives/one.zip" "$dir/corrupt/corrupt.zip" || return
+
+    size=$(wc -c < "$dir/one/$member")
+    offset=$((30 + ${#member} + size - 1))
+
+    printf 'X' | dd of="$dir/corrupt/corrupt.zip" bs=1 seek="$offset" \
+        conv=notrunc 2> /dev/null
+
+    out="$dir/corrupt-out"
+    if ! run_tbd -p --zip -r all "$dir/corrupt" -o "$out"; then
+        fail "parsing a corrupt zip archive with --zip"
+        return
+    fi
+
+    if ! grep -q "checksum doesn't match" "$WORK_DIR/tbd.log"; then
+        cat "$WORK_DIR/tbd.log" >&2
+        fail "--zip didn't report a member whose checksum doesn't match"
+    elif [ -n "$(find "$out" -type f -name '*.tbd' 2> /dev/null)" ]; then
+        fail "--zip wrote out a member whose checksum doesn't match"
+    else
+        pass "--zip skips a member whose checksum doesn't match"
+    fi
+}
+
+if command -v zip > /dev/null 2>&1; then
+    check_zip
+else
+    echo "SKIP: --zip, as the zip tool wasn't found"
+fi
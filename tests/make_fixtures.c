@@ -0,0 +1,801 @@
+//
+//  tests/make_fixtures.c
+//  tbd
+//
+//  Created by inoahdev on 10/16/20.
+//  Copyright © 2020 inoahdev. All rights reserved.
+//
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dyld_shared_cache_format.h"
+#include "mach/machine.h"
+#include "mach/vm_prot.h"
+#include "mach-o/fat.h"
+#include "mach-o/loader.h"
+#include "mach-o/nlist.h"
+#include "swap.h"
+
+/*
+ * Writes the small mach-o libraries, fat mach-o libraries, and
+ * dyld_shared_cache files that tests/check.sh parses.
+ *
+ * Every fixture is generated from a seed, so that two fixtures with the same
+ * seed are identical, and a fixture can be given the uuid of another while
+ * having different symbols.
+ */
+
+static const uint64_t IMAGE_MAX_SIZE = 4096;
+static const uint64_t SLICE_ALIGN = 12;
+
+static const uint32_t PLATFORM_MACOS_VALUE = 1;
+
+struct image_args {
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+
+    const char *install_name;
+
+    uint32_t uuid_seed;
+    uint32_t symbol_seed;
+
+    /*
+     * The symbol-table and string-table offsets of a dyld_shared_cache image
+     * are relative to the cache-file, not the image's header.
+     */
+
+    uint64_t base_offset;
+
+    /*
+     * Give the image every other field a .tbd can have: a parent-umbrella,
+     * clients, a re-export, objc symbols, a weak symbol, and an undefined
+     * symbol.
+     */
+
+    bool full;
+};
+
+static const char full_umbrella[] = "FixtureUmbrella";
+static const char *const full_clients[] = {
+    "FixtureClientA",
+    "FixtureClientB"
+};
+
+static const char full_reexport[] = "/usr/lib/libfixture_reexport.dylib";
+
+static const struct {
+    const char *name;
+    uint8_t n_type;
+    uint16_t n_desc;
+} full_symbols[] = {
+    { "_OBJC_CLASS_$_FixtureClass", N_SECT | N_EXT, 0 },
+    { "_OBJC_METACLASS_$_FixtureClass", N_SECT | N_EXT, 0 },
+    { "_OBJC_IVAR_$_FixtureClass._ivar", N_SECT | N_EXT, 0 },
+    { "_OBJC_EHTYPE_$_FixtureClass", N_SECT | N_EXT, 0 },
+    { "_fixture_weak", N_SECT | N_EXT, N_WEAK_DEF },
+    { "_fixture_undefined", N_UNDF | N_EXT, 0 }
+};
+
+static const uint32_t FULL_SYMBOL_COUNT =
+    sizeof(full_symbols) / sizeof(full_symbols[0]);
+
+static uint64_t align_up(const uint64_t value, const uint64_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static void fill_uuid(uint8_t uuid[16], const uint32_t seed) {
+    for (uint8_t i = 0; i != 16; i++) {
+        uuid[i] = (uint8_t)((seed * 31 + i * 17 + 1) & 0xff);
+    }
+
+    uuid[0] = (uint8_t)seed;
+    uuid[1] = (uint8_t)(seed >> 8);
+}
+
+/*
+ * Write a load-command holding a single string, such as LC_SUB_CLIENT, at
+ * iter, and return its size.
+ */
+
+static uint32_t
+write_string_command(uint8_t *const iter,
+                     const uint32_t cmd,
+                     const uint32_t string_offset,
+                     const char *const string)
+{
+    const uint64_t length = strlen(string) + 1;
+    const uint32_t cmdsize = (uint32_t)align_up(string_offset + length, 8);
+
+    struct load_command *const load_cmd = (struct load_command *)iter;
+
+    load_cmd->cmd = cmd;
+    load_cmd->cmdsize = cmdsize;
+
+    /*
+     * The string's offset is always the first field after cmdsize.
+     */
+
+    *(uint32_t *)(iter + sizeof(struct load_command)) = string_offset;
+    memcpy(iter + string_offset, string, length);
+
+    return cmdsize;
+}
+
+/*
+ * Write a 64-bit mach-o dylib into buffer, which must hold IMAGE_MAX_SIZE
+ * bytes, and return its size.
+ */
+
+static uint64_t write_image(uint8_t *const buffer, const struct image_args args)
+{
+    memset(buffer, 0, IMAGE_MAX_SIZE);
+
+    struct mach_header_64 *const header = (struct mach_header_64 *)buffer;
+
+    header->magic = MH_MAGIC_64;
+    header->cputype = args.cputype;
+    header->cpusubtype = args.cpusubtype;
+    header->filetype = MH_DYLIB;
+    header->ncmds = 4;
+    header->flags = MH_TWOLEVEL | MH_APP_EXTENSION_SAFE;
+
+    uint8_t *const load_commands = buffer + sizeof(*header);
+    uint8_t *iter = load_commands;
+
+    struct dylib_command *const id_cmd = (struct dylib_command *)iter;
+    iter +=
+        write_string_command(iter,
+                             LC_ID_DYLIB,
+                             sizeof(struct dylib_command),
+                             args.install_name);
+
+    id_cmd->dylib.current_version = 0x10000 + (args.symbol_seed << 8);
+    id_cmd->dylib.compatibility_version = 0x10000;
+
+    if (args.full) {
+        header->flags = MH_TWOLEVEL;
+
+        iter +=
+            write_string_command(iter,
+                                 LC_SUB_FRAMEWORK,
+                                 sizeof(struct sub_framework_command),
+                                 full_umbrella);
+
+        const uint32_t clients_count =
+            sizeof(full_clients) / sizeof(full_clients[0]);
+
+        for (uint32_t i = 0; i != clients_count; i++) {
+            iter +=
+                write_string_command(iter,
+                                     LC_SUB_CLIENT,
+                                     sizeof(struct sub_client_command),
+                                     full_clients[i]);
+        }
+
+        struct dylib_command *const reexport_cmd = (struct dylib_command *)iter;
+        iter +=
+            write_string_command(iter,
+                                 LC_REEXPORT_DYLIB,
+                                 sizeof(struct dylib_command),
+                                 full_reexport);
+
+        reexport_cmd->dylib.current_version = 0x10000;
+        reexport_cmd->dylib.compatibility_version = 0x10000;
+
+        header->ncmds += 2 + clients_count;
+    }
+
+    struct uuid_command *const uuid_cmd = (struct uuid_command *)iter;
+
+    uuid_cmd->cmd = LC_UUID;
+    uuid_cmd->cmdsize = sizeof(struct uuid_command);
+
+    fill_uuid(uuid_cmd->uuid, args.uuid_seed);
+    iter += sizeof(struct uuid_command);
+
+    struct build_version_command *const build_cmd =
+        (struct build_version_command *)iter;
+
+    build_cmd->cmd = LC_BUILD_VERSION;
+    build_cmd->cmdsize = sizeof(struct build_version_command);
+    build_cmd->platform = PLATFORM_MACOS_VALUE;
+    build_cmd->minos = 0xa0f00;
+    build_cmd->sdk = 0xa0f00;
+
+    iter += sizeof(struct build_version_command);
+
+    struct symtab_command *const symtab_cmd = (struct symtab_command *)iter;
+    iter += sizeof(struct symtab_command);
+
+    header->sizeofcmds = (uint32_t)(iter - load_commands);
+
+    /*
+     * Every image exports _fixture_common, along with a few symbols unique to
+     * its symbol-seed.
+     */
+
+    const uint32_t seed_nsyms = 2 + (args.symbol_seed % 5);
+    const uint32_t nsyms =
+        seed_nsyms + ((args.full) ? FULL_SYMBOL_COUNT : 0);
+
+    const uint64_t symoff = align_up((uint64_t)(iter - buffer), 8);
+    const uint64_t stroff = symoff + sizeof(struct nlist_64) * nsyms;
+
+    struct nlist_64 *const symbols = (struct nlist_64 *)(buffer + symoff);
+    char *const strings = (char *)(buffer + stroff);
+
+    uint32_t strsize = 2;
+    strings[0] = ' ';
+
+    for (uint32_t i = 0; i != nsyms; i++) {
+        char *const name = strings + strsize;
+
+        symbols[i].n_un.n_strx = strsize;
+        symbols[i].n_type = N_SECT | N_EXT;
+        symbols[i].n_sect = 1;
+        symbols[i].n_value = 0x1000 + i * 16;
+
+        if (i == 0) {
+            strcpy(name, "_fixture_common");
+        } else if (i < seed_nsyms) {
+            sprintf(name, "_fixture_%" PRIu32 "_%" PRIu32, args.symbol_seed, i);
+        } else {
+            const uint32_t index = i - seed_nsyms;
+
+            strcpy(name, full_symbols[index].name);
+            symbols[i].n_type = full_symbols[index].n_type;
+            symbols[i].n_desc = full_symbols[index].n_desc;
+
+            if ((symbols[i].n_type & N_TYPE) == N_UNDF) {
+                symbols[i].n_sect = NO_SECT;
+                symbols[i].n_value = 0;
+            }
+        }
+
+        strsize += (uint32_t)strlen(name) + 1;
+    }
+
+    strsize = (uint32_t)align_up(strsize, 8);
+
+    symtab_cmd->cmd = LC_SYMTAB;
+    symtab_cmd->cmdsize = sizeof(struct symtab_command);
+    symtab_cmd->symoff = (uint32_t)(args.base_offset + symoff);
+    symtab_cmd->nsyms = nsyms;
+    symtab_cmd->stroff = (uint32_t)(args.base_offset + stroff);
+    symtab_cmd->strsize = strsize;
+
+    return stroff + strsize;
+}
+
+static int write_file(const char *const path, const void *const data,
+                      const uint64_t size)
+{
+    FILE *const file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to open %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    if (fwrite(data, 1, size, file) != size || fclose(file) != 0) {
+        fprintf(stderr, "Failed to write %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    return 0;
+}
+
+static int
+make_dylib(const char *const path,
+           const char *const install_name,
+           const uint32_t uuid_seed,
+           const uint32_t symbol_seed,
+           const bool full)
+{
+    uint8_t buffer[IMAGE_MAX_SIZE];
+    const struct image_args args = {
+        .cputype = CPU_TYPE_X86_64,
+        .cpusubtype = CPU_SUBTYPE_X86_64_ALL,
+        .install_name = install_name,
+        .uuid_seed = uuid_seed,
+        .symbol_seed = symbol_seed,
+        .full = full
+    };
+
+    const uint64_t size = write_image(buffer, args);
+    return write_file(path, buffer, size);
+}
+
+/*
+ * Write a fat mach-o library with one slice for each of the architectures
+ * below, each with its own uuid and a few symbols of its own.
+ */
+
+static int
+make_fat(const char *const path,
+         const char *const install_name,
+         const uint32_t seed)
+{
+    static const struct {
+        cpu_type_t cputype;
+        cpu_subtype_t cpusubtype;
+    } archs[] = {
+        { CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_ALL },
+        { CPU_TYPE_X86_64, CPU_SUBTYPE_X86_64_H },
+        { CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64_ALL },
+        { CPU_TYPE_ARM64, CPU_SUBTYPE_ARM64E }
+    };
+
+    const uint32_t count = sizeof(archs) / sizeof(archs[0]);
+    const uint64_t slice_size = 1ull << SLICE_ALIGN;
+    const uint64_t size = slice_size * (count + 1);
+
+    uint8_t *const map = calloc(1, size);
+    if (map == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return 1;
+    }
+
+    struct fat_header *const header = (struct fat_header *)map;
+
+    header->magic = swap_uint32(FAT_MAGIC);
+    header->nfat_arch = swap_uint32(count);
+
+    struct fat_arch *const fat_archs = (struct fat_arch *)(header + 1);
+    for (uint32_t i = 0; i != count; i++) {
+        const uint64_t offset = slice_size * (i + 1);
+        const struct image_args args = {
+            .cputype = archs[i].cputype,
+            .cpusubtype = archs[i].cpusubtype,
+            .install_name = install_name,
+            .uuid_seed = seed * 8 + i,
+            .symbol_seed = seed + i
+        };
+
+        const uint64_t image_size = write_image(map + offset, args);
+
+        fat_archs[i].cputype = (cpu_type_t)swap_uint32(archs[i].cputype);
+        fat_archs[i].cpusubtype =
+            (cpu_subtype_t)swap_uint32(archs[i].cpusubtype);
+
+        fat_archs[i].offset = swap_uint32((uint32_t)offset);
+        fat_archs[i].size = swap_uint32((uint32_t)image_size);
+        fat_archs[i].align = swap_uint32((uint32_t)SLICE_ALIGN);
+    }
+
+    const int result = write_file(path, map, size);
+    free(map);
+
+    return result;
+}
+
+static const char *const dsc_image_paths[] = {
+    "/usr/lib/libfixture_a.dylib",
+    "/usr/lib/libfixture_b.dylib",
+    "/System/Library/Frameworks/Fixture.framework/Fixture"
+};
+
+static const uint32_t DSC_IMAGE_COUNT =
+    sizeof(dsc_image_paths) / sizeof(dsc_image_paths[0]);
+
+static const uint64_t DSC_ADDRESS = 0x7fff20000000;
+
+struct dsc_arch {
+    const char *name;
+    char magic[16];
+
+    cpu_type_t cputype;
+    cpu_subtype_t cpusubtype;
+
+    /*
+     * Added to the uuid-seed of each image, so that the images of each
+     * architecture have their own uuids, while having the same symbols.
+     */
+
+    uint32_t uuid_seed_offset;
+};
+
+static const struct dsc_arch dsc_archs[] = {
+    {
+        "x86_64",
+        "dyld_v1  x86_64",
+        CPU_TYPE_X86_64,
+        CPU_SUBTYPE_X86_64_ALL,
+        0
+    },
+    {
+        "arm64",
+        "dyld_v1   arm64",
+        CPU_TYPE_ARM64,
+        CPU_SUBTYPE_ARM64_ALL,
+        200
+    }
+};
+
+static const struct dsc_arch *get_dsc_arch(const char *const name) {
+    const uint32_t count = sizeof(dsc_archs) / sizeof(dsc_archs[0]);
+    for (uint32_t i = 0; i != count; i++) {
+        if (strcmp(dsc_archs[i].name, name) == 0) {
+            return dsc_archs + i;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * For version 2, the second image is given a new uuid and different symbols,
+ * while the others are left unchanged.
+ */
+
+static struct image_args
+get_dsc_image_args(const struct dsc_arch *const arch,
+                   const uint32_t index,
+                   const uint32_t version,
+                   const uint64_t base_offset)
+{
+    const bool changed = (version != 1 && index == 1);
+    const struct image_args args = {
+        .cputype = arch->cputype,
+        .cpusubtype = arch->cpusubtype,
+        .install_name = dsc_image_paths[index],
+        .uuid_seed = arch->uuid_seed_offset + 100 + index + (changed ? 50 : 0),
+        .symbol_seed = 100 + index + (changed ? 3 : 0),
+        .base_offset = base_offset
+    };
+
+    return args;
+}
+
+/*
+ * Write a dyld_shared_cache of three images, mapped as a single mapping.
+ */
+
+static int
+make_dsc(const char *const path,
+         const uint32_t version,
+         const struct dsc_arch *const arch)
+{
+    const uint32_t count = DSC_IMAGE_COUNT;
+    const uint64_t address = DSC_ADDRESS;
+
+    const uint64_t mappings_offset = sizeof(struct dyld_cache_header);
+    const uint64_t images_offset =
+        mappings_offset + sizeof(struct dyld_cache_mapping_info);
+
+    const uint64_t paths_offset =
+        images_offset + sizeof(struct dyld_cache_image_info) * count;
+
+    const uint64_t slice_size = 1ull << SLICE_ALIGN;
+    const uint64_t size = slice_size * (count + 1);
+
+    uint8_t *const map = calloc(1, size);
+    if (map == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return 1;
+    }
+
+    struct dyld_cache_header *const header = (struct dyld_cache_header *)map;
+
+    memcpy(header->magic, arch->magic, 16);
+    header->mappingOffset = (uint32_t)mappings_offset;
+    header->mappingCount = 1;
+    header->imagesOffset = (uint32_t)images_offset;
+    header->imagesCount = count;
+
+    struct dyld_cache_mapping_info *const mapping =
+        (struct dyld_cache_mapping_info *)(map + mappings_offset);
+
+    mapping->address = address;
+    mapping->size = size;
+    mapping->maxProt = VM_PROT_READ;
+    mapping->initProt = VM_PROT_READ;
+
+    struct dyld_cache_image_info *const images =
+        (struct dyld_cache_image_info *)(map + images_offset);
+
+    uint64_t path_offset = paths_offset;
+    for (uint32_t i = 0; i != count; i++) {
+        const uint64_t offset = slice_size * (i + 1);
+        write_image(map + offset, get_dsc_image_args(arch, i, version, offset));
+
+        images[i].address = address + offset;
+        images[i].pathFileOffset = (uint32_t)path_offset;
+
+        const uint64_t path_length = strlen(dsc_image_paths[i]) + 1;
+
+        memcpy(map + path_offset, dsc_image_paths[i], path_length);
+        path_offset += path_length;
+    }
+
+    const int result = write_file(path, map, size);
+    free(map);
+
+    return result;
+}
+
+/*
+ * Write the same dyld_shared_cache as make_dsc() does for version 1 of x86_64,
+ * but split into a main cache-file at path, holding only the header,
+ * image-infos, and image-paths, and two subcaches next to it holding the
+ * images themselves, with the first two images in the first subcache, and the
+ * last in the second.
+ *
+ * With the first version of the subcache-array entries, the subcaches are
+ * named path.1 and path.2, and otherwise path.01 and path.02, as stored in
+ * each entry.
+ */
+
+static const uint32_t SPLIT_DSC_SUBCACHE_COUNT = 2;
+static const uint64_t SPLIT_DSC_SUBCACHE_VM_SIZE = 0x100000;
+
+static uint32_t get_split_dsc_subcache_of_image(const uint32_t index) {
+    return (index == DSC_IMAGE_COUNT - 1) ? 2 : 1;
+}
+
+static int
+make_split_dsc_subcache(const char *const path,
+                        const uint32_t subcache,
+                        const uint8_t uuid[16])
+{
+    const uint64_t slice_size = 1ull << SLICE_ALIGN;
+    const uint64_t vm_offset = SPLIT_DSC_SUBCACHE_VM_SIZE * subcache;
+
+    uint32_t image_count = 0;
+    for (uint32_t i = 0; i != DSC_IMAGE_COUNT; i++) {
+        if (get_split_dsc_subcache_of_image(i) == subcache) {
+            image_count++;
+        }
+    }
+
+    const uint64_t size = slice_size * (image_count + 1);
+    uint8_t *const map = calloc(1, size);
+
+    if (map == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return 1;
+    }
+
+    /*
+     * A subcache stores the same header as the main cache-file, but lists no
+     * images.
+     */
+
+    const uint64_t mappings_offset = 0x200;
+    struct dyld_cache_header *const header = (struct dyld_cache_header *)map;
+
+    memcpy(header->magic, "dyld_v1  x86_64", 16);
+    memcpy(map + DYLD_CACHE_HEADER_UUID_OFFSET, uuid, 16);
+
+    header->mappingOffset = (uint32_t)mappings_offset;
+    header->mappingCount = 1;
+
+    struct dyld_cache_mapping_info *const mapping =
+        (struct dyld_cache_mapping_info *)(map + mappings_offset);
+
+    mapping->address = DSC_ADDRESS + vm_offset;
+    mapping->size = size;
+    mapping->maxProt = VM_PROT_READ;
+    mapping->initProt = VM_PROT_READ;
+
+    uint64_t offset = slice_size;
+    for (uint32_t i = 0; i != DSC_IMAGE_COUNT; i++) {
+        if (get_split_dsc_subcache_of_image(i) != subcache) {
+            continue;
+        }
+
+        write_image(map + offset, get_dsc_image_args(dsc_archs, i, 1, offset));
+        offset += slice_size;
+    }
+
+    const int result = write_file(path, map, size);
+    free(map);
+
+    return result;
+}
+
+static int
+make_split_dsc(const char *const path, const uint32_t entry_version) {
+    const uint32_t count = DSC_IMAGE_COUNT;
+    const uint32_t subcache_count = SPLIT_DSC_SUBCACHE_COUNT;
+
+    /*
+     * The subcache-array entries only store a suffix once the header reaches
+     * the cacheSubType field, and the image-infos are then listed in the
+     * header's newer images field.
+     */
+
+    const bool has_suffixes = (entry_version != 1);
+    const uint64_t mappings_offset = (has_suffixes) ? 0x200 : 0x1c0;
+    const uint64_t entry_size =
+        (has_suffixes) ?
+            sizeof(struct dyld_subcache_entry) :
+            sizeof(struct dyld_subcache_entry_v1);
+
+    const uint64_t images_offset =
+        mappings_offset + sizeof(struct dyld_cache_mapping_info);
+
+    const uint64_t subcaches_offset =
+        images_offset + sizeof(struct dyld_cache_image_info) * count;
+
+    const uint64_t paths_offset = subcaches_offset + entry_size * subcache_count;
+    const uint64_t size = 1ull << SLICE_ALIGN;
+
+    uint8_t *const map = calloc(1, size);
+    if (map == NULL) {
+        fputs("Failed to allocate memory\n", stderr);
+        return 1;
+    }
+
+    struct dyld_cache_header *const header = (struct dyld_cache_header *)map;
+
+    memcpy(header->magic, "dyld_v1  x86_64", 16);
+    header->mappingOffset = (uint32_t)mappings_offset;
+    header->mappingCount = 1;
+
+    uint8_t uuid[16] = {};
+    fill_uuid(uuid, 900);
+
+    memcpy(map + DYLD_CACHE_HEADER_UUID_OFFSET, uuid, sizeof(uuid));
+
+    if (has_suffixes) {
+        struct dyld_cache_header_images *const images_field =
+            (struct dyld_cache_header_images *)
+                (map + DYLD_CACHE_HEADER_IMAGES_OFFSET);
+
+        images_field->imagesOffset = (uint32_t)images_offset;
+        images_field->imagesCount = count;
+    } else {
+        header->imagesOffset = (uint32_t)images_offset;
+        header->imagesCount = count;
+    }
+
+    struct dyld_cache_header_subcaches *const subcaches_field =
+        (struct dyld_cache_header_subcaches *)
+            (map + DYLD_CACHE_HEADER_SUBCACHES_OFFSET);
+
+    subcaches_field->subCacheArrayOffset = (uint32_t)subcaches_offset;
+    subcaches_field->subCacheArrayCount = subcache_count;
+
+    struct dyld_cache_mapping_info *const mapping =
+        (struct dyld_cache_mapping_info *)(map + mappings_offset);
+
+    mapping->address = DSC_ADDRESS;
+    mapping->size = size;
+    mapping->maxProt = VM_PROT_READ;
+    mapping->initProt = VM_PROT_READ;
+
+    /*
+     * Room for a suffix of up to three characters.
+     */
+
+    const uint64_t path_length = strlen(path);
+    char *const subcache_path = malloc(path_length + 4);
+
+    if (subcache_path == NULL) {
+        free(map);
+
+        fputs("Failed to allocate memory\n", stderr);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i != subcache_count; i++) {
+        const uint32_t subcache = i + 1;
+        uint8_t *const entry = map + subcaches_offset + entry_size * i;
+
+        fill_uuid(uuid, 900 + subcache);
+        memcpy(entry, uuid, sizeof(uuid));
+
+        const uint64_t vm_offset = SPLIT_DSC_SUBCACHE_VM_SIZE * subcache;
+        if (has_suffixes) {
+            struct dyld_subcache_entry *const subcache_entry =
+                (struct dyld_subcache_entry *)entry;
+
+            subcache_entry->cacheVMOffset = vm_offset;
+            sprintf(subcache_entry->fileSuffix, ".%02" PRIu32, subcache);
+            sprintf(subcache_path, "%s.%02" PRIu32, path, subcache);
+        } else {
+            ((struct dyld_subcache_entry_v1 *)entry)->cacheVMOffset = vm_offset;
+            sprintf(subcache_path, "%s.%" PRIu32, path, subcache);
+        }
+
+        if (make_split_dsc_subcache(subcache_path, subcache, uuid) != 0) {
+            free(subcache_path);
+            free(map);
+
+            return 1;
+        }
+    }
+
+    free(subcache_path);
+
+    struct dyld_cache_image_info *const images =
+        (struct dyld_cache_image_info *)(map + images_offset);
+
+    /*
+     * The offset of the next image within each subcache.
+     */
+
+    const uint64_t slice_size = 1ull << SLICE_ALIGN;
+    uint64_t image_offsets[SPLIT_DSC_SUBCACHE_COUNT + 1];
+
+    for (uint32_t i = 0; i != subcache_count + 1; i++) {
+        image_offsets[i] = slice_size;
+    }
+
+    uint64_t path_offset = paths_offset;
+    for (uint32_t i = 0; i != count; i++) {
+        const uint32_t subcache = get_split_dsc_subcache_of_image(i);
+
+        images[i].address =
+            DSC_ADDRESS +
+            SPLIT_DSC_SUBCACHE_VM_SIZE * subcache +
+            image_offsets[subcache];
+
+        images[i].pathFileOffset = (uint32_t)path_offset;
+        image_offsets[subcache] += slice_size;
+
+        const uint64_t image_path_length = strlen(dsc_image_paths[i]) + 1;
+
+        memcpy(map + path_offset, dsc_image_paths[i], image_path_length);
+        path_offset += image_path_length;
+    }
+
+    const int result = write_file(path, map, size);
+    free(map);
+
+    return result;
+}
+
+static void print_usage(void) {
+    fputs("Usage: make_fixtures dylib <path> <install-name> <uuid-seed> "
+          "<symbol-seed>\n"
+          "       make_fixtures full-dylib <path> <install-name> <uuid-seed> "
+          "<symbol-seed>\n"
+          "       make_fixtures fat <path> <install-name> <seed>\n"
+          "       make_fixtures dsc <path> <version> [x86_64|arm64]\n"
+          "       make_fixtures split-dsc <path> <entry-version>\n",
+          stderr);
+}
+
+int main(const int argc, const char *const argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    const char *const kind = argv[1];
+    const bool is_full_dylib = (strcmp(kind, "full-dylib") == 0);
+    if ((strcmp(kind, "dylib") == 0 || is_full_dylib) && argc == 6) {
+        return make_dylib(argv[2],
+                          argv[3],
+                          (uint32_t)strtoul(argv[4], NULL, 10),
+                          (uint32_t)strtoul(argv[5], NULL, 10),
+                          is_full_dylib);
+    }
+
+    if (strcmp(kind, "fat") == 0 && argc == 5) {
+        return make_fat(argv[2], argv[3], (uint32_t)strtoul(argv[4], NULL, 10));
+    }
+
+    if (strcmp(kind, "dsc") == 0 && (argc == 4 || argc == 5)) {
+        const struct dsc_arch *const arch =
+            (argc == 5) ? get_dsc_arch(argv[4]) : dsc_archs;
+
+        if (arch != NULL) {
+            return make_dsc(argv[2], (uint32_t)strtoul(argv[3], NULL, 10), arch);
+        }
+    }
+
+    if (strcmp(kind, "split-dsc") == 0 && argc == 4) {
+        return make_split_dsc(argv[2], (uint32_t)strtoul(argv[3], NULL, 10));
+    }
+
+    print_usage();
+    return 1;
+}